@@ -0,0 +1,379 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <enki/PhysicalEngine.h>
+#include <enki/WorldBatch.h>
+#include <enki/robots/e-puck/EPuck.h>
+#include <enki/robots/khepera/Khepera.h>
+#include <enki/robots/marxbot/Marxbot.h>
+#include <enki/robots/thymio2/Thymio2.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <stdexcept>
+#include <cstdlib>
+#include <cmath>
+
+/*!	\file enkiBatch.cpp
+	\brief Run a scenario for a range of seeds in parallel and write a summary of each run
+*/
+
+using namespace Enki;
+
+//! Robots of a given type in a scenario
+struct RobotGroup
+{
+	std::string type; //!< epuck, khepera, marxbot or thymio2
+	unsigned count; //!< number of robots
+	double leftSpeed; //!< speed of the left wheel
+	double rightSpeed; //!< speed of the right wheel
+};
+
+//! Balls in a scenario
+struct BallGroup
+{
+	unsigned count; //!< number of balls
+	double radius; //!< radius of balls
+	double mass; //!< mass of balls
+};
+
+//! A scenario, read from a text file
+struct Scenario
+{
+	World::WallsType walls; //!< type of walls
+	double width; //!< width of square arenas
+	double height; //!< height of square arenas
+	double radius; //!< radius of circular arenas
+	unsigned steps; //!< number of steps of each run
+	double dt; //!< duration of a step
+	unsigned oversampling; //!< physics oversampling
+	std::vector<RobotGroup> robots; //!< robots, placed randomly
+	std::vector<BallGroup> balls; //!< balls, placed randomly
+	
+	Scenario():
+		walls(World::WALLS_SQUARE),
+		width(100),
+		height(100),
+		radius(50),
+		steps(1000),
+		dt(0.1),
+		oversampling(1)
+	{}
+};
+
+//! Read a scenario, throw std::runtime_error on errors
+Scenario readScenario(const std::string& fileName)
+{
+	std::ifstream file(fileName.c_str());
+	if (!file)
+		throw std::runtime_error("cannot open scenario " + fileName);
+	
+	Scenario scenario;
+	std::string line;
+	unsigned lineNumber(0);
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+		const size_t comment(line.find('#'));
+		if (comment != std::string::npos)
+			line.erase(comment);
+		std::istringstream stream(line);
+		std::string keyword;
+		if (!(stream >> keyword))
+			continue;
+		
+		bool ok(true);
+		if (keyword == "arena")
+		{
+			std::string type;
+			stream >> type;
+			if (type == "square")
+			{
+				scenario.walls = World::WALLS_SQUARE;
+				ok = bool(stream >> scenario.width >> scenario.height);
+			}
+			else if (type == "circular")
+			{
+				scenario.walls = World::WALLS_CIRCULAR;
+				ok = bool(stream >> scenario.radius);
+			}
+			else if (type == "none")
+			{
+				// objects are placed in a square of width x height
+				scenario.walls = World::WALLS_NONE;
+				ok = bool(stream >> scenario.width >> scenario.height);
+			}
+			else
+				ok = false;
+		}
+		else if (keyword == "steps")
+			ok = bool(stream >> scenario.steps);
+		else if (keyword == "dt")
+			ok = bool(stream >> scenario.dt);
+		else if (keyword == "oversampling")
+			ok = bool(stream >> scenario.oversampling);
+		else if (keyword == "robot")
+		{
+			RobotGroup group;
+			ok = bool(stream >> group.type >> group.count >> group.leftSpeed >> group.rightSpeed);
+			ok = ok && (group.type == "epuck" || group.type == "khepera" || group.type == "marxbot" || group.type == "thymio2");
+			scenario.robots.push_back(group);
+		}
+		else if (keyword == "ball")
+		{
+			BallGroup group;
+			ok = bool(stream >> group.count >> group.radius >> group.mass);
+			scenario.balls.push_back(group);
+		}
+		else
+			ok = false;
+		
+		if (!ok)
+		{
+			std::ostringstream message;
+			message << fileName << ":" << lineNumber << ": invalid line \"" << line << "\"";
+			throw std::runtime_error(message.str());
+		}
+	}
+	return scenario;
+}
+
+//! Return a random position for an object of radius r in the arena of scenario
+Point randomPosition(const Scenario& scenario, double r)
+{
+	if (scenario.walls == World::WALLS_CIRCULAR)
+	{
+		const double distance((scenario.radius - r) * std::sqrt(Enki::random.getRange(1)));
+		const double angle(Enki::random.getRange(2 * M_PI));
+		return Point(distance * std::cos(angle), distance * std::sin(angle));
+	}
+	return Point(r + Enki::random.getRange(scenario.width - 2 * r), r + Enki::random.getRange(scenario.height - 2 * r));
+}
+
+//! Build the world of scenario for seed
+World* createWorld(const Scenario& scenario, unsigned long seed)
+{
+	World* world;
+	if (scenario.walls == World::WALLS_SQUARE)
+		world = new World(scenario.width, scenario.height);
+	else if (scenario.walls == World::WALLS_CIRCULAR)
+		world = new World(scenario.radius);
+	else
+		world = new World();
+	// also seeds the generator of this thread, used for placing objects
+	world->setRandomSeed(seed);
+	
+	for (size_t i = 0; i < scenario.robots.size(); ++i)
+	{
+		const RobotGroup& group(scenario.robots[i]);
+		for (unsigned j = 0; j < group.count; ++j)
+		{
+			DifferentialWheeled* robot;
+			if (group.type == "epuck")
+				robot = new EPuck;
+			else if (group.type == "khepera")
+				robot = new Khepera;
+			else if (group.type == "marxbot")
+				robot = new Marxbot;
+			else
+				robot = new Thymio2;
+			robot->pos = randomPosition(scenario, robot->getRadius());
+			robot->angle = Enki::random.getRange(2 * M_PI);
+			robot->leftSpeed = group.leftSpeed;
+			robot->rightSpeed = group.rightSpeed;
+			world->addObject(robot);
+		}
+	}
+	for (size_t i = 0; i < scenario.balls.size(); ++i)
+	{
+		const BallGroup& group(scenario.balls[i]);
+		for (unsigned j = 0; j < group.count; ++j)
+		{
+			PhysicalObject* ball = new PhysicalObject;
+			ball->setCylindric(group.radius, group.radius, group.mass);
+			ball->pos = randomPosition(scenario, group.radius);
+			world->addObject(ball);
+		}
+	}
+	return world;
+}
+
+//! Statistics of a run, updated after each step
+struct RunSummary
+{
+	unsigned long seed; //!< seed of this run
+	std::vector<Point> lastPositions; //!< positions of robots after the previous step
+	double distance; //!< distance travelled by all robots
+	
+	//! Accumulate the distance travelled by robots during the last step
+	bool update(World* world, unsigned step)
+	{
+		size_t i(0);
+		for (World::ObjectsIterator it = world->objects.begin(); it != world->objects.end(); ++it)
+		{
+			if (!dynamic_cast<Robot*>(*it))
+				continue;
+			if (i < lastPositions.size())
+				distance += ((*it)->pos - lastPositions[i]).norm();
+			else
+				lastPositions.push_back(Point());
+			lastPositions[i++] = (*it)->pos;
+		}
+		return true;
+	}
+};
+
+//! Print usage
+void usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " [options] SCENARIO FIRST_SEED LAST_SEED\n"
+		"Run SCENARIO for every seed in [FIRST_SEED, LAST_SEED] in parallel and write a summary of each run.\n"
+		"Options:\n"
+		"  -t, --threads N  number of threads, default is one per CPU\n"
+		"  -p, --pin        pin threads to CPUs and keep worlds on their NUMA node\n"
+		"  -l, --lockstep   step all worlds together instead of each one to completion\n"
+		"  -o, --output F   write summaries to F instead of the standard output\n"
+		"Scenarios are text files with one setting per line, # starts a comment:\n"
+		"  arena square WIDTH HEIGHT | arena circular RADIUS | arena none WIDTH HEIGHT\n"
+		"  steps N\n"
+		"  dt SECONDS\n"
+		"  oversampling N\n"
+		"  robot epuck|khepera|marxbot|thymio2 COUNT LEFT_SPEED RIGHT_SPEED\n"
+		"  ball COUNT RADIUS MASS\n";
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned threadCount(0);
+	bool pin(false);
+	bool lockstep(false);
+	std::string outputFileName;
+	std::vector<std::string> arguments;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg(argv[i]);
+		if ((arg == "-t" || arg == "--threads") && i + 1 < argc)
+			threadCount = strtoul(argv[++i], 0, 10);
+		else if (arg == "-p" || arg == "--pin")
+			pin = true;
+		else if (arg == "-l" || arg == "--lockstep")
+			lockstep = true;
+		else if ((arg == "-o" || arg == "--output") && i + 1 < argc)
+			outputFileName = argv[++i];
+		else if (arg == "-h" || arg == "--help")
+		{
+			usage(argv[0]);
+			return 0;
+		}
+		else if (!arg.empty() && arg[0] == '-')
+		{
+			usage(argv[0]);
+			return 1;
+		}
+		else
+			arguments.push_back(arg);
+	}
+	if (arguments.size() != 3)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+	
+	try
+	{
+		const Scenario scenario(readScenario(arguments[0]));
+		const unsigned long firstSeed(strtoul(arguments[1].c_str(), 0, 10));
+		const unsigned long lastSeed(strtoul(arguments[2].c_str(), 0, 10));
+		if (lastSeed < firstSeed)
+			throw std::runtime_error("LAST_SEED is smaller than FIRST_SEED");
+		const size_t runCount(lastSeed - firstSeed + 1);
+		
+		// build worlds in parallel, on the NUMA node of the threads stepping them
+		const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+		WorldBatch batch(threadCount, pin);
+		batch.createWorlds(runCount, [&](size_t index) { return createWorld(scenario, firstSeed + index); });
+		std::vector<RunSummary> summaries(runCount);
+		for (size_t i = 0; i < runCount; ++i)
+		{
+			summaries[i].seed = firstSeed + i;
+			summaries[i].distance = 0;
+			summaries[i].update(batch.getWorld(i), 0);
+			RunSummary* summary(&summaries[i]);
+			batch.setCallback(i, [summary](World* world, unsigned step) { return summary->update(world, step); });
+		}
+		
+		if (lockstep)
+		{
+			for (unsigned step = 0; step < scenario.steps; ++step)
+				batch.step(scenario.dt, scenario.oversampling);
+		}
+		else
+			batch.run(scenario.steps, scenario.dt, scenario.oversampling);
+		const double seconds(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		
+		// one line per run
+		std::ofstream outputFile;
+		if (!outputFileName.empty())
+		{
+			outputFile.open(outputFileName.c_str());
+			if (!outputFile)
+				throw std::runtime_error("cannot open output " + outputFileName);
+		}
+		std::ostream& output(outputFileName.empty() ? std::cout : outputFile);
+		output << "seed,steps,robots,mean_distance,mean_x,mean_y\n";
+		for (size_t i = 0; i < runCount; ++i)
+		{
+			const RunSummary& summary(summaries[i]);
+			const size_t robotCount(summary.lastPositions.size());
+			Point meanPosition(0, 0);
+			for (size_t j = 0; j < robotCount; ++j)
+				meanPosition += summary.lastPositions[j] / double(robotCount);
+			output << summary.seed << "," << batch.getStepCount(i) << "," << robotCount << ",";
+			output << (robotCount ? summary.distance / robotCount : 0) << "," << meanPosition.x << "," << meanPosition.y << "\n";
+		}
+		
+		std::cerr << runCount << " runs of " << scenario.steps << " steps in " << seconds << " s on " << batch.getThreadCount() << " threads";
+		std::cerr << " and " << batch.getNodeCount() << " NUMA nodes, " << (runCount * scenario.steps) / seconds << " world steps/s" << std::endl;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return 1;
+	}
+	
+	return 0;
+}
@@ -104,6 +104,11 @@ namespace Enki
 			return false;
 	}
 	
+	void BluetoothBase::removeAllClients()
+	{
+		clients.clear();
+	}
+	
 	bool BluetoothBase::bbSendDataTo(Bluetooth* source, unsigned address, char* data, unsigned size)
 	{
 		Bluetooth* destination = getAddress(address);
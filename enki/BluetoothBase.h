@@ -131,6 +131,8 @@ namespace Enki
 		bool registerClient(Bluetooth* owner, unsigned address);
 		//! Remove a previously registered Bluetooth module
 		bool removeClient(Bluetooth* owner);
+		//! Remove all registered Bluetooth modules, used by World::restoreState() before modules register again
+		void removeAllClients();
 		
 		//! Schedule a transmission of data to be sent during the next step
 		void sendDataTo(Bluetooth* source, unsigned address, char* data, unsigned size);
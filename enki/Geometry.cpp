@@ -391,4 +391,32 @@ namespace Enki
 		// ... and return true
 		return true;
 	}
+	
+	void sinCos(const double* angles, double* sines, double* cosines, size_t count)
+	{
+		// PI/2 split in three parts, the first two having enough trailing zeros for their products with the quadrant to be exact
+		const double piOver2A = 1.57079625129699707031;
+		const double piOver2B = 7.54978941586159635335e-8;
+		const double piOver2C = 5.39030285815811905290e-15;
+		
+		for (size_t i = 0; i < count; ++i)
+		{
+			// reduce to z in [-PI/4, PI/4], with angle = z + quadrant * PI/2
+			const double x = angles[i];
+			const double quadrant = std::floor(x * M_2_PI + 0.5);
+			const double z = ((x - quadrant * piOver2A) - quadrant * piOver2B) - quadrant * piOver2C;
+			const double zz = z * z;
+			
+			// minimax polynomials on [-PI/4, PI/4]
+			const double s = z + z * zz * (((((1.58962301576546568060e-10 * zz - 2.50507477628578072866e-8) * zz + 2.75573136213857245213e-6) * zz - 1.98412698295895385996e-4) * zz + 8.33333333332211858878e-3) * zz - 1.66666666666666307295e-1);
+			const double c = 1. - 0.5 * zz + zz * zz * (((((-1.13585365213876817300e-11 * zz + 2.08757008419747316778e-9) * zz - 2.75573141792967388112e-7) * zz + 2.48015872888517045348e-5) * zz - 1.38888888888730564116e-3) * zz + 4.16666666666665929218e-2);
+			
+			// rotate back by the quadrant: odd quadrants swap sine and cosine, quadrants 2 and 3 negate sine, 1 and 2 negate cosine
+			const long q = long(quadrant) & 3;
+			const double sinSign = 1. - double(q & 2);
+			const double cosSign = 1. - double((q + 1) & 2);
+			sines[i] = sinSign * ((q & 1) ? c : s);
+			cosines[i] = cosSign * ((q & 1) ? s : c);
+		}
+	}
 }
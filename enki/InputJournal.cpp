@@ -0,0 +1,295 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "InputJournal.h"
+#include <stdexcept>
+#include <cstring>
+
+/*!	\file InputJournal.cpp
+	\brief Implementation of the journal of the inputs of a world
+*/
+
+namespace Enki
+{
+	InputJournal::InputJournal() :
+		recordedWorld(0),
+		replayedWorld(0),
+		stepIndex(0),
+		lastRandomState(0),
+		nextEvent(0)
+	{
+	}
+	
+	InputJournal::~InputJournal()
+	{
+		stopRecording();
+	}
+	
+	void InputJournal::startRecording(World* world)
+	{
+		if (world->inputJournal)
+			throw std::runtime_error("world already has an input journal");
+		
+		// copy objects as the classes implementing clone(), which do not have the controllers of their subclasses
+		initialWorld.reset(world->fork(false));
+		events.clear();
+		eventData.clear();
+		steps.clear();
+		addedObjects.clear();
+		initialUids.clear();
+		for (World::ObjectsIterator it = world->objects.begin(); it != world->objects.end(); ++it)
+			initialUids.push_back((*it)->uid);
+		
+		saveLastInputs(world, world->worldRandom.getState());
+		stepIndex = 0;
+		recordedWorld = world;
+		world->inputJournal = this;
+	}
+	
+	void InputJournal::stopRecording()
+	{
+		if (recordedWorld)
+			recordedWorld->inputJournal = 0;
+		recordedWorld = 0;
+	}
+	
+	World* InputJournal::replay(unsigned stepCount)
+	{
+		if (!initialWorld)
+			throw std::runtime_error("cannot replay an input journal that never recorded");
+		World* world(new World(*initialWorld));
+		try
+		{
+			replay(world, stepCount);
+		}
+		catch (...)
+		{
+			delete world;
+			throw;
+		}
+		return world;
+	}
+	
+	void InputJournal::replay(World* world, unsigned stepCount)
+	{
+		if (recordedWorld)
+			throw std::runtime_error("cannot replay an input journal while recording");
+		if (!initialWorld)
+			throw std::runtime_error("cannot replay an input journal that never recorded");
+		if (!world->objects.empty() || world->inputJournal)
+			throw std::runtime_error("input journals can only be replayed into empty worlds without journal");
+		
+		// copies get increasing uids, so objects are in the same order as in the recorded world
+		replayedObjects.clear();
+		size_t i(0);
+		for (World::ObjectsIterator it = initialWorld->objects.begin(); it != initialWorld->objects.end(); ++it, ++i)
+		{
+			PhysicalObject* copy((*it)->clone());
+			copy->userData = 0;
+			world->addObject(copy);
+			replayedObjects[initialUids[i]] = copy;
+		}
+		
+		replayedWorld = world;
+		world->inputJournal = this;
+		stepIndex = 0;
+		nextEvent = 0;
+		try
+		{
+			for (unsigned step = 0; step < stepCount && step < steps.size(); ++step)
+				world->step(steps[step].dt, steps[step].physicsOversampling);
+		}
+		catch (...)
+		{
+			world->inputJournal = 0;
+			replayedWorld = 0;
+			replayedObjects.clear();
+			throw;
+		}
+		world->inputJournal = 0;
+		replayedWorld = 0;
+		replayedObjects.clear();
+	}
+	
+	void InputJournal::stepStarted(World* world, double dt, unsigned physicsOversampling)
+	{
+		if (world == replayedWorld)
+		{
+			while (nextEvent < events.size() && events[nextEvent].step == stepIndex && !events[nextEvent].inControlStep)
+				applyEvent(events[nextEvent++]);
+			return;
+		}
+		
+		Step step = { dt, physicsOversampling };
+		steps.push_back(step);
+		
+		const unsigned long randomState(world->worldRandom.getState());
+		if (randomState != lastRandomState)
+			addEvent(EVENT_RANDOM_SEED, false, 0, reinterpret_cast<const uint8_t*>(&randomState), sizeof(randomState));
+		
+		// both objects and lastUids are ordered by uid
+		World::ObjectsIterator it(world->objects.begin());
+		size_t last(0);
+		while (it != world->objects.end() || last < lastUids.size())
+		{
+			if (it == world->objects.end() || (last < lastUids.size() && lastUids[last] < (*it)->uid))
+			{
+				addEvent(EVENT_REMOVE_OBJECT, false, lastUids[last], 0, 0);
+				++last;
+			}
+			else if (last == lastUids.size() || (*it)->uid < lastUids[last])
+			{
+				PhysicalObject* copy((*it)->clone());
+				copy->userData = 0;
+				addedObjects.push_back(std::unique_ptr<PhysicalObject>(copy));
+				addEvent(EVENT_ADD_OBJECT, false, (*it)->uid, 0, 0);
+				events.back().offset = addedObjects.size() - 1;
+				++it;
+			}
+			else
+			{
+				inputsAfter.clear();
+				StateWriter writer(inputsAfter);
+				(*it)->saveInputs(writer);
+				const size_t size(lastOffsets[last + 1] - lastOffsets[last]);
+				if (inputsAfter.size() != size || memcmp(&inputsAfter[0], &lastInputs[lastOffsets[last]], size) != 0)
+					addEvent(EVENT_INPUTS, false, (*it)->uid, &inputsAfter[0], inputsAfter.size());
+				++it;
+				++last;
+			}
+		}
+	}
+	
+	void InputJournal::controlStep(PhysicalObject* object, double dt)
+	{
+		if (replayedWorld)
+		{
+			// objects are stepped in the same order as when recording
+			while (nextEvent < events.size() && events[nextEvent].step == stepIndex && events[nextEvent].inControlStep && getReplayedObject(events[nextEvent].uid) == object)
+				applyEvent(events[nextEvent++]);
+			object->controlStep(dt);
+			return;
+		}
+		
+		inputsBefore.clear();
+		StateWriter before(inputsBefore);
+		object->saveInputs(before);
+		object->controlStep(dt);
+		inputsAfter.clear();
+		StateWriter after(inputsAfter);
+		object->saveInputs(after);
+		if (inputsAfter != inputsBefore)
+			addEvent(EVENT_INPUTS, true, object->uid, &inputsAfter[0], inputsAfter.size());
+	}
+	
+	void InputJournal::stepEnded(World* world)
+	{
+		// during the step, the generator of the world is Enki::random
+		if (world == recordedWorld)
+			saveLastInputs(world, random.getState());
+		++stepIndex;
+	}
+	
+	void InputJournal::saveLastInputs(World* world, unsigned long randomState)
+	{
+		lastUids.clear();
+		lastInputs.clear();
+		lastOffsets.clear();
+		StateWriter writer(lastInputs);
+		for (World::ObjectsIterator it = world->objects.begin(); it != world->objects.end(); ++it)
+		{
+			lastUids.push_back((*it)->uid);
+			lastOffsets.push_back(lastInputs.size());
+			(*it)->saveInputs(writer);
+		}
+		lastOffsets.push_back(lastInputs.size());
+		lastRandomState = randomState;
+	}
+	
+	void InputJournal::addEvent(EventType type, bool inControlStep, unsigned uid, const uint8_t* data, size_t size)
+	{
+		Event event = { stepIndex, type, inControlStep, uid, eventData.size(), size };
+		events.push_back(event);
+		eventData.insert(eventData.end(), data, data + size);
+	}
+	
+	void InputJournal::applyEvent(const Event& event)
+	{
+		switch (event.type)
+		{
+			case EVENT_INPUTS:
+			{
+				PhysicalObject* object(getReplayedObject(event.uid));
+				if (!object)
+					throw std::runtime_error("input journal refers to an object missing from the replayed world");
+				StateReader reader(&eventData[event.offset], event.size);
+				object->restoreInputs(reader);
+				break;
+			}
+			
+			case EVENT_ADD_OBJECT:
+			{
+				PhysicalObject* copy(addedObjects[event.offset]->clone());
+				replayedObjects[event.uid] = copy;
+				replayedWorld->addObject(copy);
+				break;
+			}
+			
+			case EVENT_REMOVE_OBJECT:
+			{
+				PhysicalObject* object(getReplayedObject(event.uid));
+				replayedObjects.erase(event.uid);
+				if (object)
+				{
+					replayedWorld->removeObject(object);
+					delete object;
+				}
+				break;
+			}
+			
+			case EVENT_RANDOM_SEED:
+			{
+				unsigned long state;
+				memcpy(&state, &eventData[event.offset], sizeof(state));
+				replayedWorld->worldRandom.setSeed(state);
+				break;
+			}
+		}
+	}
+	
+	PhysicalObject* InputJournal::getReplayedObject(unsigned uid) const
+	{
+		std::map<unsigned, PhysicalObject*>::const_iterator it(replayedObjects.find(uid));
+		return it == replayedObjects.end() ? 0 : it->second;
+	}
+}
@@ -0,0 +1,189 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __ENKI_INPUTJOURNAL_H
+#define __ENKI_INPUTJOURNAL_H
+
+#include "PhysicalEngine.h"
+#include <vector>
+#include <map>
+#include <memory>
+#include <limits>
+#include <stdint.h>
+
+/*!	\file InputJournal.h
+	\brief Journal of the inputs of a world, to replay a run exactly
+*/
+
+namespace Enki
+{
+	//! Record the inputs applied to a world and replay them to reproduce its run exactly
+	/*!
+		While recording, the journal compares the inputs of objects (see PhysicalObject::saveInputs(),
+		which cover poses, speeds, colors, wheel speeds, LEDs and Bluetooth transmissions) at the
+		beginning of every step to their values at the end of the previous one, and before and after
+		the control step of every object. Changes become events with the index of their step: the
+		former are the changes of external code between steps, such as teleports or commands of
+		a remote client, the latter the changes of controllers. Objects added or removed between
+		steps and changes of the seed of the world are recorded as well.
+
+		replay() steps a copy of the world as it was when the recording started, applying the
+		events at the same points of the same steps, without calling the controllers of objects:
+		objects are copied with PhysicalObject::clone(), and subclasses that only add a controller
+		do not implement it, so they are copied as their base class. Subclasses that change the
+		physics of objects must implement clone(). The replay reproduces the run bit-exactly as long as:
+		- controllers set their commands before calling the controlStep() of their base class,
+		  as the robots of pyenki do, because replay applies them before the control step;
+		- controllers do not draw from Enki::random, which is the generator of the world during steps;
+		- objects added during recording were created after it started, so that their order is the same;
+		- the settings of the world do not change during recording.
+
+		Events are kept in memory, with copies of the world at start and of added objects.
+		\ingroup core
+	*/
+	class InputJournal
+	{
+	public:
+		//! Type of an event
+		enum EventType
+		{
+			EVENT_INPUTS = 0,		//!< the inputs of an object changed, data holds the ones of PhysicalObject::saveInputs()
+			EVENT_ADD_OBJECT,		//!< an object was added, a copy of it is kept
+			EVENT_REMOVE_OBJECT,	//!< an object was removed
+			EVENT_RANDOM_SEED		//!< the random generator of the world was reset, data holds its state
+		};
+		
+		//! A change of inputs during a step
+		struct Event
+		{
+			unsigned step;			//!< index of the step, from the start of the recording
+			EventType type;			//!< type of the event
+			bool inControlStep;		//!< whether the change was made by the control step of the object, otherwise before the step
+			unsigned uid;			//!< uid of the object in the recorded world
+			size_t offset;			//!< offset of the data of this event in the journal, or index of the copy of an added object
+			size_t size;			//!< size of the data of this event
+		};
+		
+		//! Parameters of a recorded step
+		struct Step
+		{
+			double dt;						//!< time step
+			unsigned physicsOversampling;	//!< physics oversampling
+		};
+		
+	protected:
+		//! Events, in the order they were recorded
+		std::vector<Event> events;
+		//! Data of all events
+		std::vector<uint8_t> eventData;
+		//! Recorded steps
+		std::vector<Step> steps;
+		//! Copy of the world when the recording started
+		std::unique_ptr<World> initialWorld;
+		//! Uids of the objects of the recorded world when the recording started, in order
+		std::vector<unsigned> initialUids;
+		//! Copies of the objects added during the recording
+		std::vector<std::unique_ptr<PhysicalObject> > addedObjects;
+		
+		//! World being recorded, 0 if none
+		World* recordedWorld;
+		//! World being replayed, 0 if none
+		World* replayedWorld;
+		//! Index of the current step, during recording or replay
+		unsigned stepIndex;
+		
+		// recording
+		//! Uids of the objects at the end of the last step
+		std::vector<unsigned> lastUids;
+		//! Inputs of these objects, end to end
+		std::vector<uint8_t> lastInputs;
+		//! Offset of the inputs of each object in lastInputs, with a last element for the end
+		std::vector<size_t> lastOffsets;
+		//! State of the random generator at the end of the last step
+		unsigned long lastRandomState;
+		//! Scratch buffers to compare inputs
+		std::vector<uint8_t> inputsBefore, inputsAfter;
+		
+		// replay
+		//! Objects of the replayed world, by uid in the recorded world
+		std::map<unsigned, PhysicalObject*> replayedObjects;
+		//! Next event to apply
+		size_t nextEvent;
+		
+	public:
+		//! Constructor, the journal is empty
+		InputJournal();
+		//! Destructor, stop recording
+		~InputJournal();
+		
+		//! Clear the journal, copy world and record its inputs until stopRecording(); throw std::runtime_error if world already has a journal
+		void startRecording(World* world);
+		//! Stop recording, keeping the events so far
+		void stopRecording();
+		//! Return whether a world is being recorded
+		bool isRecording() const { return recordedWorld != 0; }
+		
+		//! Return a copy of the world as it was when the recording started, stepped with the recorded inputs for steps steps, or all recorded steps; the caller owns the returned world
+		World* replay(unsigned steps = std::numeric_limits<unsigned>::max());
+		//! Add copies of the objects of getInitialWorld() to world and step it with the recorded inputs; world must be empty, own its objects and have the settings and state of getInitialWorld(), for instance by being built from it by a subclass of World
+		void replay(World* world, unsigned steps = std::numeric_limits<unsigned>::max());
+		//! Return the copy of the world made when the recording started, without the controllers of objects, or 0 if never recorded
+		const World* getInitialWorld() const { return initialWorld.get(); }
+		
+		//! Return the number of recorded steps
+		unsigned getStepCount() const { return steps.size(); }
+		//! Return the parameters of the recorded step of index
+		const Step& getStep(unsigned index) const { return steps[index]; }
+		//! Return the recorded events
+		const std::vector<Event>& getEvents() const { return events; }
+		
+		//! Called by World::step() before anything else, record or apply the changes since the last step
+		void stepStarted(World* world, double dt, unsigned physicsOversampling);
+		//! Called by World::step() instead of the control step of object, record or apply the changes it makes
+		void controlStep(PhysicalObject* object, double dt);
+		//! Called by World::step() after the control steps
+		void stepEnded(World* world);
+		
+	protected:
+		//! Remember the inputs of the objects of world and the state of its random generator
+		void saveLastInputs(World* world, unsigned long randomState);
+		//! Append an event with data
+		void addEvent(EventType type, bool inControlStep, unsigned uid, const uint8_t* data, size_t size);
+		//! Apply the event of index to the replayed world
+		void applyEvent(const Event& event);
+		//! Return the object of the replayed world corresponding to uid in the recorded one, 0 if none
+		PhysicalObject* getReplayedObject(unsigned uid) const;
+	};
+}
+
+#endif
@@ -47,6 +47,8 @@ namespace Enki
 	class PhysicalObject;
 	class Robot;
 	class World;
+	class StateWriter;
+	class StateReader;
 
 	//! Interacts with another object or wall only up to a certain distance
 	/*! \ingroup core */
@@ -84,8 +86,14 @@ namespace Enki
 		virtual void wallsStep(double dt, World* w) { }
 		//! Finalize at each step
 		virtual void finalize(double dt, World* w) { }
+		//! Append the dynamic state of this interaction, typically its last outputs, see World::saveState()
+		virtual void saveState(StateWriter& writer) const { }
+		//! Restore the dynamic state appended by saveState()
+		virtual void restoreState(StateReader& reader) { }
 		//! Return the range of the interaction
 		double getRange() const { return r; }
+		//! Attach this interaction to another robot, used when robots are cloned, see World::fork()
+		virtual void setOwner(Robot* owner) { this->owner = owner; }
 	};
 
 	//! Interacts with the whole world
@@ -109,6 +117,12 @@ namespace Enki
 		virtual void step(double dt, World *w) { }
 		//! Finalize at each step
 		virtual void finalize(double dt, World *w) { }
+		//! Append the dynamic state of this interaction, typically its last outputs, see World::saveState()
+		virtual void saveState(StateWriter& writer) const { }
+		//! Restore the dynamic state appended by saveState()
+		virtual void restoreState(StateReader& reader) { }
+		//! Attach this interaction to another robot, used when robots are cloned, see World::fork()
+		virtual void setOwner(Robot* owner) { this->owner = owner; }
 	};
 }
 #endif
@@ -32,11 +32,15 @@
 */
 
 #include "PhysicalEngine.h"
+#include "InputJournal.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <algorithm>
 #include <limits>
+#include <atomic>
+#include <typeinfo>
+#include <stdexcept>
 
 // _________________________________
 //
@@ -46,16 +50,17 @@
 
 namespace Enki
 {
-	//switching to an std::atomic<unsigned> when in the future we switch to C++11
-	static unsigned int uidNewObject = 0;
+	//! Uid of the next object, atomic so that worlds can be built in parallel
+	static std::atomic<unsigned> uidNewObject(0);
 
-	FastRandom random;
+	thread_local FastRandom random;
 	
 	// PhysicalObject::Part
 	
 	PhysicalObject::Part::Part(const Polygon& shape, double height) :
 		height(height),
-		shape(shape)
+		shape(new Polygon(shape)),
+		textures(new Textures())
 	{
 		computeAreaAndCentroid();
 		
@@ -64,8 +69,8 @@ namespace Enki
 	
 	PhysicalObject::Part::Part(const Polygon& shape, double height, const Textures& textures) :
 		height(height),
-		shape(shape),
-		textures(textures)
+		shape(new Polygon(shape)),
+		textures(new Textures(textures))
 	{
 		computeAreaAndCentroid();
 		
@@ -75,7 +80,7 @@ namespace Enki
 		{
 			std::cerr << "Error: PhysicalObject::Part::Part: texture sides count " << textures.size() << " missmatch shape sides count " << shape.size() << std::endl;
 			std::cerr << "\tignoring textures for this object" << std::endl;
-			this->textures.clear();
+			this->textures.reset(new Textures());
 			return;
 		}
 		
@@ -85,7 +90,7 @@ namespace Enki
 			{
 				std::cerr << "Error: PhysicalObject::Part::Part: texture for side " << i << " contains no data" << std::endl;
 				std::cerr << "\tignoring textures for this object" << std::endl;
-				this->textures.clear();
+				this->textures.reset(new Textures());
 				return;
 			}
 		}
@@ -94,18 +99,22 @@ namespace Enki
 	PhysicalObject::Part::Part(double l1, double l2, double height) :
 		height(height),
 		area(l1*l2),
-		centroid(0, 0)
+		centroid(0, 0),
+		textures(new Textures())
 	{
 		const double hl1 = l1 / 2;
 		const double hl2 = l2 / 2;
 		
-		shape << Point(-hl1, -hl2) << Point(hl1, -hl2) << Point(hl1, hl2) << Point(-hl1, hl2);
-		transformedShape.resize(shape.size());
+		Polygon rectangle;
+		rectangle << Point(-hl1, -hl2) << Point(hl1, -hl2) << Point(hl1, hl2) << Point(-hl1, hl2);
+		shape.reset(new Polygon(rectangle));
+		transformedShape.resize(rectangle.size());
 	}
 	
 	void PhysicalObject::Part::computeAreaAndCentroid()
 	{
 		// from: http://local.wasp.uwa.edu.au/~pbourke/geometry/polyarea/
+		const Polygon& shape(*this->shape);
 		const size_t size = shape.size();
 		
 		// area
@@ -129,6 +138,7 @@ namespace Enki
 	
 	void PhysicalObject::Part::computeTransformedShape(const Matrix22& rot, const Point& trans)
 	{
+		const Polygon& shape(*this->shape);
 		assert(!shape.empty());
 		assert(transformedShape.size() == shape.size());
 		for (size_t i = 0; i < shape.size(); ++i)
@@ -138,12 +148,15 @@ namespace Enki
 	
 	void PhysicalObject::Part::applyTransformation(const Matrix22& rot, const Point& trans, double* radius = 0)
 	{
+		// copy on write, as the shape might be shared with other parts
+		Polygon shape(*this->shape);
 		for (size_t i = 0; i < shape.size(); ++i)
 		{
 			(shape)[i] = rot * (shape)[i] + trans;
 			if (radius)
 				*radius = std::max(*radius, shape[i].norm());
 		}
+		this->shape.reset(new Polygon(shape));
 		centroid = rot * centroid + trans;
 	}
 	
@@ -238,6 +251,13 @@ namespace Enki
 		angle(0),
 		angSpeed(0),
 		interlacedDistance(0),
+		lastStepInterlacedDistance(0),
+		rotation(0.),
+		rotationAngle(0),
+		dynamicsModel(DYNAMICS_CUSTOM),
+		dynamicsCmdSpeed(0),
+		dynamicsCmdAngSpeed(0),
+		defaultDynamicsClass(&typeid(PhysicalObject)),
 		uid(uidNewObject++)
 	{
 		setCylindric(1, 1, 1);
@@ -316,6 +336,36 @@ namespace Enki
 		dirtyUserData();
 	}
 	
+	void PhysicalObject::setCustomHull(const Hull& hull, double mass, double momentOfInertia)
+	{
+		// robots are not moved to their center of mass, so only the radius and height depend on the hull
+		this->hull = hull;
+		height = 0;
+		r = 0;
+		for (Hull::const_iterator it = hull.begin(); it != hull.end(); ++it)
+		{
+			height = std::max(height, it->getHeight());
+			const Polygon& shape(it->getShape());
+			for (size_t i = 0; i < shape.size(); ++i)
+				r = std::max(r, shape[i].norm());
+		}
+		this->mass = mass;
+		this->momentOfInertia = momentOfInertia;
+		
+		dirtyUserData();
+	}
+	
+	void PhysicalObject::setShape(const PhysicalObject& other)
+	{
+		hull = other.hull;
+		r = other.r;
+		height = other.height;
+		mass = other.mass;
+		momentOfInertia = other.momentOfInertia;
+		
+		dirtyUserData();
+	}
+	
 	void PhysicalObject::setColor(const Color &color)
 	{
 		this->color = color;
@@ -324,6 +374,54 @@ namespace Enki
 		
 	}
 	
+	void PhysicalObject::saveState(StateWriter& writer) const
+	{
+		writer.write(pos);
+		writer.write(angle);
+		writer.write(speed);
+		writer.write(angSpeed);
+		writer.write(interlacedDistance);
+		writer.write(lastStepInterlacedDistance);
+		writer.write(color);
+	}
+	
+	void PhysicalObject::restoreState(StateReader& reader)
+	{
+		reader.read(pos);
+		reader.read(angle);
+		reader.read(speed);
+		reader.read(angSpeed);
+		reader.read(interlacedDistance);
+		reader.read(lastStepInterlacedDistance);
+		Color savedColor;
+		reader.read(savedColor);
+		if (!(savedColor == color))
+			setColor(savedColor);
+		computeTransformedShape();
+	}
+	
+	void PhysicalObject::saveInputs(StateWriter& writer) const
+	{
+		writer.write(pos);
+		writer.write(angle);
+		writer.write(speed);
+		writer.write(angSpeed);
+		writer.write(color);
+	}
+	
+	void PhysicalObject::restoreInputs(StateReader& reader)
+	{
+		reader.read(pos);
+		reader.read(angle);
+		reader.read(speed);
+		reader.read(angSpeed);
+		Color savedColor;
+		reader.read(savedColor);
+		if (!(savedColor == color))
+			setColor(savedColor);
+		computeTransformedShape();
+	}
+	
 	void PhysicalObject::computeMomentOfInertia()
 	{
 		if (hull.empty())
@@ -340,7 +438,7 @@ namespace Enki
 			for (double ix = -r; ix < r; ix += dr)
 				for (double iy = -r; iy < r; iy += dr)
 					for (Hull::const_iterator it = hull.begin(); it != hull.end(); ++it)
-						if (it->shape.isPointInside(Point(ix, iy)))
+						if (it->shape->isPointInside(Point(ix, iy)))
 						{
 							momentOfInertia += ix * ix + iy * iy;
 							numericalArea++;
@@ -366,11 +464,11 @@ namespace Enki
 		// get bounding box of the whole hull
 		Point bottomLeft, topRight;
 		Hull::iterator it = hull.begin();
-		bool validBB = it->shape.getAxisAlignedBoundingBox(bottomLeft, topRight);
+		bool validBB = it->shape->getAxisAlignedBoundingBox(bottomLeft, topRight);
 		assert(validBB);
 		++it;
 		for (;it != hull.end(); ++it)
-			it->shape.extendAxisAlignedBoundingBox(bottomLeft, topRight);
+			it->shape->extendAxisAlignedBoundingBox(bottomLeft, topRight);
 		
 		// numerically compute the center of mass of the shape
 		Point cm;
@@ -380,7 +478,7 @@ namespace Enki
 		for (double ix = bottomLeft.x; ix < topRight.x; ix += dx)
 			for (double iy = bottomLeft.y; iy < topRight.y; iy += dy)
 				for (it = hull.begin(); it != hull.end(); ++it)
-					if (it->shape.isPointInside(Point(ix, iy)))
+					if (it->shape->isPointInside(Point(ix, iy)))
 					{
 						cm.x += ix;
 						cm.y += iy;
@@ -408,7 +506,8 @@ namespace Enki
 		Robot* robot(dynamic_cast<Robot*>(this));
 		if (!robot)
 		{
-			pos += Matrix22(angle) * cm;
+			updateRotation();
+			pos += getRotation() * cm;
 			hull.applyTransformation(Matrix22::identity(), -cm, &r);
 		}
 		else
@@ -420,9 +519,10 @@ namespace Enki
 	
 	void PhysicalObject::computeTransformedShape()
 	{
+		updateRotation();
 		if (!hull.empty())
 		{
-			Matrix22 rotMat(angle);
+			const Matrix22& rotMat(getRotation());
 			for (Hull::iterator it = hull.begin(); it != hull.end(); ++it)
 				it->computeTransformedShape(rotMat, pos);
 		}
@@ -515,7 +615,12 @@ namespace Enki
 	void PhysicalObject::initPhysicsInteractions(double dt)
 	{
 		applyForces(dt);
-		
+		integrate(dt);
+	}
+	
+	void PhysicalObject::integrate(double dt)
+	{
+		posBeforeIntegration = pos;
 		pos += speed * dt;
 		angle += angSpeed * dt;
 		computeTransformedShape();
@@ -529,6 +634,7 @@ namespace Enki
 		// increment interlacedDistance based on pos before and after physics
 		interlacedDistance += (posBeforeCollision - pos).norm();
 		angle = normalizeAngle(angle);
+		updateRotation();
 	}
 	
 	
@@ -599,11 +705,14 @@ namespace Enki
 		that.computeTransformedShape();
 		cp += thatDisp; // we have to move cp as much as we move that because cp lie on that's boundary
 		
+		collideWithMovableObject(that, cp, dist.unitary());
+	}
+	
+	void PhysicalObject::collideWithMovableObject(PhysicalObject &that, const Point &cp, const Vector &n)
+	{
 		// Perform physics!
 		// we use model from http://www.myphysicslab.com/collision.html
 		// this is object A, that is object B
-		const Vector n = dist.unitary();
-		
 		const Vector r_ap = (cp - pos);
 		const Vector r_bp = (cp - that.pos);
 		
@@ -624,6 +733,11 @@ namespace Enki
 		collisionEvent(&that);
 		that.collisionEvent(this);
 	}
+	
+	PhysicalObject* PhysicalObject::clone() const
+	{
+		return new PhysicalObject(*this);
+	}
 
 	//! A functor then compares the radius of two local interactions
 	struct InteractionRadiusCompare
@@ -639,6 +753,7 @@ namespace Enki
 	void Robot::addLocalInteraction(LocalInteraction *li)
 	{
 		localInteractions.push_back(li);
+		registeredLocalInteractions.push_back(li);
 		sortLocalInteractions();
 	}
 	
@@ -699,6 +814,38 @@ namespace Enki
 		}
 	}
 	
+	void Robot::saveState(StateWriter& writer) const
+	{
+		PhysicalObject::saveState(writer);
+		for (size_t i = 0; i < localInteractions.size(); i++)
+			localInteractions[i]->saveState(writer);
+		for (size_t i = 0; i < globalInteractions.size(); i++)
+			globalInteractions[i]->saveState(writer);
+	}
+	
+	void Robot::restoreState(StateReader& reader)
+	{
+		PhysicalObject::restoreState(reader);
+		for (size_t i = 0; i < localInteractions.size(); i++)
+			localInteractions[i]->restoreState(reader);
+		for (size_t i = 0; i < globalInteractions.size(); i++)
+			globalInteractions[i]->restoreState(reader);
+	}
+	
+	PhysicalObject* Robot::clone() const
+	{
+		return new Robot(*this);
+	}
+	
+	void Robot::copyLocalInteraction(const Robot& other, const LocalInteraction& otherInteraction, LocalInteraction& interaction)
+	{
+		if (find(other.localInteractions.begin(), other.localInteractions.end(), &otherInteraction) == other.localInteractions.end())
+			return;
+		interaction.setOwner(this);
+		// registering in the order of the constructor reproduces the order of other
+		addLocalInteraction(&interaction);
+	}
+	
 	World::GroundTexture::GroundTexture():
 		width(0),
 		height(0)
@@ -710,15 +857,40 @@ namespace Enki
 		data(data, data+width*height)
 	{}
 
+	World::AdaptiveOversampling::AdaptiveOversampling():
+		enabled(false),
+		maxDisplacementRatio(0.25),
+		maxPenetrationRatio(0.05),
+		maxOversampling(20)
+	{}
+
+	World::ImpulseSolver::ImpulseSolver():
+		enabled(false),
+		iterations(10),
+		warmStarting(true),
+		positionCorrection(0.2),
+		allowedPenetration(0.01),
+		restitutionThreshold(30)
+	{}
+
+	World::ContinuousCollisionDetection::ContinuousCollisionDetection():
+		enabled(false),
+		minDisplacementRatio(0.5),
+		maxImpacts(4)
+	{}
+
 	World::World(double width, double height, const Color& color, const GroundTexture& groundTexture) :
 		wallsType(WALLS_SQUARE),
 		w(width),
 		h(height),
 		r(0),
 		color(color),
-		groundTexture(groundTexture),
+		sharedGroundTexture(new GroundTexture(groundTexture)),
+		groundTexture(*sharedGroundTexture),
 		takeObjectOwnership(true),
-		bluetoothBase(NULL)
+		bluetoothBase(NULL),
+		inputJournal(0),
+		batchIntegration(false)
 	{
 	}
 	
@@ -728,9 +900,12 @@ namespace Enki
 		h(0),
 		r(r),
 		color(color),
-		groundTexture(groundTexture),
+		sharedGroundTexture(new GroundTexture(groundTexture)),
+		groundTexture(*sharedGroundTexture),
 		takeObjectOwnership(true),
-		bluetoothBase(NULL)
+		bluetoothBase(NULL),
+		inputJournal(0),
+		batchIntegration(false)
 	{
 	}
 	
@@ -740,13 +915,40 @@ namespace Enki
 		h(0),
 		r(0),
 		color(Color::gray),
+		sharedGroundTexture(new GroundTexture()),
+		groundTexture(*sharedGroundTexture),
 		takeObjectOwnership(true),
-		bluetoothBase(NULL)
+		bluetoothBase(NULL),
+		inputJournal(0),
+		batchIntegration(false)
+	{
+	}
+	
+	World::World(const World& other) :
+		wallsType(other.wallsType),
+		w(other.w),
+		h(other.h),
+		r(other.r),
+		color(other.color),
+		sharedGroundTexture(other.sharedGroundTexture),
+		groundTexture(*sharedGroundTexture),
+		takeObjectOwnership(true),
+		bluetoothBase(other.bluetoothBase ? new BluetoothBase() : NULL),
+		inputJournal(0),
+		adaptiveOversampling(other.adaptiveOversampling),
+		impulseSolver(other.impulseSolver),
+		continuousCollisionDetection(other.continuousCollisionDetection),
+		batchIntegration(other.batchIntegration),
+		contactCache(other.contactCache),
+		worldRandom(other.worldRandom)
 	{
 	}
 
 	World::~World()
 	{
+		if (inputJournal)
+			inputJournal->stopRecording();
+		
 		if (takeObjectOwnership)
 			for (ObjectsIterator i = objects.begin(); i != objects.end(); ++i)
 				delete (*i);
@@ -755,6 +957,30 @@ namespace Enki
 			delete bluetoothBase;
 	}
 	
+	World* World::fork() const
+	{
+		return fork(true);
+	}
+	
+	World* World::fork(bool requireSameClass) const
+	{
+		World* copy(new World(*this));
+		for (ObjectsIterator i = objects.begin(); i != objects.end(); ++i)
+		{
+			PhysicalObject* o(*i);
+			PhysicalObject* oCopy(o->clone());
+			if (requireSameClass && typeid(*oCopy) != typeid(*o))
+			{
+				delete oCopy;
+				delete copy;
+				throw std::runtime_error(std::string("cannot fork a world containing objects of class ") + typeid(*o).name() + ", that does not implement clone()");
+			}
+			oCopy->userData = 0;
+			copy->objects.insert(oCopy);
+		}
+		return copy;
+	}
+	
 	bool World::hasGroundTexture() const
 	{
 		return !groundTexture.data.empty();
@@ -937,13 +1163,17 @@ namespace Enki
 		}
 	}
 
-	void World::collideObjects(PhysicalObject *object1, PhysicalObject *object2)
+	bool World::findContact(PhysicalObject *object1, PhysicalObject *object2, Contact& contact) const
 	{
+		// Objects of infinite mass do not collide together
+		if (object1->mass < 0 && object2->mass < 0)
+			return false;
+		
 		// Is there a possible contact ?
 		const Vector distOCtoOC = object1->pos-object2->pos;
 		const double addedRay = object1->r+object2->r;
 		if (distOCtoOC.norm2() > (addedRay*addedRay))
-			return;
+			return false;
 
 		// variables for finding parts of maximum penetration
 		PhysicalObject *o1 = NULL, *o2 = NULL;
@@ -1037,53 +1267,837 @@ namespace Enki
 		{
 			assert(o1);
 			assert(o2);
-			o1->collideWithObject(*o2, collisionPoint, maxMtv);
+			contact.o1 = o1;
+			contact.o2 = o2;
+			contact.point = collisionPoint;
+			contact.mtv = maxMtv;
+			return true;
 		}
+		return false;
 	}
-
-	void World::step(double dt, unsigned physicsOversampling)
+	
+	void World::collideObjects(PhysicalObject *object1, PhysicalObject *object2)
 	{
-		// oversampling physics
-		const double overSampledDt = dt / (double)physicsOversampling;
-		for (unsigned po = 0; po < physicsOversampling; po++)
+		Contact contact;
+		if (findContact(object1, object2, contact))
+			contact.o1->collideWithObject(*contact.o2, contact.point, contact.mtv);
+	}
+	
+	double World::getContactNormalSpeed(const Contact& c) const
+	{
+		const Vector v1 = c.o1->speed + c.r1.crossFromZVector(c.o1->angSpeed);
+		const Vector v2 = c.o2->speed + c.r2.crossFromZVector(c.o2->angSpeed);
+		return (v1 - v2) * c.normal;
+	}
+	
+	void World::applyContactImpulse(const Contact& c, double impulse)
+	{
+		const Vector p = c.normal * impulse;
+		c.o1->speed += p * c.invMass1;
+		c.o1->angSpeed += c.r1.cross(p) * c.invInertia1;
+		c.o2->speed -= p * c.invMass2;
+		c.o2->angSpeed -= c.r2.cross(p) * c.invInertia2;
+	}
+	
+	World::ContactCache::key_type World::contactKey(const PhysicalObject *o1, const PhysicalObject *o2)
+	{
+		// findContact() can swap objects, the impulse along the normal does not depend on their order
+		return std::make_pair(std::min(o1->uid, o2->uid), std::max(o1->uid, o2->uid));
+	}
+	
+	void World::gatherContacts(const std::vector<PhysicalObject *>& collidingObjects, double dt)
+	{
+		contacts.clear();
+		Contact contact;
+		for (size_t i = 0; i < collidingObjects.size(); ++i)
 		{
-			// init physics interactions
-			for (ObjectsIterator i = objects.begin(); i != objects.end(); ++i)
-				(*i)->initPhysicsInteractions(overSampledDt);
+			for (size_t j = i + 1; j < collidingObjects.size(); ++j)
+			{
+				PhysicalObject *o1(collidingObjects[i]);
+				PhysicalObject *o2(collidingObjects[j]);
+				if (o1->mass < 0 && o2->mass < 0)
+					continue;
+				if (o1->hull.empty() && o2->hull.empty())
+				{
+					// cylinders that might touch during dt give speculative contacts of negative depth
+					const Vector distOCtoOC = o1->pos - o2->pos;
+					const double dist = distOCtoOC.norm();
+					const double margin = (o1->speed - o2->speed).norm() * dt;
+					if (dist > o1->r + o2->r + margin)
+						continue;
+					contact.o1 = o1;
+					contact.o2 = o2;
+					// objects at the same place are separated along x, any direction is as good
+					contact.normal = dist > std::numeric_limits<double>::epsilon() ? distOCtoOC / dist : Vector(1, 0);
+					contact.depth = o1->r + o2->r - dist;
+					contact.point = o2->pos + contact.normal * o2->r;
+					contact.mtv = contact.normal * contact.depth;
+					contacts.push_back(contact);
+				}
+				else if (findContact(o1, o2, contact))
+				{
+					contact.normal = contact.mtv.unitary();
+					contact.depth = contact.mtv.norm();
+					contacts.push_back(contact);
+				}
+			}
+		}
+	}
+	
+	void World::solveContactVelocities(double dt)
+	{
+		// prepare contacts, see http://www.myphysicslab.com/collision.html for the model
+		for (size_t i = 0; i < contacts.size(); ++i)
+		{
+			Contact& c(contacts[i]);
+			PhysicalObject* o1(c.o1);
+			PhysicalObject* o2(c.o2);
+			c.r1 = c.point - o1->pos;
+			c.r2 = c.point - o2->pos;
+			c.pos1 = o1->pos;
+			c.pos2 = o2->pos;
+			c.invMass1 = o1->mass < 0 ? 0 : 1 / o1->mass;
+			c.invMass2 = o2->mass < 0 ? 0 : 1 / o2->mass;
+			c.invInertia1 = o1->mass < 0 ? 0 : 1 / o1->momentOfInertia;
+			c.invInertia2 = o2->mass < 0 ? 0 : 1 / o2->momentOfInertia;
+			const double rn1 = c.r1.cross(c.normal);
+			const double rn2 = c.r2.cross(c.normal);
+			const double k = c.invMass1 + c.invMass2 + rn1 * rn1 * c.invInertia1 + rn2 * rn2 * c.invInertia2;
+			c.normalMass = k > 0 ? 1 / k : 0;
 			
-			// collide objects together
-			unsigned iCounter, jCounter;
-			iCounter = 0;
-			for (ObjectsIterator i = objects.begin(); i != objects.end(); ++i)
+			// contacts already present earlier in this step or during the previous one are resting
+			ContactCache::const_iterator cached = contactCache.find(contactKey(o1, o2));
+			c.resting = (cached != contactCache.end());
+			
+			// speculative contacts let objects approach until they touch
+			c.bounce = c.depth < 0 ? c.depth / dt : 0;
+			
+			// objects touching for the first time bounce, walls are fully elastic as in collideWithStaticObject()
+			const double normalSpeed = getContactNormalSpeed(c);
+			if (!c.resting && normalSpeed < std::min(c.bounce, -impulseSolver.restitutionThreshold))
+			{
+				double elasticity;
+				if (o1->mass < 0)
+					elasticity = o2->collisionElasticity;
+				else if (o2->mass < 0)
+					elasticity = o1->collisionElasticity;
+				else
+					elasticity = o1->collisionElasticity * o2->collisionElasticity;
+				c.bounce = -elasticity * normalSpeed;
+			}
+			
+			// warm start with the impulse this contact last accumulated
+			c.impulse = 0;
+			if (impulseSolver.warmStarting && c.resting)
+			{
+				c.impulse = cached->second.impulse;
+				applyContactImpulse(c, c.impulse);
+			}
+		}
+		
+		// iterate, accumulated impulses can only push objects apart
+		for (unsigned iteration = 0; iteration < impulseSolver.iterations; ++iteration)
+		{
+			for (size_t i = 0; i < contacts.size(); ++i)
 			{
-				jCounter = 0;
-				for (ObjectsIterator j = objects.begin(); j != objects.end(); ++j)
+				Contact& c(contacts[i]);
+				const double newImpulse = std::max(c.impulse + c.normalMass * (c.bounce - getContactNormalSpeed(c)), 0.);
+				applyContactImpulse(c, newImpulse - c.impulse);
+				c.impulse = newImpulse;
+			}
+		}
+		
+		for (size_t i = 0; i < contacts.size(); ++i)
+		{
+			Contact& c(contacts[i]);
+			
+			// store impulses for warm starting, speculative contacts that did not act are not collisions but stay resting
+			const bool collided(c.depth >= 0 || c.impulse > 0);
+			if (collided || c.resting)
+			{
+				CachedContact& cached(contactCache[contactKey(c.o1, c.o2)]);
+				cached.impulse = c.impulse;
+				cached.active = true;
+			}
+			if (!collided)
+				continue;
+			
+			// call the collision callbacks, static objects are considered as walls
+			if (c.o1->mass < 0)
+				c.o2->collisionEvent(0);
+			else if (c.o2->mass < 0)
+				c.o1->collisionEvent(0);
+			else
+			{
+				c.o1->collisionEvent(c.o2);
+				c.o2->collisionEvent(c.o1);
+			}
+		}
+	}
+	
+	void World::solveContactPositions()
+	{
+		// move objects proportionally to their inverse mass, taking into account their displacement since contacts were found
+		for (unsigned iteration = 0; iteration < impulseSolver.iterations; ++iteration)
+		{
+			for (size_t i = 0; i < contacts.size(); ++i)
+			{
+				Contact& c(contacts[i]);
+				const double invMassSum = c.invMass1 + c.invMass2;
+				const double depth = c.depth - ((c.o1->pos - c.pos1) - (c.o2->pos - c.pos2)) * c.normal;
+				const double correction = impulseSolver.positionCorrection * (depth - impulseSolver.allowedPenetration);
+				if (correction <= 0 || invMassSum <= 0)
+					continue;
+				c.o1->pos += c.normal * (correction * c.invMass1 / invMassSum);
+				c.o2->pos -= c.normal * (correction * c.invMass2 / invMassSum);
+			}
+		}
+		for (size_t i = 0; i < contacts.size(); ++i)
+		{
+			contacts[i].o1->computeTransformedShape();
+			contacts[i].o2->computeTransformedShape();
+		}
+	}
+	
+	//! Return true and set t to the first time in [0,1] at which a point moving from start by displacement is at distance r from center
+	static bool sweepPointToCircle(const Point& start, const Vector& displacement, const Point& center, double r, double& t)
+	{
+		const Vector s(start - center);
+		const double a(displacement.norm2());
+		const double b(s * displacement);
+		const double c(s.norm2() - r * r);
+		if (a == 0 || c <= 0 || b >= 0)
+			return false;
+		const double discriminant(b * b - a * c);
+		if (discriminant < 0)
+			return false;
+		t = (-b - sqrt(discriminant)) / a;
+		return t <= 1;
+	}
+	
+	bool World::findTimeOfImpact(const PhysicalObject *object, const Point& start, const Vector& displacement, const PhysicalObject *other, double& toi, Vector& normal, Point& cp) const
+	{
+		const double r(object->r);
+		bool hit(false);
+		toi = 1;
+		
+		if (other->hull.empty())
+		{
+			// circle against circle
+			double t;
+			if (sweepPointToCircle(start, displacement, other->pos, r + other->r, t))
+			{
+				toi = t;
+				normal = (start + displacement * t - other->pos).unitary();
+				cp = other->pos + normal * other->r;
+				hit = true;
+			}
+			return hit;
+		}
+		
+		// circle against each convex part
+		for (PhysicalObject::Hull::const_iterator it = other->hull.begin(); it != other->hull.end(); ++it)
+		{
+			const Polygon& shape(it->getTransformedShape());
+			Vector mtv;
+			Point intersectionPoint;
+			if (shape.doesIntersect(start, r, mtv, intersectionPoint))
+				continue;
+			
+			const Point& centroid(it->getTransformedCentroid());
+			for (size_t i = 0; i < shape.size(); ++i)
+			{
+				const Point& a(shape[i]);
+				const Point& b(shape[(i + 1) % shape.size()]);
+				
+				// edges, moved outwards by the radius
+				Vector n((b - a).perp().unitary());
+				if ((centroid - a) * n > 0)
+					n = -n;
+				const double startDist((start - a) * n);
+				const double approachSpeed(-(displacement * n));
+				if (startDist >= r && approachSpeed > 0)
 				{
-					if (iCounter < jCounter)
+					const double t((startDist - r) / approachSpeed);
+					const Point p(start + displacement * t - n * r);
+					const double along((p - a) * (b - a));
+					if (t < toi && along >= 0 && along <= (b - a).norm2())
 					{
-						collideObjects((*i), (*j));
+						toi = t;
+						normal = n;
+						cp = p;
+						hit = true;
 					}
-					jCounter++;
 				}
-				iCounter++;
+				
+				// vertices
+				double t;
+				if (sweepPointToCircle(start, displacement, a, r, t) && t < toi)
+				{
+					toi = t;
+					normal = (start + displacement * t - a).unitary();
+					cp = a;
+					hit = true;
+				}
+			}
+		}
+		return hit;
+	}
+	
+	//! Interval of x covered by the bounding circle of an object during the last integration, for the broad phase of continuous collision detection
+	struct SweptInterval
+	{
+		double minX; //!< smallest x
+		double maxX; //!< largest x
+		PhysicalObject* object; //!< swept object
+		
+		//! Order intervals by their start
+		bool operator<(const SweptInterval& that) const { return minX < that.minX; }
+	};
+	
+	void World::sweepFastObjects(const std::vector<PhysicalObject *>& movingObjects, const std::vector<PhysicalObject *>& collidingObjects, double dt)
+	{
+		// broad phase, built for the first fast object: swept intervals of colliding objects sorted by their start
+		std::vector<SweptInterval> intervals;
+		double maxIntervalLength(0);
+		// objects moved by impacts since the intervals were built, whose intervals are outdated and which are always tested
+		std::vector<PhysicalObject *> displacedObjects;
+		std::vector<PhysicalObject *> candidates;
+		
+		for (size_t i = 0; i < movingObjects.size(); ++i)
+		{
+			PhysicalObject* o(movingObjects[i]);
+			if (o->mass < 0)
+				continue;
+			
+			Vector displacement(o->pos - o->posBeforeIntegration);
+			const double minDisplacement(continuousCollisionDetection.minDisplacementRatio * o->r);
+			if (displacement.norm2() <= minDisplacement * minDisplacement)
+				continue;
+			
+			if (intervals.empty())
+			{
+				intervals.resize(collidingObjects.size());
+				for (size_t j = 0; j < collidingObjects.size(); ++j)
+				{
+					PhysicalObject* that(collidingObjects[j]);
+					SweptInterval& interval(intervals[j]);
+					interval.minX = std::min(that->posBeforeIntegration.x, that->pos.x) - that->r;
+					interval.maxX = std::max(that->posBeforeIntegration.x, that->pos.x) + that->r;
+					interval.object = that;
+					maxIntervalLength = std::max(maxIntervalLength, interval.maxX - interval.minX);
+				}
+				std::sort(intervals.begin(), intervals.end());
 			}
 			
-			// collide objects with walls and physics step
-			for (ObjectsIterator i = objects.begin(); i != objects.end(); ++i)
+			double remaining(1);
+			for (unsigned impact = 0; impact < continuousCollisionDetection.maxImpacts; ++impact)
 			{
-				switch (wallsType)
+				// objects can only meet if their swept intervals overlap, intervals starting before minX - maxIntervalLength end before minX
+				SweptInterval sweep;
+				sweep.minX = std::min(o->pos.x - displacement.x, o->pos.x) - o->r;
+				sweep.maxX = std::max(o->pos.x - displacement.x, o->pos.x) + o->r;
+				SweptInterval first;
+				first.minX = sweep.minX - maxIntervalLength;
+				candidates.clear();
+				for (std::vector<SweptInterval>::const_iterator it = std::lower_bound(intervals.begin(), intervals.end(), first); it != intervals.end() && it->minX <= sweep.maxX; ++it)
+					if (it->maxX >= sweep.minX)
+						candidates.push_back(it->object);
+				candidates.insert(candidates.end(), displacedObjects.begin(), displacedObjects.end());
+				
+				// find the first impact along the displacement, relative to the motion of other objects
+				double firstToi(1);
+				PhysicalObject* hitObject(0);
+				Vector hitDisplacement;
+				Vector normal;
+				Point cp;
+				for (size_t j = 0; j < candidates.size(); ++j)
+				{
+					PhysicalObject* that(candidates[j]);
+					if (that == o)
+						continue;
+					const Vector thatDisplacement(that->pos - that->posBeforeIntegration);
+					const Vector relativeDisplacement(displacement - thatDisplacement * remaining);
+					double toi;
+					Vector n;
+					Point p;
+					if (findTimeOfImpact(o, o->pos - relativeDisplacement, relativeDisplacement, that, toi, n, p) && toi < firstToi)
+					{
+						firstToi = toi;
+						hitObject = that;
+						hitDisplacement = relativeDisplacement;
+						normal = n;
+						cp = p;
+					}
+				}
+				if (!hitObject)
+					break;
+				
+				// move back to touch the hit object at its current position and collide
+				o->pos -= hitDisplacement * (1 - firstToi);
+				o->computeTransformedShape();
+				const Vector hitSpeed(hitObject->speed);
+				if (hitObject->mass < 0)
+					o->collideWithStaticObject(normal, cp);
+				else
+					o->collideWithMovableObject(*hitObject, cp, normal);
+				
+				// integrate the remaining time with the new speed
+				remaining *= 1 - firstToi;
+				if (hitObject->mass >= 0)
 				{
-					case WALLS_SQUARE: collideWithSquareWalls(*i); break;
-					case WALLS_CIRCULAR: collideWithCircularWalls(*i); break;
-					default: break;
+					// the hit object moved with its old speed after the impact, so that the result does not depend on the order of objects
+					hitObject->pos += (hitObject->speed - hitSpeed) * (dt * remaining);
+					hitObject->computeTransformedShape();
+					if (std::find(displacedObjects.begin(), displacedObjects.end(), hitObject) == displacedObjects.end())
+						displacedObjects.push_back(hitObject);
 				}
-				(*i)->finalizePhysicsInteractions(overSampledDt);
+				displacement = o->speed * (dt * remaining);
+				o->pos += displacement;
+				o->computeTransformedShape();
+				if (std::find(displacedObjects.begin(), displacedObjects.end(), o) == displacedObjects.end())
+					displacedObjects.push_back(o);
+			}
+			o->posBeforeCollision = o->pos;
+		}
+	}
+	
+	void World::KinematicState::resize(size_t count)
+	{
+		posX.resize(count);
+		posY.resize(count);
+		angle.resize(count);
+		speedX.resize(count);
+		speedY.resize(count);
+		angSpeed.resize(count);
+		dryFrictionCoefficient.resize(count);
+		viscousFrictionCoefficient.resize(count);
+		viscousMomentFrictionCoefficient.resize(count);
+		cmdSpeed.resize(count);
+		cmdAngSpeed.resize(count);
+		heading.resize(count);
+		headingSin.resize(count);
+		headingCos.resize(count);
+	}
+	
+	void World::KinematicState::applyFrictionForces(double dt)
+	{
+		// same operations in the same order as PhysicalObject::applyForces(), so that results are identical
+		const double g = PhysicalObject::g;
+		for (size_t i = 0; i < frictionCount; ++i)
+		{
+			double vx = speedX[i];
+			double vy = speedY[i];
+			double w = angSpeed[i];
+			double accX = 0.;
+			double accY = 0.;
+			double angAcc = 0.;
+			
+			// dry friction, set speed to zero if bigger
+			const double norm = sqrt(vx*vx + vy*vy);
+			const double ux = norm < std::numeric_limits<double>::epsilon() ? 0. : vx / norm;
+			const double uy = norm < std::numeric_limits<double>::epsilon() ? 0. : vy / norm;
+			const double dryFrictionX = -ux * g * dryFrictionCoefficient[i];
+			const double dryFrictionY = -uy * g * dryFrictionCoefficient[i];
+			if ((dryFrictionX * dt) * (dryFrictionX * dt) + (dryFrictionY * dt) * (dryFrictionY * dt) > vx*vx + vy*vy)
+			{
+				vx = 0.;
+				vy = 0.;
+			}
+			else
+			{
+				accX += dryFrictionX;
+				accY += dryFrictionY;
+			}
+			
+			// dry rotation friction, set angSpeed to zero if bigger
+			const double dryAngFriction = - sgn(w) * g * dryFrictionCoefficient[i];
+			if ((fabs(dryAngFriction) * dt) > fabs(w))
+				w = 0.;
+			else
+				angAcc += dryAngFriction;
+			
+			// viscous friction
+			accX += -vx * viscousFrictionCoefficient[i];
+			accY += -vy * viscousFrictionCoefficient[i];
+			angAcc += -w * viscousMomentFrictionCoefficient[i];
+			
+			speedX[i] = vx + accX * dt;
+			speedY[i] = vy + accY * dt;
+			angSpeed[i] = w + angAcc * dt;
+		}
+	}
+	
+	void World::KinematicState::applyDifferentialWheeledForces(double dt)
+	{
+		// same operations as DifferentialWheeled::applyForces()
+		const size_t count = objects.size();
+		for (size_t i = frictionCount; i < count; ++i)
+			heading[i] = angle[i] + angSpeed[i] * dt * 0.5;
+		sinCos(&heading[frictionCount], &headingSin[frictionCount], &headingCos[frictionCount], count - frictionCount);
+		for (size_t i = frictionCount; i < count; ++i)
+		{
+			speedX[i] = cmdSpeed[i] * headingCos[i];
+			speedY[i] = cmdSpeed[i] * headingSin[i];
+			angSpeed[i] = cmdAngSpeed[i];
+		}
+	}
+	
+	void World::KinematicState::integrate(double dt)
+	{
+		const size_t count = objects.size();
+		for (size_t i = 0; i < count; ++i)
+		{
+			posX[i] += speedX[i] * dt;
+			posY[i] += speedY[i] * dt;
+			angle[i] += angSpeed[i] * dt;
+		}
+	}
+	
+	void World::applyForces(const std::vector<PhysicalObject *>& movingObjects, double dt, bool integrate)
+	{
+		if (!batchIntegration)
+		{
+			for (size_t i = 0; i < movingObjects.size(); ++i)
+			{
+				if (integrate)
+					movingObjects[i]->initPhysicsInteractions(dt);
+				else
+					movingObjects[i]->applyForces(dt);
+			}
+			return;
+		}
+		
+		// sort objects by dynamics model, objects are independent so order does not matter
+		KinematicState& state(kinematicState);
+		state.objects.clear();
+		customDynamicsObjects.clear();
+		for (size_t i = 0; i < movingObjects.size(); ++i)
+			if (movingObjects[i]->dynamicsModel == PhysicalObject::DYNAMICS_FRICTION)
+				state.objects.push_back(movingObjects[i]);
+		state.frictionCount = state.objects.size();
+		for (size_t i = 0; i < movingObjects.size(); ++i)
+		{
+			if (movingObjects[i]->dynamicsModel == PhysicalObject::DYNAMICS_DIFFERENTIAL_WHEELED)
+				state.objects.push_back(movingObjects[i]);
+			else if (movingObjects[i]->dynamicsModel == PhysicalObject::DYNAMICS_CUSTOM)
+				customDynamicsObjects.push_back(movingObjects[i]);
+		}
+		
+		// gather state
+		const size_t count = state.objects.size();
+		state.resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const PhysicalObject* o(state.objects[i]);
+			state.posX[i] = o->pos.x;
+			state.posY[i] = o->pos.y;
+			state.angle[i] = o->angle;
+			state.speedX[i] = o->speed.x;
+			state.speedY[i] = o->speed.y;
+			state.angSpeed[i] = o->angSpeed;
+			state.dryFrictionCoefficient[i] = o->dryFrictionCoefficient;
+			state.viscousFrictionCoefficient[i] = o->viscousFrictionCoefficient;
+			state.viscousMomentFrictionCoefficient[i] = o->viscousMomentFrictionCoefficient;
+			state.cmdSpeed[i] = o->dynamicsCmdSpeed;
+			state.cmdAngSpeed[i] = o->dynamicsCmdAngSpeed;
+		}
+		
+		// run kernels
+		state.applyFrictionForces(dt);
+		state.applyDifferentialWheeledForces(dt);
+		if (integrate)
+			state.integrate(dt);
+		
+		// scatter state back, so that collisions see up-to-date objects
+		for (size_t i = 0; i < count; ++i)
+		{
+			PhysicalObject* o(state.objects[i]);
+			o->speed = Vector(state.speedX[i], state.speedY[i]);
+			o->angSpeed = state.angSpeed[i];
+			if (integrate)
+			{
+				o->posBeforeIntegration = o->pos;
+				o->pos = Vector(state.posX[i], state.posY[i]);
+				o->angle = state.angle[i];
+				o->computeTransformedShape();
+				o->posBeforeCollision = o->pos;
+			}
+		}
+		
+		// objects with custom dynamics
+		for (size_t i = 0; i < customDynamicsObjects.size(); ++i)
+		{
+			if (integrate)
+				customDynamicsObjects[i]->initPhysicsInteractions(dt);
+			else
+				customDynamicsObjects[i]->applyForces(dt);
+		}
+	}
+	
+	void World::physicsStep(const std::vector<PhysicalObject *>& movingObjects, const std::vector<PhysicalObject *>& collidingObjects, double dt)
+	{
+		if (impulseSolver.enabled)
+		{
+			// solve contacts on velocities before integrating them, then correct remaining penetrations
+			applyForces(movingObjects, dt, false);
+			gatherContacts(collidingObjects, dt);
+			solveContactVelocities(dt);
+			for (size_t i = 0; i < movingObjects.size(); ++i)
+				movingObjects[i]->integrate(dt);
+			if (continuousCollisionDetection.enabled)
+				sweepFastObjects(movingObjects, collidingObjects, dt);
+			solveContactPositions();
+		}
+		else
+		{
+			// init physics interactions
+			applyForces(movingObjects, dt, true);
+			if (continuousCollisionDetection.enabled)
+				sweepFastObjects(movingObjects, collidingObjects, dt);
+			
+			// collide objects together
+			for (size_t i = 0; i < collidingObjects.size(); ++i)
+				for (size_t j = i + 1; j < collidingObjects.size(); ++j)
+					collideObjects(collidingObjects[i], collidingObjects[j]);
+		}
+		
+		// collide objects with walls and physics step
+		for (size_t i = 0; i < movingObjects.size(); ++i)
+		{
+			switch (wallsType)
+			{
+				case WALLS_SQUARE: collideWithSquareWalls(movingObjects[i]); break;
+				case WALLS_CIRCULAR: collideWithCircularWalls(movingObjects[i]); break;
+				default: break;
 			}
+			movingObjects[i]->finalizePhysicsInteractions(dt);
 		}
+	}
+	
+	//! A set of objects that might collide together during a step
+	struct PhysicsIsland
+	{
+		//! Indices of the movable objects of this island, in the order of World::objects
+		std::vector<size_t> members;
+		//! Indices of the static objects these members might collide with
+		std::vector<size_t> statics;
+		//! Whether any member might collide with the walls
+		bool touchingWalls;
+		//! Smallest radius of the members
+		double minRadius;
+		//! Largest speed of the boundary of the members
+		double maxSpeed;
+		//! Largest interlaced distance of the members during the last step
+		double maxInterlacedDistance;
 		
-		// init non-physics interactions
+		PhysicsIsland():
+			touchingWalls(false),
+			minRadius(std::numeric_limits<double>::max()),
+			maxSpeed(0),
+			maxInterlacedDistance(0)
+		{}
+	};
+	
+	//! Return the root of island i, compressing the path along the way
+	static size_t findIslandRoot(std::vector<size_t>& parents, size_t i)
+	{
+		while (parents[i] != i)
+		{
+			parents[i] = parents[parents[i]];
+			i = parents[i];
+		}
+		return i;
+	}
+	
+	//! Return how many physics steps are required for amount to be below tolerance in each of them, at most maxSteps
+	static unsigned requiredPhysicsSteps(double amount, double tolerance, unsigned maxSteps)
+	{
+		if (amount <= 0)
+			return 1;
+		if (tolerance <= 0 || amount / tolerance >= maxSteps)
+			return maxSteps;
+		return std::max(1u, unsigned(ceil(amount / tolerance)));
+	}
+	
+	void World::adaptivePhysicsStep(double dt)
+	{
+		const std::vector<PhysicalObject *> all(objects.begin(), objects.end());
+		const size_t count = all.size();
+		
+		// compute the radius each object can sweep during dt and whether it can reach walls
+		std::vector<double> reaches(count);
+		std::vector<bool> touchingWalls(count);
+		std::vector<size_t> parents(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const PhysicalObject* o(all[i]);
+			const double reach = o->r + (o->speed.norm() + fabs(o->angSpeed) * o->r) * dt;
+			switch (wallsType)
+			{
+				case WALLS_SQUARE: touchingWalls[i] = (o->pos.x < reach) || (o->pos.y < reach) || (o->pos.x > w - reach) || (o->pos.y > h - reach); break;
+				case WALLS_CIRCULAR: touchingWalls[i] = (o->pos.norm() + reach > r); break;
+				default: touchingWalls[i] = false; break;
+			}
+			reaches[i] = reach;
+			parents[i] = i;
+		}
+		
+		// merge objects whose swept bounding circles overlap, static objects do not merge islands
+		std::vector<std::pair<size_t, size_t> > staticContacts;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const bool iStatic(all[i]->mass < 0);
+			for (size_t j = i + 1; j < count; ++j)
+			{
+				const bool jStatic(all[j]->mass < 0);
+				if (iStatic && jStatic)
+					continue;
+				const double maxDist(reaches[i] + reaches[j]);
+				if ((all[i]->pos - all[j]->pos).norm2() > maxDist * maxDist)
+					continue;
+				if (iStatic)
+					staticContacts.push_back(std::make_pair(j, i));
+				else if (jStatic)
+					staticContacts.push_back(std::make_pair(i, j));
+				else
+					parents[findIslandRoot(parents, j)] = findIslandRoot(parents, i);
+			}
+		}
+		
+		// build islands
+		std::vector<PhysicalObject *> statics;
+		std::vector<PhysicsIsland> islands;
+		std::vector<size_t> islandOfRoot(count, count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const PhysicalObject* o(all[i]);
+			if (o->mass < 0)
+			{
+				statics.push_back(all[i]);
+				continue;
+			}
+			const size_t root(findIslandRoot(parents, i));
+			if (islandOfRoot[root] == count)
+			{
+				islandOfRoot[root] = islands.size();
+				islands.push_back(PhysicsIsland());
+			}
+			PhysicsIsland& island(islands[islandOfRoot[root]]);
+			island.members.push_back(i);
+			island.touchingWalls = island.touchingWalls || touchingWalls[i];
+			island.minRadius = std::min(island.minRadius, o->r);
+			island.maxSpeed = std::max(island.maxSpeed, o->speed.norm() + fabs(o->angSpeed) * o->r);
+			island.maxInterlacedDistance = std::max(island.maxInterlacedDistance, o->lastStepInterlacedDistance);
+		}
+		for (size_t i = 0; i < staticContacts.size(); ++i)
+			islands[islandOfRoot[findIslandRoot(parents, staticContacts[i].first)]].statics.push_back(staticContacts[i].second);
+		
+		// static objects do not collide together, so their physics does not need oversampling
+		physicsStep(statics, statics, dt);
+		
+		// run the physics of every island with its own oversampling
+		std::vector<PhysicalObject *> movingObjects, collidingObjects;
+		for (size_t i = 0; i < islands.size(); ++i)
+		{
+			PhysicsIsland& island(islands[i]);
+			
+			// objects of this island and static objects they might hit, in the order of World::objects
+			std::sort(island.statics.begin(), island.statics.end());
+			island.statics.erase(std::unique(island.statics.begin(), island.statics.end()), island.statics.end());
+			std::vector<size_t> colliding(island.members.size() + island.statics.size());
+			std::merge(island.members.begin(), island.members.end(), island.statics.begin(), island.statics.end(), colliding.begin());
+			movingObjects.clear();
+			for (size_t j = 0; j < island.members.size(); ++j)
+				movingObjects.push_back(all[island.members[j]]);
+			collidingObjects.clear();
+			for (size_t j = 0; j < colliding.size(); ++j)
+				collidingObjects.push_back(all[colliding[j]]);
+			
+			// isolated objects far from walls cannot collide, otherwise bound displacement and penetration
+			unsigned oversampling = 1;
+			if (island.members.size() > 1 || !island.statics.empty() || island.touchingWalls)
+			{
+				const unsigned maxOversampling(std::max(1u, adaptiveOversampling.maxOversampling));
+				oversampling = std::max(
+					requiredPhysicsSteps(island.maxSpeed * dt, adaptiveOversampling.maxDisplacementRatio * island.minRadius, maxOversampling),
+					requiredPhysicsSteps(island.maxInterlacedDistance, adaptiveOversampling.maxPenetrationRatio * island.minRadius, maxOversampling)
+				);
+			}
+			
+			const double overSampledDt = dt / (double)oversampling;
+			for (unsigned po = 0; po < oversampling; po++)
+				physicsStep(movingObjects, collidingObjects, overSampledDt);
+		}
+		
+		// remember penetration for the next step
+		for (size_t i = 0; i < count; ++i)
+			all[i]->lastStepInterlacedDistance = all[i]->interlacedDistance;
+	}
+
+	//! Load the random generator of a world into Enki::random during its step, and restore the one of the thread afterwards
+	class WorldRandomScope
+	{
+		FastRandom& worldRandom;
+		const FastRandom threadRandom;
+	
+	public:
+		WorldRandomScope(FastRandom& worldRandom):
+			worldRandom(worldRandom),
+			threadRandom(random)
+		{
+			random = worldRandom;
+		}
+		~WorldRandomScope()
+		{
+			worldRandom = random;
+			random = threadRandom;
+		}
+	};
+
+	void World::step(double dt, unsigned physicsOversampling)
+	{
+		// inputs applied since the last step, before anything uses them
+		if (inputJournal)
+			inputJournal->stepStarted(this, dt, physicsOversampling);
+		
+		// forks stepped in other threads draw from their own generator, so that results are reproducible
+		WorldRandomScope randomScope(worldRandom);
+		
+		// cache dynamics models, they can only change in control steps
+		if (batchIntegration)
+			for (ObjectsIterator i = objects.begin(); i != objects.end(); ++i)
+				(*i)->dynamicsModel = (*i)->getDynamicsModel((*i)->dynamicsCmdSpeed, (*i)->dynamicsCmdAngSpeed);
+		
+		if (adaptiveOversampling.enabled)
+		{
+			adaptivePhysicsStep(dt);
+		}
+		else
+		{
+			// oversampling physics
+			const std::vector<PhysicalObject *> all(objects.begin(), objects.end());
+			const double overSampledDt = dt / (double)physicsOversampling;
+			for (unsigned po = 0; po < physicsOversampling; po++)
+				physicsStep(all, all, overSampledDt);
+		}
+		
+		// forget contacts that disappeared during this step
+		for (ContactCache::iterator it = contactCache.begin(); it != contactCache.end();)
+		{
+			if (it->second.active)
+			{
+				it->second.active = false;
+				++it;
+			}
+			else
+				contactCache.erase(it++);
+		}
+		
+		// init non-physics interactions, with rotations up to date for objects that the physics did not move
 		for (ObjectsIterator i = objects.begin(); i != objects.end(); ++i)
 		{
+			(*i)->updateRotation();
 			(*i)->initLocalInteractions(dt, this);
 			(*i)->initGlobalInteractions(dt, this);
 		}
@@ -1109,7 +2123,10 @@ namespace Enki
 			o->doGlobalInteractions(dt, this);
 			o->finalizeLocalInteractions(dt, this);
 			o->finalizeGlobalInteractions(dt, this);
-			o->controlStep(dt);
+			if (inputJournal)
+				inputJournal->controlStep(o, dt);
+			else
+				o->controlStep(dt);
 		}
 		
 		// do a control step for the world
@@ -1117,11 +2134,31 @@ namespace Enki
 		// TODO: cleanup this
 		if (bluetoothBase)
 			bluetoothBase->step(dt, this);
+		
+		if (inputJournal)
+			inputJournal->stepEnded(this);
+		
+		// notify observers, on a copy as they might unregister themselves
+		const std::vector<StepObserver *> observers(stepObservers);
+		for (size_t i = 0; i < observers.size(); ++i)
+			observers[i]->worldStepped(this, dt);
+	}
+	
+	void World::addStepObserver(StepObserver* observer)
+	{
+		if (std::find(stepObservers.begin(), stepObservers.end(), observer) == stepObservers.end())
+			stepObservers.push_back(observer);
+	}
+	
+	void World::removeStepObserver(StepObserver* observer)
+	{
+		stepObservers.erase(std::remove(stepObservers.begin(), stepObservers.end(), observer), stepObservers.end());
 	}
 	
 	void World::addObject(PhysicalObject *o)
 	{
-		objects.insert(o);
+		// new objects have the largest uid, so they go at the end in constant time
+		objects.insert(objects.end(), o);
 	}
 
 	void World::removeObject(PhysicalObject *o)
@@ -1138,9 +2175,102 @@ namespace Enki
 	
 	void World::setRandomSeed(unsigned long seed)
 	{
+		worldRandom.setSeed(seed);
+		// objects might draw from the generator of the thread when being created
 		random.setSeed(seed);
 	}
 	
+	std::vector<uint8_t> World::saveState() const
+	{
+		std::vector<uint8_t> state;
+		StateWriter writer(state);
+		
+		// identify objects first, so that restoreState() can check them before changing anything
+		writer.write<uint32_t>(objects.size());
+		for (ObjectsIterator i = objects.begin(); i != objects.end(); ++i)
+			writer.write((*i)->uid);
+		// prefix the state of each object with its size, so that restoreState() can check the whole blob before restoring objects
+		for (ObjectsIterator i = objects.begin(); i != objects.end(); ++i)
+		{
+			const size_t sizePos(state.size());
+			writer.write<uint32_t>(0);
+			(*i)->saveState(writer);
+			const uint32_t size(state.size() - sizePos - sizeof(uint32_t));
+			memcpy(&state[sizePos], &size, sizeof(uint32_t));
+		}
+		
+		writer.write(worldRandom.getState());
+		
+		writer.write<uint32_t>(contactCache.size());
+		for (ContactCache::const_iterator it = contactCache.begin(); it != contactCache.end(); ++it)
+		{
+			writer.write(it->first.first);
+			writer.write(it->first.second);
+			writer.write(it->second.impulse);
+			writer.write(it->second.active);
+		}
+		
+		return state;
+	}
+	
+	void World::restoreState(const std::vector<uint8_t>& state)
+	{
+		StateReader reader(state);
+		
+		uint32_t objectCount;
+		reader.read(objectCount);
+		if (objectCount != objects.size())
+			throw std::runtime_error("state was saved with a different number of objects");
+		for (ObjectsIterator i = objects.begin(); i != objects.end(); ++i)
+		{
+			unsigned uid;
+			reader.read(uid);
+			if (uid != (*i)->uid)
+				throw std::runtime_error("state was saved with different objects");
+		}
+		
+		// read the rest of the blob into temporaries, so that this world is unchanged if it is invalid
+		std::vector<std::pair<const uint8_t*, uint32_t> > objectStates;
+		objectStates.reserve(objects.size());
+		for (size_t i = 0; i < objects.size(); ++i)
+		{
+			uint32_t size;
+			reader.read(size);
+			objectStates.push_back(std::make_pair(reader.skip(size), size));
+		}
+		
+		unsigned long randomState;
+		reader.read(randomState);
+		
+		uint32_t contactCount;
+		reader.read(contactCount);
+		ContactCache restoredContactCache;
+		for (uint32_t i = 0; i < contactCount; ++i)
+		{
+			ContactCache::key_type key;
+			reader.read(key.first);
+			reader.read(key.second);
+			CachedContact& contact(restoredContactCache[key]);
+			reader.read(contact.impulse);
+			reader.read(contact.active);
+		}
+		
+		if (!reader.atEnd())
+			throw std::runtime_error("state contains unexpected trailing data");
+		
+		// Bluetooth modules register again with their saved addresses
+		if (bluetoothBase)
+			bluetoothBase->removeAllClients();
+		size_t index(0);
+		for (ObjectsIterator i = objects.begin(); i != objects.end(); ++i, ++index)
+		{
+			StateReader objectReader(objectStates[index].first, objectStates[index].second);
+			(*i)->restoreState(objectReader);
+		}
+		worldRandom.setSeed(randomState);
+		contactCache.swap(restoredContactCache);
+	}
+	
 	void World::initBluetoothBase()
 	{
 		bluetoothBase = new BluetoothBase();
@@ -39,10 +39,14 @@
 #include "Random.h"
 #include "Interaction.h"
 #include "BluetoothBase.h"
+#include "Serialization.h"
 #include <iostream>
 #include <set>
+#include <map>
+#include <memory>
 #include <vector>
 #include <valarray>
+#include <typeinfo>
 
 
 /*!	\file PhysicalEngine.h
@@ -125,12 +129,14 @@ Mobots group - Laboratoire de Systèmes Robotiques,
 namespace Enki
 {
 	class World;
+	class InputJournal;
 
 	//! A situated object in the world with mass, geometry properties, physical properties, ...
 	/*! \ingroup core */
 	class PhysicalObject
 	{
 		friend class World;
+		friend class InputJournal;
 		
 	public:			// inner classes
 		
@@ -203,12 +209,12 @@ namespace Enki
 			// getters
 			inline double getHeight() const { return height; }
 			inline double getArea() const { return area; }
-			inline const Polygon& getShape() const { return shape; }
+			inline const Polygon& getShape() const { return *shape; }
 			inline const Polygon& getTransformedShape() const { return transformedShape; }
 			inline const Point& getCentroid() const { return centroid; }
 			inline const Point& getTransformedCentroid() const { return transformedCentroid; }
-			inline const Textures& getTextures() const { return textures; }
-			inline bool isTextured() const { return !textures.empty(); }
+			inline const Textures& getTextures() const { return *textures; }
+			inline bool isTextured() const { return !textures->empty(); }
 			
 		private:
 			friend class PhysicalObject;
@@ -218,8 +224,8 @@ namespace Enki
 			double height;
 			//! The area of this part
 			double area;
-			//! The shape of the part in object coordinates.
-			Polygon shape;
+			//! The shape of the part in object coordinates, shared between copies of this part and replaced by applyTransformation().
+			std::shared_ptr<const Polygon> shape;
 			//! The shape of the part in world coordinates, updated on initPhysicsInteractions().
 			Polygon transformedShape;
 			//! The centroid (barycenter) of the part in object coordinates.
@@ -229,8 +235,8 @@ namespace Enki
 			
 			// visual properties
 			
-			//! Texture for several faces of this object.
-			Textures textures;
+			//! Texture for several faces of this object, shared between copies of this part.
+			std::shared_ptr<const Textures> textures;
 		
 		private:
 			//! Compute the area and the centroid (barycenter) of this shape in object coordinates.
@@ -256,15 +262,31 @@ namespace Enki
 			void applyTransformation(const Matrix22& rot, const Point& trans, double* radius = 0);
 		};
 		
+		//! Dynamics models that World can integrate for many objects at once, without calling applyForces()
+		enum DynamicsModel
+		{
+			DYNAMICS_CUSTOM = 0,			//!< applyForces() must be called
+			DYNAMICS_FRICTION,				//!< dry and viscous friction, as PhysicalObject::applyForces()
+			DYNAMICS_DIFFERENTIAL_WHEELED	//!< speeds set by the wheels, as DifferentialWheeled::applyForces()
+		};
+		
 	private:		// variables
 		
 		// Physics
 		
 		//! position before collision, used to compute interlacedDistance
 		Vector posBeforeCollision;
+		//! position before the last integration, used by continuous collision detection
+		Vector posBeforeIntegration;
 		
 		//! How much this object did penetrate other objects in the course of physics steps since last control step
 		double interlacedDistance;
+		//! Value of interlacedDistance at the end of the physics of the last step, used by adaptive oversampling
+		double lastStepInterlacedDistance;
+		//! Rotation matrix of rotationAngle, updated by updateRotation()
+		Matrix22 rotation;
+		//! Angle for which rotation was computed
+		double rotationAngle;
 		
 		// mass and inertia tensor
 		
@@ -284,6 +306,15 @@ namespace Enki
 		//! The overall color of this object, if hull is empty or if it does not contain any texture
 		Color color;
 		
+		// Dynamics model, cached by World at the beginning of each step
+		
+		//! Value returned by getDynamicsModel()
+		DynamicsModel dynamicsModel;
+		//! Commanded tangent speed returned by getDynamicsModel()
+		double dynamicsCmdSpeed;
+		//! Commanded angular speed returned by getDynamicsModel()
+		double dynamicsCmdAngSpeed;
+		
 	public:			// methods
 		
 		//! Constructor
@@ -301,6 +332,8 @@ namespace Enki
 		inline double getMass() const { return mass; }
 		inline double getMomentOfInertia() const { return momentOfInertia; }
 		inline double getInterlacedDistance() const { return interlacedDistance; }
+		//! Return the rotation matrix of angle, as updated by the physics and at the beginning of the interactions of each step, so that concurrent reads are safe
+		inline const Matrix22& getRotation() const { return rotation; }
 		
 		// setters
 		
@@ -310,9 +343,25 @@ namespace Enki
 		void setRectangular(double l1, double l2, double height, double mass);
 		//! Set a custom shape and mass to the object
 		void setCustomHull(const Hull& hull, double mass);
+		//! Set a custom shape, mass and moment of inertia to a robot, sharing the shapes and textures of hull; faster than setCustomHull(hull, mass) as the moment of inertia is not computed
+		void setCustomHull(const Hull& hull, double mass, double momentOfInertia);
+		//! Set the shape and mass of other to the object, sharing the shapes and textures of its hull; faster than setCustomHull() as nothing is recomputed
+		void setShape(const PhysicalObject& other);
 		//! Set the overall color of this object, if hull is empty or if it does not contain any texture
 		void setColor(const Color &color);
 
+		//! Return the model implemented by applyForces() and, for DYNAMICS_DIFFERENTIAL_WHEELED, the commanded tangent and angular speeds; DYNAMICS_FRICTION if hasDefaultDynamics(), DYNAMICS_CUSTOM otherwise
+		virtual DynamicsModel getDynamicsModel(double& cmdSpeed, double& cmdAngSpeed) const { return hasDefaultDynamics() ? DYNAMICS_FRICTION : DYNAMICS_CUSTOM; }
+		
+		//! Append the dynamic state of this object (pose, speeds, interlaced distance, color) to writer. Subclasses with additional dynamic state must call this implementation first.
+		virtual void saveState(StateWriter& writer) const;
+		//! Restore in place the dynamic state appended by saveState()
+		virtual void restoreState(StateReader& reader);
+		//! Append the state that controllers and external code set (pose, speeds, color) to writer, see InputJournal. Subclasses with additional commands must call this implementation first.
+		virtual void saveInputs(StateWriter& writer) const;
+		//! Restore in place the state appended by saveInputs()
+		virtual void restoreInputs(StateReader& reader);
+
 		//! A struct with bitfields for buttons
 		enum MouseButtonCode
 		{
@@ -335,6 +384,15 @@ namespace Enki
 		void setupCenterOfMass();
 		//! Compute the hull of this object in world coordinates.
 		void computeTransformedShape();
+		//! Recompute rotation if angle has changed since the last call
+		void updateRotation() { if (angle != rotationAngle) { rotation = Matrix22(angle); rotationAngle = angle; } }
+	
+	protected:		// dynamics model
+		
+		//! Most derived class known to keep the applyForces() of PhysicalObject or DifferentialWheeled, set by its constructor; subclasses of it get DYNAMICS_CUSTOM unless their constructor sets it too, so that batchIntegration never skips an overridden applyForces()
+		const std::type_info* defaultDynamicsClass;
+		//! Return whether this object is of class defaultDynamicsClass exactly
+		bool hasDefaultDynamics() const { return typeid(*this) == *defaultDynamicsClass; }
 	
 	protected:		// physical actions
 		
@@ -363,11 +421,16 @@ namespace Enki
 		virtual void doGlobalInteractions(double dt, World* w) { }
 		//! All global interactions are finished, do nothing for PhysicalObject.
 		virtual void finalizeGlobalInteractions(double dt, World* w) { }
+		
+		//! Return a copy of this object, sharing the shapes and textures of its hull, used by World::fork(). Subclasses owning interactions or resources must override it and return an object of their own type.
+		virtual PhysicalObject* clone() const;
 
 	private:		// physical actions
 		
 		//! Initialize the collision logic
 		void initPhysicsInteractions(double dt);
+		//! Integrate speeds into position and orientation, then update the hull in world coordinates
+		void integrate(double dt);
 		//! All collisions are finished, deinterlace the object.
 		void finalizePhysicsInteractions(double dt);
 		
@@ -375,6 +438,8 @@ namespace Enki
 		void collideWithStaticObject(const Vector &n, const Point &cp);
 		//! Dynamics for collision with that at point cp (on that) with a penetrated distance of dist,
 		void collideWithObject(PhysicalObject &that, Point cp, const Vector &dist);
+		//! Dynamics for collision with that, which has a finite mass, at point cp with normal vector n pointing towards this, without de-penetration
+		void collideWithMovableObject(PhysicalObject &that, const Point &cp, const Vector &n);
 
 	public:
 		//! ID is used when sharing a world over the network where it should be
@@ -390,14 +455,25 @@ namespace Enki
 	protected:
 		//! Vector of local interactions
 		std::vector<LocalInteraction *> localInteractions;
+		//! The local interactions in their order of registration
+		std::vector<LocalInteraction *> registeredLocalInteractions;
 		//! Vector of global interactions
 		std::vector<GlobalInteraction *> globalInteractions;
 		
 	public:
+		//! Constructor
+		Robot() {}
+		//! Copy constructor, does not copy the interactions as they point into other, see copyLocalInteraction()
+		Robot(const Robot& other) : PhysicalObject(other) {}
+		
 		//! Add a new local interaction, re-sort interaction vector from long ranged to short ranged.
 		void addLocalInteraction(LocalInteraction *li);
 		//! Add a global interaction, just add it at the end of the vector.
 		void addGlobalInteraction(GlobalInteraction *gi) {globalInteractions.push_back(gi);}
+		//! Return the local interactions, sorted from long ranged to short ranged
+		const std::vector<LocalInteraction *>& getLocalInteractions() const { return localInteractions; }
+		//! Return the local interactions in their order of registration, which for the sensors of robots is that of their indices
+		const std::vector<LocalInteraction *>& getRegisteredLocalInteractions() const { return registeredLocalInteractions; }
 		//! Initialize the local interactions, call init on each one.
 		virtual void initLocalInteractions(double dt, World* w);
 		//! Do the local interactions with other objects, call objectStep on each one.
@@ -409,16 +485,40 @@ namespace Enki
 		
 		//! Do the global interactions, call step on each one.
 		virtual void doGlobalInteractions(double dt, World* w);
+		
+		//! Append the dynamic state of this robot and of all its interactions to writer
+		virtual void saveState(StateWriter& writer) const;
+		//! Restore in place the dynamic state appended by saveState()
+		virtual void restoreState(StateReader& reader);
 		//! Sort local interactions. Called by addLocalInteraction ; can be called by subclasses in case of interaction radius change.
 		void sortLocalInteractions(void);
+	
+	protected:
+		//! Return a copy of this robot with copies of its interactions
+		virtual PhysicalObject* clone() const;
+		//! If otherInteraction is registered in other, attach interaction, its copy in this robot, to this robot and register it; the clone() of subclasses call it for every member interaction, in the order of their constructor
+		void copyLocalInteraction(const Robot& other, const LocalInteraction& otherInteraction, LocalInteraction& interaction);
 	};
 
+	//! An object notified at the end of every step of the worlds it is registered to, see World::stepObservers
+	/*! \ingroup core */
+	class StepObserver
+	{
+	public:
+		//! Destructor
+		virtual ~StepObserver() {}
+		//! Called at the end of World::step(), after the control steps of objects and of world
+		virtual void worldStepped(World* world, double dt) = 0;
+	};
+	
 	//! The world is the container of all objects and robots.
 	/*! It is either a rectangular arena with walls at all sides, a circular area with walls, or an infinite surface.
 		\ingroup core
 	*/
 	class World
 	{
+		friend class InputJournal;
+		
 	public:
 		//! Type of walls around the world
 		enum WallsType
@@ -458,10 +558,20 @@ namespace Enki
 			GroundTexture(unsigned width, unsigned height, const uint32_t* data);
 		};
 		
+	protected:
+		//! Storage of groundTexture, shared with the forks of this world
+		std::shared_ptr<const GroundTexture> sharedGroundTexture;
+		
+	public:
 		//! Current ground texture
-		const GroundTexture groundTexture;
+		const GroundTexture& groundTexture;
 		
-		typedef std::set<PhysicalObject *> Objects;
+		//! Order of objects in a world, by uid, so that iterating over them is reproducible and the same in forks
+		struct ObjectsOrder
+		{
+			bool operator()(const PhysicalObject* o1, const PhysicalObject* o2) const { return o1->uid < o2->uid; }
+		};
+		typedef std::set<PhysicalObject *, ObjectsOrder> Objects;
 		typedef Objects::iterator ObjectsIterator;
 		
 		//! Whether the world should delete the objects upon destruction, true by default
@@ -471,10 +581,185 @@ namespace Enki
 		Objects objects;
 		//! Base for the Bluetooth connections between robots
 		BluetoothBase* bluetoothBase;
+		//! Observers notified at the end of every step, in order; they are not owned by the world and not copied to its forks
+		std::vector<StepObserver *> stepObservers;
+		//! Journal recording or replaying the inputs of this world, 0 by default, see InputJournal
+		InputJournal* inputJournal;
+		
+		//! Parameters of the adaptive physics oversampling, see step()
+		struct AdaptiveOversampling
+		{
+			//! If true, step() ignores physicsOversampling and chooses the oversampling of each island of interacting objects, false by default
+			bool enabled;
+			//! Maximum displacement of the boundary of an object during a physics step, relative to the smallest radius of its island
+			double maxDisplacementRatio;
+			//! Maximum interlaced distance accumulated during the last step, relative to the smallest radius of its island
+			double maxPenetrationRatio;
+			//! Upper bound of the oversampling of any island
+			unsigned maxOversampling;
+			
+			//! Constructor, adaptive oversampling is disabled
+			AdaptiveOversampling();
+		};
+		//! Adaptive physics oversampling, disabled by default
+		AdaptiveOversampling adaptiveOversampling;
+		
+		//! Parameters of the sequential impulse contact solver
+		struct ImpulseSolver
+		{
+			//! If true, contacts between objects are gathered and solved iteratively instead of pairwise in loop order, false by default
+			bool enabled;
+			//! Number of iterations of the velocity and of the position solvers
+			unsigned iterations;
+			//! If true, contacts start with the impulse they last accumulated, earlier in the current step or during the previous one
+			bool warmStarting;
+			//! Fraction of the remaining penetration removed at each iteration of the position solver
+			double positionCorrection;
+			//! Penetration left uncorrected, so that resting contacts persist between physics steps
+			double allowedPenetration;
+			//! Approaching speed below which new contacts are inelastic, it should be above the speed at which robots push each other in crowds, twice their speed when they face each other
+			double restitutionThreshold;
+			
+			//! Constructor, the solver is disabled
+			ImpulseSolver();
+		};
+		//! Sequential impulse contact solver, disabled by default
+		ImpulseSolver impulseSolver;
+		
+		//! Parameters of continuous collision detection
+		struct ContinuousCollisionDetection
+		{
+			//! If true, the bounding circle of fast objects is swept along their displacement to find the time of impact, false by default
+			bool enabled;
+			//! Displacement during a physics step, relative to the radius, above which an object is considered fast
+			double minDisplacementRatio;
+			//! Maximum number of impacts a fast object can have during a physics step
+			unsigned maxImpacts;
+			
+			//! Constructor, continuous collision detection is disabled
+			ContinuousCollisionDetection();
+		};
+		//! Continuous collision detection, disabled by default
+		ContinuousCollisionDetection continuousCollisionDetection;
+		
+		//! If true, objects whose dynamics model is not DYNAMICS_CUSTOM are integrated in batch through kinematicState instead of calling their applyForces(), false by default; the headings of differential wheeled objects then go through sinCos(), whose results differ from std::sin() and std::cos() by rounding
+		bool batchIntegration;
 
 	protected:
+		//! A contact between two objects; o1 must move along mtv to get out of o2, point lies on the boundary of o2
+		struct Contact
+		{
+			PhysicalObject *o1; //!< first object, pushed along the normal
+			PhysicalObject *o2; //!< second object, pushed against the normal
+			Point point; //!< contact point, in world coordinates
+			Vector mtv; //!< minimum translation vector getting o1 out of o2
+			
+			// data used by the impulse solver
+			Vector normal; //!< unitary normal, direction of mtv
+			double depth; //!< penetration depth, norm of mtv, or negative distance for speculative contacts
+			Vector r1; //!< contact point relative to o1
+			Vector r2; //!< contact point relative to o2
+			Point pos1; //!< position of o1 when the contact was found
+			Point pos2; //!< position of o2 when the contact was found
+			double invMass1; //!< inverse mass of o1, 0 if static
+			double invMass2; //!< inverse mass of o2, 0 if static
+			double invInertia1; //!< inverse moment of inertia of o1, 0 if static
+			double invInertia2; //!< inverse moment of inertia of o2, 0 if static
+			double normalMass; //!< effective mass along the normal
+			double bounce; //!< target separating speed due to elasticity
+			double impulse; //!< impulse accumulated along the normal
+			bool resting; //!< whether this contact was already present earlier in the current step or during the previous one
+		};
+		//! Impulse last accumulated by the contact between two objects, kept until a step without this contact, for warm starting
+		struct CachedContact
+		{
+			double impulse; //!< accumulated impulse
+			bool active; //!< whether the contact was present during the current step
+		};
+		//! Cached contacts, indexed by the smaller then the larger uid of the two objects
+		typedef std::map<std::pair<unsigned, unsigned>, CachedContact> ContactCache;
+		
+		//! Structure-of-arrays copy of the kinematic state of objects, integrated without virtual calls
+		/*!
+			It is filled from the objects at the beginning of every physics step and copied back
+			before collisions, so the members of objects stay valid for user code between steps.
+		*/
+		struct KinematicState
+		{
+			//! Mirrored objects, first those with DYNAMICS_FRICTION, then those with DYNAMICS_DIFFERENTIAL_WHEELED
+			std::vector<PhysicalObject *> objects;
+			//! Number of objects with DYNAMICS_FRICTION
+			size_t frictionCount;
+			
+			// state
+			std::vector<double> posX; //!< x of PhysicalObject::pos
+			std::vector<double> posY; //!< y of PhysicalObject::pos
+			std::vector<double> angle; //!< PhysicalObject::angle
+			std::vector<double> speedX; //!< x of PhysicalObject::speed
+			std::vector<double> speedY; //!< y of PhysicalObject::speed
+			std::vector<double> angSpeed; //!< PhysicalObject::angSpeed
+			
+			// parameters
+			std::vector<double> dryFrictionCoefficient; //!< PhysicalObject::dryFrictionCoefficient
+			std::vector<double> viscousFrictionCoefficient; //!< PhysicalObject::viscousFrictionCoefficient
+			std::vector<double> viscousMomentFrictionCoefficient; //!< PhysicalObject::viscousMomentFrictionCoefficient
+			std::vector<double> cmdSpeed; //!< commanded tangent speed of differential wheeled objects
+			std::vector<double> cmdAngSpeed; //!< commanded angular speed of differential wheeled objects
+			
+			// scratch arrays
+			std::vector<double> heading; //!< heading of differential wheeled objects at mid step
+			std::vector<double> headingSin; //!< sine of heading
+			std::vector<double> headingCos; //!< cosine of heading
+			
+			//! Resize all arrays to hold count objects
+			void resize(size_t count);
+			//! Apply friction to objects with DYNAMICS_FRICTION, as PhysicalObject::applyForces()
+			void applyFrictionForces(double dt);
+			//! Set speeds of objects with DYNAMICS_DIFFERENTIAL_WHEELED, as DifferentialWheeled::applyForces()
+			void applyDifferentialWheeledForces(double dt);
+			//! Integrate speeds into positions and angles
+			void integrate(double dt);
+		};
+		
+		//! Kinematic state of objects being integrated in batch
+		KinematicState kinematicState;
+		//! Objects with DYNAMICS_CUSTOM, in the current physics step
+		std::vector<PhysicalObject *> customDynamicsObjects;
+		
+		//! Cache of contacts of the impulse solver
+		ContactCache contactCache;
+		//! Contacts gathered during the current physics step by the impulse solver
+		std::vector<Contact> contacts;
+		
+		//! Random generator of this world, loaded into Enki::random during step(); seeded with 0, so worlds that are not given a seed draw the same numbers
+		FastRandom worldRandom;
+		
+		//! Run physics for dt on movingObjects, colliding objects in collidingObjects (that must contain movingObjects) together and with walls.
+		void physicsStep(const std::vector<PhysicalObject *>& movingObjects, const std::vector<PhysicalObject *>& collidingObjects, double dt);
+		//! Apply forces to movingObjects, in batch for those with a known dynamics model if batchIntegration is true, and integrate them if integrate is true
+		void applyForces(const std::vector<PhysicalObject *>& movingObjects, double dt, bool integrate);
+		//! Run physics for dt, splitting objects into islands that can collide during dt and oversampling each island depending on its speed and penetration.
+		void adaptivePhysicsStep(double dt);
+		//! Find the deepest contact between two objects, return false if they do not collide
+		bool findContact(PhysicalObject *object1, PhysicalObject *object2, Contact& contact) const;
 		//! Collide two objects. Correct functions will be called depending on type of object (circular or other shape).
 		void collideObjects(PhysicalObject *object1, PhysicalObject *object2);
+		//! Return the key of the contact between o1 and o2 in contactCache, whatever their order
+		static ContactCache::key_type contactKey(const PhysicalObject *o1, const PhysicalObject *o2);
+		//! Gather the contacts between collidingObjects, including speculative ones between cylinders that might touch during dt
+		void gatherContacts(const std::vector<PhysicalObject *>& collidingObjects, double dt);
+		//! Solve the gathered contacts on velocities with sequential impulses, warm started from contactCache
+		void solveContactVelocities(double dt);
+		//! Correct the remaining penetration of the gathered contacts
+		void solveContactPositions();
+		//! Apply an impulse along the normal of a contact, positive values separate the objects
+		void applyContactImpulse(const Contact& contact, double impulse);
+		//! Return the relative speed of the objects of a contact along its normal, negative if they are approaching
+		double getContactNormalSpeed(const Contact& contact) const;
+		//! Return true and set time of impact (in [0,1]), normal (towards object) and contact point if the bounding circle of object, moving from start by displacement, hits other
+		bool findTimeOfImpact(const PhysicalObject *object, const Point& start, const Vector& displacement, const PhysicalObject *other, double& toi, Vector& normal, Point& cp) const;
+		//! Move fast objects back to their first time of impact with collidingObjects during the last integration of dt, collide them, and integrate the remaining time
+		void sweepFastObjects(const std::vector<PhysicalObject *>& movingObjects, const std::vector<PhysicalObject *>& collidingObjects, double dt);
 		//! Collide the object with square walls.
 		void collideWithSquareWalls(PhysicalObject *object);
 		//! Collide the object with circular walls.
@@ -490,12 +775,34 @@ namespace Enki
 		//! Destructor, destroy all objects
 		virtual ~World();
 		
+		//! Return a new world with copies of the objects of this one, that can be stepped independently, for instance to evaluate plans ahead of time
+		/*!
+			Hull shapes, textures and the ground texture are shared with this world,
+			the dynamic state of objects, the settings of this world, the contacts cached by
+			the impulse solver and the state of the random generator are copied, so that
+			stepping the fork and this world with the same commands gives the same results.
+			Forks own their objects and are independent of this world, they can be stepped
+			concurrently in different threads. The userData of copied objects is 0.
+			Throw std::runtime_error if an object does not implement PhysicalObject::clone(),
+			which is the case of s-bots.
+		*/
+		World* fork() const;
+		
 		//! Return whether the ground has a texture
 		bool hasGroundTexture() const;
 		//! Return the color of the ground at a given point, or white.
 		Color getGroundColor(const Point& p) const;
 		
 		//! Simulate a timestep of dt. dt should be below 1 (typically .02-.1); physicsOversampling is the amount of time the physics is run per step, as usual collisions require a more precise simulation than the sensor-motor loop frequency.
+		/*!
+			If adaptiveOversampling.enabled is true, physicsOversampling is ignored.
+			Objects whose swept bounding circles overlap are then grouped into islands,
+			and each island is oversampled so that no object boundary moves by more than
+			adaptiveOversampling.maxDisplacementRatio times the smallest radius of the island
+			in a physics step. The oversampling is also increased for islands that penetrated
+			more than adaptiveOversampling.maxPenetrationRatio times this radius during the last step.
+			Isolated objects far from walls are integrated in a single physics step.
+		*/
 		virtual void step(double dt, unsigned physicsOversampling = 1);
 		//! Add an object to the world, simply add it to the vector. Object will be automatically deleted when world will be destroyed.
 		//! If the object is already in the world, do nothing
@@ -506,19 +813,40 @@ namespace Enki
 		void disconnectExternalObjectsUserData();
 		
 		//! Set the seed of the random generator.
+		/*!
+			The seed is 0 until this is called, so that unseeded worlds draw the same random numbers.
+			fork() copies the generator, so a fork draws the same numbers as this world unless it is
+			given a seed of its own, for instance to run independent trials from the same state.
+		*/
 		void setRandomSeed(unsigned long seed);
+		
+		//! Return a binary snapshot of the dynamic state of this world
+		/*!
+			The snapshot contains the dynamic state of all objects (see PhysicalObject::saveState()),
+			the state of the random generator, the Bluetooth connections and the contacts cached by
+			the impulse solver. It does not contain parameters such as shapes, masses or the settings
+			of this world. It can only be restored into this world, as long as no object was added or removed.
+		*/
+		std::vector<uint8_t> saveState() const;
+		//! Restore in place a snapshot created by saveState(), without reallocating objects; throw std::runtime_error and leave this world unchanged if the snapshot does not match its objects, is truncated or has trailing data
+		void restoreState(const std::vector<uint8_t>& state);
 		//! Initialise and activate the Bluetooth base
 		void initBluetoothBase();
 		//! Return the address of the Bluetooth base
 		BluetoothBase* getBluetoothBase();
+		//! Add an observer notified at the end of every step, if it is not already registered
+		void addStepObserver(StepObserver* observer);
+		//! Remove an observer added with addStepObserver(), if it is registered
+		void removeStepObserver(StepObserver* observer);
 	
 	protected:
 		//! Can implement world specific control. By default do nothing
 		virtual void controlStep(double dt) { }
+		//! Copy the settings and the state of other, but not its objects, see fork()
+		World(const World& other);
+		//! Implementation of fork(); if requireSameClass is false, objects whose class does not implement clone() are copied as the closest base class that does
+		World* fork(bool requireSameClass) const;
 	};
-	
-	//! Fast random for use by Enki
-	extern FastRandom random;
 }
 
 #endif
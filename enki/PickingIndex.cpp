@@ -0,0 +1,331 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#include "PickingIndex.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+/*!	\file PickingIndex.cpp
+	\brief Implementation of the spatial index to pick objects with rays
+*/
+
+namespace Enki
+{
+	//! Bounding circles spanning more cells than this along an axis are not stored in cells
+	static const int MAX_CELLS_SPAN = 16;
+	
+	Ray::Ray(double ox, double oy, double oz, double dx, double dy, double dz)
+	{
+		origin[0] = ox; origin[1] = oy; origin[2] = oz;
+		direction[0] = dx; direction[1] = dy; direction[2] = dz;
+	}
+	
+	void Ray::at(double t, double point[3]) const
+	{
+		for (unsigned i = 0; i < 3; ++i)
+			point[i] = origin[i] + t * direction[i];
+	}
+	
+	//! Restrict [t0, t1] to the part of the line o + t * d that lies in [low, high], return whether it is not empty
+	static bool clipSlab(double o, double d, double low, double high, double& t0, double& t1)
+	{
+		if (d == 0)
+			return o >= low && o <= high;
+		double ta((low - o) / d);
+		double tb((high - o) / d);
+		if (ta > tb)
+			std::swap(ta, tb);
+		t0 = std::max(t0, ta);
+		t1 = std::min(t1, tb);
+		return t0 <= t1;
+	}
+	
+	//! Restrict [t0, t1] to where f0 + t * slope >= 0, return whether it is not empty
+	static bool clipHalfLine(double f0, double slope, double& t0, double& t1)
+	{
+		if (slope == 0)
+			return f0 >= 0;
+		const double t(-f0 / slope);
+		if (slope > 0)
+			t0 = std::max(t0, t);
+		else
+			t1 = std::min(t1, t);
+		return t0 <= t1;
+	}
+	
+	PickingIndex::PickingIndex():
+		cellSize(1),
+		maxHeight(0),
+		minCellX(0),
+		minCellY(0),
+		maxCellX(-1),
+		maxCellY(-1)
+	{
+	}
+	
+	void PickingIndex::build(const World* world)
+	{
+		clear();
+		for (World::Objects::const_iterator it = world->objects.begin(); it != world->objects.end(); ++it)
+			add(*it, (*it)->pos, (*it)->angle);
+		finalize();
+	}
+	
+	void PickingIndex::build(const WorldSnapshot& snapshot)
+	{
+		clear();
+		for (std::vector<WorldSnapshot::Object>::const_iterator it = snapshot.objects.begin(); it != snapshot.objects.end(); ++it)
+			add(it->object, it->pos, it->angle);
+		finalize();
+	}
+	
+	void PickingIndex::clear()
+	{
+		entries.clear();
+		cells.clear();
+		largeEntries.clear();
+		maxHeight = 0;
+		minCellX = minCellY = 0;
+		maxCellX = maxCellY = -1;
+	}
+	
+	void PickingIndex::add(PhysicalObject* object, const Point& pos, double angle)
+	{
+		Entry entry;
+		entry.object = object;
+		entry.pos = pos;
+		entry.angle = angle;
+		entry.radius = object->getRadius();
+		entry.height = object->getHeight();
+		entries.push_back(entry);
+		maxHeight = std::max(maxHeight, entry.height);
+	}
+	
+	//! Choose the size of cells from the objects and store them in cells
+	void PickingIndex::finalize()
+	{
+		if (entries.empty())
+			return;
+		
+		// a few typical objects per cell
+		double radiusSum(0);
+		for (size_t i = 0; i < entries.size(); ++i)
+			radiusSum += entries[i].radius;
+		cellSize = std::max(1., 4. * radiusSum / entries.size());
+		
+		minCellX = minCellY = std::numeric_limits<int>::max();
+		maxCellX = maxCellY = std::numeric_limits<int>::min();
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			const Entry& entry(entries[i]);
+			const int x0(cellCoordinate(entry.pos.x - entry.radius));
+			const int x1(cellCoordinate(entry.pos.x + entry.radius));
+			const int y0(cellCoordinate(entry.pos.y - entry.radius));
+			const int y1(cellCoordinate(entry.pos.y + entry.radius));
+			if (x1 - x0 >= MAX_CELLS_SPAN || y1 - y0 >= MAX_CELLS_SPAN)
+			{
+				largeEntries.push_back(i);
+				continue;
+			}
+			for (int x = x0; x <= x1; ++x)
+				for (int y = y0; y <= y1; ++y)
+					cells.push_back(CellEntry(cellKey(x, y), i));
+			minCellX = std::min(minCellX, x0);
+			minCellY = std::min(minCellY, y0);
+			maxCellX = std::max(maxCellX, x1);
+			maxCellY = std::max(maxCellY, y1);
+		}
+		std::sort(cells.begin(), cells.end());
+	}
+	
+	uint64_t PickingIndex::cellKey(int x, int y) const
+	{
+		return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y));
+	}
+	
+	int PickingIndex::cellCoordinate(double v) const
+	{
+		return int(std::floor(v / cellSize));
+	}
+	
+	//! Add the entries of the cells overlapping the box to candidates
+	void PickingIndex::queryCells(double xMin, double yMin, double xMax, double yMax) const
+	{
+		const int x0(std::max(minCellX, cellCoordinate(xMin)));
+		const int x1(std::min(maxCellX, cellCoordinate(xMax)));
+		const int y0(std::max(minCellY, cellCoordinate(yMin)));
+		const int y1(std::min(maxCellY, cellCoordinate(yMax)));
+		for (int x = x0; x <= x1; ++x)
+		{
+			for (int y = y0; y <= y1; ++y)
+			{
+				const uint64_t key(cellKey(x, y));
+				std::vector<CellEntry>::const_iterator it(std::lower_bound(cells.begin(), cells.end(), CellEntry(key, 0)));
+				for (; it != cells.end() && it->first == key; ++it)
+					candidates.push_back(it->second);
+			}
+		}
+	}
+	
+	bool PickingIndex::pick(const Ray& ray, Hit& hit, double maxT, double tolerance) const
+	{
+		const double* o(ray.origin);
+		const double* d(ray.direction);
+		
+		// the ground
+		bool found(false);
+		double bestT(maxT);
+		hit.object = 0;
+		if (d[2] < 0 && o[2] >= 0 && -o[2] / d[2] <= maxT)
+		{
+			bestT = -o[2] / d[2];
+			found = true;
+		}
+		
+		// the part of the ray below the highest object and within the cells
+		double t0(0), t1(bestT);
+		if (!entries.empty() &&
+			clipSlab(o[2], d[2], 0, maxHeight, t0, t1))
+		{
+			candidates.clear();
+			const double margin(tolerance + cellSize);
+			if (maxCellX >= minCellX &&
+				clipSlab(o[0], d[0], minCellX * cellSize - margin, (maxCellX + 1) * cellSize + margin, t0, t1) &&
+				clipSlab(o[1], d[1], minCellY * cellSize - margin, (maxCellY + 1) * cellSize + margin, t0, t1))
+			{
+				// query cells along the ray, a cell-long piece at a time
+				const double length(std::sqrt(d[0] * d[0] + d[1] * d[1]) * (t1 - t0));
+				const unsigned pieces(std::max(1u, unsigned(std::ceil(length / cellSize))));
+				const double dt((t1 - t0) / pieces);
+				for (unsigned i = 0; i < pieces; ++i)
+				{
+					const double ta(t0 + i * dt), tb(t0 + (i + 1) * dt);
+					const double xa(o[0] + ta * d[0]), xb(o[0] + tb * d[0]);
+					const double ya(o[1] + ta * d[1]), yb(o[1] + tb * d[1]);
+					queryCells(std::min(xa, xb) - tolerance, std::min(ya, yb) - tolerance, std::max(xa, xb) + tolerance, std::max(ya, yb) + tolerance);
+				}
+			}
+			candidates.insert(candidates.end(), largeEntries.begin(), largeEntries.end());
+			std::sort(candidates.begin(), candidates.end());
+			candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+			
+			// the closest object
+			for (size_t i = 0; i < candidates.size(); ++i)
+			{
+				const Entry& entry(entries[candidates[i]]);
+				double t;
+				if (intersect(entry, ray, tolerance, t) && t <= bestT)
+				{
+					bestT = t;
+					hit.object = entry.object;
+					found = true;
+				}
+			}
+		}
+		
+		if (found)
+		{
+			hit.t = bestT;
+			ray.at(bestT, hit.point);
+		}
+		return found;
+	}
+	
+	//! Return whether ray hits the object of entry, and if so the parameter t of the first point hit
+	bool PickingIndex::intersect(const Entry& entry, const Ray& ray, double tolerance, double& t) const
+	{
+		// ray in object coordinates
+		const Matrix22 rot(-entry.angle);
+		const Point o(rot * (Point(ray.origin[0], ray.origin[1]) - entry.pos));
+		const Vector d(rot * Vector(ray.direction[0], ray.direction[1]));
+		const double oz(ray.origin[2]), dz(ray.direction[2]);
+		
+		const PhysicalObject::Hull& hull(entry.object->getHull());
+		if (hull.empty())
+		{
+			// a cylinder
+			double t0(0), t1(std::numeric_limits<double>::max());
+			if (!clipSlab(oz, dz, 0, entry.height, t0, t1))
+				return false;
+			const double r(entry.radius + tolerance);
+			const double a(d.norm2());
+			const double b(2 * (o * d));
+			const double c(o.norm2() - r * r);
+			if (a == 0)
+			{
+				if (c > 0)
+					return false;
+			}
+			else
+			{
+				const double disc(b * b - 4 * a * c);
+				if (disc < 0)
+					return false;
+				const double sqrtDisc(std::sqrt(disc));
+				t0 = std::max(t0, (-b - sqrtDisc) / (2 * a));
+				t1 = std::min(t1, (-b + sqrtDisc) / (2 * a));
+				if (t0 > t1)
+					return false;
+			}
+			t = t0;
+			return true;
+		}
+		
+		// hull parts, each a convex polygon extruded to its height
+		bool hit(false);
+		for (PhysicalObject::Hull::const_iterator it = hull.begin(); it != hull.end(); ++it)
+		{
+			double t0(0), t1(std::numeric_limits<double>::max());
+			if (!clipSlab(oz, dz, 0, it->getHeight(), t0, t1))
+				continue;
+			const Polygon& shape(it->getShape());
+			bool inside(true);
+			for (size_t i = 0; i < shape.size() && inside; ++i)
+			{
+				// signed distance to the side, positive inside, is linear along the ray
+				const Segment segment(shape.getSegment(i));
+				const double f0(segment.dist(o) + tolerance);
+				const double f1(segment.dist(o + d) + tolerance);
+				inside = clipHalfLine(f0, f1 - f0, t0, t1);
+			}
+			if (inside && (!hit || t0 < t))
+			{
+				t = t0;
+				hit = true;
+			}
+		}
+		return hit;
+	}
+}
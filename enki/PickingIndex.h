@@ -0,0 +1,141 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#ifndef __ENKI_PICKINGINDEX_H
+#define __ENKI_PICKINGINDEX_H
+
+#include "PhysicalEngine.h"
+#include "SimulationThread.h"
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+/*!	\file PickingIndex.h
+	\brief A spatial index of the objects of a world to find which one a ray points to
+*/
+
+namespace Enki
+{
+	//! A ray in world coordinates, for instance going from the camera through the mouse cursor
+	struct Ray
+	{
+		//! Start point
+		double origin[3];
+		//! Direction, not necessarily of unit length
+		double direction[3];
+		
+		//! Constructor, ray from origin along direction
+		Ray(double ox, double oy, double oz, double dx, double dy, double dz);
+		//! Return the point at origin + t * direction
+		void at(double t, double point[3]) const;
+	};
+	
+	//! A uniform grid of the bounding circles of the objects of a world, to pick objects with rays on the CPU
+	/*!
+		Objects are seen as their hull extruded from the ground to the height of each part,
+		or as a cylinder if they have no hull. build() stores the pose of objects, so the
+		index can be built from a world or from a snapshot, and must be built again once
+		objects have moved. pick() only tests the objects in the cells crossed by the
+		part of the ray below the highest object, so its cost hardly depends on the number
+		of objects in the world.
+		\ingroup core
+	*/
+	class PickingIndex
+	{
+	public:
+		//! What a ray points to
+		struct Hit
+		{
+			//! The object hit, 0 if the ray hit the ground
+			PhysicalObject* object;
+			//! The point hit, in world coordinates
+			double point[3];
+			//! Parameter of the point along the ray
+			double t;
+		};
+		
+	protected:
+		//! An indexed object
+		struct Entry
+		{
+			PhysicalObject* object;
+			Point pos;
+			double angle;
+			double radius;
+			double height;
+		};
+		typedef std::pair<uint64_t, unsigned> CellEntry;
+		
+		//! The indexed objects
+		std::vector<Entry> entries;
+		//! Indices of entries in each cell, sorted by cell key
+		std::vector<CellEntry> cells;
+		//! Indices of entries whose bounding circle covers too many cells to be stored in them
+		std::vector<unsigned> largeEntries;
+		//! Size of a cell
+		double cellSize;
+		//! Height of the highest object
+		double maxHeight;
+		//! Bounds of the cells holding entries
+		int minCellX, minCellY, maxCellX, maxCellY;
+		//! Candidates of the last query, kept to reuse their storage
+		mutable std::vector<unsigned> candidates;
+		
+	public:
+		//! Constructor, empty index
+		PickingIndex();
+		
+		//! Index the objects of world at their current pose
+		void build(const World* world);
+		//! Index the objects of snapshot at their captured pose
+		void build(const WorldSnapshot& snapshot);
+		//! Remove all objects
+		void clear();
+		//! Return the number of indexed objects
+		size_t size() const { return entries.size(); }
+		
+		//! Find the first object hit by ray or else the ground, up to maxT; tolerance enlarges objects to ease picking small ones
+		bool pick(const Ray& ray, Hit& hit, double maxT = 1e6, double tolerance = 0) const;
+		
+	protected:
+		void add(PhysicalObject* object, const Point& pos, double angle);
+		void finalize();
+		uint64_t cellKey(int x, int y) const;
+		int cellCoordinate(double v) const;
+		void queryCells(double xMin, double yMin, double xMax, double yMax) const;
+		bool intersect(const Entry& entry, const Ray& ray, double tolerance, double& t) const;
+	};
+}
+
+#endif // __ENKI_PICKINGINDEX_H
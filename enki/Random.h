@@ -55,17 +55,22 @@ namespace Enki
 		FastRandom(void) { randx = 0; }
 		//! Set the seed
 		void setSeed(unsigned long seed) { randx = seed; }
+		//! Get the current state, calling setSeed() with it later resumes the sequence from this point
+		unsigned long getState(void) const { return randx; }
 		//! Get a random number between 0 and 2^31
 		unsigned long get(void) { return (randx = randx*1103515245 + 12345) & 0x7fffffff; }
 		//! Get a random double between 0 and range, use get() internally
 		double getRange(double range) { return (static_cast<double>(get()) * range) / 2147483648.0; }
 	};
 	
-	//! Return a number in [0;1[ in a uniform distribution
+	//! Fast random for use by Enki, one per thread; World::step() uses the generator of the world being stepped
+	extern thread_local FastRandom random;
+	
+	//! Return a number in [0;1[ in a uniform distribution, drawn from Enki::random so that it is reproducible and part of World::saveState()
 	/*! \ingroup an */
 	inline double uniformRand(void)
 	{
-		return double(rand())/RAND_MAX;
+		return random.getRange(1.);
 	}
 	
 	//! Functor to be used with \<algorithm\>
@@ -86,7 +91,7 @@ namespace Enki
 	inline unsigned intRand(unsigned max)
 	{
 		if (max)
-			return rand() % max;
+			return unsigned(uniformRand() * max);
 		else
 			return 0;
 	}
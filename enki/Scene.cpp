@@ -0,0 +1,634 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "Scene.h"
+#include "robots/e-puck/EPuck.h"
+#include "robots/thymio2/Thymio2.h"
+#include "robots/khepera/Khepera.h"
+#include "robots/marxbot/Marxbot.h"
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*!	\file Scene.cpp
+	\brief Implementation of the declarative description of a world
+*/
+
+namespace Enki
+{
+	static_assert(sizeof(Scene::FileHeader) == 144, "scene header must not depend on padding");
+	static_assert(sizeof(Scene::ShapeRecord) == 48, "shape record must not depend on padding");
+	static_assert(sizeof(Scene::ObjectRecord) == 64, "object record must not depend on padding");
+	
+	//! Round size up to a multiple of 8
+	static size_t alignSize(size_t size)
+	{
+		return ((size + 7) / 8) * 8;
+	}
+	
+	//! Return fileName relative to directory, unless it is absolute
+	static std::string joinPath(const std::string& directory, const std::string& fileName)
+	{
+		if (directory.empty() || fileName.empty() || fileName[0] == '/')
+			return fileName;
+		return directory + '/' + fileName;
+	}
+	
+	//! Read a number from the header of a PPM file, skipping comments
+	static unsigned readPPMNumber(std::istream& stream)
+	{
+		stream >> std::ws;
+		while (stream.peek() == '#')
+		{
+			std::string comment;
+			std::getline(stream, comment);
+			stream >> std::ws;
+		}
+		unsigned value;
+		if (!(stream >> value))
+			throw std::runtime_error("invalid PPM header");
+		return value;
+	}
+	
+	//! Load a P3 or P6 PPM file as ARGB pixels
+	static void loadPPM(const std::string& fileName, uint32_t& width, uint32_t& height, std::vector<uint32_t>& pixels)
+	{
+		std::ifstream stream(fileName.c_str(), std::ios::binary);
+		if (!stream.good())
+			throw std::runtime_error("cannot open ground texture " + fileName);
+		std::string magic;
+		stream >> magic;
+		if (magic != "P3" && magic != "P6")
+			throw std::runtime_error("not a PPM file: " + fileName);
+		width = readPPMNumber(stream);
+		height = readPPMNumber(stream);
+		const unsigned maxValue(readPPMNumber(stream));
+		if (maxValue == 0 || maxValue > 255)
+			throw std::runtime_error("unsupported PPM depth: " + fileName);
+		stream.get();
+		
+		pixels.resize(size_t(width) * height);
+		for (size_t i = 0; i < pixels.size(); ++i)
+		{
+			unsigned rgb[3];
+			for (size_t c = 0; c < 3; ++c)
+			{
+				if (magic == "P6")
+					rgb[c] = uint8_t(stream.get());
+				else
+					stream >> rgb[c];
+				rgb[c] = (rgb[c] * 255) / maxValue;
+			}
+			if (!stream)
+				throw std::runtime_error("early end of file: " + fileName);
+			pixels[i] = 0xff000000 | (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+		}
+	}
+	
+	//! Split a line of a scene into words and numbers
+	class SceneTokenizer
+	{
+	public:
+		//! Constructor, tokenize line until its end or a #
+		SceneTokenizer(const char* line, unsigned lineNumber):
+			cursor(line),
+			lineNumber(lineNumber)
+		{}
+		
+		//! Throw std::runtime_error with message and the line number
+		void error(const std::string& message) const
+		{
+			std::ostringstream oss;
+			oss << "scene line " << lineNumber << ": " << message;
+			throw std::runtime_error(oss.str());
+		}
+		
+		//! Return whether the line has no more tokens
+		bool atEnd()
+		{
+			while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')
+				++cursor;
+			return *cursor == 0 || *cursor == '#';
+		}
+		
+		//! Return the next word, throw if there is none
+		std::string word(const char* what)
+		{
+			if (atEnd())
+				error(std::string("missing ") + what);
+			const char* begin(cursor);
+			while (*cursor && *cursor != ' ' && *cursor != '\t' && *cursor != '\r' && *cursor != '#')
+				++cursor;
+			return std::string(begin, cursor);
+		}
+		
+		//! Return the next number, throw if there is none
+		double number(const char* what)
+		{
+			if (atEnd())
+				error(std::string("missing ") + what);
+			char* end;
+			const double value(strtod(cursor, &end));
+			if (end == cursor || (*end && *end != ' ' && *end != '\t' && *end != '\r' && *end != '#'))
+				error(std::string("invalid ") + what);
+			cursor = end;
+			return value;
+		}
+		
+		//! Read an optional color of 3 or 4 components into color, or set its alpha to -1
+		void optionalColor(double color[4])
+		{
+			color[3] = -1;
+			if (atEnd())
+				return;
+			color[0] = number("red");
+			color[1] = number("green");
+			color[2] = number("blue");
+			color[3] = atEnd() ? 1 : number("alpha");
+		}
+		
+		//! Throw if the line has more tokens
+		void end()
+		{
+			if (!atEnd())
+				error("unexpected " + word("token"));
+		}
+		
+	protected:
+		//! Next character to read
+		const char* cursor;
+		//! Line number, for errors
+		const unsigned lineNumber;
+	};
+	
+	Scene::Scene(const std::string& fileName):
+		mapped(0),
+		mappedSize(0),
+		header(0)
+	{
+		std::ifstream stream(fileName.c_str(), std::ios::binary);
+		if (!stream.good())
+			throw std::runtime_error("cannot open scene " + fileName);
+		char magic[sizeof(header->magic)] = { 0 };
+		stream.read(magic, sizeof(magic));
+		if (stream.gcount() != sizeof(magic) || strncmp(magic, "ENKISCN", sizeof(magic)) != 0)
+		{
+			// text form
+			stream.clear();
+			stream.seekg(0);
+			const size_t slash(fileName.rfind('/'));
+			parse(stream, slash == std::string::npos ? std::string() : fileName.substr(0, slash));
+			return;
+		}
+		
+		#ifdef _WIN32
+		stream.seekg(0, std::ios::end);
+		data.resize(size_t(stream.tellg()));
+		stream.seekg(0);
+		stream.read(reinterpret_cast<char*>(&data[0]), data.size());
+		setBinaryForm(&data[0], data.size());
+		#else // _WIN32
+		stream.close();
+		const int fd(::open(fileName.c_str(), O_RDONLY));
+		struct stat status;
+		if (fd < 0 || fstat(fd, &status) != 0)
+		{
+			if (fd >= 0)
+				::close(fd);
+			throw std::runtime_error("cannot open scene " + fileName);
+		}
+		mappedSize = status.st_size;
+		mapped = mmap(0, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (mapped == MAP_FAILED)
+		{
+			mapped = 0;
+			throw std::runtime_error("cannot map scene " + fileName);
+		}
+		try
+		{
+			setBinaryForm(mapped, mappedSize);
+		}
+		catch (...)
+		{
+			munmap(mapped, mappedSize);
+			throw;
+		}
+		#endif // _WIN32
+	}
+	
+	Scene::Scene(std::istream& stream, const std::string& directory):
+		mapped(0),
+		mappedSize(0),
+		header(0)
+	{
+		parse(stream, directory);
+	}
+	
+	Scene::~Scene()
+	{
+		#ifndef _WIN32
+		if (mapped)
+			munmap(mapped, mappedSize);
+		#endif // _WIN32
+	}
+	
+	void Scene::save(const std::string& fileName) const
+	{
+		std::ofstream stream(fileName.c_str(), std::ios::binary | std::ios::trunc);
+		stream.write(reinterpret_cast<const char*>(header), header->fileSize);
+		if (!stream.good())
+			throw std::runtime_error("cannot write scene " + fileName);
+	}
+	
+	const Scene::TypeRecord* Scene::getTypes() const
+	{
+		return reinterpret_cast<const TypeRecord*>(reinterpret_cast<const uint8_t*>(header) + header->typesOffset);
+	}
+	
+	const Scene::ShapeRecord* Scene::getShapes() const
+	{
+		return reinterpret_cast<const ShapeRecord*>(reinterpret_cast<const uint8_t*>(header) + header->shapesOffset);
+	}
+	
+	const Scene::ObjectRecord* Scene::getObjects() const
+	{
+		return reinterpret_cast<const ObjectRecord*>(reinterpret_cast<const uint8_t*>(header) + header->objectsOffset);
+	}
+	
+	const Point* Scene::getVertices() const
+	{
+		return reinterpret_cast<const Point*>(reinterpret_cast<const uint8_t*>(header) + header->verticesOffset);
+	}
+	
+	World::GroundTexture Scene::getGroundTexture() const
+	{
+		if (header->groundWidth == 0 || header->groundHeight == 0)
+			return World::GroundTexture();
+		const uint32_t* pixels(reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(header) + header->groundOffset));
+		return World::GroundTexture(header->groundWidth, header->groundHeight, pixels);
+	}
+	
+	Color Scene::getWallsColor() const
+	{
+		return Color(header->wallsColor[0], header->wallsColor[1], header->wallsColor[2], header->wallsColor[3]);
+	}
+	
+	World* Scene::createWorld() const
+	{
+		std::unique_ptr<World> world;
+		if (header->wallsType == World::WALLS_SQUARE)
+			world.reset(new World(header->width, header->height, getWallsColor(), getGroundTexture()));
+		else if (header->wallsType == World::WALLS_CIRCULAR)
+			world.reset(new World(header->radius, getWallsColor(), getGroundTexture()));
+		else
+			world.reset(new World());
+		addObjects(world.get());
+		return world.release();
+	}
+	
+	void Scene::addObjects(World* world, const ObjectFactories& factories) const
+	{
+		// resolve types once
+		const ObjectFactories& registered(registeredFactories());
+		const TypeRecord* types(getTypes());
+		std::vector<const ObjectFactory*> typeFactories(header->typeCount);
+		for (size_t i = 0; i < typeFactories.size(); ++i)
+		{
+			const std::string name(types[i].name, strnlen(types[i].name, sizeof(types[i].name)));
+			ObjectFactories::const_iterator it(factories.find(name));
+			if (it == factories.end())
+			{
+				it = registered.find(name);
+				if (it == registered.end())
+					throw std::runtime_error("unknown robot type " + name);
+			}
+			typeFactories[i] = &it->second;
+		}
+		
+		// build a prototype per shape, objects share their hulls
+		const ShapeRecord* shapes(getShapes());
+		const Point* vertices(getVertices());
+		std::vector<std::unique_ptr<PhysicalObject> > prototypes(header->shapeCount);
+		for (size_t i = 0; i < prototypes.size(); ++i)
+		{
+			const ShapeRecord& shape(shapes[i]);
+			prototypes[i].reset(new PhysicalObject);
+			if (shape.kind == SHAPE_CYLINDER)
+				prototypes[i]->setCylindric(shape.size[0], shape.height, shape.mass);
+			else if (shape.kind == SHAPE_BOX)
+				prototypes[i]->setRectangular(shape.size[0], shape.size[1], shape.height, shape.mass);
+			else if (shape.kind == SHAPE_HULL)
+			{
+				Polygon polygon;
+				polygon.assign(vertices + shape.firstVertex, vertices + shape.firstVertex + shape.vertexCount);
+				prototypes[i]->setCustomHull(PhysicalObject::Hull(PhysicalObject::Part(polygon, shape.height)), shape.mass);
+			}
+			else
+				throw std::runtime_error("invalid shape kind in scene");
+		}
+		
+		// create all objects before adding them, so that world is unchanged on errors
+		const ObjectRecord* records(getObjects());
+		std::vector<PhysicalObject*> objects;
+		objects.reserve(header->objectCount);
+		try
+		{
+			for (size_t i = 0; i < header->objectCount; ++i)
+			{
+				const ObjectRecord& record(records[i]);
+				if (record.type >= 0)
+				{
+					if (size_t(record.type) >= typeFactories.size())
+						throw std::runtime_error("invalid robot type in scene");
+					objects.push_back((*typeFactories[record.type])());
+				}
+				else
+				{
+					if (record.shape >= prototypes.size())
+						throw std::runtime_error("invalid shape in scene");
+					objects.push_back(new PhysicalObject);
+					objects.back()->setShape(*prototypes[record.shape]);
+				}
+				PhysicalObject* object(objects.back());
+				object->pos = Point(record.pos[0], record.pos[1]);
+				object->angle = record.angle;
+				if (record.color[3] >= 0)
+					object->setColor(Color(record.color[0], record.color[1], record.color[2], record.color[3]));
+			}
+		}
+		catch (...)
+		{
+			for (size_t i = 0; i < objects.size(); ++i)
+				delete objects[i];
+			throw;
+		}
+		
+		// objects were created in the order of their uids
+		for (size_t i = 0; i < objects.size(); ++i)
+			world->addObject(objects[i]);
+	}
+	
+	void Scene::registerType(const std::string& name, const ObjectFactory& factory)
+	{
+		registeredFactories()[name] = factory;
+	}
+	
+	Scene::ObjectFactories& Scene::registeredFactories()
+	{
+		static ObjectFactories factories {
+			{ "epuck", [] () -> PhysicalObject* { return new EPuck; } },
+			{ "thymio2", [] () -> PhysicalObject* { return new Thymio2; } },
+			{ "khepera", [] () -> PhysicalObject* { return new Khepera; } },
+			{ "marxbot", [] () -> PhysicalObject* { return new Marxbot; } }
+		};
+		return factories;
+	}
+	
+	void Scene::setBinaryForm(const void* base, size_t size)
+	{
+		const FileHeader* fileHeader(static_cast<const FileHeader*>(base));
+		if (size < sizeof(FileHeader) || strncmp(fileHeader->magic, "ENKISCN", sizeof(fileHeader->magic)) != 0)
+			throw std::runtime_error("not a binary scene");
+		if (fileHeader->version != 1)
+			throw std::runtime_error("unsupported binary scene version");
+		if (fileHeader->fileSize > size)
+			throw std::runtime_error("truncated binary scene");
+		const uint64_t tables[5][3] = {
+			{ fileHeader->typesOffset, fileHeader->typeCount, sizeof(TypeRecord) },
+			{ fileHeader->shapesOffset, fileHeader->shapeCount, sizeof(ShapeRecord) },
+			{ fileHeader->objectsOffset, fileHeader->objectCount, sizeof(ObjectRecord) },
+			{ fileHeader->verticesOffset, fileHeader->vertexCount, sizeof(Point) },
+			{ fileHeader->groundOffset, uint64_t(fileHeader->groundWidth) * fileHeader->groundHeight, sizeof(uint32_t) }
+		};
+		for (size_t i = 0; i < 5; ++i)
+			if (tables[i][0] % 8 != 0 || tables[i][0] > fileHeader->fileSize || tables[i][1] * tables[i][2] > fileHeader->fileSize - tables[i][0])
+				throw std::runtime_error("corrupted binary scene");
+		header = fileHeader;
+		const ShapeRecord* shapes(getShapes());
+		for (size_t i = 0; i < header->shapeCount; ++i)
+			if (shapes[i].kind == SHAPE_HULL && uint64_t(shapes[i].firstVertex) + shapes[i].vertexCount > header->vertexCount)
+				throw std::runtime_error("corrupted binary scene");
+	}
+	
+	void Scene::parse(std::istream& stream, const std::string& directory)
+	{
+		FileHeader fileHeader;
+		memset(&fileHeader, 0, sizeof(fileHeader));
+		strncpy(fileHeader.magic, "ENKISCN", sizeof(fileHeader.magic));
+		fileHeader.version = 1;
+		fileHeader.wallsType = World::WALLS_NONE;
+		const Color defaultColor(Color::gray);
+		for (size_t i = 0; i < 4; ++i)
+			fileHeader.wallsColor[i] = defaultColor.components[i];
+		
+		std::vector<TypeRecord> types;
+		std::map<std::string, int32_t> typeIndices;
+		std::vector<ShapeRecord> shapes;
+		std::map<std::string, uint32_t> shapeIndices;
+		std::vector<ObjectRecord> objects;
+		std::vector<Point> vertices;
+		std::vector<uint32_t> pixels;
+		
+		std::string line;
+		unsigned lineNumber(0);
+		while (std::getline(stream, line))
+		{
+			SceneTokenizer tokens(line.c_str(), ++lineNumber);
+			if (tokens.atEnd())
+				continue;
+			const std::string statement(tokens.word("statement"));
+			if (statement == "world")
+			{
+				const std::string walls(tokens.word("walls type"));
+				if (walls == "square")
+				{
+					fileHeader.wallsType = World::WALLS_SQUARE;
+					fileHeader.width = tokens.number("width");
+					fileHeader.height = tokens.number("height");
+				}
+				else if (walls == "circular")
+				{
+					fileHeader.wallsType = World::WALLS_CIRCULAR;
+					fileHeader.radius = tokens.number("radius");
+				}
+				else if (walls == "none")
+					fileHeader.wallsType = World::WALLS_NONE;
+				else
+					tokens.error("unknown walls type " + walls);
+				double color[4];
+				tokens.optionalColor(color);
+				if (color[3] >= 0)
+					std::copy(color, color + 4, fileHeader.wallsColor);
+			}
+			else if (statement == "ground")
+			{
+				const std::string fileName(joinPath(directory, tokens.word("ground file name")));
+				try
+				{
+					loadPPM(fileName, fileHeader.groundWidth, fileHeader.groundHeight, pixels);
+				}
+				catch (const std::runtime_error& e)
+				{
+					tokens.error(e.what());
+				}
+			}
+			else if (statement == "shape")
+			{
+				const std::string name(tokens.word("shape name"));
+				if (shapeIndices.find(name) != shapeIndices.end())
+					tokens.error("shape " + name + " is already defined");
+				ShapeRecord shape;
+				memset(&shape, 0, sizeof(shape));
+				const std::string kind(tokens.word("shape kind"));
+				if (kind == "cylinder")
+				{
+					shape.kind = SHAPE_CYLINDER;
+					shape.size[0] = tokens.number("radius");
+				}
+				else if (kind == "box")
+				{
+					shape.kind = SHAPE_BOX;
+					shape.size[0] = tokens.number("length along x");
+					shape.size[1] = tokens.number("length along y");
+				}
+				else if (kind == "hull")
+					shape.kind = SHAPE_HULL;
+				else
+					tokens.error("unknown shape kind " + kind);
+				shape.height = tokens.number("height");
+				shape.mass = tokens.number("mass");
+				if (shape.kind == SHAPE_HULL)
+				{
+					shape.firstVertex = vertices.size();
+					while (!tokens.atEnd())
+					{
+						const double x(tokens.number("vertex x"));
+						vertices.push_back(Point(x, tokens.number("vertex y")));
+					}
+					shape.vertexCount = vertices.size() - shape.firstVertex;
+					if (shape.vertexCount < 3)
+						tokens.error("hull needs at least 3 vertices");
+					for (size_t i = 0; i < shape.vertexCount; ++i)
+					{
+						const Point& a(vertices[shape.firstVertex + i]);
+						const Point& b(vertices[shape.firstVertex + (i + 1) % shape.vertexCount]);
+						const Point& c(vertices[shape.firstVertex + (i + 2) % shape.vertexCount]);
+						if ((b - a).cross(c - b) <= 0)
+							tokens.error("hull must be convex and counter-clockwise");
+					}
+				}
+				shapeIndices[name] = shapes.size();
+				shapes.push_back(shape);
+			}
+			else
+			{
+				ObjectRecord object;
+				memset(&object, 0, sizeof(object));
+				if (statement == "object")
+				{
+					const std::string name(tokens.word("shape name"));
+					std::map<std::string, uint32_t>::const_iterator it(shapeIndices.find(name));
+					if (it == shapeIndices.end())
+						tokens.error("unknown shape " + name);
+					object.type = -1;
+					object.shape = it->second;
+				}
+				else
+				{
+					std::map<std::string, int32_t>::const_iterator it(typeIndices.find(statement));
+					if (it == typeIndices.end())
+					{
+						TypeRecord type;
+						memset(&type, 0, sizeof(type));
+						if (statement.size() >= sizeof(type.name))
+							tokens.error("robot type name too long: " + statement);
+						memcpy(type.name, statement.c_str(), statement.size());
+						it = typeIndices.insert(std::make_pair(statement, int32_t(types.size()))).first;
+						types.push_back(type);
+					}
+					object.type = it->second;
+				}
+				object.pos[0] = tokens.number("x");
+				object.pos[1] = tokens.number("y");
+				object.angle = tokens.number("angle");
+				tokens.optionalColor(object.color);
+				objects.push_back(object);
+			}
+			tokens.end();
+		}
+		if (stream.bad())
+			throw std::runtime_error("cannot read scene");
+		
+		// lay out tables after the header
+		fileHeader.typeCount = types.size();
+		fileHeader.shapeCount = shapes.size();
+		fileHeader.objectCount = objects.size();
+		fileHeader.vertexCount = vertices.size();
+		size_t offset(alignSize(sizeof(FileHeader)));
+		fileHeader.typesOffset = offset;
+		offset = alignSize(offset + types.size() * sizeof(TypeRecord));
+		fileHeader.shapesOffset = offset;
+		offset = alignSize(offset + shapes.size() * sizeof(ShapeRecord));
+		fileHeader.objectsOffset = offset;
+		offset = alignSize(offset + objects.size() * sizeof(ObjectRecord));
+		fileHeader.verticesOffset = offset;
+		offset = alignSize(offset + vertices.size() * sizeof(Point));
+		fileHeader.groundOffset = offset;
+		offset = alignSize(offset + pixels.size() * sizeof(uint32_t));
+		fileHeader.fileSize = offset;
+		
+		data.assign(offset, 0);
+		memcpy(&data[0], &fileHeader, sizeof(fileHeader));
+		if (!types.empty())
+			memcpy(&data[fileHeader.typesOffset], &types[0], types.size() * sizeof(TypeRecord));
+		if (!shapes.empty())
+			memcpy(&data[fileHeader.shapesOffset], &shapes[0], shapes.size() * sizeof(ShapeRecord));
+		if (!objects.empty())
+			memcpy(&data[fileHeader.objectsOffset], &objects[0], objects.size() * sizeof(ObjectRecord));
+		if (!vertices.empty())
+			memcpy(&data[fileHeader.verticesOffset], &vertices[0], vertices.size() * sizeof(Point));
+		if (!pixels.empty())
+			memcpy(&data[fileHeader.groundOffset], &pixels[0], pixels.size() * sizeof(uint32_t));
+		header = reinterpret_cast<const FileHeader*>(&data[0]);
+	}
+}
@@ -0,0 +1,198 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __ENKI_SCENE_H
+#define __ENKI_SCENE_H
+
+#include "PhysicalEngine.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <istream>
+#include <stdint.h>
+
+/*!	\file Scene.h
+	\brief Declarative description of a world and its objects, with a binary form that can be memory-mapped
+*/
+
+namespace Enki
+{
+	//! A world and its objects described by a file, that can be instantiated many times
+	/*!
+		Scenes are written as text, one statement per line, # starting a comment:
+		\code
+		world square 120 120 [r g b]          # or: world circular 60 [r g b], or: world none
+		ground arena.ppm                      # P3 or P6 file, relative to the scene file
+		shape pillar cylinder 3 5 -1          # radius height mass
+		shape crate box 4 4 3 10              # l1 l2 height mass
+		shape ramp hull 2 -1 0 0 8 0 8 4      # height mass, then the vertices of a convex polygon, counter-clockwise
+		epuck 20 20 0 [r g b]                 # a robot by type: x y angle, and optionally a color
+		object pillar 40 40 0 [r g b]         # an object of a shape: x y angle, and optionally a color
+		\endcode
+		A negative mass makes objects static. Robot types are the names registered by registerType(),
+		by default epuck, thymio2, khepera and marxbot.
+
+		The parser streams the text line by line into the binary form, a header followed by flat
+		tables of types, shapes, objects, vertices and ground pixels. save() writes this form,
+		which a Scene constructed from the file maps in memory instead of parsing it; the layout
+		is that of the machine writing the file.
+
+		addObjects() instantiates all objects in one pass: it builds a prototype per shape,
+		whose hull is then shared by its objects through PhysicalObject::setShape(),
+		and adds objects in the order of their uids, which World::addObject() does in constant time.
+		\ingroup core
+	*/
+	class Scene
+	{
+	public:
+		//! Create an object of a given type
+		typedef std::function<PhysicalObject*()> ObjectFactory;
+		//! Factories by type name
+		typedef std::map<std::string, ObjectFactory> ObjectFactories;
+		
+		//! Kind of a shape
+		enum ShapeKind
+		{
+			SHAPE_CYLINDER = 0,	//!< size[0] is the radius
+			SHAPE_BOX,			//!< size[0] and size[1] are the lengths along x and y
+			SHAPE_HULL			//!< vertexCount vertices starting at firstVertex
+		};
+		
+		//! Header at the beginning of the binary form
+		struct FileHeader
+		{
+			char magic[8];			//!< "ENKISCN", null-terminated
+			uint32_t version;		//!< version of the format, 1
+			uint32_t wallsType;		//!< a World::WallsType
+			double width;			//!< width of square walls
+			double height;			//!< height of square walls
+			double radius;			//!< radius of circular walls
+			double wallsColor[4];	//!< color of the walls and ground, RGBA
+			uint32_t groundWidth;	//!< width of the ground texture, 0 if none
+			uint32_t groundHeight;	//!< height of the ground texture, 0 if none
+			uint32_t typeCount;		//!< number of TypeRecord
+			uint32_t shapeCount;	//!< number of ShapeRecord
+			uint32_t objectCount;	//!< number of ObjectRecord
+			uint32_t vertexCount;	//!< number of vertices, as pairs of doubles
+			uint64_t typesOffset;	//!< offset of the types from the beginning of the file
+			uint64_t shapesOffset;	//!< offset of the shapes
+			uint64_t objectsOffset;	//!< offset of the objects
+			uint64_t verticesOffset;	//!< offset of the vertices
+			uint64_t groundOffset;	//!< offset of the ground pixels, as uint32_t ARGB
+			uint64_t fileSize;		//!< size of the binary form in bytes
+		};
+		
+		//! Name of a robot type
+		struct TypeRecord
+		{
+			char name[32];			//!< name, null-terminated
+		};
+		
+		//! A shape shared by objects
+		struct ShapeRecord
+		{
+			uint32_t kind;			//!< a ShapeKind
+			uint32_t firstVertex;	//!< index of the first vertex, for SHAPE_HULL
+			uint32_t vertexCount;	//!< number of vertices, for SHAPE_HULL
+			uint32_t reserved;		//!< 0
+			double size[2];			//!< size, see ShapeKind
+			double height;			//!< height
+			double mass;			//!< mass, negative for static objects
+		};
+		
+		//! An object, either a robot or an object of a shape
+		struct ObjectRecord
+		{
+			int32_t type;			//!< index of the robot type, or -1 for an object of a shape
+			uint32_t shape;			//!< index of the shape, if type is -1
+			double pos[2];			//!< position
+			double angle;			//!< orientation
+			double color[4];		//!< color, RGBA, if alpha is not negative
+		};
+		
+	protected:
+		//! Binary form, if built by the parser or read without mmap
+		std::vector<uint8_t> data;
+		//! Mapped binary form, 0 if not mapped
+		void* mapped;
+		//! Size of the mapped binary form
+		size_t mappedSize;
+		//! Header of the binary form, in data or mapped
+		const FileHeader* header;
+		
+	public:
+		//! Load fileName, mapping it if it is in binary form and parsing it otherwise; throw std::runtime_error if it cannot be read or has errors
+		explicit Scene(const std::string& fileName);
+		//! Parse a scene in text form from stream, relative file names being relative to directory; throw std::runtime_error on errors, with the line number
+		Scene(std::istream& stream, const std::string& directory = std::string());
+		//! Destructor, unmap the file
+		virtual ~Scene();
+		
+		//! Write the binary form to fileName; throw std::runtime_error if it cannot be written
+		void save(const std::string& fileName) const;
+		
+		//! Return the header of the binary form
+		const FileHeader& getHeader() const { return *header; }
+		//! Return the types of robots, getHeader().typeCount of them
+		const TypeRecord* getTypes() const;
+		//! Return the shapes, getHeader().shapeCount of them
+		const ShapeRecord* getShapes() const;
+		//! Return the objects, getHeader().objectCount of them
+		const ObjectRecord* getObjects() const;
+		//! Return the vertices of hulls, getHeader().vertexCount of them
+		const Point* getVertices() const;
+		//! Return a copy of the ground texture
+		World::GroundTexture getGroundTexture() const;
+		//! Return the color of the walls and ground
+		Color getWallsColor() const;
+		
+		//! Return a new world with the walls and ground of this scene, and its objects
+		World* createWorld() const;
+		//! Add the objects of this scene to world, using factories for the types they contain, and the registered ones for other types; throw std::runtime_error if a type is unknown
+		void addObjects(World* world, const ObjectFactories& factories = ObjectFactories()) const;
+		
+		//! Register a factory for robots of type name, replacing any existing one; not thread-safe
+		static void registerType(const std::string& name, const ObjectFactory& factory);
+		
+	protected:
+		//! Return the registered factories
+		static ObjectFactories& registeredFactories();
+		//! Point to the binary form of size bytes at base, throw std::runtime_error if it is invalid
+		void setBinaryForm(const void* base, size_t size);
+		//! Parse stream into the binary form
+		void parse(std::istream& stream, const std::string& directory);
+	};
+}
+
+#endif
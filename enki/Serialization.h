@@ -0,0 +1,200 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __ENKI_SERIALIZATION_H
+#define __ENKI_SERIALIZATION_H
+
+#include <vector>
+#include <valarray>
+#include <queue>
+#include <stdexcept>
+#include <cstring>
+#include <stdint.h>
+
+/*!	\file Serialization.h
+	\brief Binary writer and reader for snapshots of the dynamic state of a world
+*/
+
+namespace Enki
+{
+	//! Append the dynamic state of objects to a binary blob
+	/*!
+		Values are stored as their raw bytes, so a blob is only meaningful for the
+		same build of Enki on the same architecture. Arrays are prefixed with their
+		number of elements, which StateReader checks against the destination.
+		\ingroup core
+	*/
+	class StateWriter
+	{
+	protected:
+		//! Blob values are appended to
+		std::vector<uint8_t>& data;
+		
+	public:
+		//! Constructor, values will be appended to data
+		StateWriter(std::vector<uint8_t>& data) : data(data) {}
+		
+		//! Append the bytes of a value of a trivially copyable type
+		template<typename T>
+		void write(const T& value)
+		{
+			const uint8_t* bytes(reinterpret_cast<const uint8_t*>(&value));
+			data.insert(data.end(), bytes, bytes + sizeof(T));
+		}
+		
+		//! Append count, followed by count values
+		template<typename T>
+		void writeArray(const T* values, size_t count)
+		{
+			write<uint32_t>(count);
+			const uint8_t* bytes(reinterpret_cast<const uint8_t*>(values));
+			data.insert(data.end(), bytes, bytes + count * sizeof(T));
+		}
+		
+		//! Append the elements of a vector
+		template<typename T>
+		void writeArray(const std::vector<T>& values) { writeArray(values.empty() ? 0 : &values[0], values.size()); }
+		
+		//! Append the elements of a valarray
+		template<typename T>
+		void writeArray(const std::valarray<T>& values) { writeArray(values.size() ? &values[0] : 0, values.size()); }
+		
+		//! Append the elements of a queue, from front to back
+		template<typename T>
+		void writeQueue(std::queue<T> values)
+		{
+			write<uint32_t>(values.size());
+			for (; !values.empty(); values.pop())
+				write(values.front());
+		}
+	};
+	
+	//! Read back the dynamic state of objects from a blob created by StateWriter
+	/*!
+		Values must be read in the order they were written. Reading past the end
+		of the blob or into an array of a different size throws std::runtime_error.
+		\ingroup core
+	*/
+	class StateReader
+	{
+	protected:
+		//! Next byte to read
+		const uint8_t* pos;
+		//! End of the blob
+		const uint8_t* end;
+		
+		//! Throw if less than size bytes remain
+		void require(size_t size) const
+		{
+			if (size_t(end - pos) < size)
+				throw std::runtime_error("state blob is truncated");
+		}
+		
+		//! Read an array count and throw if it differs from expected
+		void readCount(size_t expected)
+		{
+			uint32_t count;
+			read(count);
+			if (count != expected)
+				throw std::runtime_error("state blob does not match the objects it is restored into");
+		}
+		
+	public:
+		//! Constructor, read from data
+		StateReader(const std::vector<uint8_t>& data) :
+			pos(data.empty() ? 0 : &data[0]),
+			end(pos + data.size())
+		{}
+		//! Constructor, read from size bytes at data
+		StateReader(const uint8_t* data, size_t size) :
+			pos(data),
+			end(data + size)
+		{}
+		
+		//! Return whether all values have been read
+		bool atEnd() const { return pos == end; }
+		
+		//! Skip size bytes and return their address, so that they can be read later by another StateReader
+		const uint8_t* skip(size_t size)
+		{
+			require(size);
+			const uint8_t* skipped(pos);
+			pos += size;
+			return skipped;
+		}
+		
+		//! Read a value of a trivially copyable type
+		template<typename T>
+		void read(T& value)
+		{
+			require(sizeof(T));
+			memcpy(&value, pos, sizeof(T));
+			pos += sizeof(T);
+		}
+		
+		//! Read count values, throw if the blob holds a different count
+		template<typename T>
+		void readArray(T* values, size_t count)
+		{
+			readCount(count);
+			require(count * sizeof(T));
+			memcpy(values, pos, count * sizeof(T));
+			pos += count * sizeof(T);
+		}
+		
+		//! Read the elements of a vector, which must already have the right size
+		template<typename T>
+		void readArray(std::vector<T>& values) { readArray(values.empty() ? 0 : &values[0], values.size()); }
+		
+		//! Read the elements of a valarray, which must already have the right size
+		template<typename T>
+		void readArray(std::valarray<T>& values) { readArray(values.size() ? &values[0] : 0, values.size()); }
+		
+		//! Replace the content of a queue
+		template<typename T>
+		void readQueue(std::queue<T>& values)
+		{
+			uint32_t count;
+			read(count);
+			values = std::queue<T>();
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				T value;
+				read(value);
+				values.push(value);
+			}
+		}
+	};
+}
+
+#endif
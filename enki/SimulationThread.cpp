@@ -0,0 +1,274 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "SimulationThread.h"
+#include "robots/DifferentialWheeled.h"
+#include "robots/thymio2/Thymio2.h"
+#include <algorithm>
+#include <chrono>
+
+/*!	\file SimulationThread.cpp
+	\brief Implementation of the thread stepping a world and of its snapshots
+*/
+
+namespace Enki
+{
+	WorldSnapshot::WorldSnapshot():
+		step(0),
+		time(0)
+	{
+	}
+	
+	void WorldSnapshot::capture(const World* world, uint64_t step, double time)
+	{
+		this->step = step;
+		this->time = time;
+		objects.resize(world->objects.size());
+		leds.clear();
+		size_t i(0);
+		for (World::Objects::const_iterator it = world->objects.begin(); it != world->objects.end(); ++it, ++i)
+		{
+			PhysicalObject* object(*it);
+			Object& state(objects[i]);
+			state.object = object;
+			state.uid = object->uid;
+			state.pos = object->pos;
+			state.angle = object->angle;
+			state.color = object->getColor();
+			const DifferentialWheeled* robot(dynamic_cast<const DifferentialWheeled*>(object));
+			state.leftOdometry = robot ? robot->leftOdometry : 0;
+			state.rightOdometry = robot ? robot->rightOdometry : 0;
+			state.firstLed = leds.size();
+			if (const Thymio2* thymio = dynamic_cast<const Thymio2*>(object))
+				for (unsigned led = 0; led < Thymio2::LED_COUNT; ++led)
+					leds.push_back(thymio->getColorLed(Thymio2::LedIndex(led)));
+			state.ledCount = leds.size() - state.firstLed;
+		}
+	}
+	
+	//! Order object states by uid
+	static bool uidLess(const WorldSnapshot::Object& state, unsigned uid)
+	{
+		return state.uid < uid;
+	}
+	
+	const WorldSnapshot::Object* WorldSnapshot::find(const PhysicalObject* object) const
+	{
+		// uids never change, so reading the one of object is safe from any thread
+		std::vector<Object>::const_iterator it(std::lower_bound(objects.begin(), objects.end(), object->uid, uidLess));
+		if (it == objects.end() || it->object != object)
+			return 0;
+		return &*it;
+	}
+	
+	SnapshotBuffer::SnapshotBuffer():
+		middle(1),
+		back(0),
+		front(2)
+	{
+	}
+	
+	void SnapshotBuffer::publish()
+	{
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+	}
+	
+	bool SnapshotBuffer::take()
+	{
+		if (!(middle.load(std::memory_order_acquire) & FRESH))
+			return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+		return true;
+	}
+	
+	SimulationThread::SimulationThread(World* world, double dt, unsigned physicsOversampling):
+		world(world),
+		dt(dt),
+		physicsOversampling(physicsOversampling),
+		speed(1),
+		paused(false),
+		stepCount(0),
+		stopping(false),
+		settingsGeneration(0)
+	{
+	}
+	
+	SimulationThread::~SimulationThread()
+	{
+		stop();
+	}
+	
+	void SimulationThread::start()
+	{
+		if (isRunning())
+			return;
+		stopping = false;
+		publishSnapshot();
+		thread = std::thread(&SimulationThread::run, this);
+	}
+	
+	void SimulationThread::stop()
+	{
+		if (!isRunning())
+			return;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wakeUp.notify_all();
+		thread.join();
+		// the world belongs to the calling thread again
+		callPosted();
+	}
+	
+	void SimulationThread::setSpeed(double speed)
+	{
+		this->speed = std::max(speed, 0.);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			++settingsGeneration;
+		}
+		wakeUp.notify_all();
+	}
+	
+	void SimulationThread::setPaused(bool paused)
+	{
+		this->paused = paused;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			++settingsGeneration;
+		}
+		wakeUp.notify_all();
+	}
+	
+	void SimulationThread::post(const WorldFunction& function)
+	{
+		if (!isRunning())
+		{
+			function(world);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			posted.push_back(function);
+		}
+		wakeUp.notify_all();
+	}
+	
+	void SimulationThread::run()
+	{
+		typedef std::chrono::steady_clock Clock;
+		// steps are due at regular intervals from a reference, restarted when settings change or when late
+		Clock::time_point reference;
+		uint64_t referenceStep(0);
+		unsigned seenGeneration(0);
+		bool referenceValid(false);
+		Clock::time_point lastSnapshot(Clock::now());
+		
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!stopping)
+		{
+			if (!posted.empty())
+			{
+				lock.unlock();
+				callPosted();
+				publishSnapshot();
+				lastSnapshot = Clock::now();
+				lock.lock();
+				continue;
+			}
+			if (paused)
+			{
+				wakeUp.wait(lock);
+				continue;
+			}
+			
+			const double currentSpeed(speed);
+			if (currentSpeed > 0)
+			{
+				if (!referenceValid || seenGeneration != settingsGeneration)
+				{
+					reference = Clock::now();
+					referenceStep = stepCount;
+					seenGeneration = settingsGeneration;
+					referenceValid = true;
+				}
+				const std::chrono::duration<double> delay(double(stepCount - referenceStep) * dt / currentSpeed);
+				const Clock::time_point due(reference + std::chrono::duration_cast<Clock::duration>(delay));
+				const Clock::time_point now(Clock::now());
+				if (now < due)
+				{
+					wakeUp.wait_until(lock, due);
+					continue;
+				}
+				// do not catch up by stepping in bursts when stepping is slower than requested
+				if (now - due > std::chrono::milliseconds(100))
+				{
+					reference = now;
+					referenceStep = stepCount;
+				}
+			}
+			lock.unlock();
+			
+			world->step(dt, physicsOversampling);
+			++stepCount;
+			
+			const Clock::time_point now(Clock::now());
+			if (currentSpeed > 0 || snapshots.isTaken() || now - lastSnapshot > std::chrono::milliseconds(10))
+			{
+				publishSnapshot();
+				lastSnapshot = now;
+			}
+			lock.lock();
+		}
+	}
+	
+	bool SimulationThread::callPosted()
+	{
+		std::vector<WorldFunction> functions;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			functions.swap(posted);
+		}
+		for (size_t i = 0; i < functions.size(); ++i)
+			functions[i](world);
+		return !functions.empty();
+	}
+	
+	void SimulationThread::publishSnapshot()
+	{
+		const uint64_t steps(stepCount);
+		snapshots.getBack().capture(world, steps, double(steps) * dt);
+		snapshots.publish();
+	}
+}
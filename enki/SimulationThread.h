@@ -0,0 +1,225 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __ENKI_SIMULATIONTHREAD_H
+#define __ENKI_SIMULATIONTHREAD_H
+
+#include "PhysicalEngine.h"
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <stdint.h>
+
+/*!	\file SimulationThread.h
+	\brief A thread stepping a world and publishing snapshots of it to a viewer
+*/
+
+namespace Enki
+{
+	//! The state of the objects of a world needed to display it, captured after a step
+	/*!
+		Snapshots are read by other threads than the one stepping the world, so they copy
+		the dynamic state of objects. The object pointers identify objects and give access
+		to their static properties, such as their class, hull and height; objects must stay
+		allocated as long as snapshots referring to them are displayed.
+		\ingroup core
+	*/
+	struct WorldSnapshot
+	{
+		//! State of an object
+		struct Object
+		{
+			PhysicalObject* object;	//!< the object, whose dynamic state must not be read outside the stepping thread
+			unsigned uid;			//!< uid of the object
+			Point pos;				//!< position
+			double angle;			//!< orientation
+			Color color;			//!< overall color
+			double leftOdometry;	//!< odometry of the left wheel of differential wheeled robots, 0 for other objects
+			double rightOdometry;	//!< odometry of the right wheel of differential wheeled robots, 0 for other objects
+			unsigned firstLed;		//!< index of the first LED of this object in leds
+			unsigned ledCount;		//!< number of LEDs of this object, those of Thymio II robots
+		};
+		
+		//! Number of steps done when captured
+		uint64_t step;
+		//! Simulated time when captured
+		double time;
+		//! Objects in the order of their uids
+		std::vector<Object> objects;
+		//! Colors of LEDs of all objects
+		std::vector<Color> leds;
+		
+		//! Constructor, empty snapshot
+		WorldSnapshot();
+		
+		//! Capture the objects of world, reusing the storage of this snapshot
+		void capture(const World* world, uint64_t step = 0, double time = 0);
+		//! Return the state of object, or 0 if it was not in the world
+		const Object* find(const PhysicalObject* object) const;
+	};
+	
+	//! Three snapshots exchanged without locks between a thread writing them and a thread reading them
+	/*!
+		The writer fills the back snapshot and publishes it, while the reader takes the
+		latest published snapshot as its front one. A third snapshot between them lets
+		both sides proceed without ever waiting for the other.
+		\ingroup core
+	*/
+	class SnapshotBuffer
+	{
+	protected:
+		//! Set in middle when the middle snapshot was published but not yet taken
+		static const unsigned FRESH = 4;
+		//! The snapshots
+		WorldSnapshot snapshots[3];
+		//! Index of the snapshot between the writer and the reader, with FRESH
+		std::atomic<unsigned> middle;
+		//! Index of the snapshot of the writer
+		unsigned back;
+		//! Index of the snapshot of the reader
+		unsigned front;
+		
+	public:
+		//! Constructor
+		SnapshotBuffer();
+		
+		//! Writer: return the snapshot to fill
+		WorldSnapshot& getBack() { return snapshots[back]; }
+		//! Writer: publish the back snapshot, replacing any snapshot the reader has not taken
+		void publish();
+		//! Writer: return whether the reader took the last published snapshot
+		bool isTaken() const { return !(middle.load(std::memory_order_relaxed) & FRESH); }
+		
+		//! Reader: take the latest published snapshot if any, return whether the front snapshot changed
+		bool take();
+		//! Reader: return the snapshot taken last
+		const WorldSnapshot& getFront() const { return snapshots[front]; }
+	};
+	
+	//! Step a world in a thread of its own, in real time scaled by a speed multiplier or as fast as possible
+	/*!
+		After steps, the state of objects is captured into snapshots that other threads, for
+		instance a viewer rendering at its own pace, read with updateSnapshot() and getSnapshot()
+		without ever blocking the simulation. Snapshots are captured after every step in real
+		time, and when the reader took the previous one or every 10 ms when stepping as fast
+		as possible.
+
+		While the thread runs, the world and its objects belong to it: other threads must only
+		change them through functions passed to post(), which are called between two steps,
+		and must not delete objects that the reader may still display.
+		\ingroup core
+	*/
+	class SimulationThread
+	{
+	public:
+		//! Function called by the simulation thread between two steps
+		typedef std::function<void(World* world)> WorldFunction;
+		
+	protected:
+		//! World being stepped
+		World* world;
+		//! Timestep
+		const double dt;
+		//! Physics oversampling
+		const unsigned physicsOversampling;
+		
+		//! Speed multiplier with respect to real time, 0 for as fast as possible
+		std::atomic<double> speed;
+		//! Whether stepping is paused
+		std::atomic<bool> paused;
+		//! Number of steps done by this thread
+		std::atomic<uint64_t> stepCount;
+		//! Snapshots from this thread to the reader
+		SnapshotBuffer snapshots;
+		
+		//! Protect the fields below
+		std::mutex mutex;
+		//! Signal the thread that it must stop, or that functions or settings changed
+		std::condition_variable wakeUp;
+		//! Functions to call before the next step
+		std::vector<WorldFunction> posted;
+		//! Whether the thread must stop
+		bool stopping;
+		//! Incremented when speed or paused change, so that the thread restarts its real time reference
+		unsigned settingsGeneration;
+		//! The thread, if running
+		std::thread thread;
+		
+	public:
+		//! Constructor, the world is stepped with dt and physicsOversampling once start() is called
+		SimulationThread(World* world, double dt = 0.03, unsigned physicsOversampling = 3);
+		//! Destructor, stop the thread
+		virtual ~SimulationThread();
+		
+		//! Start stepping in a new thread, and capture a first snapshot; do nothing if already running
+		void start();
+		//! Stop stepping and wait for the thread to finish, so that the world can be used by the calling thread again
+		void stop();
+		//! Return whether the thread is running
+		bool isRunning() const { return thread.joinable(); }
+		
+		//! Set the speed multiplier with respect to real time, 0 steps as fast as possible
+		void setSpeed(double speed);
+		//! Return the speed multiplier
+		double getSpeed() const { return speed; }
+		//! Pause or resume stepping; functions passed to post() are still called when paused
+		void setPaused(bool paused);
+		//! Return whether stepping is paused
+		bool isPaused() const { return paused; }
+		//! Return the number of steps done so far
+		uint64_t getStepCount() const { return stepCount; }
+		//! Return the timestep
+		double getDt() const { return dt; }
+		
+		//! Call function with the world in the simulation thread before the next step, or now if the thread is not running
+		void post(const WorldFunction& function);
+		
+		//! Reader: take the latest snapshot, return whether it changed; must be called from a single thread
+		bool updateSnapshot() { return snapshots.take(); }
+		//! Reader: return the snapshot taken by the last updateSnapshot()
+		const WorldSnapshot& getSnapshot() const { return snapshots.getFront(); }
+		
+	protected:
+		//! Loop of the thread
+		void run();
+		//! Call the posted functions, return whether there were some
+		bool callPosted();
+		//! Capture the state of the world into the back snapshot and publish it
+		void publishSnapshot();
+	};
+}
+
+#endif
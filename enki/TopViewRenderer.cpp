@@ -0,0 +1,366 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#include "TopViewRenderer.h"
+#include "interactions/IRSensor.h"
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cmath>
+
+/*!	\file TopViewRenderer.cpp
+	\brief Implementation of the software renderer of worlds seen from above
+*/
+
+namespace Enki
+{
+	//! Width of walls and of the margin around the world when fitting it, in pixels
+	static const double WALLS_WIDTH = 3;
+	
+	bool TopViewRenderer::BackgroundKey::operator ==(const BackgroundKey& that) const
+	{
+		return world == that.world && groundData == that.groundData &&
+			scale == that.scale && left == that.left && top == that.top;
+	}
+	
+	TopViewRenderer::TopViewRenderer(unsigned width, unsigned height):
+		drawSensorRays(false),
+		backgroundColor(Color::white),
+		width(std::max(width, 1u)),
+		height(std::max(height, 1u)),
+		pixels(this->width * this->height),
+		fixedView(false),
+		scale(1),
+		left(0),
+		top(0)
+	{
+		std::memset(&backgroundKey, 0, sizeof(backgroundKey));
+	}
+	
+	void TopViewRenderer::setView(double xMin, double yMin, double xMax, double yMax)
+	{
+		fixedView = true;
+		setViewRect(xMin, yMin, xMax, yMax, 0);
+	}
+	
+	void TopViewRenderer::fitWorld()
+	{
+		fixedView = false;
+	}
+	
+	//! Set scale, left and top to show the rectangle with margin pixels around it
+	void TopViewRenderer::setViewRect(double xMin, double yMin, double xMax, double yMax, double margin)
+	{
+		const double w(std::max(xMax - xMin, 1e-6));
+		const double h(std::max(yMax - yMin, 1e-6));
+		scale = std::min(std::max(width - 2 * margin, 1.) / w, std::max(height - 2 * margin, 1.) / h);
+		left = (xMin + xMax) / 2 - width / (2 * scale);
+		top = (yMin + yMax) / 2 + height / (2 * scale);
+	}
+	
+	//! Show the walls of world, or its objects if it has no walls
+	void TopViewRenderer::fit(const World* world)
+	{
+		switch (world->wallsType)
+		{
+			case World::WALLS_SQUARE:
+				setViewRect(0, 0, world->w, world->h, 2 * WALLS_WIDTH);
+				break;
+			case World::WALLS_CIRCULAR:
+				setViewRect(-world->r, -world->r, world->r, world->r, 2 * WALLS_WIDTH);
+				break;
+			default:
+			{
+				double xMin(0), yMin(0), xMax(1), yMax(1);
+				if (!world->objects.empty())
+				{
+					xMin = yMin = std::numeric_limits<double>::max();
+					xMax = yMax = -std::numeric_limits<double>::max();
+					for (World::Objects::const_iterator it = world->objects.begin(); it != world->objects.end(); ++it)
+					{
+						const double r((*it)->getRadius());
+						xMin = std::min(xMin, (*it)->pos.x - r);
+						yMin = std::min(yMin, (*it)->pos.y - r);
+						xMax = std::max(xMax, (*it)->pos.x + r);
+						yMax = std::max(yMax, (*it)->pos.y + r);
+					}
+				}
+				setViewRect(xMin, yMin, xMax, yMax, 2 * WALLS_WIDTH);
+			}
+			break;
+		}
+	}
+	
+	Point TopViewRenderer::toImage(const Point& p) const
+	{
+		return Point((p.x - left) * scale, (top - p.y) * scale);
+	}
+	
+	//! Return color as 4 bytes R, G, B, A in memory
+	uint32_t TopViewRenderer::toPixel(const Color& color)
+	{
+		uint8_t bytes[4];
+		for (unsigned i = 0; i < 4; ++i)
+			bytes[i] = uint8_t(std::min(std::max(color.components[i], 0.), 1.) * 255. + 0.5);
+		uint32_t pixel;
+		std::memcpy(&pixel, bytes, 4);
+		return pixel;
+	}
+	
+	static bool heightLess(const PhysicalObject* o1, const PhysicalObject* o2)
+	{
+		return o1->getHeight() < o2->getHeight();
+	}
+	
+	void TopViewRenderer::render(const World* world)
+	{
+		if (!fixedView)
+			fit(world);
+		renderBackground(world);
+		std::copy(background.begin(), background.end(), pixels.begin());
+		
+		sortedObjects.assign(world->objects.begin(), world->objects.end());
+		std::stable_sort(sortedObjects.begin(), sortedObjects.end(), heightLess);
+		for (size_t i = 0; i < sortedObjects.size(); ++i)
+			renderObject(sortedObjects[i]);
+		
+		if (drawSensorRays)
+			for (World::Objects::const_iterator it = world->objects.begin(); it != world->objects.end(); ++it)
+				renderSensorRays(*it);
+	}
+	
+	//! Render the ground and walls into background, unless they are already for this world and view
+	void TopViewRenderer::renderBackground(const World* world)
+	{
+		BackgroundKey key;
+		std::memset(&key, 0, sizeof(key));
+		key.world = world;
+		key.groundData = world->groundTexture.data.empty() ? 0 : &world->groundTexture.data[0];
+		key.scale = scale;
+		key.left = left;
+		key.top = top;
+		if (key == backgroundKey && !background.empty())
+			return;
+		backgroundKey = key;
+		
+		background.resize(width * height);
+		const uint32_t outside(toPixel(backgroundColor));
+		const uint32_t walls(toPixel(world->color * 0.6));
+		const uint32_t ground(toPixel(world->color));
+		const bool textured(world->hasGroundTexture());
+		const double wallsWidth(WALLS_WIDTH / scale);
+		for (unsigned py = 0; py < height; ++py)
+		{
+			const double y(top - (py + 0.5) / scale);
+			uint32_t* row(&background[py * width]);
+			for (unsigned px = 0; px < width; ++px)
+			{
+				const double x(left + (px + 0.5) / scale);
+				bool inside(true), inWalls(false);
+				if (world->wallsType == World::WALLS_SQUARE)
+				{
+					inside = x >= 0 && x <= world->w && y >= 0 && y <= world->h;
+					inWalls = !inside && x >= -wallsWidth && x <= world->w + wallsWidth && y >= -wallsWidth && y <= world->h + wallsWidth;
+				}
+				else if (world->wallsType == World::WALLS_CIRCULAR)
+				{
+					const double d2(x * x + y * y);
+					inside = d2 <= world->r * world->r;
+					inWalls = !inside && d2 <= (world->r + wallsWidth) * (world->r + wallsWidth);
+				}
+				if (inside)
+					row[px] = textured ? toPixel(world->getGroundColor(Point(x, y))) : ground;
+				else
+					row[px] = inWalls ? walls : outside;
+			}
+		}
+	}
+	
+	//! Fill the top of the hull of object, and outline the sides of textured parts
+	void TopViewRenderer::renderObject(const PhysicalObject* object)
+	{
+		const uint32_t color(toPixel(object->getColor()));
+		const PhysicalObject::Hull& hull(object->getHull());
+		if (hull.empty())
+		{
+			fillCircle(toImage(object->pos), object->getRadius() * scale, color);
+			return;
+		}
+		
+		const Matrix22 rot(object->angle);
+		for (PhysicalObject::Hull::const_iterator it = hull.begin(); it != hull.end(); ++it)
+		{
+			const Polygon& shape(it->getShape());
+			polygon.resize(shape.size());
+			for (size_t i = 0; i < shape.size(); ++i)
+				polygon[i] = toImage(object->pos + rot * shape[i]);
+			fillPolygon(color);
+			if (it->isTextured())
+			{
+				const Textures& textures(it->getTextures());
+				for (size_t i = 0; i < polygon.size() && i < textures.size(); ++i)
+					drawTexturedLine(polygon[i], polygon[(i + 1) % polygon.size()], textures[i]);
+			}
+		}
+	}
+	
+	//! Draw the rays of the IR sensors of object up to what they touch
+	void TopViewRenderer::renderSensorRays(const PhysicalObject* object)
+	{
+		const Robot* robot(dynamic_cast<const Robot*>(object));
+		if (!robot)
+			return;
+		const std::vector<LocalInteraction *>& interactions(robot->getLocalInteractions());
+		for (size_t i = 0; i < interactions.size(); ++i)
+		{
+			const IRSensor* sensor(dynamic_cast<const IRSensor*>(interactions[i]));
+			if (!sensor)
+				continue;
+			const Point start(sensor->getAbsolutePosition());
+			const double range(sensor->getRange());
+			for (unsigned ray = 0; ray < sensor->getRayCount(); ++ray)
+			{
+				const double angle(sensor->getAbsoluteRayAngle(ray));
+				const double dist(sensor->getRayDist(ray));
+				const bool touching(dist < range);
+				const double length(touching ? std::max(dist, 0.) : range);
+				const double closeness(touching ? 1 - length / range : 0);
+				const Color rayColor(closeness, 1 - closeness, 0);
+				drawLine(toImage(start), toImage(start + Vector(cos(angle), sin(angle)) * length), toPixel(rayColor));
+			}
+		}
+	}
+	
+	//! Fill the convex polygon in polygon, in pixel coordinates, with a pixel at least
+	void TopViewRenderer::fillPolygon(uint32_t color)
+	{
+		double xMin(polygon[0].x), xMax(polygon[0].x), yMin(polygon[0].y), yMax(polygon[0].y);
+		for (size_t i = 1; i < polygon.size(); ++i)
+		{
+			xMin = std::min(xMin, polygon[i].x);
+			xMax = std::max(xMax, polygon[i].x);
+			yMin = std::min(yMin, polygon[i].y);
+			yMax = std::max(yMax, polygon[i].y);
+		}
+		
+		// smaller than a pixel, so that small objects remain visible
+		if (xMax - xMin < 1 && yMax - yMin < 1)
+		{
+			const int px(int(std::floor((xMin + xMax) / 2)));
+			const int py(int(std::floor((yMin + yMax) / 2)));
+			if (px >= 0 && py >= 0 && px < int(width) && py < int(height))
+				pixels[py * width + px] = color;
+			return;
+		}
+		
+		// pixels whose center is inside, row by row
+		const int rowBegin(std::max(0, int(std::ceil(yMin - 0.5))));
+		const int rowEnd(std::min(int(height) - 1, int(std::floor(yMax - 0.5))));
+		for (int py = rowBegin; py <= rowEnd; ++py)
+		{
+			const double y(py + 0.5);
+			double spanBegin(std::numeric_limits<double>::max());
+			double spanEnd(-std::numeric_limits<double>::max());
+			for (size_t i = 0; i < polygon.size(); ++i)
+			{
+				const Point& a(polygon[i]);
+				const Point& b(polygon[(i + 1) % polygon.size()]);
+				if ((a.y <= y && b.y > y) || (b.y <= y && a.y > y))
+				{
+					const double x(a.x + (y - a.y) * (b.x - a.x) / (b.y - a.y));
+					spanBegin = std::min(spanBegin, x);
+					spanEnd = std::max(spanEnd, x);
+				}
+			}
+			const int columnBegin(std::max(0, int(std::ceil(spanBegin - 0.5))));
+			const int columnEnd(std::min(int(width) - 1, int(std::floor(spanEnd - 0.5))));
+			if (columnBegin <= columnEnd)
+				std::fill(&pixels[py * width + columnBegin], &pixels[py * width + columnEnd] + 1, color);
+		}
+	}
+	
+	//! Fill the circle of center and radius in pixel coordinates, with a pixel at least
+	void TopViewRenderer::fillCircle(const Point& center, double radius, uint32_t color)
+	{
+		if (radius < 0.5)
+		{
+			const int px(int(std::floor(center.x)));
+			const int py(int(std::floor(center.y)));
+			if (px >= 0 && py >= 0 && px < int(width) && py < int(height))
+				pixels[py * width + px] = color;
+			return;
+		}
+		const int rowBegin(std::max(0, int(std::ceil(center.y - radius - 0.5))));
+		const int rowEnd(std::min(int(height) - 1, int(std::floor(center.y + radius - 0.5))));
+		for (int py = rowBegin; py <= rowEnd; ++py)
+		{
+			const double dy(py + 0.5 - center.y);
+			const double halfSpan(std::sqrt(std::max(radius * radius - dy * dy, 0.)));
+			const int columnBegin(std::max(0, int(std::ceil(center.x - halfSpan - 0.5))));
+			const int columnEnd(std::min(int(width) - 1, int(std::floor(center.x + halfSpan - 0.5))));
+			if (columnBegin <= columnEnd)
+				std::fill(&pixels[py * width + columnBegin], &pixels[py * width + columnEnd] + 1, color);
+		}
+	}
+	
+	//! Draw a one-pixel line from a to b in pixel coordinates
+	void TopViewRenderer::drawLine(const Point& a, const Point& b, uint32_t color)
+	{
+		const unsigned steps(unsigned(std::ceil(std::max(std::fabs(b.x - a.x), std::fabs(b.y - a.y)))) + 1);
+		for (unsigned i = 0; i < steps; ++i)
+		{
+			const double t(steps > 1 ? double(i) / (steps - 1) : 0);
+			const int px(int(std::floor(a.x + t * (b.x - a.x))));
+			const int py(int(std::floor(a.y + t * (b.y - a.y))));
+			if (px >= 0 && py >= 0 && px < int(width) && py < int(height))
+				pixels[py * width + px] = color;
+		}
+	}
+	
+	//! Draw a one-pixel line from a to b in pixel coordinates, with the colors of texture from a to b
+	void TopViewRenderer::drawTexturedLine(const Point& a, const Point& b, const Texture& texture)
+	{
+		if (texture.empty())
+			return;
+		const unsigned steps(unsigned(std::ceil(std::max(std::fabs(b.x - a.x), std::fabs(b.y - a.y)))) + 1);
+		for (unsigned i = 0; i < steps; ++i)
+		{
+			const double t(steps > 1 ? double(i) / (steps - 1) : 0);
+			const int px(int(std::floor(a.x + t * (b.x - a.x))));
+			const int py(int(std::floor(a.y + t * (b.y - a.y))));
+			if (px >= 0 && py >= 0 && px < int(width) && py < int(height))
+				pixels[py * width + px] = toPixel(texture[std::min(size_t(t * texture.size()), texture.size() - 1)]);
+		}
+	}
+}
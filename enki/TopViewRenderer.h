@@ -0,0 +1,134 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#ifndef __ENKI_TOPVIEWRENDERER_H
+#define __ENKI_TOPVIEWRENDERER_H
+
+#include "PhysicalEngine.h"
+#include <vector>
+#include <stdint.h>
+
+/*!	\file TopViewRenderer.h
+	\brief A software renderer of worlds seen from above, for videos and thumbnails without display
+*/
+
+namespace Enki
+{
+	//! Render a world seen from above into an RGBA image, on the CPU
+	/*!
+		The image shows the ground, with its texture if any, the walls, the top of objects
+		in their color, with the sides of textured parts outlined in their texture, and
+		optionally the rays of IR sensors, colored from green when they see nothing to red
+		when they touch something. Objects are drawn from the lowest to the highest.
+
+		Pixels are stored row by row from the top of the image, that is the highest y,
+		each as 4 bytes R, G, B, A. The ground and walls are rendered once and kept until
+		the world or the view changes, so that rendering a frame mostly costs a copy of the
+		image and filling the pixels of objects.
+		\ingroup core
+	*/
+	class TopViewRenderer
+	{
+	public:
+		//! Whether to draw the rays of IR sensors
+		bool drawSensorRays;
+		//! Color of pixels outside the world
+		Color backgroundColor;
+		
+	protected:
+		const unsigned width;
+		const unsigned height;
+		//! The rendered image
+		std::vector<uint32_t> pixels;
+		
+		//! Whether the view was set by setView(), otherwise it fits the world at every render()
+		bool fixedView;
+		//! Number of pixels per cm
+		double scale;
+		//! World coordinates of the top-left corner of the image
+		double left, top;
+		
+		//! Ground and walls, rendered for the world and view in backgroundKey
+		std::vector<uint32_t> background;
+		//! What background depends on
+		struct BackgroundKey
+		{
+			const World* world;
+			const uint32_t* groundData;
+			double scale, left, top;
+			
+			bool operator ==(const BackgroundKey& that) const;
+		} backgroundKey;
+		
+		//! Objects sorted by height, kept to reuse the storage
+		std::vector<const PhysicalObject*> sortedObjects;
+		//! Vertices of the polygon being filled, in pixels, kept to reuse the storage
+		std::vector<Point> polygon;
+		
+	public:
+		//! Constructor, image of width x height pixels
+		TopViewRenderer(unsigned width, unsigned height);
+		
+		//! Show the rectangle (xMin, yMin) - (xMax, yMax) of the world, centered, keeping the aspect ratio
+		void setView(double xMin, double yMin, double xMax, double yMax);
+		//! Show the whole world with its walls, or all objects if there are no walls, at every render(); the default
+		void fitWorld();
+		
+		//! Render world into the image
+		void render(const World* world);
+		
+		//! Return the width of the image
+		unsigned getWidth() const { return width; }
+		//! Return the height of the image
+		unsigned getHeight() const { return height; }
+		//! Return the pixels of the image, height rows of width pixels of 4 bytes R, G, B, A
+		const uint8_t* getPixels() const { return reinterpret_cast<const uint8_t*>(&pixels[0]); }
+		//! Return the pixel coordinates of a point of the world
+		Point toImage(const Point& p) const;
+		
+	protected:
+		void fit(const World* world);
+		void setViewRect(double xMin, double yMin, double xMax, double yMax, double margin);
+		void renderBackground(const World* world);
+		void renderObject(const PhysicalObject* object);
+		void renderSensorRays(const PhysicalObject* object);
+		void fillPolygon(uint32_t color);
+		void fillCircle(const Point& center, double radius, uint32_t color);
+		void drawLine(const Point& a, const Point& b, uint32_t color);
+		void drawTexturedLine(const Point& a, const Point& b, const Texture& texture);
+		static uint32_t toPixel(const Color& color);
+	};
+}
+
+#endif // __ENKI_TOPVIEWRENDERER_H
@@ -0,0 +1,380 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "TrajectoryRecorder.h"
+#include "robots/DifferentialWheeled.h"
+#include "interactions/IRSensor.h"
+#include "interactions/CircularCam.h"
+#include <algorithm>
+#include <limits>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*!	\file TrajectoryRecorder.cpp
+	\brief Implementation of the recorder of trajectories into a memory-mapped columnar file
+*/
+
+namespace Enki
+{
+	static_assert(sizeof(TrajectoryRecorder::FileHeader) == 48, "file header must have the size documented in enkitrajectory.py");
+	static_assert(sizeof(TrajectoryRecorder::ColumnHeader) == 48, "column header must have the size documented in enkitrajectory.py");
+	
+	//! Round size up to a multiple of alignment
+	static size_t alignSize(size_t size, size_t alignment)
+	{
+		return ((size + alignment - 1) / alignment) * alignment;
+	}
+	
+	//! Return the first circular camera of object, or 0
+	static const CircularCam* findCamera(const PhysicalObject* object)
+	{
+		const Robot* robot(dynamic_cast<const Robot*>(object));
+		if (!robot)
+			return 0;
+		const std::vector<LocalInteraction *>& interactions(robot->getLocalInteractions());
+		for (size_t i = 0; i < interactions.size(); ++i)
+			if (const CircularCam* camera = dynamic_cast<const CircularCam*>(interactions[i]))
+				return camera;
+		return 0;
+	}
+	
+	//! Return the IR sensors of object, in their order of registration
+	static std::vector<const IRSensor*> findIRSensors(const PhysicalObject* object)
+	{
+		std::vector<const IRSensor*> sensors;
+		const Robot* robot(dynamic_cast<const Robot*>(object));
+		if (!robot)
+			return sensors;
+		const std::vector<LocalInteraction *>& interactions(robot->getRegisteredLocalInteractions());
+		for (size_t i = 0; i < interactions.size(); ++i)
+			if (const IRSensor* sensor = dynamic_cast<const IRSensor*>(interactions[i]))
+				sensors.push_back(sensor);
+		return sensors;
+	}
+	
+	TrajectoryRecorder::TrajectoryRecorder(World* world, const std::string& fileName, unsigned channels, unsigned chunkRows, bool deltaEncoding) :
+		poseColumn(0),
+		speedColumn(0),
+		wheelsColumn(0),
+		irColumn(0),
+		cameraColumn(0),
+		world(0),
+		fd(-1),
+		fileHeader(0),
+		headerSize(0),
+		chunkRows(std::max(chunkRows, 1u)),
+		chunkSize(0),
+		chunk(0),
+		chunkIndex(0),
+		rowCount(0),
+		time(0)
+	{
+		#ifdef _WIN32
+		throw std::runtime_error("TrajectoryRecorder is only supported on POSIX systems");
+		#else
+		
+		// schema
+		unsigned irWidth(0), cameraWidth(0);
+		for (World::ObjectsIterator it = world->objects.begin(); it != world->objects.end(); ++it)
+		{
+			uids.push_back((*it)->uid);
+			irSensors.push_back(findIRSensors(*it));
+			irWidth = std::max(irWidth, unsigned(irSensors.back().size()));
+			cameras.push_back(findCamera(*it));
+			if (cameras.back())
+				cameraWidth = std::max(cameraWidth, unsigned(cameras.back()->image.size()) * 4);
+		}
+		const unsigned count(uids.size());
+		const ColumnType doubleType(deltaEncoding ? TYPE_DELTA32 : TYPE_FLOAT64);
+		addColumn("time", TYPE_FLOAT64, 1, 1);
+		if (channels & CHANNEL_POSE)
+			poseColumn = addColumn("pose", doubleType, count, 3);
+		if (channels & CHANNEL_SPEED)
+			speedColumn = addColumn("speed", doubleType, count, 3);
+		if (channels & CHANNEL_WHEELS)
+			wheelsColumn = addColumn("wheels", doubleType, count, 2);
+		if (channels & CHANNEL_IR)
+			irColumn = addColumn("ir", doubleType, count, irWidth);
+		if (channels & CHANNEL_CAMERA)
+			cameraColumn = addColumn("camera", TYPE_UINT8, count, cameraWidth);
+		
+		// layout of chunks, with 8-byte aligned columns
+		const size_t pageSize(sysconf(_SC_PAGESIZE));
+		size_t offset(0);
+		for (size_t i = 0; i < columns.size(); ++i)
+		{
+			ColumnHeader& header(columns[i].header);
+			const size_t rowSize(size_t(header.count) * header.width);
+			if (header.type == TYPE_DELTA32)
+			{
+				header.keyOffset = offset;
+				offset += rowSize * sizeof(double);
+			}
+			header.offset = offset;
+			offset = alignSize(offset + size_t(this->chunkRows) * rowSize * columns[i].itemSize, 8);
+		}
+		chunkSize = alignSize(std::max(offset, size_t(1)), pageSize);
+		headerSize = alignSize(sizeof(FileHeader) + columns.size() * sizeof(ColumnHeader) + uids.size() * sizeof(uint32_t), pageSize);
+		
+		// header
+		fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0)
+			throw std::runtime_error("Cannot create trajectory file " + fileName);
+		void* mapped(MAP_FAILED);
+		if (ftruncate(fd, headerSize) == 0)
+			mapped = mmap(0, headerSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (mapped == MAP_FAILED)
+		{
+			::close(fd);
+			fd = -1;
+			throw std::runtime_error("Cannot map trajectory file " + fileName);
+		}
+		fileHeader = static_cast<FileHeader*>(mapped);
+		strncpy(fileHeader->magic, "ENKITRJ", sizeof(fileHeader->magic));
+		fileHeader->version = 1;
+		fileHeader->headerSize = headerSize;
+		fileHeader->chunkSize = chunkSize;
+		fileHeader->chunkRows = this->chunkRows;
+		fileHeader->objectCount = count;
+		fileHeader->columnCount = columns.size();
+		fileHeader->reserved = 0;
+		fileHeader->rowCount = 0;
+		ColumnHeader* columnHeaders(reinterpret_cast<ColumnHeader*>(fileHeader + 1));
+		for (size_t i = 0; i < columns.size(); ++i)
+			columnHeaders[i] = columns[i].header;
+		uint32_t* fileUids(reinterpret_cast<uint32_t*>(columnHeaders + columns.size()));
+		std::copy(uids.begin(), uids.end(), fileUids);
+		
+		this->world = world;
+		world->addStepObserver(this);
+		#endif // _WIN32
+	}
+	
+	TrajectoryRecorder::~TrajectoryRecorder()
+	{
+		close();
+	}
+	
+	size_t TrajectoryRecorder::addColumn(const char* name, ColumnType type, unsigned count, unsigned width)
+	{
+		Column column;
+		memset(&column.header, 0, sizeof(column.header));
+		strncpy(column.header.name, name, sizeof(column.header.name) - 1);
+		column.header.type = type;
+		column.header.count = count;
+		column.header.width = width;
+		column.itemSize = type == TYPE_FLOAT64 ? sizeof(double) : (type == TYPE_DELTA32 ? sizeof(float) : 1);
+		if (type == TYPE_UINT8)
+			column.bytes.resize(size_t(count) * width);
+		else
+			column.values.resize(size_t(count) * width);
+		if (type == TYPE_DELTA32)
+			column.previous.resize(size_t(count) * width);
+		columns.push_back(column);
+		return columns.size() - 1;
+	}
+	
+	void TrajectoryRecorder::readObjects()
+	{
+		const double nan(std::numeric_limits<double>::quiet_NaN());
+		columns[0].values[0] = time;
+		
+		// both objects and uids are ordered by uid, removed objects are skipped in objects
+		World::ObjectsIterator it(world->objects.begin());
+		for (size_t i = 0; i < uids.size(); ++i)
+		{
+			while (it != world->objects.end() && (*it)->uid < uids[i])
+				++it;
+			const PhysicalObject* object((it != world->objects.end() && (*it)->uid == uids[i]) ? *it : 0);
+			
+			if (poseColumn)
+			{
+				double* values(&columns[poseColumn].values[i * 3]);
+				values[0] = object ? object->pos.x : nan;
+				values[1] = object ? object->pos.y : nan;
+				values[2] = object ? object->angle : nan;
+			}
+			if (speedColumn)
+			{
+				double* values(&columns[speedColumn].values[i * 3]);
+				values[0] = object ? object->speed.x : nan;
+				values[1] = object ? object->speed.y : nan;
+				values[2] = object ? object->angSpeed : nan;
+			}
+			if (wheelsColumn)
+			{
+				const DifferentialWheeled* wheeled(dynamic_cast<const DifferentialWheeled*>(object));
+				double* values(&columns[wheelsColumn].values[i * 2]);
+				values[0] = wheeled ? wheeled->leftSpeed : nan;
+				values[1] = wheeled ? wheeled->rightSpeed : nan;
+			}
+			if (irColumn)
+			{
+				const unsigned width(columns[irColumn].header.width);
+				double* values(&columns[irColumn].values[i * width]);
+				std::fill(values, values + width, nan);
+				if (object)
+					for (size_t j = 0; j < irSensors[i].size(); ++j)
+						values[j] = irSensors[i][j]->getValue();
+			}
+			if (cameraColumn)
+			{
+				const unsigned width(columns[cameraColumn].header.width);
+				uint8_t* bytes(&columns[cameraColumn].bytes[i * width]);
+				std::fill(bytes, bytes + width, 0);
+				if (const CircularCam* camera = object ? cameras[i] : 0)
+				{
+					const size_t pixelCount(std::min(size_t(width / 4), camera->image.size()));
+					for (size_t p = 0; p < pixelCount; ++p)
+						for (size_t c = 0; c < 4; ++c)
+							bytes[p * 4 + c] = uint8_t(std::min(std::max(camera->image[p].components[c], 0.), 1.) * 255. + 0.5);
+				}
+			}
+		}
+	}
+	
+	void TrajectoryRecorder::mapChunk(uint64_t index)
+	{
+		#ifndef _WIN32
+		if (chunk)
+			munmap(chunk, chunkSize);
+		chunk = 0;
+		const off_t begin(headerSize + index * chunkSize);
+		if (ftruncate(fd, begin + chunkSize) != 0)
+			throw std::runtime_error("Cannot grow trajectory file");
+		void* mapped(mmap(0, chunkSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, begin));
+		if (mapped == MAP_FAILED)
+			throw std::runtime_error("Cannot map trajectory chunk");
+		chunk = static_cast<uint8_t*>(mapped);
+		chunkIndex = index;
+		#endif // _WIN32
+	}
+	
+	void TrajectoryRecorder::writeRow(unsigned rowInChunk)
+	{
+		for (size_t i = 0; i < columns.size(); ++i)
+		{
+			Column& column(columns[i]);
+			const size_t rowSize(size_t(column.header.count) * column.header.width);
+			uint8_t* destination(chunk + column.header.offset + rowInChunk * rowSize * column.itemSize);
+			switch (column.header.type)
+			{
+				case TYPE_FLOAT64:
+					memcpy(destination, &column.values[0], rowSize * sizeof(double));
+					break;
+				
+				case TYPE_DELTA32:
+				{
+					float* deltas(reinterpret_cast<float*>(destination));
+					if (rowInChunk == 0)
+					{
+						// key row, the reader starts accumulating from it
+						memcpy(chunk + column.header.keyOffset, &column.values[0], rowSize * sizeof(double));
+						column.previous = column.values;
+						std::fill(deltas, deltas + rowSize, 0.f);
+					}
+					else
+					{
+						// accumulate the rounded differences as the reader does, so that errors do not add up
+						for (size_t j = 0; j < rowSize; ++j)
+						{
+							deltas[j] = float(column.values[j] - column.previous[j]);
+							column.previous[j] += double(deltas[j]);
+						}
+					}
+					break;
+				}
+				
+				default:
+					memcpy(destination, &column.bytes[0], rowSize);
+					break;
+			}
+		}
+	}
+	
+	void TrajectoryRecorder::record(double time)
+	{
+		if (fd < 0)
+			return;
+		this->time = time;
+		readObjects();
+		const unsigned rowInChunk(rowCount % chunkRows);
+		if (rowInChunk == 0)
+			mapChunk(rowCount / chunkRows);
+		writeRow(rowInChunk);
+		
+		// publish the row to concurrent readers once its values are written
+		++rowCount;
+		std::atomic_thread_fence(std::memory_order_release);
+		*static_cast<volatile uint64_t*>(&fileHeader->rowCount) = rowCount;
+	}
+	
+	void TrajectoryRecorder::worldStepped(World* steppedWorld, double dt)
+	{
+		// the world keeps stepping when the file cannot grow, only the recording stops
+		try
+		{
+			record(time + dt);
+		}
+		catch (const std::exception& e)
+		{
+			error = e.what();
+			close();
+		}
+	}
+	
+	void TrajectoryRecorder::close()
+	{
+		if (world)
+			world->removeStepObserver(this);
+		world = 0;
+		#ifndef _WIN32
+		if (chunk)
+			munmap(chunk, chunkSize);
+		chunk = 0;
+		if (fileHeader)
+			munmap(fileHeader, headerSize);
+		fileHeader = 0;
+		if (fd >= 0)
+			::close(fd);
+		fd = -1;
+		#endif // _WIN32
+	}
+}
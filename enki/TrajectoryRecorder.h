@@ -0,0 +1,199 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __ENKI_TRAJECTORYRECORDER_H
+#define __ENKI_TRAJECTORYRECORDER_H
+
+#include "PhysicalEngine.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*!	\file TrajectoryRecorder.h
+	\brief Recorder of the trajectories of objects into a memory-mapped columnar file
+*/
+
+namespace Enki
+{
+	class IRSensor;
+	class CircularCam;
+	
+	//! Record the state of the objects of a world after every step into a memory-mapped, chunked columnar file
+	/*!
+		The file starts with a header describing its schema, followed by chunks of chunkRows rows.
+		Each row holds the state of the objects present in the world when the recorder was created,
+		after a step. Within a chunk, each column is stored contiguously as an array of shape
+		(chunkRows, objects, width), so that reading a channel does not touch the others.
+		Chunks are fixed-size and the file only grows by whole chunks, while the header holds
+		the number of rows completely written, updated after each row; the file can thus be read
+		while being written, for instance by python/enkitrajectory.py.
+
+		If deltaEncoding is true, the columns of doubles are stored as differences to the previous
+		row in single precision, the first row of each chunk being stored in full as a key.
+		The encoder accumulates the differences as the reader does, so the error does not grow
+		along a chunk and is that of rounding a difference to single precision. This halves the
+		size of the file, which also compresses much better; NaN values must remain NaN along
+		a chunk, as is the case for the padding of missing sensors.
+
+		Values of objects that are removed from the world are NaN, or 0 for camera images.
+		The layout is that of the machine writing the file, which is little-endian in practice.
+		Files are only supported on POSIX systems, the constructor throws std::runtime_error elsewhere.
+		\ingroup core
+	*/
+	class TrajectoryRecorder: public StepObserver
+	{
+	public:
+		//! Channels that can be recorded, combine them with |
+		enum Channel
+		{
+			CHANNEL_POSE = 1 << 0,		//!< "pose": x, y and angle of each object
+			CHANNEL_SPEED = 1 << 1,		//!< "speed": speed x, speed y and angular speed of each object
+			CHANNEL_WHEELS = 1 << 2,	//!< "wheels": left and right speed commands of differential wheeled robots, NaN for other objects
+			CHANNEL_IR = 1 << 3,		//!< "ir": values of the IR sensors of robots, in their order of registration, padded with NaN
+			CHANNEL_CAMERA = 1 << 4,	//!< "camera": pixels of the first circular camera of robots as RGBA bytes, padded with 0
+			CHANNELS_ALL = (1 << 5) - 1	//!< all channels above
+		};
+		
+		//! Type of the elements of a column in the file
+		enum ColumnType
+		{
+			TYPE_FLOAT64 = 'd',	//!< double, stored as is
+			TYPE_DELTA32 = 'f',	//!< double, stored as a float difference to the previous row, after a key row of doubles at the beginning of the chunk
+			TYPE_UINT8 = 'B'	//!< byte, stored as is
+		};
+		
+		//! Header at the beginning of the file
+		struct FileHeader
+		{
+			char magic[8];			//!< "ENKITRJ", null-terminated
+			uint32_t version;		//!< version of the format, 1
+			uint32_t headerSize;	//!< size of the header in bytes, including column headers and uids, the first chunk follows
+			uint64_t chunkSize;		//!< size of a chunk in bytes
+			uint32_t chunkRows;		//!< number of rows in a chunk
+			uint32_t objectCount;	//!< number of recorded objects
+			uint32_t columnCount;	//!< number of columns
+			uint32_t reserved;		//!< 0
+			uint64_t rowCount;		//!< number of rows completely written, updated after each row
+		};
+		
+		//! Description of a column, columnCount of them follow the file header, followed by the uids of objects as uint32_t
+		struct ColumnHeader
+		{
+			char name[16];			//!< name of the column, null-terminated
+			uint32_t type;			//!< type of elements, a ColumnType
+			uint32_t count;			//!< number of objects in a row, 1 for the time
+			uint32_t width;			//!< number of elements per object
+			uint32_t reserved;		//!< 0
+			uint64_t keyOffset;		//!< offset of the key row within a chunk, for TYPE_DELTA32
+			uint64_t offset;		//!< offset of the rows within a chunk
+		};
+		
+	protected:
+		//! A column and the state needed to fill it
+		struct Column
+		{
+			ColumnHeader header;	//!< description written in the file
+			size_t itemSize;		//!< size of an element in bytes
+			std::vector<double> values;	//!< values of the current row, for columns of doubles
+			std::vector<uint8_t> bytes;	//!< values of the current row, for columns of bytes
+			std::vector<double> previous;	//!< values of the previous row as decoded by a reader, for TYPE_DELTA32
+		};
+		
+		//! Uids of the recorded objects, in the order of World::objects
+		std::vector<unsigned> uids;
+		//! IR sensors of each recorded object, resolved when recording starts
+		std::vector<std::vector<const IRSensor*> > irSensors;
+		//! First circular camera of each recorded object, or 0, resolved when recording starts
+		std::vector<const CircularCam*> cameras;
+		//! Columns, the first one being the time
+		std::vector<Column> columns;
+		//! Index in columns of each channel that is recorded, 0 otherwise
+		size_t poseColumn, speedColumn, wheelsColumn, irColumn, cameraColumn;
+		//! World being observed, 0 after close()
+		World* world;
+		
+		//! File descriptor, -1 after close()
+		int fd;
+		//! Mapped header
+		FileHeader* fileHeader;
+		//! Size of the mapped header
+		size_t headerSize;
+		//! Number of rows in a chunk
+		unsigned chunkRows;
+		//! Size of a chunk, a multiple of the page size
+		size_t chunkSize;
+		//! Mapped current chunk, 0 if none
+		uint8_t* chunk;
+		//! Index of the current chunk
+		uint64_t chunkIndex;
+		//! Number of rows written
+		uint64_t rowCount;
+		//! Time of the next row, incremented by dt at each step
+		double time;
+		//! Why recording stopped during a step, empty if it did not
+		std::string error;
+		
+	public:
+		//! Create fileName and record the objects currently in world after each of its steps; throw std::runtime_error if the file cannot be created
+		TrajectoryRecorder(World* world, const std::string& fileName, unsigned channels = CHANNEL_POSE | CHANNEL_SPEED, unsigned chunkRows = 1024, bool deltaEncoding = false);
+		//! Destructor, call close()
+		virtual ~TrajectoryRecorder();
+		
+		//! Append a row with the current state of the objects of world, at the given time
+		void record(double time);
+		//! Stop observing the world and close the file, further steps are not recorded
+		void close();
+		
+		//! Return the number of rows written so far
+		uint64_t getRowCount() const { return rowCount; }
+		//! Return the number of recorded objects
+		size_t getObjectCount() const { return uids.size(); }
+		//! Return why recording stopped during a step, for instance because the disk is full, or an empty string
+		const std::string& getError() const { return error; }
+		
+		//! Record a row at the time accumulated over steps; if it fails, close() and keep the reason for getError()
+		virtual void worldStepped(World* world, double dt);
+		
+	protected:
+		//! Add a column of given type and width per object, return its index
+		size_t addColumn(const char* name, ColumnType type, unsigned count, unsigned width);
+		//! Fill the values of the current row from the objects of world
+		void readObjects();
+		//! Map the chunk of index, growing the file
+		void mapChunk(uint64_t index);
+		//! Copy the values of the current row into the current chunk
+		void writeRow(unsigned rowInChunk);
+	};
+}
+
+#endif
@@ -0,0 +1,334 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "WorldBatch.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <stdlib.h>
+#endif
+
+/*!	\file WorldBatch.cpp
+	\brief Implementation of the thread pool stepping many independent worlds
+*/
+
+namespace Enki
+{
+#ifdef __linux__
+	//! Parse a Linux CPU list such as "0-3,8-11"
+	static std::vector<unsigned> parseCpuList(const std::string& list)
+	{
+		std::vector<unsigned> cpus;
+		std::istringstream stream(list);
+		std::string range;
+		while (std::getline(stream, range, ','))
+		{
+			if (range.empty() || range[0] < '0' || range[0] > '9')
+				continue;
+			const size_t dash(range.find('-'));
+			const unsigned first(strtoul(range.c_str(), 0, 10));
+			const unsigned last(dash == std::string::npos ? first : strtoul(range.c_str() + dash + 1, 0, 10));
+			for (unsigned cpu = first; cpu <= last; ++cpu)
+				cpus.push_back(cpu);
+		}
+		return cpus;
+	}
+#endif // __linux__
+	
+	//! Return the CPUs of each NUMA node this process can run on, all CPUs in a single node if the topology is unknown
+	static std::vector<std::vector<unsigned> > readNumaNodes()
+	{
+		std::vector<std::vector<unsigned> > nodes;
+		
+		#ifdef __linux__
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+			for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu)
+				CPU_SET(cpu, &allowed);
+		
+		// nodes are numbered, but not necessarily contiguously
+		std::vector<unsigned> nodeNumbers;
+		DIR* dir(opendir("/sys/devices/system/node"));
+		if (dir)
+		{
+			while (struct dirent* entry = readdir(dir))
+			{
+				const std::string name(entry->d_name);
+				if (name.size() > 4 && name.compare(0, 4, "node") == 0 && name.find_first_not_of("0123456789", 4) == std::string::npos)
+					nodeNumbers.push_back(strtoul(name.c_str() + 4, 0, 10));
+			}
+			closedir(dir);
+		}
+		std::sort(nodeNumbers.begin(), nodeNumbers.end());
+		
+		for (size_t i = 0; i < nodeNumbers.size(); ++i)
+		{
+			std::ostringstream fileName;
+			fileName << "/sys/devices/system/node/node" << nodeNumbers[i] << "/cpulist";
+			std::ifstream file(fileName.str().c_str());
+			std::string list;
+			std::getline(file, list);
+			const std::vector<unsigned> nodeCpus(parseCpuList(list));
+			std::vector<unsigned> allowedCpus;
+			for (size_t j = 0; j < nodeCpus.size(); ++j)
+				if (nodeCpus[j] < CPU_SETSIZE && CPU_ISSET(nodeCpus[j], &allowed))
+					allowedCpus.push_back(nodeCpus[j]);
+			if (!allowedCpus.empty())
+				nodes.push_back(allowedCpus);
+		}
+		
+		if (nodes.empty())
+		{
+			nodes.resize(1);
+			for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+				if (CPU_ISSET(cpu, &allowed))
+					nodes[0].push_back(cpu);
+		}
+		#endif // __linux__
+		
+		if (nodes.empty() || nodes[0].empty())
+		{
+			nodes.assign(1, std::vector<unsigned>());
+			for (unsigned cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1u); ++cpu)
+				nodes[0].push_back(cpu);
+		}
+		return nodes;
+	}
+	
+	WorldBatch::WorldBatch(unsigned threadCount, bool pinThreads) :
+		takeWorldOwnership(true),
+		nodeCpus(readNumaNodes()),
+		pinThreads(pinThreads),
+		jobGeneration(0),
+		busyThreads(0),
+		stopping(false),
+		jobStealing(true)
+	{
+		#ifndef __linux__
+		this->pinThreads = false;
+		#endif
+		
+		// CPUs grouped by node
+		std::vector<unsigned> cpus, cpuNodes;
+		for (size_t node = 0; node < nodeCpus.size(); ++node)
+		{
+			cpus.insert(cpus.end(), nodeCpus[node].begin(), nodeCpus[node].end());
+			cpuNodes.insert(cpuNodes.end(), nodeCpus[node].size(), unsigned(node));
+		}
+		if (threadCount == 0)
+			threadCount = unsigned(cpus.size());
+		
+		// spread threads evenly over CPUs, so that all nodes are used even with few threads
+		for (unsigned i = 0; i < threadCount; ++i)
+		{
+			const size_t cpu((size_t(i) * cpus.size()) / threadCount);
+			threadCpus.push_back(cpus[cpu]);
+			threadNodes.push_back(this->pinThreads ? cpuNodes[cpu] : 0);
+		}
+		
+		nodeEntries.resize(getNodeCount());
+		nodeCursors.reset(new std::atomic<size_t>[getNodeCount()]);
+		for (unsigned i = 0; i < threadCount; ++i)
+			threads.push_back(std::thread(&WorldBatch::workerLoop, this, i));
+	}
+	
+	WorldBatch::~WorldBatch()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		jobAvailable.notify_all();
+		for (size_t i = 0; i < threads.size(); ++i)
+			threads[i].join();
+		
+		if (takeWorldOwnership)
+			for (size_t i = 0; i < entries.size(); ++i)
+				delete entries[i].world;
+	}
+	
+	size_t WorldBatch::addWorld(World* world, const StepCallback& callback)
+	{
+		Entry entry;
+		entry.world = world;
+		entry.callback = callback;
+		entry.steps = 0;
+		entry.running = true;
+		entry.node = threadNodes[entries.size() % threadNodes.size()];
+		entries.push_back(entry);
+		return entries.size() - 1;
+	}
+	
+	size_t WorldBatch::createWorlds(size_t count, const WorldFactory& factory)
+	{
+		const size_t first(entries.size());
+		for (size_t i = 0; i < count; ++i)
+			addWorld(0);
+		
+		try
+		{
+			// no stealing, so that the memory of each world is local to its home node
+			dispatch([&](size_t index) { entries[index].world = factory(index); }, first, entries.size(), false);
+		}
+		catch (...)
+		{
+			for (size_t i = first; i < entries.size(); ++i)
+				delete entries[i].world;
+			entries.resize(first);
+			throw;
+		}
+		return first;
+	}
+	
+	void WorldBatch::setCallback(size_t index, const StepCallback& callback)
+	{
+		entries[index].callback = callback;
+	}
+	
+	void WorldBatch::run(unsigned steps, double dt, unsigned physicsOversampling)
+	{
+		dispatch([&](size_t index) {
+			for (unsigned i = 0; i < steps && entries[index].running; ++i)
+				stepEntry(index, dt, physicsOversampling);
+		}, 0, entries.size());
+	}
+	
+	size_t WorldBatch::step(double dt, unsigned physicsOversampling)
+	{
+		dispatch([&](size_t index) {
+			if (entries[index].running)
+				stepEntry(index, dt, physicsOversampling);
+		}, 0, entries.size());
+		
+		size_t runningCount(0);
+		for (size_t i = 0; i < entries.size(); ++i)
+			if (entries[i].running)
+				++runningCount;
+		return runningCount;
+	}
+	
+	bool WorldBatch::stepEntry(size_t index, double dt, unsigned physicsOversampling)
+	{
+		Entry& entry(entries[index]);
+		entry.world->step(dt, physicsOversampling);
+		++entry.steps;
+		if (entry.callback && !entry.callback(entry.world, entry.steps))
+			entry.running = false;
+		return entry.running;
+	}
+	
+	void WorldBatch::dispatch(const std::function<void(size_t)>& job, size_t begin, size_t end, bool stealing)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		for (size_t node = 0; node < nodeEntries.size(); ++node)
+		{
+			nodeEntries[node].clear();
+			nodeCursors[node] = 0;
+		}
+		for (size_t i = begin; i < end; ++i)
+			nodeEntries[entries[i].node].push_back(i);
+		this->job = job;
+		jobStealing = stealing;
+		busyThreads = unsigned(threads.size());
+		++jobGeneration;
+		jobAvailable.notify_all();
+		
+		while (busyThreads > 0)
+			jobDone.wait(lock);
+		this->job = nullptr;
+		
+		if (jobException)
+		{
+			std::exception_ptr exception(jobException);
+			jobException = nullptr;
+			std::rethrow_exception(exception);
+		}
+	}
+	
+	void WorldBatch::workerLoop(unsigned threadIndex)
+	{
+		#ifdef __linux__
+		if (pinThreads)
+		{
+			cpu_set_t cpuSet;
+			CPU_ZERO(&cpuSet);
+			CPU_SET(threadCpus[threadIndex], &cpuSet);
+			pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+		}
+		#endif // __linux__
+		
+		const unsigned node(threadNodes[threadIndex]);
+		unsigned seenGeneration(0);
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				while (!stopping && jobGeneration == seenGeneration)
+					jobAvailable.wait(lock);
+				if (stopping)
+					return;
+				seenGeneration = jobGeneration;
+			}
+			
+			// process the entries of the home node first, then help the other nodes if allowed
+			try
+			{
+				const size_t nodeCount(jobStealing ? nodeEntries.size() : 1);
+				for (size_t i = 0; i < nodeCount; ++i)
+				{
+					const size_t other((node + i) % nodeEntries.size());
+					const std::vector<size_t>& indices(nodeEntries[other]);
+					for (size_t j = nodeCursors[other]++; j < indices.size(); j = nodeCursors[other]++)
+						job(indices[j]);
+				}
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!jobException)
+					jobException = std::current_exception();
+			}
+			
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (--busyThreads == 0)
+					jobDone.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,170 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __ENKI_WORLDBATCH_H
+#define __ENKI_WORLDBATCH_H
+
+#include "PhysicalEngine.h"
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <atomic>
+
+/*!	\file WorldBatch.h
+	\brief A thread pool stepping many independent worlds
+*/
+
+namespace Enki
+{
+	//! Step many independent worlds in parallel, for instance runs of an experiment with different seeds or parameters
+	/*!
+		Worlds are stepped by a pool of threads, each world by a single thread at a time.
+		run() steps every world to completion independently of the others, while step()
+		steps all worlds once in lockstep. A callback can be attached to each world, it is
+		called by the thread stepping the world after each of its steps and can stop it.
+
+		If pinThreads is true, threads are pinned to CPUs spread evenly over the NUMA nodes,
+		and each world has a home node whose threads step it in priority, other threads
+		only stepping it once the worlds of their own node are done. Worlds built by
+		createWorlds() are allocated by a thread of their home node, so that their memory
+		is local to the threads stepping them. Pinning is only implemented on Linux.
+
+		Callbacks must not call run() or step() of their batch.
+
+		Worlds must not share objects, and objects whose interactions share state between
+		worlds, such as s-bots with global sound, must not be stepped in parallel.
+		\ingroup core
+	*/
+	class WorldBatch
+	{
+	public:
+		//! Called after each step of world, step being the number of steps of this world so far; return false to stop stepping this world
+		typedef std::function<bool(World* world, unsigned step)> StepCallback;
+		//! Build the world of index
+		typedef std::function<World*(size_t index)> WorldFactory;
+		
+		//! Whether the batch should delete the worlds upon destruction, true by default
+		bool takeWorldOwnership;
+		
+	protected:
+		//! A world and its stepping state
+		struct Entry
+		{
+			World* world; //!< world being stepped
+			StepCallback callback; //!< callback of this world, may be empty
+			unsigned steps; //!< number of steps of this world so far
+			bool running; //!< false once the callback has returned false
+			unsigned node; //!< NUMA node whose threads step this world in priority
+		};
+		//! The worlds of this batch
+		std::vector<Entry> entries;
+		
+		//! CPUs of each NUMA node, restricted to the ones this process can run on
+		std::vector<std::vector<unsigned> > nodeCpus;
+		//! Whether threads are pinned to CPUs
+		bool pinThreads;
+		//! NUMA node of each thread, 0 if threads are not pinned
+		std::vector<unsigned> threadNodes;
+		//! CPU of each thread, if threads are pinned
+		std::vector<unsigned> threadCpus;
+		//! Worker threads
+		std::vector<std::thread> threads;
+		
+		//! Protect the fields below
+		std::mutex mutex;
+		//! Signal workers that a job is available or that they must stop
+		std::condition_variable jobAvailable;
+		//! Signal dispatch() that all workers are done
+		std::condition_variable jobDone;
+		//! Incremented for every job
+		unsigned jobGeneration;
+		//! Number of workers still working on the current job
+		unsigned busyThreads;
+		//! Whether workers must stop
+		bool stopping;
+		//! Job called for each entry index
+		std::function<void(size_t)> job;
+		//! Whether threads process the entries of other nodes once those of their node are done, for the current job
+		bool jobStealing;
+		//! First exception thrown by the current job
+		std::exception_ptr jobException;
+		//! Indices of entries of each node, for the current job
+		std::vector<std::vector<size_t> > nodeEntries;
+		//! Next index in nodeEntries of each node, for the current job
+		std::unique_ptr<std::atomic<size_t>[]> nodeCursors;
+		
+		//! Loop of a worker thread
+		void workerLoop(unsigned threadIndex);
+		//! Call job for every entry index in [begin, end[, each index being processed by one thread, of its home node only if stealing is false, and return when all are processed; rethrow the first exception thrown by job
+		void dispatch(const std::function<void(size_t)>& job, size_t begin, size_t end, bool stealing = true);
+		//! Step world of index and call its callback, return whether it is still running
+		bool stepEntry(size_t index, double dt, unsigned physicsOversampling);
+		
+	public:
+		//! Constructor, threadCount of 0 uses one thread per CPU available
+		WorldBatch(unsigned threadCount = 0, bool pinThreads = false);
+		//! Destructor, stop threads and delete the worlds if takeWorldOwnership is true
+		virtual ~WorldBatch();
+		
+		//! Add a world with an optional callback, return its index
+		size_t addWorld(World* world, const StepCallback& callback = StepCallback());
+		//! Build count worlds in parallel by calling factory from the threads, each world being built by a thread of its home node even if other nodes are idle, return the index of the first one
+		size_t createWorlds(size_t count, const WorldFactory& factory);
+		//! Set the callback of world of index
+		void setCallback(size_t index, const StepCallback& callback);
+		
+		//! Step every running world steps times or until its callback returns false, independently of the other worlds
+		void run(unsigned steps, double dt, unsigned physicsOversampling = 1);
+		//! Step every running world once, return the number of worlds still running
+		size_t step(double dt, unsigned physicsOversampling = 1);
+		
+		//! Return the number of worlds
+		size_t size() const { return entries.size(); }
+		//! Return the world of index
+		World* getWorld(size_t index) const { return entries[index].world; }
+		//! Return the number of steps of world of index so far
+		unsigned getStepCount(size_t index) const { return entries[index].steps; }
+		//! Return whether the world of index is still running
+		bool isRunning(size_t index) const { return entries[index].running; }
+		//! Return the number of threads
+		unsigned getThreadCount() const { return unsigned(threads.size()); }
+		//! Return the number of NUMA nodes threads are spread over
+		unsigned getNodeCount() const { return pinThreads ? unsigned(nodeCpus.size()) : 1; }
+	};
+}
+
+#endif
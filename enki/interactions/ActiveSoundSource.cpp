@@ -67,6 +67,22 @@ namespace Enki
 		delete[] pitch;
 	}
 
+	void ActiveSoundSource::saveState(StateWriter& writer) const
+	{
+		writer.writeArray(pitch, noOfChannels);
+		writer.write(enableFlag);
+		writer.write(elapsedTime);
+		writer.write(activityTime);
+	}
+	
+	void ActiveSoundSource::restoreState(StateReader& reader)
+	{
+		reader.readArray(pitch, noOfChannels);
+		reader.read(enableFlag);
+		reader.read(elapsedTime);
+		reader.read(activityTime);
+	}
+
 	void ActiveSoundSource::setSoundRange(double range)
 	{
 		this->r = range;
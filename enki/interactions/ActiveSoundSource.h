@@ -68,6 +68,10 @@ namespace Enki
 		// Local interaction functions
 		virtual void init() {}
 		virtual void objectStep(double dt, PhysicalObject *po, World *w) {}
+		//! Append the emitted sound and activity to writer
+		virtual void saveState(StateWriter& writer) const;
+		//! Restore the emitted sound and activity appended by saveState()
+		virtual void restoreState(StateReader& reader);
 		
 		//! Set the range of this sound interraction
 		void setSoundRange(double range);
@@ -36,6 +36,7 @@
 
 #include <limits.h>
 #include <assert.h>
+#include <algorithm>
 
 /*!	\file Bluetooth.cpp
 	\brief Implementation of the bluetooth module
@@ -51,6 +52,8 @@ namespace Enki
 		this->address=address;
 		this->updateAddress=true;
 		this->randomAddress=true;
+		this->base=NULL;
+		this->registeredAddress=UINT_MAX;
 		this->connectionError=BT_NO_ERROR;
 		this->disconnectionError=BT_NO_ERROR;
 		this->rxBufferSize=rxbuffersize;
@@ -62,6 +65,40 @@ namespace Enki
 		
 	}
 	
+	Bluetooth::Bluetooth(const Bluetooth& other) :
+		GlobalInteraction(other)
+	{
+		this->range=other.range;
+		this->maxConnections=other.maxConnections;
+		this->address=other.address;
+		this->updateAddress=other.updateAddress;
+		this->randomAddress=other.randomAddress;
+		// registered lazily by step() with the same address
+		this->base=NULL;
+		this->registeredAddress=other.registeredAddress;
+		this->connectionError=other.connectionError;
+		this->disconnectionError=other.disconnectionError;
+		this->rxBufferSize=other.rxBufferSize;
+		this->txBufferSize=other.txBufferSize;
+		
+		initAllData();
+		
+		std::copy(other.sizeReceived, other.sizeReceived+maxConnections, sizeReceived);
+		std::copy(other.transmissionError, other.transmissionError+maxConnections, transmissionError);
+		std::copy(other.receptionFlags, other.receptionFlags+maxConnections, receptionFlags);
+		std::copy(other.destAddress, other.destAddress+maxConnections, destAddress);
+		std::copy(other.sizeToSend, other.sizeToSend+maxConnections, sizeToSend);
+		for (unsigned i=0;i<maxConnections;++i)
+		{
+			std::copy(other.rxBuffer[i], other.rxBuffer[i]+rxBufferSize, rxBuffer[i]);
+			std::copy(other.txBuffer[i], other.txBuffer[i]+txBufferSize, txBuffer[i]);
+		}
+		connectToRobot=other.connectToRobot;
+		closeConnectionToRobot=other.closeConnectionToRobot;
+		
+		nbConnections=other.nbConnections;
+	}
+	
 	Bluetooth::~Bluetooth()
 	{
 		cancelAllData();
@@ -323,6 +360,14 @@ namespace Enki
 			else
 				assert(bb->registerClient(this,address));
 			updateAddress=false;
+			base=bb;
+			registeredAddress=address;
+		}
+		else if (base != bb && registeredAddress != UINT_MAX)
+		{
+			// this module is a copy of a module of another world, register with the same address
+			bb->registerClient(this,registeredAddress);
+			base=bb;
 		}
 		
 		// Connection to another robot
@@ -353,6 +398,56 @@ namespace Enki
 		}
 	}
 	
+	void Bluetooth::saveState(StateWriter& writer) const
+	{
+		writer.write(address);
+		writer.write(registeredAddress);
+		writer.write(updateAddress);
+		writer.write(randomAddress);
+		writer.write(nbConnections);
+		writer.writeArray(destAddress, maxConnections);
+		writer.writeArray(receptionFlags, maxConnections);
+		writer.writeArray(sizeToSend, maxConnections);
+		writer.writeArray(sizeReceived, maxConnections);
+		writer.writeArray(transmissionError, maxConnections);
+		for (unsigned i=0;i<maxConnections;++i)
+		{
+			writer.writeArray(rxBuffer[i], rxBufferSize);
+			writer.writeArray(txBuffer[i], txBufferSize);
+		}
+		writer.writeQueue(connectToRobot);
+		writer.writeQueue(closeConnectionToRobot);
+		writer.write(connectionError);
+		writer.write(disconnectionError);
+	}
+	
+	void Bluetooth::restoreState(StateReader& reader)
+	{
+		reader.read(address);
+		reader.read(registeredAddress);
+		reader.read(updateAddress);
+		reader.read(randomAddress);
+		reader.read(nbConnections);
+		reader.readArray(destAddress, maxConnections);
+		reader.readArray(receptionFlags, maxConnections);
+		reader.readArray(sizeToSend, maxConnections);
+		reader.readArray(sizeReceived, maxConnections);
+		reader.readArray(transmissionError, maxConnections);
+		for (unsigned i=0;i<maxConnections;++i)
+		{
+			reader.readArray(rxBuffer[i], rxBufferSize);
+			reader.readArray(txBuffer[i], txBufferSize);
+		}
+		reader.readQueue(connectToRobot);
+		reader.readQueue(closeConnectionToRobot);
+		reader.read(connectionError);
+		reader.read(disconnectionError);
+		
+		// World::restoreState() cleared the clients of the base
+		if (base && registeredAddress != UINT_MAX)
+			base->registerClient(this, registeredAddress);
+	}
+	
 	unsigned Bluetooth::getConnectionError()
 	{
 		return (unsigned)connectionError;
@@ -85,6 +85,10 @@ protected:
 		bool updateAddress;
 		//! Flag indicating that the current address has been assigned randomly
 		bool randomAddress;
+		//! Bluetooth base this module is registered to, NULL if not registered yet
+		BluetoothBase* base;
+		//! Address this module is registered with in base, UINT_MAX if not registered
+		unsigned registeredAddress;
 		
 		//! Queue containing request for connection to other modules
 		std::queue<unsigned> connectToRobot;
@@ -126,11 +130,17 @@ public:
 		//! Constructor
 		//! e.g.: "bluetooth(this,10000,7,100,10,1)" for a module of address 1 with a range of 10 meters, 7 supporting simultaneous connections capable of receiving packets of 100 bytes and emitting packets of 10 bytes.
 		Bluetooth(Robot* owner,double range, unsigned maxConnections, unsigned rxbuffersize, unsigned txbuffersize,unsigned address);
+		//! Copy constructor, copies buffers and connections; the copy registers with the Bluetooth base of the world it is stepped in, see World::fork()
+		Bluetooth(const Bluetooth& other);
 		//! Destructor
 		virtual ~Bluetooth();
 		
 		//! On every timestep, send the commands recorded to the bluetooth Base to be executed
 		virtual void step(double dt, World *w);
+		//! Append connections, buffers and pending requests to writer
+		virtual void saveState(StateWriter& writer) const;
+		//! Restore the state appended by saveState(), registering again with the Bluetooth base if needed
+		virtual void restoreState(StateReader& reader);
 		
 		//! Change the address of the module
 		void setAddress(unsigned address);
@@ -289,7 +289,7 @@ namespace Enki
 	void CircularCam::init(double dt, World* w)
 	{
 		// compute absolute position and orientation
-		const Matrix22 rot(owner->angle);
+		const Matrix22& rot(owner->getRotation());
 		absPos = owner->pos + rot * positionOffset;
 		absOrientation = owner->angle + angleOffset;
 		
@@ -358,6 +358,22 @@ namespace Enki
 		}
 	}
 	
+	void CircularCam::saveState(StateWriter& writer) const
+	{
+		writer.write(absPos);
+		writer.write(absOrientation);
+		writer.writeArray(zbuffer);
+		writer.writeArray(image);
+	}
+	
+	void CircularCam::restoreState(StateReader& reader)
+	{
+		reader.read(absPos);
+		reader.read(absOrientation);
+		reader.readArray(zbuffer);
+		reader.readArray(image);
+	}
+	
 	void CircularCam::setRange(double range)
 	{
 		this->r = range;
@@ -405,6 +421,29 @@ namespace Enki
 		std::copy(&cam1.image[0], &cam1.image[camPixelCount], &image[camPixelCount]);
 	}
 	
+	void OmniCam::saveState(StateWriter& writer) const
+	{
+		cam0.saveState(writer);
+		cam1.saveState(writer);
+		writer.writeArray(zbuffer);
+		writer.writeArray(image);
+	}
+	
+	void OmniCam::restoreState(StateReader& reader)
+	{
+		cam0.restoreState(reader);
+		cam1.restoreState(reader);
+		reader.readArray(zbuffer);
+		reader.readArray(image);
+	}
+	
+	void OmniCam::setOwner(Robot* owner)
+	{
+		LocalInteraction::setOwner(owner);
+		cam0.setOwner(owner);
+		cam1.setOwner(owner);
+	}
+	
 	void OmniCam::setRange(double range)
 	{
 		this->r = range;
@@ -113,6 +113,10 @@ namespace Enki
 		virtual void objectStep(double dt, World *w, PhysicalObject *po);
 		virtual void wallsStep(double dt, World* w);
 		virtual void finalize(double dt, World* w);
+		//! Append the last outputs to writer
+		virtual void saveState(StateWriter& writer) const;
+		//! Restore the last outputs appended by saveState()
+		virtual void restoreState(StateReader& reader);
 		
 		//! Change the sight range of the camera
 		void setRange(double range);
@@ -160,6 +164,12 @@ namespace Enki
 		virtual void objectStep(double dt, World *w, PhysicalObject *po);
 		virtual void wallsStep(double dt, World* w);
 		virtual void finalize(double dt, World* w);
+		//! Append the last outputs to writer
+		virtual void saveState(StateWriter& writer) const;
+		//! Restore the last outputs appended by saveState()
+		virtual void restoreState(StateReader& reader);
+		//! Attach this camera and the cameras doing the real job to another robot
+		virtual void setOwner(Robot* owner);
 		//! Change the sight range of the camera
 		void setRange(double range);
 		//! Change the fog condition for this camera. If useFog is true, an exponential fog with density will be used. Additionally, a threshold can be applied on the resulting color
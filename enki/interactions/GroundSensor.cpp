@@ -82,7 +82,7 @@ namespace Enki
 	void GroundSensor::init(double dt, World* w)
 	{
 		// compute absolute position
-		const Matrix22 rot(owner->angle);
+		const Matrix22& rot(owner->getRotation());
 		absPos = owner->pos + rot * pos;
 		
 		// compute sensor value on a gaussian filtered ground
@@ -101,4 +101,16 @@ namespace Enki
 		// changing value to response space and adding Gaussian noise before returning value
 		finalValue = gaussianRand(_sigm(v - cFactor, sFactor) * mFactor + aFactor, noiseSd);
 	}
+	
+	void GroundSensor::saveState(StateWriter& writer) const
+	{
+		writer.write(absPos);
+		writer.write(finalValue);
+	}
+	
+	void GroundSensor::restoreState(StateReader& reader)
+	{
+		reader.read(absPos);
+		reader.read(finalValue);
+	}
 }
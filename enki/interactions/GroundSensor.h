@@ -99,6 +99,10 @@ namespace Enki
 		GroundSensor(Robot *owner, Vector pos, double cFactor, double sFactor, double mFactor, double aFactor, double spatialSd = 0.4, double noiseSd = 0.);
 		//! Compute absolute position
 		void init(double dt, World* w);
+		//! Append the last outputs to writer
+		virtual void saveState(StateWriter& writer) const;
+		//! Restore the last outputs appended by saveState()
+		virtual void restoreState(StateReader& reader);
 		
 		//! Reset intensity value
 		//! Return the final sensor value
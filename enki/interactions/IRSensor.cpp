@@ -91,7 +91,7 @@ namespace Enki
 		std::fill(rayValues.begin(), rayValues.end(), 0);
 
 		// compute absolute position and orientation
-		const Matrix22 rot(owner->angle);
+		const Matrix22& rot(owner->getRotation());
 		absPos = owner->pos + rot * pos;
 		absOrientation = owner->angle + orientation;
 		// compute correct absolute angles
@@ -265,6 +265,30 @@ namespace Enki
 		finalDist = inverseResponseFunction(finalValue);
 	}
 	
+	void IRSensor::saveState(StateWriter& writer) const
+	{
+		writer.write(absPos);
+		writer.write(absOrientation);
+		writer.write(absSmartPos);
+		writer.writeArray(absRayAngles);
+		writer.writeArray(rayDists);
+		writer.writeArray(rayValues);
+		writer.write(finalValue);
+		writer.write(finalDist);
+	}
+	
+	void IRSensor::restoreState(StateReader& reader)
+	{
+		reader.read(absPos);
+		reader.read(absOrientation);
+		reader.read(absSmartPos);
+		reader.readArray(absRayAngles);
+		reader.readArray(rayDists);
+		reader.readArray(rayValues);
+		reader.read(finalValue);
+		reader.read(finalDist);
+	}
+	
 	void IRSensor::updateRay(size_t i, double dist)
 	{
 		// if we have a smaller distance than the initial one, replace it
@@ -155,6 +155,10 @@ namespace Enki
 		void wallsStep(double dt, World* w);
 		//! Applies the SensorResponseFunction to each ray and combines all rays using weights defined in the rayCombinationKernel.
 		void finalize(double dt, World* w);
+		//! Append the last outputs to writer
+		virtual void saveState(StateWriter& writer) const;
+		//! Restore the last outputs appended by saveState()
+		virtual void restoreState(StateReader& reader);
 		
 		//! Return the final sensor value
 		double getValue(void) const { return finalValue; }
@@ -171,6 +175,8 @@ namespace Enki
 		double getAbsoluteOrientation(void) const { return absOrientation; }
 		//! Return the number of rays
 		unsigned getRayCount(void) const { return rayCount; }
+		//! Return the absolute orientation of a ray, updated at each time step on init()
+		double getAbsoluteRayAngle(unsigned i) const { return absRayAngles.at(i); }
 		//! Return the aperture of the sensor
 		double getAperture(void) const { return aperture; }
 		//! Return the range of the sensor
@@ -56,7 +56,7 @@ namespace Enki
 		for (size_t i=0; i<noOfChannels; i++)
 			acquiredSound[i] = 0.0;
 
-		Matrix22 rot(owner->angle);
+		const Matrix22& rot(owner->getRotation());
 		micAbsPos = owner->pos + rot*micRelPos;
 	}
 
@@ -67,7 +67,7 @@ namespace Enki
 	
 	void Microphone::init()
 	{
-		Matrix22 rot(owner->angle);
+		const Matrix22& rot(owner->getRotation());
 		micAbsPos = owner->pos + rot*micRelPos;
 		resetSound();
 	}
@@ -123,6 +123,18 @@ namespace Enki
 		for (size_t i=0; i<noOfChannels; i++) acquiredSound[i] = 0.0;
 	}
 
+	void Microphone::saveState(StateWriter& writer) const
+	{
+		writer.write(micAbsPos);
+		writer.writeArray(acquiredSound, noOfChannels);
+	}
+	
+	void Microphone::restoreState(StateReader& reader)
+	{
+		reader.read(micAbsPos);
+		reader.readArray(acquiredSound, noOfChannels);
+	}
+
 	void Microphone::getMaxChannel(double *intensity, int *channel)
 	{
 		*intensity = 0;
@@ -157,7 +169,7 @@ namespace Enki
 				acquiredSound[i][j] = 0.0;
 		}
 
-		Matrix22 rot(owner->angle);
+		const Matrix22& rot(owner->getRotation());
 		allMicAbsPos[0] = owner->pos + rot*Vector( micDist, micDist);
 		allMicAbsPos[1] = owner->pos + rot*Vector( micDist,-micDist);
 		allMicAbsPos[2] = owner->pos + rot*Vector(-micDist, micDist);
@@ -172,7 +184,7 @@ namespace Enki
 		
 	void FourWayMic::init()
 	{
-		Matrix22 rot(owner->angle);
+		const Matrix22& rot(owner->getRotation());
 		allMicAbsPos[0] = owner->pos + rot*Vector( micDist, micDist);
 		allMicAbsPos[1] = owner->pos + rot*Vector( micDist,-micDist);
 		allMicAbsPos[2] = owner->pos + rot*Vector(-micDist, micDist);
@@ -238,6 +250,24 @@ namespace Enki
 				acquiredSound[i][j] = 0.0;
 	}
 
+	void FourWayMic::saveState(StateWriter& writer) const
+	{
+		for (unsigned i=0; i<4; i++)
+		{
+			writer.write(allMicAbsPos[i]);
+			writer.writeArray(acquiredSound[i], noOfChannels);
+		}
+	}
+	
+	void FourWayMic::restoreState(StateReader& reader)
+	{
+		for (unsigned i=0; i<4; i++)
+		{
+			reader.read(allMicAbsPos[i]);
+			reader.readArray(acquiredSound[i], noOfChannels);
+		}
+	}
+
 	void FourWayMic::getMaxChannel(unsigned micNo, double *intensity, int *channel)
 	{
 		*intensity = 0;
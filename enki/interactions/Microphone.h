@@ -84,6 +84,10 @@ namespace Enki
 		virtual void objectStep(double dt, PhysicalObject *po, World *w);
 		//! Reset sound buffer to 0 after one time-step in experiment
 		void resetSound(void);
+		//! Append the acquired sound to writer
+		virtual void saveState(StateWriter& writer) const;
+		//! Restore the acquired sound appended by saveState()
+		virtual void restoreState(StateReader& reader);
 		//! Return frequencies of input sound
 		double* getAcquiredSound(void);
 		//! Find frequency with maximum intensity
@@ -127,6 +131,10 @@ namespace Enki
 		virtual void objectStep(double dt, PhysicalObject *po, World *w);
 		//! Reset sound buffer to 0 after one time-step in experiment
 		void resetSound(void);
+		//! Append the acquired sound to writer
+		virtual void saveState(StateWriter& writer) const;
+		//! Restore the acquired sound appended by saveState()
+		virtual void restoreState(StateReader& reader);
 		//! Return frequencies of input sound
 		double* getAcquiredSound(unsigned micNo);
 		//! Find frequency with maximum intensity
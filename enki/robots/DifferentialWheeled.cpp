@@ -58,6 +58,7 @@ namespace Enki
 	{
 		leftSpeed = rightSpeed = 0;
 		resetEncoders();
+		defaultDynamicsClass = &typeid(DifferentialWheeled);
 	}
 	
 	void DifferentialWheeled::resetEncoders()
@@ -104,5 +105,59 @@ namespace Enki
 		angSpeed = cmdAngSpeed;
 		speed = cmdVelocity;
 	}
+	
+	PhysicalObject::DynamicsModel DifferentialWheeled::getDynamicsModel(double& tangentSpeed, double& angularSpeed) const
+	{
+		if (!hasDefaultDynamics())
+			return DYNAMICS_CUSTOM;
+		tangentSpeed = cmdSpeed;
+		angularSpeed = cmdAngSpeed;
+		return DYNAMICS_DIFFERENTIAL_WHEELED;
+	}
+	
+	void DifferentialWheeled::saveState(StateWriter& writer) const
+	{
+		Robot::saveState(writer);
+		writer.write(leftSpeed);
+		writer.write(rightSpeed);
+		writer.write(leftEncoder);
+		writer.write(rightEncoder);
+		writer.write(leftOdometry);
+		writer.write(rightOdometry);
+		writer.write(cmdAngSpeed);
+		writer.write(cmdSpeed);
+	}
+	
+	void DifferentialWheeled::restoreState(StateReader& reader)
+	{
+		Robot::restoreState(reader);
+		reader.read(leftSpeed);
+		reader.read(rightSpeed);
+		reader.read(leftEncoder);
+		reader.read(rightEncoder);
+		reader.read(leftOdometry);
+		reader.read(rightOdometry);
+		reader.read(cmdAngSpeed);
+		reader.read(cmdSpeed);
+	}
+	
+	void DifferentialWheeled::saveInputs(StateWriter& writer) const
+	{
+		Robot::saveInputs(writer);
+		writer.write(leftSpeed);
+		writer.write(rightSpeed);
+	}
+	
+	void DifferentialWheeled::restoreInputs(StateReader& reader)
+	{
+		Robot::restoreInputs(reader);
+		reader.read(leftSpeed);
+		reader.read(rightSpeed);
+	}
+	
+	PhysicalObject* DifferentialWheeled::clone() const
+	{
+		return new DifferentialWheeled(*this);
+	}
 }
 
@@ -84,6 +84,20 @@ namespace Enki
 		virtual void controlStep(double dt);
 		//! Consider that robot wheels have immobile contact points with ground, and override speeds. This kills three objects dynamics, but is good enough for the type of simulation Enki covers (and the correct solution is immensely more complex)
 		virtual void applyForces(double dt);
+		//! Return DYNAMICS_DIFFERENTIAL_WHEELED and the speeds resulting from wheels, as used by applyForces(), if hasDefaultDynamics(), DYNAMICS_CUSTOM otherwise
+		virtual DynamicsModel getDynamicsModel(double& tangentSpeed, double& angularSpeed) const;
+		//! Append wheel speeds, encoders and odometry to the state of the robot
+		virtual void saveState(StateWriter& writer) const;
+		//! Restore the state appended by saveState()
+		virtual void restoreState(StateReader& reader);
+		//! Append wheel speeds to the inputs of the robot
+		virtual void saveInputs(StateWriter& writer) const;
+		//! Restore the inputs appended by saveInputs()
+		virtual void restoreInputs(StateReader& reader);
+	
+	protected:
+		//! Return a copy of this robot with copies of its interactions
+		virtual PhysicalObject* clone() const;
 	};
 }
 
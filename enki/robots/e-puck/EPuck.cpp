@@ -75,6 +75,18 @@ namespace Enki
 		}
 	}
 	
+	void EPuckScannerTurret::saveState(StateWriter& writer) const
+	{
+		OmniCam::saveState(writer);
+		writer.writeArray(scan);
+	}
+	
+	void EPuckScannerTurret::restoreState(StateReader& reader)
+	{
+		OmniCam::restoreState(reader);
+		reader.readArray(scan);
+	}
+	
 	
 	#define deg2rad(x) ((x)*M_PI/180.)
 	
@@ -93,6 +105,8 @@ namespace Enki
 		scannerTurret(this, 7.2, 32),
 		bluetooth(NULL)
 	{
+		defaultDynamicsClass = &typeid(EPuck);
+		
 		if (capabilities & CAPABILITY_BASIC_SENSORS)
 		{
 			addLocalInteraction(&infraredSensor0);
@@ -139,5 +153,47 @@ namespace Enki
 	{
 		setColor(status ? Color::red : Color(0, 0.7, 0));
 	}
+	
+	void EPuck::saveInputs(StateWriter& writer) const
+	{
+		DifferentialWheeled::saveInputs(writer);
+		if (bluetooth)
+			bluetooth->saveState(writer);
+	}
+	
+	void EPuck::restoreInputs(StateReader& reader)
+	{
+		DifferentialWheeled::restoreInputs(reader);
+		if (bluetooth)
+			bluetooth->restoreState(reader);
+	}
+	
+	PhysicalObject* EPuck::clone() const
+	{
+		EPuck* copy(new EPuck(*this));
+		copy->copyInteractions(*this);
+		return copy;
+	}
+	
+	void EPuck::copyInteractions(const EPuck& other)
+	{
+		copyLocalInteraction(other, other.infraredSensor0, infraredSensor0);
+		copyLocalInteraction(other, other.infraredSensor1, infraredSensor1);
+		copyLocalInteraction(other, other.infraredSensor2, infraredSensor2);
+		copyLocalInteraction(other, other.infraredSensor3, infraredSensor3);
+		copyLocalInteraction(other, other.infraredSensor4, infraredSensor4);
+		copyLocalInteraction(other, other.infraredSensor5, infraredSensor5);
+		copyLocalInteraction(other, other.infraredSensor6, infraredSensor6);
+		copyLocalInteraction(other, other.infraredSensor7, infraredSensor7);
+		copyLocalInteraction(other, other.camera, camera);
+		copyLocalInteraction(other, other.scannerTurret, scannerTurret);
+		// the Bluetooth module is not a member, copy it
+		if (other.bluetooth)
+		{
+			bluetooth = new Bluetooth(*other.bluetooth);
+			bluetooth->setOwner(this);
+			addGlobalInteraction(bluetooth);
+		}
+	}
 }
 
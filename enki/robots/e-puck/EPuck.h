@@ -63,6 +63,10 @@ namespace Enki
 		EPuckScannerTurret(Robot *owner, double height, unsigned halfPixelCount);
 		
 		virtual void finalize(double dt, World* w);
+		//! Append the last outputs to writer
+		virtual void saveState(StateWriter& writer) const;
+		//! Restore the last outputs appended by saveState()
+		virtual void restoreState(StateReader& reader);
 	
 	public:
 		std::valarray<double> scan;
@@ -120,6 +124,17 @@ namespace Enki
 		
 		//! Set ring color (true = red, false = black) 
 		void setLedRing(bool status);
+		
+		//! Append the state of the Bluetooth module, whose transmissions controllers request, to the inputs of the robot
+		virtual void saveInputs(StateWriter& writer) const;
+		//! Restore the inputs appended by saveInputs()
+		virtual void restoreInputs(StateReader& reader);
+	
+	protected:
+		//! Return a copy of this robot with copies of its sensors and of its Bluetooth module
+		virtual PhysicalObject* clone() const;
+		//! Register the copies of the sensors that other, which this robot is a copy of, registered, and copy its Bluetooth module; called by clone()
+		void copyInteractions(const EPuck& other);
 	};
 }
 
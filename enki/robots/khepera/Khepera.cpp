@@ -50,6 +50,8 @@ namespace Enki
 		infraredSensor7(this, Vector(-1.5, 1.0), 1.8, -M_PI,  10, 1200, -0.9, 7, 20),
 		camera(this, Vector(0, 0), 0, 0.0, M_PI/4, 50)
 	{
+		defaultDynamicsClass = &typeid(Khepera);
+		
 		if (capabilities & CAPABILITIY_BASIC_SENSORS)
 		{
 			addLocalInteraction(&infraredSensor0);
@@ -69,5 +71,25 @@ namespace Enki
 		
 		setCylindric(2.6, 5, 80);
 	}
+	
+	PhysicalObject* Khepera::clone() const
+	{
+		Khepera* copy(new Khepera(*this));
+		copy->copyInteractions(*this);
+		return copy;
+	}
+	
+	void Khepera::copyInteractions(const Khepera& other)
+	{
+		copyLocalInteraction(other, other.infraredSensor0, infraredSensor0);
+		copyLocalInteraction(other, other.infraredSensor1, infraredSensor1);
+		copyLocalInteraction(other, other.infraredSensor2, infraredSensor2);
+		copyLocalInteraction(other, other.infraredSensor3, infraredSensor3);
+		copyLocalInteraction(other, other.infraredSensor4, infraredSensor4);
+		copyLocalInteraction(other, other.infraredSensor5, infraredSensor5);
+		copyLocalInteraction(other, other.infraredSensor6, infraredSensor6);
+		copyLocalInteraction(other, other.infraredSensor7, infraredSensor7);
+		copyLocalInteraction(other, other.camera, camera);
+	}
 }
 
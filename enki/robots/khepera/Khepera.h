@@ -83,6 +83,12 @@ namespace Enki
 	public:
 		//! Create a Khepera with certain modules aka capabilities (basic)
 		Khepera(unsigned capabilities = CAPABILITIY_BASIC_SENSORS);
+	
+	protected:
+		//! Return a copy of this robot with copies of its sensors
+		virtual PhysicalObject* clone() const;
+		//! Register the copies of the sensors that other, which this robot is a copy of, registered; called by clone()
+		void copyInteractions(const Khepera& other);
 	};
 }
 
@@ -61,6 +61,8 @@ namespace Enki
 		DifferentialWheeled(15, 30, 0.02),
 		rotatingDistanceSensor(this, 11, 90)
 	{
+		defaultDynamicsClass = &typeid(Marxbot);
+		
 		addLocalInteraction(&rotatingDistanceSensor);
 		
 		setCylindric(8.5, 12, 1000);
@@ -73,5 +75,12 @@ namespace Enki
 		unsigned physicalNumber = (24 + 12 - number) % 24;
 		return marxbotVirtualBumperResponseFunction(sqrt(rotatingDistanceSensor.zbuffer[(physicalNumber * 180) / 24]) - getRadius());
 	}
+	
+	PhysicalObject* Marxbot::clone() const
+	{
+		Marxbot* copy(new Marxbot(*this));
+		copy->copyLocalInteraction(*this, rotatingDistanceSensor, copy->rotatingDistanceSensor);
+		return copy;
+	}
 }
 
@@ -63,6 +63,10 @@ namespace Enki
 		~Marxbot() {}
 		//! Return the value of a virtual bumper
 		double getVirtualBumper(unsigned number);
+	
+	protected:
+		//! Return a copy of this robot with copies of its sensors
+		virtual PhysicalObject* clone() const;
 	};
 
 }
@@ -114,6 +114,8 @@ namespace Enki
 		camera(this, 12, 64),
 		globalSound(this)
 	{
+		defaultDynamicsClass = &typeid(Sbot);
+		
 		addLocalInteraction(&camera);
 		//addGlobalInteraction(&globalSound);
 		
@@ -136,6 +138,22 @@ namespace Enki
 		lastDEnergy = dEnergy;
 		dEnergy = 0;
 	}
+	
+	void FeedableSbot::saveState(StateWriter& writer) const
+	{
+		Sbot::saveState(writer);
+		writer.write(energy);
+		writer.write(dEnergy);
+		writer.write(lastDEnergy);
+	}
+	
+	void FeedableSbot::restoreState(StateReader& reader)
+	{
+		Sbot::restoreState(reader);
+		reader.read(energy);
+		reader.read(dEnergy);
+		reader.read(lastDEnergy);
+	}
 
 	SoundSbot::SoundSbot() :
 		// microphones can pick up sound reaching up to 1m away
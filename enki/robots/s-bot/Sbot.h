@@ -68,6 +68,8 @@ namespace Enki
 		virtual void init() { worldFrequenciesState = 0; }
 		//! Emit our frequencies to the world
 		virtual void step(double dt, World *w) { worldFrequenciesState |= frequenciesState; }
+		virtual void saveState(StateWriter& writer) const { writer.write(frequenciesState); }
+		virtual void restoreState(StateReader& reader) { reader.read(frequenciesState); }
 		// FIXME: ugly and not re-entrant, will be removed by ECS refactor
 		//! Return state of the frequencies in the world
 		static unsigned getWorldFrequenciesState(void);
@@ -129,9 +131,11 @@ namespace Enki
 		double lastDEnergy;
 
 		//! Constructor
-		FeedableSbot() { energy=0; dEnergy=0; lastDEnergy=0; }
+		FeedableSbot() { energy=0; dEnergy=0; lastDEnergy=0; defaultDynamicsClass = &typeid(FeedableSbot); }
 		//! Call DifferentialWheeled::step and compute the new energy
 		virtual void controlStep(double dt) ;
+		virtual void saveState(StateWriter& writer) const;
+		virtual void restoreState(StateReader& reader);
 	};
 
 
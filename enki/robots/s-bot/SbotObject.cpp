@@ -109,6 +109,18 @@ namespace Enki
 		owner->setColor((actualTime < activeDuration) ? activeColor : inactiveColor);
 	}
 
+	void SbotFeeding::saveState(StateWriter& writer) const
+	{
+		writer.write(actualEnergy);
+		writer.write(actualTime);
+	}
+	
+	void SbotFeeding::restoreState(StateReader& reader)
+	{
+		reader.read(actualEnergy);
+		reader.read(actualTime);
+	}
+	
 	SbotActiveObject::SbotActiveObject(double objectRadius, double actionRange) :
 		feeding(actionRange, this)
 	{
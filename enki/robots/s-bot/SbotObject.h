@@ -72,6 +72,8 @@ namespace Enki
 		SbotFeeding(double r, Robot *owner);
 		virtual void objectStep (double dt, PhysicalObject *po, World *w);
 		virtual void finalize(double dt);
+		virtual void saveState(StateWriter& writer) const;
+		virtual void restoreState(StateReader& reader);
 	};
 
 	//! SbotActiveObject give or remove energy to nearby Sbots through an SbotFeeding interaction
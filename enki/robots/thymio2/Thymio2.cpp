@@ -44,6 +44,36 @@ namespace Enki
 {
 	using namespace std;
 	
+	namespace
+	{
+		//! Mass of the Thymio II
+		const double thymio2Mass = 200;
+		//! Moment of inertia of thymio2Hull() with thymio2Mass, as numerically computed by PhysicalObject::setCustomHull(), which is slow for this hull
+		const double thymio2MomentOfInertia = 4658.7410774106102;
+		
+		//! Return the hull of the Thymio II, built once and shared by all of them
+		const PhysicalObject::Hull& thymio2Hull()
+		{
+			static const PhysicalObject::Hull hull([]()
+			{
+				// define the physical shape of the Thymio
+				Enki::Polygon thymio2Shape;
+				const double amount = 10.0;
+				const double radius = 8.0;
+				const double height = 5.1;
+				const double angle1 = asin(5.5/8.0);
+				const double angle2 = atan(5.5/3.0);
+				const double distance = sqrt(3.0*3.0+5.5*5.5);
+				for (double a = -angle1; a < angle1+0.01; a += 2*angle1/amount)
+					thymio2Shape.push_back(Enki::Point(radius * cos(a), radius * sin(a)));        
+				thymio2Shape.push_back(Enki::Point(distance * cos(M_PI - angle2), distance * sin(M_PI - angle2)));
+				thymio2Shape.push_back(Enki::Point(distance * cos(M_PI - angle2), distance * sin(M_PI + angle2)));
+				return Enki::PhysicalObject::Hull(Enki::PhysicalObject::Part(thymio2Shape, height));
+			}());
+			return hull;
+		}
+	}
+	
 	Thymio2::Thymio2() :
 		DifferentialWheeled(9.4, 16.6, 0.027),
 		infraredSensor0(this, Vector(6.2, 4.85),   3.4, 0.69813,  14, 4505, 0.03, 73, 2.87),
@@ -56,6 +86,8 @@ namespace Enki
 		groundSensor0(this, Vector(7.2, 1.15),  0.44, 9, 884, 60, 0.4, 10),
 		groundSensor1(this, Vector(7.2, -1.15), 0.44, 9, 884, 60, 0.4, 10)
 	{
+		defaultDynamicsClass = &typeid(Thymio2);
+		
 		// add interactions
 		addLocalInteraction(&infraredSensor0);
 		addLocalInteraction(&infraredSensor1);
@@ -71,20 +103,7 @@ namespace Enki
 		dryFrictionCoefficient = 0.25;
 		dryFrictionCoefficient = 2.5;
 		
-		// define the physical shape of the Thymio
-		Enki::Polygon thymio2Shape;
-		const double amount = 10.0;
-		const double radius = 8.0;
-		const double height = 5.1;
-		const double angle1 = asin(5.5/8.0);
-		const double angle2 = atan(5.5/3.0);
-		const double distance = sqrt(3.0*3.0+5.5*5.5);
-		for (double a = -angle1; a < angle1+0.01; a += 2*angle1/amount)
-			thymio2Shape.push_back(Enki::Point(radius * cos(a), radius * sin(a)));        
-		thymio2Shape.push_back(Enki::Point(distance * cos(M_PI - angle2), distance * sin(M_PI - angle2)));
-		thymio2Shape.push_back(Enki::Point(distance * cos(M_PI - angle2), distance * sin(M_PI + angle2)));
-		Enki::PhysicalObject::Hull hull(Enki::PhysicalObject::Part(thymio2Shape, height));
-		setCustomHull(hull, 200);
+		setCustomHull(thymio2Hull(), thymio2Mass, thymio2MomentOfInertia);
 		setColor(Color(0.98, 0.98, 0.98));
 
 		textureID = 0;
@@ -163,5 +182,55 @@ namespace Enki
 		else
 			return ledColor[ledIndex];
 	}
+
+	void Thymio2::saveState(StateWriter& writer) const
+	{
+		DifferentialWheeled::saveState(writer);
+		writer.writeArray(ledColor, LED_COUNT);
+	}
+	
+	void Thymio2::restoreState(StateReader& reader)
+	{
+		DifferentialWheeled::restoreState(reader);
+		reader.readArray(ledColor, LED_COUNT);
+		ledTextureNeedUpdate = true;
+	}
+	
+	void Thymio2::saveInputs(StateWriter& writer) const
+	{
+		DifferentialWheeled::saveInputs(writer);
+		writer.writeArray(ledColor, LED_COUNT);
+	}
+	
+	void Thymio2::restoreInputs(StateReader& reader)
+	{
+		DifferentialWheeled::restoreInputs(reader);
+		reader.readArray(ledColor, LED_COUNT);
+		ledTextureNeedUpdate = true;
+	}
+	
+	PhysicalObject* Thymio2::clone() const
+	{
+		Thymio2* copy(new Thymio2(*this));
+		copy->copyInteractions(*this);
+		// the LED texture belongs to the viewer of this robot
+		copy->textureID = 0;
+		copy->ledTexture = NULL;
+		copy->ledTextureNeedUpdate = true;
+		return copy;
+	}
+	
+	void Thymio2::copyInteractions(const Thymio2& other)
+	{
+		copyLocalInteraction(other, other.infraredSensor0, infraredSensor0);
+		copyLocalInteraction(other, other.infraredSensor1, infraredSensor1);
+		copyLocalInteraction(other, other.infraredSensor2, infraredSensor2);
+		copyLocalInteraction(other, other.infraredSensor3, infraredSensor3);
+		copyLocalInteraction(other, other.infraredSensor4, infraredSensor4);
+		copyLocalInteraction(other, other.infraredSensor5, infraredSensor5);
+		copyLocalInteraction(other, other.infraredSensor6, infraredSensor6);
+		copyLocalInteraction(other, other.groundSensor0, groundSensor0);
+		copyLocalInteraction(other, other.groundSensor1, groundSensor1);
+	}
 }
 
@@ -102,8 +102,22 @@ namespace Enki
 		void setLedIntensity(LedIndex ledIndex, double intensity = 1.f);
 		void setLedColor(LedIndex ledIndex, const Color& color = Color(1.,1.,1.,1.));
 		Color getColorLed(LedIndex ledIndex) const;
+		
+		//! Append the color of LEDs to the state of the robot
+		virtual void saveState(StateWriter& writer) const;
+		//! Restore the state appended by saveState()
+		virtual void restoreState(StateReader& reader);
+		//! Append the color of LEDs to the inputs of the robot
+		virtual void saveInputs(StateWriter& writer) const;
+		//! Restore the inputs appended by saveInputs()
+		virtual void restoreInputs(StateReader& reader);
 
 	protected:
+		//! Return a copy of this robot, without the LED texture of the viewer
+		virtual PhysicalObject* clone() const;
+		//! Register the copies of the sensors that other, which this robot is a copy of, registered; called by clone()
+		void copyInteractions(const Thymio2& other);
+		
 		Color ledColor[LED_COUNT];
 	};
 }
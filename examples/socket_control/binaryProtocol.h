@@ -0,0 +1,159 @@
+#ifndef BINARYPROTOCOL_H
+#define BINARYPROTOCOL_H
+
+#include <string>
+#include <cstring>
+#include <stdint.h>
+
+/*
+    Protocolo binário do servidor sem janela (enkiSocketControlHeadless, porta 9998)
+
+    Cada mensagem, nos dois sentidos, é um u32 com o tamanho do resto da
+    mensagem, um u8 com o tipo e o conteúdo. Os números são little-endian,
+    f32 e f64 em IEEE 754. Os objetos são endereçados pelo seu uid.
+
+    Cliente -> servidor:
+    - SET_SPEEDS   u32 n, n x (u32 uid, f32 left, f32 right)
+    - STEP         u32 n, no máximo --max-steps (1000)        -> STEPPED
+    - RUN          f32 fator de tempo real, 0 = o mais rápido possível
+    - PAUSE
+    - SUBSCRIBE    u8 canal, u32 período em passos (0 = cancelar),
+                   u32 n, n x u32 uid (n = 0: todos os objetos)
+    - LIST                                                    -> OBJECTS
+    - ACK          u64 quadro STATE recebido e aplicado
+
+    Servidor -> cliente:
+    - STEPPED      u64 passo, f64 tempo
+    - POSES        u64 passo, f64 tempo, u32 n, n x (u32 uid, f32 x, f32 y, f32 angle)
+    - IR           u64 passo, f64 tempo, u32 n, n x (u32 uid, u16 m, m x f32 valor)
+    - CAMERA       u64 passo, f64 tempo, u32 n, n x (u32 uid, u16 m, m x u8[4] RGBA)
+    - OBJECTS      u32 n, n x (u32 uid, u8 com rodas, u8 sensores IR, u16 pixels da câmera, f32 raio)
+    - STATE        u64 quadro, f64 tempo, u8 keyframe, u64 quadro de base, estado (stateStream.cpp)
+    - ERROR_REPLY  u8 tipo da mensagem recebida, u16 tamanho, texto
+
+    POSES, IR, CAMERA e STATE são enviadas após os passos múltiplos do período
+    de cada assinatura, e descartadas enquanto o cliente não lê o que já recebeu.
+    O canal STATE vale para todos os objetos: cada mensagem traz apenas o que
+    mudou desde o último quadro confirmado por ACK, ou periodicamente um
+    keyframe com todos os objetos.
+*/
+namespace BinaryProtocol
+{
+    enum MessageType
+    {
+        SET_SPEEDS = 1,
+        STEP,
+        RUN,
+        PAUSE,
+        SUBSCRIBE,
+        LIST,
+        ACK,
+
+        STEPPED = 128,
+        POSES,          // POSES + canal é a mensagem do canal
+        IR,
+        CAMERA,
+        OBJECTS,
+        STATE,
+        ERROR_REPLY = 255
+    };
+
+    enum Channel
+    {
+        CHANNEL_POSES = 0,
+        CHANNEL_IR,
+        CHANNEL_CAMERA,
+        CHANNEL_STATE,  // mensagens STATE
+        CHANNEL_COUNT
+    };
+
+    // Tamanho máximo de uma mensagem recebida
+    static const uint32_t MAX_MESSAGE_SIZE = 16 << 20;
+
+    // Escrever mensagens no fim de um buffer
+    class Writer
+    {
+    protected:
+        std::string& buffer;
+        size_t start;
+
+        void put(uint64_t value, size_t bytes)
+        {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            buffer.append(reinterpret_cast<const char*>(&value), bytes);
+#else
+            for (size_t i = 0; i < bytes; ++i)
+                buffer += char(value >> (8 * i));
+#endif
+        }
+
+    public:
+        Writer(std::string& buffer) : buffer(buffer), start(buffer.size()) {}
+
+        // Começar uma mensagem, cujo tamanho é escrito por end()
+        void begin(uint8_t type) { start = buffer.size(); u32(0); u8(type); }
+        void end() { patch(start, uint32_t(buffer.size() - start - 4)); }
+
+        size_t position() const { return buffer.size(); }
+        // Reescrever um u32 escrito antes em position
+        void patch(size_t position, uint32_t value)
+        {
+            for (size_t i = 0; i < 4; ++i)
+                buffer[position + i] = char(value >> (8 * i));
+        }
+
+        void u8(uint8_t value) { buffer += char(value); }
+        void u16(uint16_t value) { put(value, 2); }
+        void u32(uint32_t value) { put(value, 4); }
+        void i32(int32_t value) { put(uint32_t(value), 4); }
+        void u64(uint64_t value) { put(value, 8); }
+        void f32(float value) { uint32_t bits; memcpy(&bits, &value, 4); put(bits, 4); }
+        void f64(double value) { uint64_t bits; memcpy(&bits, &value, 8); put(bits, 8); }
+        void bytes(const void* data, size_t size) { buffer.append(static_cast<const char*>(data), size); }
+    };
+
+    // Ler o conteúdo de uma mensagem; após uma leitura além do fim, ok() é false e os valores lidos são 0
+    class Reader
+    {
+    protected:
+        const uint8_t* data;
+        size_t size;
+        size_t offset;
+        bool valid;
+
+        uint64_t get(size_t bytes)
+        {
+            if (offset + bytes > size) {
+                valid = false;
+                return 0;
+            }
+            uint64_t value = 0;
+            for (size_t i = 0; i < bytes; ++i)
+                value |= uint64_t(data[offset + i]) << (8 * i);
+            offset += bytes;
+            return value;
+        }
+
+    public:
+        Reader(const void* data, size_t size) : data(static_cast<const uint8_t*>(data)), size(size), offset(0), valid(true) {}
+
+        bool ok() const { return valid; }
+        size_t remaining() const { return size - offset; }
+
+        uint8_t u8() { return uint8_t(get(1)); }
+        uint16_t u16() { return uint16_t(get(2)); }
+        uint32_t u32() { return uint32_t(get(4)); }
+        uint64_t u64() { return get(8); }
+        float f32() { const uint32_t bits = u32(); float value; memcpy(&value, &bits, 4); return value; }
+        double f64() { const uint64_t bits = u64(); double value; memcpy(&value, &bits, 8); return value; }
+    };
+
+    // Ler o u32 little-endian do tamanho de uma mensagem
+    inline uint32_t readSize(const char* data)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        return uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+    }
+}
+
+#endif // BINARYPROTOCOL_H
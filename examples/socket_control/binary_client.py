@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""
+Cliente do protocolo binário de enkiSocketControlHeadless
+
+Demonstra o protocolo de binaryProtocol.h: lista os objetos, assina as poses
+de todos os objetos a cada 10 passos e os sensores IR do primeiro robô a cada
+passo, dá velocidades a todos os robôs com uma única mensagem e avança a
+simulação em sincronia. Com --state, acompanha o estado de todos os objetos
+pelo canal STATE, recebendo apenas as diferenças desde o último quadro
+confirmado.
+
+Uso:
+    enkiSocketControlHeadless --lockstep --scene arena.scene
+    python3 binary_client.py [--state] [host] [porta]
+"""
+
+import math
+import socket
+import struct
+import sys
+
+# Tipos de mensagem
+SET_SPEEDS, STEP, RUN, PAUSE, SUBSCRIBE, LIST, ACK = 1, 2, 3, 4, 5, 6, 7
+STEPPED, POSES, IR, CAMERA, OBJECTS, STATE, ERROR_REPLY = 128, 129, 130, 131, 132, 133, 255
+
+# Canais
+CHANNEL_POSES, CHANNEL_IR, CHANNEL_CAMERA, CHANNEL_STATE = 0, 1, 2, 3
+
+# Quantização e bits de mudança do canal STATE (stateStream.h)
+POSITION_RESOLUTION = 0.01
+ANGLE_RESOLUTION = 2 * math.pi / 65536
+CHANGE_POSE_DELTA, CHANGE_POSE_FULL, CHANGE_COLOR, CHANGE_LEDS = 1, 2, 4, 8
+
+
+class EnkiBinaryClient:
+    def __init__(self, host='localhost', port=9998):
+        self.socket = socket.create_connection((host, port))
+        self.socket.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.buffer = b''
+
+    def send(self, message_type, payload=b''):
+        """Envia uma mensagem: tamanho, tipo e conteúdo"""
+        self.socket.sendall(struct.pack('<IB', len(payload) + 1, message_type) + payload)
+
+    def receive(self):
+        """Recebe uma mensagem, retorna (tipo, conteúdo)"""
+        while True:
+            if len(self.buffer) >= 4:
+                size, = struct.unpack_from('<I', self.buffer)
+                if len(self.buffer) >= 4 + size:
+                    message = self.buffer[4:4 + size]
+                    self.buffer = self.buffer[4 + size:]
+                    return message[0], message[1:]
+            data = self.socket.recv(1 << 16)
+            if not data:
+                raise ConnectionError('Servidor desconectado')
+            self.buffer += data
+
+    def set_speeds(self, speeds):
+        """Define as velocidades de vários robôs: {uid: (esquerda, direita)}"""
+        payload = struct.pack('<I', len(speeds))
+        payload += b''.join(struct.pack('<Iff', uid, left, right) for uid, (left, right) in speeds.items())
+        self.send(SET_SPEEDS, payload)
+
+    def subscribe(self, channel, period, uids=()):
+        """Assina um canal a cada period passos, para os uids ou todos os objetos"""
+        self.send(SUBSCRIBE, struct.pack('<BII', channel, period, len(uids)) + struct.pack('<%dI' % len(uids), *uids))
+
+    def list_objects(self):
+        """Retorna {uid: (com rodas, sensores IR, pixels da câmera, raio)}"""
+        self.send(LIST)
+        message_type, payload = self.receive_until(OBJECTS)
+        count, = struct.unpack_from('<I', payload)
+        return {uid: rest for uid, *rest in struct.iter_unpack('<IBBHf', payload[4:4 + count * 12])}
+
+    def ack(self, frame):
+        """Confirma um quadro STATE, base das próximas diferenças"""
+        self.send(ACK, struct.pack('<Q', frame))
+
+    def step(self, count, handler=None):
+        """Avança count passos; as mensagens assinadas recebidas até a resposta vão para handler"""
+        self.send(STEP, struct.pack('<I', count))
+        return struct.unpack('<Qd', self.receive_until(STEPPED, handler)[1])
+
+    def receive_until(self, expected, handler=None):
+        while True:
+            message_type, payload = self.receive()
+            if message_type == expected:
+                return message_type, payload
+            if message_type == ERROR_REPLY:
+                request, length = struct.unpack_from('<BH', payload)
+                print('ERRO (mensagem %d): %s' % (request, payload[3:3 + length].decode()))
+            elif handler:
+                handler(message_type, payload)
+
+
+def decode_poses(payload):
+    """Retorna passo, tempo e {uid: (x, y, ângulo)}"""
+    step, time, count = struct.unpack_from('<QdI', payload)
+    return step, time, {uid: (x, y, angle) for uid, x, y, angle in struct.iter_unpack('<Ifff', payload[20:20 + count * 16])}
+
+
+def decode_ir(payload):
+    """Retorna passo, tempo e {uid: [valores]}"""
+    step, time, count = struct.unpack_from('<QdI', payload)
+    offset, values = 20, {}
+    for _ in range(count):
+        uid, n = struct.unpack_from('<IH', payload, offset)
+        values[uid] = struct.unpack_from('<%df' % n, payload, offset + 6)
+        offset += 6 + 4 * n
+    return step, time, values
+
+
+class WorldState:
+    """Estado de todos os objetos reconstruído a partir das mensagens STATE
+
+    objects é {uid: [x, y, ângulo, cor, [cores dos LEDs]]}, em unidades
+    quantizadas (POSITION_RESOLUTION, ANGLE_RESOLUTION, RGBA em um u32). As
+    diferenças são relativas a um quadro já confirmado, que pode ser anterior
+    ao último recebido: os quadros recebidos e não confirmados ficam guardados
+    até que uma mensagem mais recente seja baseada em um deles.
+    """
+
+    def __init__(self):
+        self.frame = 0
+        self.time = 0.0
+        self.objects = {}
+        self.frames = {}
+
+    def apply(self, payload):
+        """Aplica uma mensagem STATE, retorna o número do quadro a confirmar"""
+        self.payload, self.offset = payload, 0
+        frame, time, keyframe, base = self._unpack('<QdBQ')
+        if keyframe:
+            objects = {}
+            self._read_objects(objects)
+        else:
+            if base not in self.frames:
+                raise ValueError('Quadro de base %d desconhecido' % base)
+            objects = {uid: [x, y, angle, color, list(leds)] for uid, (x, y, angle, color, leds) in self.frames[base].items()}
+            uid = 0
+            for _ in range(self._unpack('<I')[0]):
+                uid += self._varint()
+                del objects[uid]
+            self._read_objects(objects)
+            uid = 0
+            for _ in range(self._unpack('<I')[0]):
+                uid += self._varint()
+                self._read_change(objects[uid])
+        # Os quadros anteriores à base não servirão mais de base
+        self.frames = {number: state for number, state in self.frames.items() if number >= base}
+        self.frames[frame] = objects
+        self.frame, self.time, self.objects = frame, time, objects
+        return frame
+
+    def pose(self, uid):
+        """Retorna (x, y, ângulo) de um objeto em cm e radianos"""
+        x, y, angle = self.objects[uid][:3]
+        return x * POSITION_RESOLUTION, y * POSITION_RESOLUTION, angle * ANGLE_RESOLUTION
+
+    def _unpack(self, fmt):
+        values = struct.unpack_from(fmt, self.payload, self.offset)
+        self.offset += struct.calcsize(fmt)
+        return values
+
+    def _varint(self):
+        value, shift = 0, 0
+        while True:
+            byte = self.payload[self.offset]
+            self.offset += 1
+            value |= (byte & 0x7f) << shift
+            if byte < 0x80:
+                return value
+            shift += 7
+
+    def _read_objects(self, objects):
+        uid = 0
+        for _ in range(self._unpack('<I')[0]):
+            uid += self._varint()
+            x, y, angle, color, count = self._unpack('<iiHIB')
+            objects[uid] = [x, y, angle, color, list(self._unpack('<%dI' % count))]
+
+    def _read_change(self, state):
+        flags, = self._unpack('<B')
+        if flags & CHANGE_POSE_DELTA:
+            dx, dy, dangle = self._unpack('<hhH')
+            state[0] += dx
+            state[1] += dy
+            state[2] = (state[2] + dangle) & 0xffff
+        elif flags & CHANGE_POSE_FULL:
+            state[0], state[1], state[2] = self._unpack('<iiH')
+        if flags & CHANGE_COLOR:
+            state[3], = self._unpack('<I')
+        if flags & CHANGE_LEDS:
+            count, = self._unpack('<B')
+            mask = self.payload[self.offset:self.offset + (count + 7) // 8]
+            self.offset += (count + 7) // 8
+            leds = state[4] if len(state[4]) == count else [0] * count
+            for i in range(count):
+                if mask[i // 8] & (1 << (i % 8)):
+                    leds[i], = self._unpack('<I')
+            state[4] = leds
+
+
+def follow_state(client, steps):
+    """Acompanha o estado do mundo pelo canal STATE, confirmando cada quadro"""
+    state = WorldState()
+    received = [0, 0]
+
+    def handler(message_type, payload):
+        if message_type == STATE:
+            client.ack(state.apply(payload))
+            received[0] += 1
+            received[1] += len(payload) + 4
+
+    client.subscribe(CHANNEL_STATE, 1)
+    for _ in range(steps):
+        client.step(1, handler)
+    print('%d mensagens STATE, %.0f bytes em média, %d objetos no quadro %d' % (received[0], received[1] / max(received[0], 1), len(state.objects), state.frame))
+    return state
+
+
+def main():
+    args = [arg for arg in sys.argv[1:] if arg != '--state']
+    host = args[0] if len(args) > 0 else 'localhost'
+    port = int(args[1]) if len(args) > 1 else 9998
+    client = EnkiBinaryClient(host, port)
+
+    objects = client.list_objects()
+    robots = [uid for uid, (wheeled, ir, camera, radius) in objects.items() if wheeled]
+    print('%d objetos, %d robôs' % (len(objects), len(robots)))
+
+    if '--state' in sys.argv:
+        client.set_speeds({uid: (5.0, 4.0) for uid in robots})
+        state = follow_state(client, 100)
+        if robots:
+            print('robô %d em (%.2f, %.2f)' % ((robots[0],) + state.pose(robots[0])[:2]))
+        return
+
+    client.subscribe(CHANNEL_POSES, 10)
+    if robots:
+        client.subscribe(CHANNEL_IR, 1, [robots[0]])
+    client.set_speeds({uid: (5.0, 4.0) for uid in robots})
+
+    def handler(message_type, payload):
+        if message_type == POSES:
+            step, time, poses = decode_poses(payload)
+            if robots:
+                print('passo %d: robô %d em (%.2f, %.2f)' % ((step, robots[0]) + poses[robots[0]][:2]))
+        elif message_type == IR:
+            step, time, values = decode_ir(payload)
+
+    step, time = client.step(100, handler)
+    print('parado no passo %d, tempo %.2f s' % (step, time))
+
+
+if __name__ == '__main__':
+    main()
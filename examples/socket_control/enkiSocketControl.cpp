@@ -37,13 +37,7 @@ SocketControlExample::SocketControlExample(World *world, QWidget *parent) :
     clientSocket(nullptr),
     stepCounter(0),
     verbose(true),
-    isMoving(false),
-    targetDistance(0.0),
-    currentDistance(0.0),
-    startPosition(0, 0),
-    startAngle(0.0),
-    currentMovementType(""),
-    pendingMoveDistance(0.0)
+    movement(nullptr)
 {
     // Criar e configurar o robô E-Puck
     setupRobot(world);
@@ -75,6 +69,7 @@ void SocketControlExample::setupRobot(World* world)
     robot->rightSpeed = 0.0;
     
     world->addObject(robot);
+    movement = new RobotMovement(robot);
     
     if (verbose) {
         cout << "Robô criado em (" << robot->pos.x << ", " << robot->pos.y << ")" << endl;
@@ -102,8 +97,11 @@ void SocketControlExample::timerEvent(QTimerEvent * event)
     stepCounter++;
     
     // Verificar progresso do movimento se estiver em movimento
-    if (isMoving) {
-        checkMovementProgress();
+    if (movement->isMoving()) {
+        const std::string message = movement->update();
+        if (!message.empty()) {
+            sendResponse(QString::fromStdString(message));
+        }
     }
     
     // Log ocasional da posição
@@ -129,19 +127,13 @@ void SocketControlExample::processCommand(const QString& command)
         QApplication::quit();
         return;
     } else if (cmd.toLower() == "stop") {
-        stopRobot();
+        movement->stop();
         sendResponse("OK: Robot stopped");
         return;
     }
     
     // Processar comandos de movimento (formato: 10F;30R;23B;7L)
-    QStringList movements = cmd.split(';', Qt::SkipEmptyParts);
-    if (movements.isEmpty()) {
-        sendResponse("ERROR: Invalid command format. Use: XF;YB;ZL;WR (e.g., 10F;5R)");
-        return;
-    }
-    
-    executeMovementSequence(movements);
+    sendResponse(QString::fromStdString(movement->execute(cmd.toStdString())));
     
     if (verbose) {
         cout << "Comando executado: " << command.toStdString() << endl;
@@ -158,177 +150,7 @@ void SocketControlExample::sendResponse(const QString& message)
 
 void SocketControlExample::sendRobotStatus()
 {
-    QString status = QString("STATUS: pos=(%1,%2) angle=%3 left_speed=%4 right_speed=%5")
-                    .arg(robot->pos.x, 0, 'f', 2)
-                    .arg(robot->pos.y, 0, 'f', 2)
-                    .arg(robot->angle, 0, 'f', 2)
-                    .arg(robot->leftSpeed, 0, 'f', 2)
-                    .arg(robot->rightSpeed, 0, 'f', 2);
-    sendResponse(status);
-}
-
-void SocketControlExample::executeMovementSequence(const QStringList& movements)
-{
-    const double DEFAULT_SPEED = 5.0;
-    
-    // Executar cada movimento individualmente, em sequência
-    for (const QString& movement : movements) {
-        if (movement.isEmpty()) continue;
-        
-        // Extrair número e direção (ex: "10F", "30R")
-        QString cleanMove = movement.trimmed().toUpper();
-        if (cleanMove.length() < 2) {
-            sendResponse("ERROR: Invalid movement format: " + movement);
-            return;
-        }
-        
-        QChar direction = cleanMove.right(1)[0];
-        QString numberStr = cleanMove.left(cleanMove.length() - 1);
-        
-        bool ok;
-        double distance = numberStr.toDouble(&ok);
-        if (!ok || distance < 0) {
-            sendResponse("ERROR: Invalid distance in movement: " + movement);
-            return;
-        }
-        
-        // Se já está em movimento, parar primeiro
-        if (isMoving) {
-            stopRobot();
-        }
-        
-        // Executar movimento baseado na direção
-        switch (direction.toLatin1()) {
-            case 'F':
-                // Apenas mover para frente
-                startPosition = robot->pos;
-                targetDistance = distance;
-                currentDistance = 0.0;
-                isMoving = true;
-                currentMovementType = "forward";
-                
-                robot->leftSpeed = DEFAULT_SPEED;
-                robot->rightSpeed = DEFAULT_SPEED;
-                
-                sendResponse(QString("OK: Moving forward for %1 units").arg(distance, 0, 'f', 1));
-                break;
-                
-            case 'B':
-                // Apenas mover para trás
-                startPosition = robot->pos;
-                targetDistance = distance;
-                currentDistance = 0.0;
-                isMoving = true;
-                currentMovementType = "backward";
-                
-                robot->leftSpeed = -DEFAULT_SPEED;
-                robot->rightSpeed = -DEFAULT_SPEED;
-                
-                sendResponse(QString("OK: Moving backward for %1 units").arg(distance, 0, 'f', 1));
-                break;
-                
-            case 'L':
-                // Virar 90° à esquerda E mover nessa direção
-                startAngle = robot->angle;
-                targetDistance = M_PI / 2; // 90 graus em radianos
-                currentDistance = 0.0;
-                isMoving = true;
-                currentMovementType = "turn_left_then_move";
-                pendingMoveDistance = distance; // Armazenar distância para depois
-                
-                // Primeiro virar à esquerda
-                robot->leftSpeed = -DEFAULT_SPEED * 0.6;
-                robot->rightSpeed = DEFAULT_SPEED * 0.6;
-                
-                sendResponse(QString("OK: Turning left 90° then moving %1 units").arg(distance, 0, 'f', 1));
-                break;
-                
-            case 'R':
-                // Virar 90° à direita E mover nessa direção
-                startAngle = robot->angle;
-                targetDistance = M_PI / 2; // 90 graus em radianos
-                currentDistance = 0.0;
-                isMoving = true;
-                currentMovementType = "turn_right_then_move";
-                pendingMoveDistance = distance; // Armazenar distância para depois
-                
-                // Primeiro virar à direita
-                robot->leftSpeed = DEFAULT_SPEED * 0.6;
-                robot->rightSpeed = -DEFAULT_SPEED * 0.6;
-                
-                sendResponse(QString("OK: Turning right 90° then moving %1 units").arg(distance, 0, 'f', 1));
-                break;
-                
-            default:
-                sendResponse("ERROR: Invalid direction '" + QString(direction) + "'. Use F, B, L, R");
-                return;
-        }
-        
-        // Para múltiplos comandos, precisamos esperar cada um terminar
-        // Por simplicidade, vamos executar apenas o primeiro comando por vez
-        return;
-    }
-}
-
-void SocketControlExample::checkMovementProgress()
-{
-    if (!isMoving) return;
-    
-    const double DEFAULT_SPEED = 5.0;
-    
-    if (currentMovementType == "forward" || currentMovementType == "backward") {
-        // Calcular distância percorrida desde o início
-        double dx = robot->pos.x - startPosition.x;
-        double dy = robot->pos.y - startPosition.y;
-        currentDistance = sqrt(dx*dx + dy*dy);
-        
-        if (currentDistance >= targetDistance) {
-            stopRobot();
-            sendResponse(QString("OK: Completed %1 movement of %2 units")
-                        .arg(currentMovementType)
-                        .arg(targetDistance, 0, 'f', 1));
-        }
-    } else if (currentMovementType == "turn_left_then_move" || currentMovementType == "turn_right_then_move") {
-        // Calcular ângulo rotacionado
-        double angleDiff = abs(robot->angle - startAngle);
-        if (angleDiff > M_PI) {
-            angleDiff = 2*M_PI - angleDiff; // Ajustar para ângulo menor
-        }
-        currentDistance = angleDiff;
-        
-        if (currentDistance >= targetDistance) {
-            // Terminou a rotação, agora começar o movimento linear
-            startPosition = robot->pos;
-            targetDistance = pendingMoveDistance;
-            currentDistance = 0.0;
-            
-            // Determinar novo tipo de movimento
-            if (currentMovementType == "turn_left_then_move") {
-                currentMovementType = "forward";
-            } else {
-                currentMovementType = "forward";
-            }
-            
-            // Começar movimento para frente
-            robot->leftSpeed = DEFAULT_SPEED;
-            robot->rightSpeed = DEFAULT_SPEED;
-            
-            sendResponse(QString("OK: Rotation complete, now moving forward %1 units")
-                        .arg(pendingMoveDistance, 0, 'f', 1));
-            
-            pendingMoveDistance = 0.0; // Limpar
-        }
-    }
-}
-
-void SocketControlExample::stopRobot()
-{
-    robot->leftSpeed = 0.0;
-    robot->rightSpeed = 0.0;
-    isMoving = false;
-    targetDistance = 0.0;
-    currentDistance = 0.0;
-    currentMovementType = "";
+    sendResponse(QString::fromStdString("STATUS: " + movement->status()));
 }
 
 void SocketControlExample::onNewConnection()
@@ -376,6 +198,7 @@ SocketControlExample::~SocketControlExample()
     if (server) {
         server->close();
     }
+    delete movement;
     cout << "Simulação finalizada após " << stepCounter << " passos." << endl;
 }
 
@@ -4,6 +4,7 @@
 #include <viewer/Viewer.h>
 #include <enki/PhysicalEngine.h>
 #include <enki/robots/e-puck/EPuck.h>
+#include "robotMovement.h"
 #include <QApplication>
 #include <QTcpServer>
 #include <QTcpSocket>
@@ -25,13 +26,7 @@ protected:
     bool verbose;
     
     // Sistema de movimento por distância
-    bool isMoving;
-    double targetDistance;
-    double currentDistance;
-    Point startPosition;
-    double startAngle;
-    QString currentMovementType;
-    double pendingMoveDistance; // Para armazenar distância após rotação
+    RobotMovement* movement;
     
 public:
     SocketControlExample(World *world, QWidget *parent = 0);
@@ -43,9 +38,6 @@ public:
     void processCommand(const QString& command);
     void sendResponse(const QString& message);
     void sendRobotStatus();
-    void executeMovementSequence(const QStringList& movements);
-    void checkMovementProgress();
-    void stopRobot();
     
 public slots:
     void onNewConnection();
@@ -0,0 +1,844 @@
+/*
+    Controle via Socket sem janela - Enki
+
+    Servidor para máquinas sem display: o mesmo protocolo de texto que
+    enkiSocketControl, sem Qt nem viewer, com um laço de eventos baseado em
+    poll() que atende vários clientes. A simulação não depende do relógio de
+    uma janela e pode rodar mais rápido que o tempo real.
+
+    Comandos aceitos via socket, um por linha:
+    - "XF;YB;ZL;WR", "stop", "status", "quit" - como em enkiSocketControl
+    - "step N" - avançar N passos (1 se omitido) e responder
+      "STEPPED: step=S time=T pos=(x,y) angle=a left_speed=l right_speed=r",
+      para controlar a simulação em sincronia, o mais rápido possível
+    - "run F" - avançar livremente a F vezes o tempo real (1 se omitido),
+      o mais rápido possível se F = 0
+    - "pause" - parar de avançar livremente, apenas "step" avança
+
+    Os comandos de texto controlam o primeiro E-Puck do mundo. Na porta
+    binária, o protocolo de binaryProtocol.h controla todos os robôs pelos seus
+    uids, em lote, e envia a cada cliente os canais que ele assinou (poses,
+    sensores IR, câmeras), cada um com seu período. O canal STATE envia o
+    estado quantizado de todos os objetos apenas com o que mudou desde o
+    último quadro confirmado pelo cliente, para acompanhar mundos grandes
+    com pouca banda.
+
+    Opções da linha de comando:
+    - --port P - porta TCP do protocolo de texto (9999)
+    - --binary-port P - porta TCP do protocolo binário (9998)
+    - --scene F - carregar o mundo de uma cena (enki/Scene.h), em vez de um
+      mundo vazio de 120x120; um E-Puck é criado no centro se não houver nenhum
+    - --keyframe-interval N - enviar um keyframe do canal STATE a cada N
+      mensagens, mesmo se o cliente confirmou os quadros (100, 0 = nunca)
+    - --max-steps N - número máximo de passos de um "step" ou STEP (1000),
+      pedidos maiores são recusados para não bloquear os outros clientes
+    - --rtf F - fator de tempo real inicial (1)
+    - --lockstep - começar parado, avançando apenas com "step"
+    - --verbose - mostrar os comandos recebidos
+*/
+
+#include "enkiSocketControlHeadless.h"
+#include <enki/Scene.h>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cerrno>
+#include <algorithm>
+#include <valarray>
+#include <csignal>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+using namespace Enki;
+using namespace std;
+
+// Tempo máximo passado avançando a simulação antes de atender a rede
+static const chrono::steady_clock::duration MAX_STEPPING_TIME = chrono::milliseconds(10);
+
+// Ler o argumento opcional de um comando em value, retornar false se ele não for um número
+static bool readArgument(istringstream& stream, double& value)
+{
+    string argument;
+    if (!(stream >> argument))
+        return true;
+    char* end;
+    value = strtod(argument.c_str(), &end);
+    return *end == 0;
+}
+
+static bool setNonBlocking(int fd)
+{
+    const int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+HeadlessSocketControl::HeadlessSocketControl(World *world, double dt, unsigned physicsOversampling) :
+    world(world),
+    robot(nullptr),
+    movement(nullptr),
+    serverSocket(-1),
+    binarySocket(-1),
+    stateCaptureStep(uint64_t(-1)),
+    keyframeInterval(100),
+    maxStepsPerRequest(1000),
+    dt(dt),
+    physicsOversampling(physicsOversampling),
+    stepCounter(0),
+    verbose(false),
+    running(false),
+    freeRunning(true),
+    realTimeFactor(1),
+    referenceTime(Clock::now()),
+    referenceStep(0)
+{
+    for (unsigned i = 0; i < BinaryProtocol::CHANNEL_COUNT; ++i)
+        channelCacheStep[i] = uint64_t(-1);
+    setupRobot();
+    indexObjects();
+}
+
+HeadlessSocketControl::~HeadlessSocketControl()
+{
+    for (size_t i = 0; i < clients.size(); ++i)
+        close(clients[i].socket);
+    if (serverSocket >= 0)
+        close(serverSocket);
+    if (binarySocket >= 0)
+        close(binarySocket);
+    delete movement;
+    cout << "Simulação finalizada após " << stepCounter << " passos." << endl;
+}
+
+void HeadlessSocketControl::setupRobot()
+{
+    // Controlar o primeiro E-Puck do mundo
+    for (World::ObjectsIterator it = world->objects.begin(); it != world->objects.end(); ++it) {
+        robot = dynamic_cast<EPuck*>(*it);
+        if (robot) {
+            movement = new RobotMovement(robot);
+            return;
+        }
+    }
+
+    // Ou criar robô E-Puck no centro do mundo, como em enkiSocketControl
+    robot = new EPuck;
+    robot->pos = Point(world->w / 2, world->h / 2);
+    robot->angle = 0;
+    robot->setColor(Color(0.2, 0.7, 0.2));
+    robot->leftSpeed = 0.0;
+    robot->rightSpeed = 0.0;
+    world->addObject(robot);
+    movement = new RobotMovement(robot);
+}
+
+// Indexar os objetos do mundo pelos seus uids, com seus sensores
+void HeadlessSocketControl::indexObjects()
+{
+    objects.clear();
+    for (World::ObjectsIterator it = world->objects.begin(); it != world->objects.end(); ++it) {
+        ObjectInfo info;
+        info.object = *it;
+        info.wheeled = dynamic_cast<DifferentialWheeled*>(*it);
+        info.camera = nullptr;
+        if (const Robot* robot = dynamic_cast<const Robot*>(*it)) {
+            const vector<LocalInteraction*>& interactions = robot->getLocalInteractions();
+            for (size_t i = 0; i < interactions.size(); ++i) {
+                if (const IRSensor* sensor = dynamic_cast<const IRSensor*>(interactions[i]))
+                    info.irSensors.push_back(sensor);
+                else if (const CircularCam* camera = dynamic_cast<const CircularCam*>(interactions[i]))
+                    if (!info.camera)
+                        info.camera = camera;
+            }
+        }
+        objects[(*it)->uid] = info;
+    }
+}
+
+// Abrir um socket TCP não bloqueante escutando em port, retornar -1 em caso de erro
+int HeadlessSocketControl::openServer(int port)
+{
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        cout << "Erro: Não foi possível criar o socket: " << strerror(errno) << endl;
+        return -1;
+    }
+    const int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0 ||
+        ::listen(fd, 16) != 0 ||
+        !setNonBlocking(fd)) {
+        cout << "Erro: Não foi possível iniciar o servidor TCP na porta " << port << ": " << strerror(errno) << endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool HeadlessSocketControl::listen(int port, int binaryPort)
+{
+    serverSocket = openServer(port);
+    binarySocket = openServer(binaryPort);
+    if (serverSocket < 0 || binarySocket < 0)
+        return false;
+    cout << "Servidor TCP iniciado na porta " << port << ", protocolo binário na porta " << binaryPort << endl;
+    return true;
+}
+
+void HeadlessSocketControl::setFreeRunning(double realTimeFactor)
+{
+    freeRunning = true;
+    this->realTimeFactor = max(realTimeFactor, 0.0);
+    referenceTime = Clock::now();
+    referenceStep = stepCounter;
+}
+
+void HeadlessSocketControl::setLockstep()
+{
+    freeRunning = false;
+}
+
+int HeadlessSocketControl::exec()
+{
+    running = true;
+    while (running) {
+        const int timeoutMs = runFreeSteps();
+        pollEvents(timeoutMs);
+        sendPending();
+    }
+    flushClients();
+    return 0;
+}
+
+void HeadlessSocketControl::step(unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i) {
+        world->step(dt, physicsOversampling);
+        ++stepCounter;
+
+        // Verificar progresso do movimento se estiver em movimento
+        if (movement->isMoving()) {
+            const string message = movement->update();
+            if (!message.empty())
+                broadcast(message);
+        }
+
+        publishChannels();
+    }
+}
+
+// Avançar a simulação no modo livre, retornar o tempo em ms até o próximo passo, -1 se parada
+int HeadlessSocketControl::runFreeSteps()
+{
+    if (!freeRunning)
+        return -1;
+
+    const Clock::time_point start = Clock::now();
+    if (realTimeFactor == 0) {
+        // O mais rápido possível, atendendo a rede regularmente
+        do {
+            step(1);
+        } while (Clock::now() - start < MAX_STEPPING_TIME);
+        return 0;
+    }
+
+    // Alcançar o passo correspondente ao tempo decorrido
+    const double elapsed = chrono::duration<double>(start - referenceTime).count();
+    const uint64_t dueStep = referenceStep + uint64_t(elapsed * realTimeFactor / dt);
+    while (stepCounter < dueStep) {
+        step(1);
+        if (Clock::now() - start >= MAX_STEPPING_TIME) {
+            // A simulação não consegue acompanhar o fator pedido: não acumular atraso
+            if (stepCounter < dueStep) {
+                referenceTime = Clock::now();
+                referenceStep = stepCounter;
+            }
+            return 0;
+        }
+    }
+
+    const double nextStepTime = double(stepCounter + 1 - referenceStep) * dt / realTimeFactor;
+    const double now = chrono::duration<double>(Clock::now() - referenceTime).count();
+    return max(0, int(ceil((nextStepTime - now) * 1000)));
+}
+
+void HeadlessSocketControl::pollEvents(int timeoutMs)
+{
+    vector<pollfd> fds(clients.size() + 2);
+    fds[0].fd = serverSocket;
+    fds[0].events = POLLIN;
+    fds[1].fd = binarySocket;
+    fds[1].events = POLLIN;
+    for (size_t i = 0; i < clients.size(); ++i) {
+        fds[i + 2].fd = clients[i].socket;
+        fds[i + 2].events = POLLIN | (clients[i].output.empty() ? 0 : POLLOUT);
+    }
+    if (poll(&fds[0], fds.size(), timeoutMs) <= 0)
+        return;
+
+    // Clientes antes das novas conexões, cujos índices não estão em fds
+    for (size_t i = 0; i < clients.size() && running; ++i) {
+        const short events = fds[i + 2].revents;
+        if ((events & (POLLIN | POLLHUP | POLLERR)) && !readClient(clients[i]))
+            clients[i].closing = true;
+    }
+
+    if (fds[0].revents & POLLIN)
+        acceptClients(serverSocket, false);
+    if (fds[1].revents & POLLIN)
+        acceptClients(binarySocket, true);
+}
+
+// Enviar as respostas pendentes e desconectar os clientes que fecharam a conexão
+void HeadlessSocketControl::sendPending()
+{
+    for (size_t i = clients.size(); i-- > 0;) {
+        Client& client = clients[i];
+        if (!client.closing && !client.output.empty() && !writeClient(client))
+            client.closing = true;
+        if (client.closing) {
+            cout << "Cliente desconectado." << endl;
+            if (client.droppedMessages)
+                cout << client.droppedMessages << " mensagens descartadas para este cliente." << endl;
+            close(client.socket);
+            clients.erase(clients.begin() + i);
+        }
+    }
+}
+
+void HeadlessSocketControl::acceptClients(int serverSocket, bool binary)
+{
+    int clientSocket;
+    while ((clientSocket = accept(serverSocket, nullptr, nullptr)) >= 0) {
+        setNonBlocking(clientSocket);
+        // Respostas curtas do modo sincronizado: enviar sem esperar
+        const int yes = 1;
+        setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+        Client client;
+        client.socket = clientSocket;
+        client.binary = binary;
+        client.closing = false;
+        client.droppedMessages = 0;
+        client.stateAcked = 0;
+        client.framesSinceKeyframe = 0;
+        clients.push_back(client);
+        if (binary) {
+            cout << "Cliente binário conectado!" << endl;
+        } else {
+            cout << "Cliente conectado!" << endl;
+            sendResponse(clients.back(), "HELLO: Connected to Enki Robot Controller");
+            sendResponse(clients.back(), "COMMANDS: Use format XF;YB;ZL;WR (e.g., 10F;5R) or stop, status, step N, run F, pause, quit");
+        }
+    }
+}
+
+// Ler e processar as mensagens recebidas, retornar false se o cliente desconectou ou deve ser desconectado
+bool HeadlessSocketControl::readClient(Client& client)
+{
+    char buffer[4096];
+    for (;;) {
+        const ssize_t received = recv(client.socket, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            client.input.append(buffer, received);
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            break;
+        return false;
+    }
+
+    if (client.binary)
+        return readMessages(client);
+    readCommands(client);
+    return true;
+}
+
+// Processar as linhas completas recebidas por um cliente de texto
+void HeadlessSocketControl::readCommands(Client& client)
+{
+    size_t begin = 0, end;
+    while (running && (end = client.input.find('\n', begin)) != string::npos) {
+        string command = client.input.substr(begin, end - begin);
+        begin = end + 1;
+        if (!command.empty() && command[command.size() - 1] == '\r')
+            command.erase(command.size() - 1);
+        if (command.find_first_not_of(" \t") == string::npos)
+            continue;
+        if (verbose)
+            cout << "Comando recebido: " << command << endl;
+        processCommand(client, command);
+    }
+    client.input.erase(0, begin);
+}
+
+// Processar as mensagens completas recebidas por um cliente binário, retornar false se uma é inválida
+bool HeadlessSocketControl::readMessages(Client& client)
+{
+    size_t begin = 0;
+    while (running && client.input.size() - begin >= 4) {
+        const uint32_t size = BinaryProtocol::readSize(&client.input[begin]);
+        if (size == 0 || size > BinaryProtocol::MAX_MESSAGE_SIZE) {
+            cout << "Erro: mensagem binária de " << size << " bytes" << endl;
+            return false;
+        }
+        if (client.input.size() - begin - 4 < size)
+            break;
+        BinaryProtocol::Reader reader(&client.input[begin + 4], size);
+        processMessage(client, reader);
+        begin += 4 + size;
+    }
+    client.input.erase(0, begin);
+    return true;
+}
+
+// Enviar o que o socket aceitar, retornar false se o cliente desconectou
+bool HeadlessSocketControl::writeClient(Client& client)
+{
+    while (!client.output.empty()) {
+        const ssize_t sent = send(client.socket, client.output.data(), client.output.size(), 0);
+        if (sent > 0) {
+            client.output.erase(0, sent);
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            return true;
+        return false;
+    }
+    return true;
+}
+
+// Enviar as respostas pendentes antes de sair, esperando no máximo um segundo
+void HeadlessSocketControl::flushClients()
+{
+    const Clock::time_point deadline = Clock::now() + chrono::seconds(1);
+    for (size_t i = 0; i < clients.size(); ++i) {
+        while (!clients[i].output.empty() && Clock::now() < deadline) {
+            if (!writeClient(clients[i]))
+                break;
+            pollfd fd = { clients[i].socket, POLLOUT, 0 };
+            poll(&fd, 1, 10);
+        }
+    }
+}
+
+void HeadlessSocketControl::processCommand(Client& client, const string& command)
+{
+    istringstream stream(command);
+    string name;
+    stream >> name;
+    for (size_t i = 0; i < name.size(); ++i)
+        name[i] = tolower(name[i]);
+
+    // Comandos especiais
+    if (name == "status") {
+        sendResponse(client, "STATUS: " + movement->status());
+    } else if (name == "quit") {
+        sendResponse(client, "OK: Goodbye!");
+        running = false;
+    } else if (name == "stop") {
+        movement->stop();
+        sendResponse(client, "OK: Robot stopped");
+    } else if (name == "step") {
+        double count = 1;
+        if (!readArgument(stream, count) || count < 0 || count != floor(count)) {
+            sendResponse(client, "ERROR: Invalid step count. Use: step N");
+            return;
+        }
+        if (count > maxStepsPerRequest) {
+            ostringstream reply;
+            reply << "ERROR: At most " << maxStepsPerRequest << " steps per request";
+            sendResponse(client, reply.str());
+            return;
+        }
+        step(unsigned(count));
+        // Os passos feitos a pedido não contam no modo livre
+        referenceTime = Clock::now();
+        referenceStep = stepCounter;
+        ostringstream reply;
+        reply << "STEPPED: step=" << stepCounter << " time=" << stepCounter * dt << " " << movement->status();
+        sendResponse(client, reply.str());
+    } else if (name == "run") {
+        double factor = 1;
+        if (!readArgument(stream, factor) || !(factor >= 0)) {
+            sendResponse(client, "ERROR: Invalid real-time factor. Use: run F");
+            return;
+        }
+        setFreeRunning(factor);
+        ostringstream reply;
+        if (factor == 0)
+            reply << "OK: Running as fast as possible";
+        else
+            reply << "OK: Running at " << factor << "x real time";
+        sendResponse(client, reply.str());
+    } else if (name == "pause") {
+        setLockstep();
+        ostringstream reply;
+        reply << "OK: Paused at step " << stepCounter;
+        sendResponse(client, reply.str());
+    } else {
+        // Processar comandos de movimento (formato: 10F;30R;23B;7L)
+        sendResponse(client, movement->execute(command));
+    }
+}
+
+void HeadlessSocketControl::sendResponse(Client& client, const string& message)
+{
+    client.output += message;
+    client.output += '\n';
+}
+
+// Enviar uma mensagem a todos os clientes de texto
+void HeadlessSocketControl::broadcast(const string& message)
+{
+    for (size_t i = 0; i < clients.size(); ++i)
+        if (!clients[i].binary)
+            sendResponse(clients[i], message);
+}
+
+void HeadlessSocketControl::processMessage(Client& client, BinaryProtocol::Reader& reader)
+{
+    using namespace BinaryProtocol;
+    const uint8_t type = reader.u8();
+    switch (type) {
+        case SET_SPEEDS: {
+            // Velocidades de vários robôs em uma mensagem
+            const uint32_t count = reader.u32();
+            if (reader.remaining() < uint64_t(count) * 12) {
+                sendError(client, type, "Truncated message");
+                return;
+            }
+            unsigned unknown = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint32_t uid = reader.u32();
+                const float left = reader.f32();
+                const float right = reader.f32();
+                const map<unsigned, ObjectInfo>::const_iterator it = objects.find(uid);
+                if (it == objects.end() || !it->second.wheeled) {
+                    ++unknown;
+                    continue;
+                }
+                it->second.wheeled->leftSpeed = left;
+                it->second.wheeled->rightSpeed = right;
+            }
+            if (unknown) {
+                ostringstream message;
+                message << unknown << " uids are not robots with wheels";
+                sendError(client, type, message.str());
+            }
+            break;
+        }
+
+        case STEP: {
+            const uint32_t count = reader.u32();
+            if (!reader.ok()) {
+                sendError(client, type, "Truncated message");
+                return;
+            }
+            if (count > maxStepsPerRequest) {
+                ostringstream message;
+                message << "At most " << maxStepsPerRequest << " steps per request";
+                sendError(client, type, message.str());
+                return;
+            }
+            step(count);
+            // Os passos feitos a pedido não contam no modo livre
+            referenceTime = Clock::now();
+            referenceStep = stepCounter;
+            Writer writer(client.output);
+            writer.begin(STEPPED);
+            writer.u64(stepCounter);
+            writer.f64(stepCounter * dt);
+            writer.end();
+            break;
+        }
+
+        case RUN: {
+            const float factor = reader.f32();
+            if (!reader.ok() || !(factor >= 0)) {
+                sendError(client, type, "Invalid real-time factor");
+                return;
+            }
+            setFreeRunning(factor);
+            break;
+        }
+
+        case PAUSE:
+            setLockstep();
+            break;
+
+        case SUBSCRIBE: {
+            const uint8_t channel = reader.u8();
+            const uint32_t period = reader.u32();
+            const uint32_t count = reader.u32();
+            if (!reader.ok() || reader.remaining() < uint64_t(count) * 4) {
+                sendError(client, type, "Truncated message");
+                return;
+            }
+            if (channel >= CHANNEL_COUNT) {
+                sendError(client, type, "Unknown channel");
+                return;
+            }
+            Subscription& subscription = client.subscriptions[channel];
+            subscription.period = period;
+            subscription.uids.resize(count);
+            for (uint32_t i = 0; i < count; ++i)
+                subscription.uids[i] = reader.u32();
+            break;
+        }
+
+        case LIST:
+            sendObjects(client);
+            break;
+
+        case ACK: {
+            const uint64_t frame = reader.u64();
+            if (!reader.ok()) {
+                sendError(client, type, "Truncated message");
+                return;
+            }
+            // Os quadros chegam em ordem, uma confirmação atrasada não volta a base
+            client.stateAcked = max(client.stateAcked, frame);
+            break;
+        }
+
+        default:
+            sendError(client, type, "Unknown message type");
+            break;
+    }
+}
+
+void HeadlessSocketControl::sendError(Client& client, uint8_t type, const string& message)
+{
+    BinaryProtocol::Writer writer(client.output);
+    writer.begin(BinaryProtocol::ERROR_REPLY);
+    writer.u8(type);
+    writer.u16(uint16_t(message.size()));
+    writer.bytes(message.data(), message.size());
+    writer.end();
+}
+
+// Enviar a lista dos objetos e do que o protocolo binário lê deles
+void HeadlessSocketControl::sendObjects(Client& client)
+{
+    BinaryProtocol::Writer writer(client.output);
+    writer.begin(BinaryProtocol::OBJECTS);
+    writer.u32(uint32_t(objects.size()));
+    for (map<unsigned, ObjectInfo>::const_iterator it = objects.begin(); it != objects.end(); ++it) {
+        const ObjectInfo& info = it->second;
+        writer.u32(it->first);
+        writer.u8(info.wheeled ? 1 : 0);
+        writer.u8(uint8_t(info.irSensors.size()));
+        writer.u16(uint16_t(info.camera ? info.camera->image.size() : 0));
+        writer.f32(float(info.object->getRadius()));
+    }
+    writer.end();
+}
+
+// Enviar aos clientes binários os canais cujo período terminou neste passo
+void HeadlessSocketControl::publishChannels()
+{
+    for (size_t i = 0; i < clients.size(); ++i) {
+        Client& client = clients[i];
+        if (!client.binary)
+            continue;
+        for (unsigned channel = 0; channel < BinaryProtocol::CHANNEL_COUNT; ++channel) {
+            const Subscription& subscription = client.subscriptions[channel];
+            if (subscription.period == 0 || stepCounter % subscription.period != 0)
+                continue;
+            // Não acumular mensagens para um cliente que não lê
+            if (client.output.size() > MAX_PENDING_OUTPUT) {
+                ++client.droppedMessages;
+                continue;
+            }
+            if (channel == BinaryProtocol::CHANNEL_STATE) {
+                publishState(client);
+            } else if (subscription.uids.empty()) {
+                if (channelCacheStep[channel] != stepCounter) {
+                    channelCache[channel].clear();
+                    encodeChannel(channel, subscription.uids, channelCache[channel]);
+                    channelCacheStep[channel] = stepCounter;
+                }
+                client.output += channelCache[channel];
+            } else {
+                encodeChannel(channel, subscription.uids, client.output);
+            }
+        }
+    }
+}
+
+// Enviar a um cliente o estado do mundo em relação ao último quadro que ele confirmou, ou um keyframe
+// se esse quadro não está mais no histórico ou se o intervalo entre keyframes terminou
+void HeadlessSocketControl::publishState(Client& client)
+{
+    if (stateCaptureStep != stepCounter) {
+        stateStream.capture(world, stepCounter, stepCounter * dt);
+        stateCaptureStep = stepCounter;
+        stateKeyframe.clear();
+        stateDeltas.clear();
+    }
+
+    const StateStream::Frame* base = client.stateAcked ? stateStream.find(client.stateAcked) : 0;
+    if (keyframeInterval && client.framesSinceKeyframe + 1 >= keyframeInterval)
+        base = 0;
+    if (base) {
+        string& delta = stateDeltas[base->number];
+        if (delta.empty())
+            stateStream.encode(base, delta);
+        client.output += delta;
+        ++client.framesSinceKeyframe;
+    } else {
+        if (stateKeyframe.empty())
+            stateStream.encode(0, stateKeyframe);
+        client.output += stateKeyframe;
+        client.framesSinceKeyframe = 0;
+    }
+}
+
+// Escrever a mensagem de um canal para os objetos uids, todos se vazio, no fim de buffer
+void HeadlessSocketControl::encodeChannel(unsigned channel, const vector<unsigned>& uids, string& buffer) const
+{
+    BinaryProtocol::Writer writer(buffer);
+    writer.begin(BinaryProtocol::POSES + channel);
+    writer.u64(stepCounter);
+    writer.f64(stepCounter * dt);
+    const size_t countPosition = writer.position();
+    writer.u32(0);
+    uint32_t count = 0;
+    if (uids.empty()) {
+        for (map<unsigned, ObjectInfo>::const_iterator it = objects.begin(); it != objects.end(); ++it)
+            encodeObject(channel, it->second, writer, count);
+    } else {
+        for (size_t i = 0; i < uids.size(); ++i) {
+            const map<unsigned, ObjectInfo>::const_iterator it = objects.find(uids[i]);
+            if (it != objects.end())
+                encodeObject(channel, it->second, writer, count);
+        }
+    }
+    writer.patch(countPosition, count);
+    writer.end();
+}
+
+// Escrever o registro de um objeto na mensagem de um canal, se ele tem os sensores do canal
+void HeadlessSocketControl::encodeObject(unsigned channel, const ObjectInfo& info, BinaryProtocol::Writer& writer, uint32_t& count) const
+{
+    switch (channel) {
+        case BinaryProtocol::CHANNEL_POSES:
+            writer.u32(info.object->uid);
+            writer.f32(float(info.object->pos.x));
+            writer.f32(float(info.object->pos.y));
+            writer.f32(float(info.object->angle));
+            break;
+
+        case BinaryProtocol::CHANNEL_IR:
+            if (info.irSensors.empty())
+                return;
+            writer.u32(info.object->uid);
+            writer.u16(uint16_t(info.irSensors.size()));
+            for (size_t i = 0; i < info.irSensors.size(); ++i)
+                writer.f32(float(info.irSensors[i]->getValue()));
+            break;
+
+        case BinaryProtocol::CHANNEL_CAMERA: {
+            if (!info.camera)
+                return;
+            const valarray<Color>& image = info.camera->image;
+            writer.u32(info.object->uid);
+            writer.u16(uint16_t(image.size()));
+            for (size_t i = 0; i < image.size(); ++i) {
+                const uint8_t rgba[4] = {
+                    uint8_t(max(0.0, min(1.0, image[i].r())) * 255 + 0.5),
+                    uint8_t(max(0.0, min(1.0, image[i].g())) * 255 + 0.5),
+                    uint8_t(max(0.0, min(1.0, image[i].b())) * 255 + 0.5),
+                    uint8_t(max(0.0, min(1.0, image[i].a())) * 255 + 0.5)
+                };
+                writer.bytes(rgba, 4);
+            }
+            break;
+        }
+
+        default:
+            return;
+    }
+    ++count;
+}
+
+int main(int argc, char *argv[])
+{
+    int port = 9999;
+    int binaryPort = 9998;
+    string sceneFileName;
+    double realTimeFactor = 1;
+    bool lockstep = false;
+    bool verbose = false;
+    unsigned keyframeInterval = 100;
+    unsigned maxSteps = 1000;
+    for (int i = 1; i < argc; ++i) {
+        const string arg(argv[i]);
+        if (arg == "--port" && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (arg == "--binary-port" && i + 1 < argc) {
+            binaryPort = atoi(argv[++i]);
+        } else if (arg == "--scene" && i + 1 < argc) {
+            sceneFileName = argv[++i];
+        } else if (arg == "--keyframe-interval" && i + 1 < argc) {
+            keyframeInterval = unsigned(atoi(argv[++i]));
+        } else if (arg == "--max-steps" && i + 1 < argc) {
+            maxSteps = unsigned(atoi(argv[++i]));
+        } else if (arg == "--rtf" && i + 1 < argc) {
+            realTimeFactor = atof(argv[++i]);
+        } else if (arg == "--lockstep") {
+            lockstep = true;
+        } else if (arg == "--verbose") {
+            verbose = true;
+        } else {
+            cout << "Uso: " << argv[0] << " [--port P] [--binary-port P] [--scene F] [--keyframe-interval N] [--max-steps N] [--rtf F | --lockstep] [--verbose]" << endl;
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    // Um cliente que desconecta não deve encerrar o servidor
+    signal(SIGPIPE, SIG_IGN);
+
+    // Criar o mundo da simulação: a cena, ou 120x120 unidades
+    unique_ptr<World> world;
+    if (!sceneFileName.empty()) {
+        try {
+            world.reset(Scene(sceneFileName).createWorld());
+        } catch (const runtime_error& e) {
+            cout << "Erro: " << e.what() << endl;
+            return 1;
+        }
+    } else {
+        world.reset(new World(120, 120, Color(0.9, 0.9, 0.9)));
+    }
+
+    HeadlessSocketControl server(world.get());
+    server.setVerbose(verbose);
+    server.setKeyframeInterval(keyframeInterval);
+    server.setMaxStepsPerRequest(maxSteps);
+    if (!server.listen(port, binaryPort))
+        return 1;
+    if (lockstep)
+        server.setLockstep();
+    else
+        server.setFreeRunning(realTimeFactor);
+
+    cout << "=== Controle via Socket sem janela - Enki ===" << endl;
+    cout << "Comandos: XF;YB;ZL;WR (ex: 10F;5R), stop, status, step N, run F, pause, quit" << endl;
+
+    return server.exec();
+}
@@ -0,0 +1,137 @@
+#ifndef ENKISOCKETCONTROLHEADLESS_H
+#define ENKISOCKETCONTROLHEADLESS_H
+
+#include <enki/PhysicalEngine.h>
+#include <enki/robots/e-puck/EPuck.h>
+#include <enki/interactions/IRSensor.h>
+#include <enki/interactions/CircularCam.h>
+#include "robotMovement.h"
+#include "binaryProtocol.h"
+#include "stateStream.h"
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Servidor do controle via socket sem janela nem Qt, com seu próprio laço de eventos.
+// A simulação avança livremente a um fator de tempo real, ou em sincronia com um cliente
+// que pede N passos e espera a resposta.
+// Clientes de texto controlam um E-Puck com os comandos de enkiSocketControl; clientes
+// binários (binaryProtocol.h) controlam todos os robôs e assinam o estado do mundo.
+class HeadlessSocketControl
+{
+protected:
+    typedef std::chrono::steady_clock Clock;
+
+    // Um canal assinado por um cliente binário
+    struct Subscription
+    {
+        unsigned period;            // em passos, 0 se não assinado
+        std::vector<unsigned> uids; // vazio para todos os objetos
+        Subscription() : period(0) {}
+    };
+
+    // Um cliente conectado
+    struct Client
+    {
+        int socket;
+        bool binary;        // protocolo binário em vez de texto
+        bool closing;       // desconectar após o envio pendente falhar
+        std::string input;  // bytes recebidos e ainda não processados
+        std::string output; // bytes a enviar quando o socket aceitar
+        Subscription subscriptions[BinaryProtocol::CHANNEL_COUNT];
+        uint64_t droppedMessages;
+        uint64_t stateAcked;            // último quadro STATE confirmado, 0 se nenhum
+        unsigned framesSinceKeyframe;   // mensagens STATE enviadas desde o último keyframe
+    };
+
+    // Um objeto do mundo e o que o protocolo binário lê ou escreve dele
+    struct ObjectInfo
+    {
+        Enki::PhysicalObject* object;
+        Enki::DifferentialWheeled* wheeled;
+        // Sensores IR na ordem de getLocalInteractions()
+        std::vector<const Enki::IRSensor*> irSensors;
+        const Enki::CircularCam* camera;
+    };
+
+    // Tamanho das respostas pendentes de um cliente acima do qual as mensagens assinadas são descartadas
+    static const size_t MAX_PENDING_OUTPUT = 8 << 20;
+
+    Enki::World* world;
+    Enki::EPuck* robot;
+    RobotMovement* movement;
+    int serverSocket;
+    int binarySocket;
+    std::vector<Client> clients;
+    std::map<unsigned, ObjectInfo> objects;
+    // Mensagens do passo atual para as assinaturas de todos os objetos, compartilhadas pelos clientes
+    std::string channelCache[BinaryProtocol::CHANNEL_COUNT];
+    uint64_t channelCacheStep[BinaryProtocol::CHANNEL_COUNT];
+    // Estado quantizado do mundo para o canal STATE, capturado no máximo uma vez por passo,
+    // e as mensagens do passo atual, compartilhadas pelos clientes com a mesma base
+    StateStream stateStream;
+    uint64_t stateCaptureStep;
+    std::string stateKeyframe;
+    std::map<uint64_t, std::string> stateDeltas;
+    // Número de mensagens STATE entre dois keyframes enviados a um cliente, 0 para nunca forçar
+    unsigned keyframeInterval;
+    // Número máximo de passos de um pedido "step" ou STEP, para que um cliente não bloqueie os outros
+    unsigned maxStepsPerRequest;
+    const double dt;
+    const unsigned physicsOversampling;
+    uint64_t stepCounter;
+    bool verbose;
+    bool running;
+
+    // Modo livre: avançar a realTimeFactor vezes o tempo real, 0 para o mais rápido possível
+    bool freeRunning;
+    double realTimeFactor;
+    // Instante e passo de referência do modo livre
+    Clock::time_point referenceTime;
+    uint64_t referenceStep;
+
+public:
+    HeadlessSocketControl(Enki::World* world, double dt = 0.03, unsigned physicsOversampling = 3);
+    virtual ~HeadlessSocketControl();
+
+    void setupRobot();
+    void indexObjects();
+    bool listen(int port, int binaryPort);
+    // Avançar livremente a realTimeFactor vezes o tempo real, 0 para o mais rápido possível
+    void setFreeRunning(double realTimeFactor);
+    // Avançar apenas com o comando "step"
+    void setLockstep();
+    void setVerbose(bool verbose) { this->verbose = verbose; }
+    void setKeyframeInterval(unsigned interval) { keyframeInterval = interval; }
+    void setMaxStepsPerRequest(unsigned steps) { maxStepsPerRequest = steps; }
+    // Executar o laço de eventos até o comando "quit"
+    int exec();
+    // Avançar count passos
+    void step(unsigned count);
+
+protected:
+    int openServer(int port);
+    int runFreeSteps();
+    void pollEvents(int timeoutMs);
+    void sendPending();
+    void acceptClients(int socket, bool binary);
+    bool readClient(Client& client);
+    void readCommands(Client& client);
+    bool readMessages(Client& client);
+    bool writeClient(Client& client);
+    void flushClients();
+    virtual void processCommand(Client& client, const std::string& command);
+    virtual void processMessage(Client& client, BinaryProtocol::Reader& reader);
+    void sendResponse(Client& client, const std::string& message);
+    void sendError(Client& client, uint8_t type, const std::string& message);
+    void sendObjects(Client& client);
+    void broadcast(const std::string& message);
+    void publishChannels();
+    void publishState(Client& client);
+    void encodeChannel(unsigned channel, const std::vector<unsigned>& uids, std::string& buffer) const;
+    void encodeObject(unsigned channel, const ObjectInfo& info, BinaryProtocol::Writer& writer, uint32_t& count) const;
+};
+
+#endif // ENKISOCKETCONTROLHEADLESS_H
@@ -0,0 +1,217 @@
+/*
+    Movimento por distância de um E-Puck - Enki
+
+    Lógica dos comandos de movimento "XF;YB;ZL;WR" comum ao exemplo com
+    viewer (enkiSocketControl) e ao servidor sem janela
+    (enkiSocketControlHeadless).
+*/
+
+#include "robotMovement.h"
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+using namespace Enki;
+using namespace std;
+
+const double RobotMovement::DEFAULT_SPEED = 5.0;
+
+// Formatar como printf em uma std::string
+static string format(const char* fmt, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    return buffer;
+}
+
+// Remover espaços no início e no fim
+static string trimmed(const string& s)
+{
+    const size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == string::npos)
+        return string();
+    const size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+RobotMovement::RobotMovement(EPuck* robot) :
+    robot(robot),
+    moving(false),
+    targetDistance(0.0),
+    currentDistance(0.0),
+    startPosition(0, 0),
+    startAngle(0.0),
+    currentMovementType(""),
+    pendingMoveDistance(0.0)
+{
+}
+
+string RobotMovement::execute(const string& movements)
+{
+    // Executar cada movimento individualmente, em sequência
+    size_t begin = 0;
+    bool found = false;
+    while (begin <= movements.size()) {
+        size_t end = movements.find(';', begin);
+        if (end == string::npos)
+            end = movements.size();
+        const string movement = movements.substr(begin, end - begin);
+        begin = end + 1;
+        if (movement.empty()) continue;
+        found = true;
+
+        // Extrair número e direção (ex: "10F", "30R")
+        string cleanMove = trimmed(movement);
+        for (size_t i = 0; i < cleanMove.size(); ++i)
+            cleanMove[i] = toupper(cleanMove[i]);
+        if (cleanMove.length() < 2)
+            return "ERROR: Invalid movement format: " + movement;
+
+        const char direction = cleanMove[cleanMove.length() - 1];
+        const string numberStr = cleanMove.substr(0, cleanMove.length() - 1);
+
+        char* numberEnd;
+        const double distance = strtod(numberStr.c_str(), &numberEnd);
+        if (numberEnd == numberStr.c_str() || trimmed(numberEnd) != "" || distance < 0)
+            return "ERROR: Invalid distance in movement: " + movement;
+
+        // Se já está em movimento, parar primeiro
+        if (moving)
+            stop();
+
+        // Executar movimento baseado na direção
+        switch (direction) {
+            case 'F':
+                // Apenas mover para frente
+                startPosition = robot->pos;
+                targetDistance = distance;
+                currentDistance = 0.0;
+                moving = true;
+                currentMovementType = "forward";
+
+                robot->leftSpeed = DEFAULT_SPEED;
+                robot->rightSpeed = DEFAULT_SPEED;
+
+                return format("OK: Moving forward for %.1f units", distance);
+
+            case 'B':
+                // Apenas mover para trás
+                startPosition = robot->pos;
+                targetDistance = distance;
+                currentDistance = 0.0;
+                moving = true;
+                currentMovementType = "backward";
+
+                robot->leftSpeed = -DEFAULT_SPEED;
+                robot->rightSpeed = -DEFAULT_SPEED;
+
+                return format("OK: Moving backward for %.1f units", distance);
+
+            case 'L':
+                // Virar 90° à esquerda E mover nessa direção
+                startAngle = robot->angle;
+                targetDistance = M_PI / 2; // 90 graus em radianos
+                currentDistance = 0.0;
+                moving = true;
+                currentMovementType = "turn_left_then_move";
+                pendingMoveDistance = distance; // Armazenar distância para depois
+
+                // Primeiro virar à esquerda
+                robot->leftSpeed = -DEFAULT_SPEED * 0.6;
+                robot->rightSpeed = DEFAULT_SPEED * 0.6;
+
+                return format("OK: Turning left 90° then moving %.1f units", distance);
+
+            case 'R':
+                // Virar 90° à direita E mover nessa direção
+                startAngle = robot->angle;
+                targetDistance = M_PI / 2; // 90 graus em radianos
+                currentDistance = 0.0;
+                moving = true;
+                currentMovementType = "turn_right_then_move";
+                pendingMoveDistance = distance; // Armazenar distância para depois
+
+                // Primeiro virar à direita
+                robot->leftSpeed = DEFAULT_SPEED * 0.6;
+                robot->rightSpeed = -DEFAULT_SPEED * 0.6;
+
+                return format("OK: Turning right 90° then moving %.1f units", distance);
+
+            default:
+                return string("ERROR: Invalid direction '") + direction + "'. Use F, B, L, R";
+        }
+
+        // Para múltiplos comandos, precisamos esperar cada um terminar
+        // Por simplicidade, executamos apenas o primeiro comando por vez
+    }
+
+    if (!found)
+        return "ERROR: Invalid command format. Use: XF;YB;ZL;WR (e.g., 10F;5R)";
+    return string();
+}
+
+string RobotMovement::update()
+{
+    if (!moving) return string();
+
+    if (currentMovementType == "forward" || currentMovementType == "backward") {
+        // Calcular distância percorrida desde o início
+        double dx = robot->pos.x - startPosition.x;
+        double dy = robot->pos.y - startPosition.y;
+        currentDistance = sqrt(dx*dx + dy*dy);
+
+        if (currentDistance >= targetDistance) {
+            const string message = format("OK: Completed %s movement of %.1f units",
+                                          currentMovementType.c_str(), targetDistance);
+            stop();
+            return message;
+        }
+    } else if (currentMovementType == "turn_left_then_move" || currentMovementType == "turn_right_then_move") {
+        // Calcular ângulo rotacionado
+        double angleDiff = fabs(robot->angle - startAngle);
+        if (angleDiff > M_PI) {
+            angleDiff = 2*M_PI - angleDiff; // Ajustar para ângulo menor
+        }
+        currentDistance = angleDiff;
+
+        if (currentDistance >= targetDistance) {
+            // Terminou a rotação, agora começar o movimento linear
+            startPosition = robot->pos;
+            targetDistance = pendingMoveDistance;
+            currentDistance = 0.0;
+            currentMovementType = "forward";
+
+            // Começar movimento para frente
+            robot->leftSpeed = DEFAULT_SPEED;
+            robot->rightSpeed = DEFAULT_SPEED;
+
+            const string message = format("OK: Rotation complete, now moving forward %.1f units",
+                                          pendingMoveDistance);
+            pendingMoveDistance = 0.0; // Limpar
+            return message;
+        }
+    }
+    return string();
+}
+
+void RobotMovement::stop()
+{
+    robot->leftSpeed = 0.0;
+    robot->rightSpeed = 0.0;
+    moving = false;
+    targetDistance = 0.0;
+    currentDistance = 0.0;
+    currentMovementType = "";
+}
+
+string RobotMovement::status() const
+{
+    return format("pos=(%.2f,%.2f) angle=%.2f left_speed=%.2f right_speed=%.2f",
+                  robot->pos.x, robot->pos.y, robot->angle,
+                  robot->leftSpeed, robot->rightSpeed);
+}
@@ -0,0 +1,39 @@
+#ifndef ROBOTMOVEMENT_H
+#define ROBOTMOVEMENT_H
+
+#include <enki/PhysicalEngine.h>
+#include <enki/robots/e-puck/EPuck.h>
+#include <string>
+
+// Movimento por distância de um E-Puck, comandado por sequências como "10F;5R".
+// Não depende de Qt, para ser usado com e sem o viewer.
+class RobotMovement
+{
+protected:
+    Enki::EPuck* robot;
+
+    bool moving;
+    double targetDistance;
+    double currentDistance;
+    Enki::Point startPosition;
+    double startAngle;
+    std::string currentMovementType;
+    double pendingMoveDistance; // Para armazenar distância após rotação
+
+public:
+    static const double DEFAULT_SPEED;
+
+    RobotMovement(Enki::EPuck* robot);
+
+    // Iniciar o primeiro movimento de uma sequência (formato: 10F;30R;23B;7L), retornar a resposta para o cliente
+    std::string execute(const std::string& movements);
+    // Verificar o progresso após um passo, retornar uma mensagem quando uma etapa terminou ou uma string vazia
+    std::string update();
+    // Parar o robô e o movimento em andamento
+    void stop();
+    bool isMoving() const { return moving; }
+    // Posição, orientação e velocidades do robô, no formato "pos=(x,y) angle=a left_speed=l right_speed=r"
+    std::string status() const;
+};
+
+#endif // ROBOTMOVEMENT_H
@@ -0,0 +1,240 @@
+/*
+    Transmissão do estado do mundo por diferenças - Enki
+
+    Formato das mensagens STATE, depois do tipo:
+    - u64 quadro, f64 tempo, u8 keyframe, u64 quadro de base (0 em um keyframe)
+    - keyframe: u32 n, n objetos completos
+    - diferença: u32 n removidos, n x varint diferença de uid,
+                 u32 n adicionados, n objetos completos,
+                 u32 n mudados, n x (varint diferença de uid, u8 ChangeFlags, campos marcados)
+    - objeto completo: varint diferença de uid, i32 x, i32 y, u16 angle, u32 color,
+                       u8 n LEDs, n x u32 cor
+    As diferenças de uid são em relação ao uid anterior na mesma lista, a partir de 0.
+*/
+
+#include "stateStream.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace Enki;
+using namespace std;
+
+const double StateStream::POSITION_RESOLUTION = 0.01;
+
+// Cor em RGBA de 8 bits, R no byte menos significativo
+static uint32_t packColor(const Color& color)
+{
+    const double components[4] = { color.r(), color.g(), color.b(), color.a() };
+    uint32_t packed = 0;
+    for (int i = 0; i < 4; ++i)
+        packed |= uint32_t(max(0.0, min(1.0, components[i])) * 255 + 0.5) << (8 * i);
+    return packed;
+}
+
+// Escrever um inteiro sem sinal em 7 bits por byte, o bit mais significativo indicando que há mais bytes
+static void writeVarint(BinaryProtocol::Writer& writer, uint32_t value)
+{
+    while (value >= 0x80) {
+        writer.u8(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    writer.u8(uint8_t(value));
+}
+
+StateStream::StateStream(size_t historySize) :
+    history(max(historySize, size_t(1))),
+    frameCount(0)
+{
+}
+
+void StateStream::capture(const World* world, uint64_t number, double time)
+{
+    snapshot.capture(world, number, time);
+
+    Frame& frame = history[frameCount % history.size()];
+    ++frameCount;
+    frame.number = number;
+    frame.time = time;
+    frame.objects.resize(snapshot.objects.size());
+    frame.leds.resize(snapshot.leds.size());
+    for (size_t i = 0; i < snapshot.leds.size(); ++i)
+        frame.leds[i] = packColor(snapshot.leds[i]);
+    for (size_t i = 0; i < snapshot.objects.size(); ++i) {
+        const WorldSnapshot::Object& source = snapshot.objects[i];
+        ObjectState& object = frame.objects[i];
+        object.uid = source.uid;
+        object.x = int32_t(lround(source.pos.x / POSITION_RESOLUTION));
+        object.y = int32_t(lround(source.pos.y / POSITION_RESOLUTION));
+        object.angle = uint16_t(lround(source.angle * 65536 / (2 * M_PI)) & 0xffff);
+        object.color = packColor(source.color);
+        object.firstLed = source.firstLed;
+        object.ledCount = source.ledCount;
+    }
+}
+
+const StateStream::Frame* StateStream::latest() const
+{
+    if (frameCount == 0)
+        return 0;
+    return &history[(frameCount - 1) % history.size()];
+}
+
+const StateStream::Frame* StateStream::find(uint64_t number) const
+{
+    const size_t available = min(frameCount, history.size());
+    for (size_t i = 0; i < available; ++i) {
+        const Frame& frame = history[(frameCount - 1 - i) % history.size()];
+        if (frame.number == number)
+            return &frame;
+        if (frame.number < number)
+            break;
+    }
+    return 0;
+}
+
+void StateStream::encodeObject(const Frame& frame, const ObjectState& object, BinaryProtocol::Writer& writer)
+{
+    writer.i32(object.x);
+    writer.i32(object.y);
+    writer.u16(object.angle);
+    writer.u32(object.color);
+    writer.u8(uint8_t(object.ledCount));
+    for (uint32_t i = 0; i < object.ledCount; ++i)
+        writer.u32(frame.leds[object.firstLed + i]);
+}
+
+// Escrever as mudanças de object em relação a baseObject, se houver
+void StateStream::encodeChange(const Frame& frame, const ObjectState& object, const Frame& base, const ObjectState& baseObject, uint32_t previousUid, BinaryProtocol::Writer& writer, uint32_t& count)
+{
+    uint8_t flags = 0;
+    const int64_t dx = int64_t(object.x) - baseObject.x;
+    const int64_t dy = int64_t(object.y) - baseObject.y;
+    if (dx != 0 || dy != 0 || object.angle != baseObject.angle) {
+        if (dx >= -32768 && dx <= 32767 && dy >= -32768 && dy <= 32767)
+            flags |= CHANGE_POSE_DELTA;
+        else
+            flags |= CHANGE_POSE_FULL;
+    }
+    if (object.color != baseObject.color)
+        flags |= CHANGE_COLOR;
+    const bool sameLedCount = object.ledCount == baseObject.ledCount;
+    const uint32_t* leds = object.ledCount ? &frame.leds[object.firstLed] : 0;
+    const uint32_t* baseLeds = baseObject.ledCount ? &base.leds[baseObject.firstLed] : 0;
+    if (!sameLedCount || !equal(leds, leds + object.ledCount, baseLeds))
+        flags |= CHANGE_LEDS;
+    if (!flags)
+        return;
+
+    writeVarint(writer, object.uid - previousUid);
+    writer.u8(flags);
+    if (flags & CHANGE_POSE_DELTA) {
+        writer.u16(uint16_t(int16_t(dx)));
+        writer.u16(uint16_t(int16_t(dy)));
+        // Os ângulos são módulo 65536, a diferença também
+        writer.u16(uint16_t(object.angle - baseObject.angle));
+    } else if (flags & CHANGE_POSE_FULL) {
+        writer.i32(object.x);
+        writer.i32(object.y);
+        writer.u16(object.angle);
+    }
+    if (flags & CHANGE_COLOR)
+        writer.u32(object.color);
+    if (flags & CHANGE_LEDS) {
+        // Máscara dos LEDs que mudaram, todos se o número de LEDs mudou
+        writer.u8(uint8_t(object.ledCount));
+        for (uint32_t byte = 0; byte < (object.ledCount + 7) / 8; ++byte) {
+            uint8_t mask = 0;
+            for (uint32_t bit = 0; bit < 8 && byte * 8 + bit < object.ledCount; ++bit) {
+                const uint32_t i = byte * 8 + bit;
+                if (!sameLedCount || leds[i] != baseLeds[i])
+                    mask |= 1 << bit;
+            }
+            writer.u8(mask);
+        }
+        for (uint32_t i = 0; i < object.ledCount; ++i)
+            if (!sameLedCount || leds[i] != baseLeds[i])
+                writer.u32(leds[i]);
+    }
+    ++count;
+}
+
+void StateStream::encode(const Frame* base, string& buffer) const
+{
+    const Frame* frame = latest();
+    if (!frame)
+        return;
+
+    BinaryProtocol::Writer writer(buffer);
+    writer.begin(BinaryProtocol::STATE);
+    writer.u64(frame->number);
+    writer.f64(frame->time);
+    writer.u8(base ? 0 : 1);
+    writer.u64(base ? base->number : 0);
+
+    if (!base) {
+        // Keyframe: todos os objetos
+        writer.u32(uint32_t(frame->objects.size()));
+        uint32_t previousUid = 0;
+        for (size_t i = 0; i < frame->objects.size(); ++i) {
+            writeVarint(writer, frame->objects[i].uid - previousUid);
+            encodeObject(*frame, frame->objects[i], writer);
+            previousUid = frame->objects[i].uid;
+        }
+        writer.end();
+        return;
+    }
+
+    // Diferença: percorrer os dois quadros em ordem de uid
+    const vector<ObjectState>& objects = frame->objects;
+    const vector<ObjectState>& baseObjects = base->objects;
+
+    // Removidos
+    size_t countPosition = writer.position();
+    writer.u32(0);
+    uint32_t count = 0, previousUid = 0;
+    for (size_t i = 0, j = 0; j < baseObjects.size(); ++j) {
+        while (i < objects.size() && objects[i].uid < baseObjects[j].uid)
+            ++i;
+        if (i == objects.size() || objects[i].uid != baseObjects[j].uid) {
+            writeVarint(writer, baseObjects[j].uid - previousUid);
+            previousUid = baseObjects[j].uid;
+            ++count;
+        }
+    }
+    writer.patch(countPosition, count);
+
+    // Adicionados
+    countPosition = writer.position();
+    writer.u32(0);
+    count = 0;
+    previousUid = 0;
+    for (size_t i = 0, j = 0; i < objects.size(); ++i) {
+        while (j < baseObjects.size() && baseObjects[j].uid < objects[i].uid)
+            ++j;
+        if (j == baseObjects.size() || baseObjects[j].uid != objects[i].uid) {
+            writeVarint(writer, objects[i].uid - previousUid);
+            encodeObject(*frame, objects[i], writer);
+            previousUid = objects[i].uid;
+            ++count;
+        }
+    }
+    writer.patch(countPosition, count);
+
+    // Mudados
+    countPosition = writer.position();
+    writer.u32(0);
+    count = 0;
+    previousUid = 0;
+    for (size_t i = 0, j = 0; i < objects.size(); ++i) {
+        while (j < baseObjects.size() && baseObjects[j].uid < objects[i].uid)
+            ++j;
+        if (j < baseObjects.size() && baseObjects[j].uid == objects[i].uid) {
+            const uint32_t countBefore = count;
+            encodeChange(*frame, objects[i], *base, baseObjects[j], previousUid, writer, count);
+            if (count != countBefore)
+                previousUid = objects[i].uid;
+        }
+    }
+    writer.patch(countPosition, count);
+    writer.end();
+}
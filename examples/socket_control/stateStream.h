@@ -0,0 +1,73 @@
+#ifndef STATESTREAM_H
+#define STATESTREAM_H
+
+#include <enki/PhysicalEngine.h>
+#include <enki/SimulationThread.h>
+#include "binaryProtocol.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Estado dos objetos de um mundo, quantizado a cada quadro publicado e codificado em mensagens
+// STATE (binaryProtocol.h): keyframes com todos os objetos, ou diferenças em relação a um quadro
+// anterior com apenas os objetos adicionados, removidos, movidos ou cujas cores ou LEDs mudaram.
+// Os últimos quadros ficam em um histórico, para as diferenças em relação ao último quadro
+// confirmado por cada cliente.
+class StateStream
+{
+public:
+    // Resolução das posições, em cm
+    static const double POSITION_RESOLUTION;
+
+    // Estado quantizado de um objeto
+    struct ObjectState
+    {
+        uint32_t uid;
+        int32_t x, y;       // em POSITION_RESOLUTION
+        uint16_t angle;     // em 2π/65536
+        uint32_t color;     // RGBA, R no byte menos significativo
+        uint32_t firstLed;  // índice do primeiro LED em Frame::leds
+        uint32_t ledCount;
+    };
+
+    // Um quadro publicado
+    struct Frame
+    {
+        uint64_t number;    // passo em que foi capturado
+        double time;
+        std::vector<ObjectState> objects; // em ordem de uid
+        std::vector<uint32_t> leds;       // cores RGBA dos LEDs de todos os objetos
+    };
+
+    // Bits de um registro de objeto em uma diferença
+    enum ChangeFlags
+    {
+        CHANGE_POSE_DELTA = 1 << 0, // i16 dx, i16 dy, i16 dangle
+        CHANGE_POSE_FULL = 1 << 1,  // i32 x, i32 y, u16 angle
+        CHANGE_COLOR = 1 << 2,      // u32 color
+        CHANGE_LEDS = 1 << 3        // u8 n, (n+7)/8 bytes de máscara, cores dos LEDs marcados
+    };
+
+protected:
+    std::vector<Frame> history; // anel de quadros, history[number % size] para os quadros recentes
+    size_t frameCount;
+    Enki::WorldSnapshot snapshot;
+
+public:
+    StateStream(size_t historySize = 64);
+
+    // Capturar o estado de world como o quadro number, que deve ser maior que o anterior
+    void capture(const Enki::World* world, uint64_t number, double time);
+    // Retornar o último quadro capturado, ou 0
+    const Frame* latest() const;
+    // Retornar o quadro number se ainda está no histórico, ou 0
+    const Frame* find(uint64_t number) const;
+    // Escrever no fim de buffer a mensagem STATE do último quadro, em relação a base, ou um keyframe se base é 0
+    void encode(const Frame* base, std::string& buffer) const;
+
+protected:
+    static void encodeObject(const Frame& frame, const ObjectState& object, BinaryProtocol::Writer& writer);
+    static void encodeChange(const Frame& frame, const ObjectState& object, const Frame& base, const ObjectState& baseObject, uint32_t previousUid, BinaryProtocol::Writer& writer, uint32_t& count);
+};
+
+#endif // STATESTREAM_H
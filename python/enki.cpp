@@ -38,12 +38,21 @@
 #include "../enki/Types.h"
 #include "../enki/Geometry.h"
 #include "../enki/PhysicalEngine.h"
+#include "../enki/WorldBatch.h"
+#include "../enki/TrajectoryRecorder.h"
+#include "../enki/InputJournal.h"
+#include "../enki/Scene.h"
+#include "../enki/TopViewRenderer.h"
 #include "../enki/robots/e-puck/EPuck.h"
 #include "../enki/robots/thymio2/Thymio2.h"
 #include "../viewer/Viewer.h"
 #include <QApplication>
 #include <QImage>
 #include <QGLWidget>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
 
 #if PY_MAJOR_VERSION >= 3
 #define INT_CHECK PyLong_Check
@@ -158,6 +167,237 @@ struct Vector_from_python
 	}
 };
 
+// zero-copy views
+
+//! A Python object exposing an array of another Python object through the buffer protocol, so that numpy.asarray() or memoryview() do not copy it
+struct ArrayView
+{
+	PyObject_HEAD
+	//! Python object owning the data, kept alive by this view
+	PyObject* owner;
+	//! Data of the array, in row-major order
+	void* data;
+	//! Number of dimensions, 1 or 2
+	int ndim;
+	//! Size of each dimension
+	Py_ssize_t shape[2];
+	//! Distance in bytes between elements of each dimension
+	Py_ssize_t strides[2];
+	//! Whether the array cannot be written through this view
+	bool readonly;
+	//! If not null, false once the data were replaced by their owner, the view then refuses to export them
+	const std::atomic<bool>* current;
+	//! Format of an element, as in the struct module or PEP 3118
+	const char* format;
+	//! Size of an element in bytes
+	Py_ssize_t itemsize;
+};
+
+static int ArrayView_getbuffer(PyObject* self, Py_buffer* view, int flags)
+{
+	ArrayView* arrayView((ArrayView*)self);
+	if (arrayView->current && !*arrayView->current)
+	{
+		PyErr_SetString(PyExc_BufferError, "this view is stale, as objects were added or removed since it was taken; access its property again to get a new one");
+		view->obj = 0;
+		return -1;
+	}
+	if ((flags & PyBUF_WRITABLE) && arrayView->readonly)
+	{
+		PyErr_SetString(PyExc_BufferError, "this view is read-only");
+		view->obj = 0;
+		return -1;
+	}
+	Py_ssize_t count(1);
+	for (int i = 0; i < arrayView->ndim; ++i)
+		count *= arrayView->shape[i];
+	view->obj = self;
+	Py_INCREF(self);
+	view->buf = arrayView->data;
+	view->len = count * arrayView->itemsize;
+	view->readonly = arrayView->readonly;
+	view->itemsize = arrayView->itemsize;
+	view->format = (flags & PyBUF_FORMAT) ? (char*)arrayView->format : 0;
+	view->ndim = arrayView->ndim;
+	view->shape = (flags & PyBUF_ND) ? arrayView->shape : 0;
+	view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? arrayView->strides : 0;
+	view->suboffsets = 0;
+	view->internal = 0;
+	return 0;
+}
+
+static void ArrayView_dealloc(PyObject* self)
+{
+	Py_XDECREF(((ArrayView*)self)->owner);
+	Py_TYPE(self)->tp_free(self);
+}
+
+//! Return the array as a numpy array; numpy only calls it when the buffer protocol failed, so that the error of a stale view is raised instead of being replaced by an array of objects
+static PyObject* ArrayView_array(PyObject* self, PyObject* args, PyObject* kwargs)
+{
+	PyObject* memoryView(PyMemoryView_FromObject(self));
+	if (!memoryView)
+		return 0;
+	PyObject* numpy(PyImport_ImportModule("numpy"));
+	PyObject* array(numpy ? PyObject_CallMethod(numpy, (char*)"asarray", (char*)"O", memoryView) : 0);
+	Py_XDECREF(numpy);
+	Py_DECREF(memoryView);
+	return array;
+}
+
+static PyMethodDef ArrayView_methods[] = {
+	{ "__array__", (PyCFunction)ArrayView_array, METH_VARARGS | METH_KEYWORDS, "Return the array as a numpy array, raise BufferError if this view is stale" },
+	{ 0, 0, 0, 0 }
+};
+
+static PyBufferProcs ArrayView_bufferProcs;
+static PyTypeObject ArrayViewType = { PyVarObject_HEAD_INIT(0, 0) };
+
+//! Initialise the type of ArrayView, to be called when loading the module
+static void initArrayViewType()
+{
+	ArrayView_bufferProcs.bf_getbuffer = ArrayView_getbuffer;
+	ArrayViewType.tp_name = "pyenki.ArrayView";
+	ArrayViewType.tp_basicsize = sizeof(ArrayView);
+	ArrayViewType.tp_dealloc = ArrayView_dealloc;
+	ArrayViewType.tp_as_buffer = &ArrayView_bufferProcs;
+	ArrayViewType.tp_methods = ArrayView_methods;
+	ArrayViewType.tp_flags = Py_TPFLAGS_DEFAULT;
+	#if PY_MAJOR_VERSION < 3
+	ArrayViewType.tp_flags |= Py_TPFLAGS_HAVE_NEWBUFFER;
+	#endif
+	ArrayViewType.tp_doc = "View on an array of an Enki object, use numpy.asarray() or memoryview() to access it without copy";
+	if (PyType_Ready(&ArrayViewType) < 0)
+		throw_error_already_set();
+}
+
+//! Return a view on rows x columns elements of itemsize bytes at data, or on rows elements if columns is 0, that keeps owner alive and, if current is not null, becomes invalid when current becomes false
+object makeView(object owner, void* data, size_t rows, size_t columns, size_t itemsize, const char* format, bool readonly, const std::atomic<bool>* current = 0)
+{
+	ArrayView* view(PyObject_New(ArrayView, &ArrayViewType));
+	if (!view)
+		throw_error_already_set();
+	view->owner = incref(owner.ptr());
+	view->data = data;
+	view->ndim = columns ? 2 : 1;
+	view->shape[0] = rows;
+	view->shape[1] = columns;
+	view->strides[0] = (columns ? columns : 1) * itemsize;
+	view->strides[1] = itemsize;
+	view->readonly = readonly;
+	view->current = current;
+	view->format = format;
+	view->itemsize = itemsize;
+	return object(handle<>((PyObject*)view));
+}
+
+//! Return a view on rows x columns doubles at data, or on rows doubles if columns is 0, that keeps owner alive
+object makeArrayView(object owner, double* data, size_t rows, size_t columns, bool readonly, const std::atomic<bool>* current = 0)
+{
+	return makeView(owner, data, rows, columns, sizeof(double), "d", readonly, current);
+}
+
+//! Return a view on rows x columns records of recordSize doubles at data, or on rows records if columns is 0, whose fields are described by format, that keeps owner alive
+object makeRecordView(object owner, double* data, size_t rows, size_t columns, size_t recordSize, const char* format, bool readonly, const std::atomic<bool>* current = 0)
+{
+	return makeView(owner, data, rows, columns, recordSize * sizeof(double), format, readonly, current);
+}
+
+//! Doubles shared by the object that updates them and the views on them
+struct SharedValues: std::vector<double>
+{
+	//! False once the object replaced these values by new ones, views on them then refuse to export them
+	std::atomic<bool> current;
+	
+	SharedValues(size_t size):
+		std::vector<double>(size),
+		current(true)
+	{}
+};
+
+//! A buffer of doubles shared by the object that updates it and the views on it
+typedef std::shared_ptr<SharedValues> SharedBuffer;
+
+//! Make buffer hold size values, replacing it by a new buffer if its size changes; the views on the old one keep valid memory but become stale
+void resizeSharedBuffer(SharedBuffer& buffer, size_t size)
+{
+	if (!buffer || buffer->size() != size)
+	{
+		if (buffer)
+			buffer->current = false;
+		buffer = std::make_shared<SharedValues>(size);
+	}
+}
+
+static void SharedBuffer_destroy(PyObject* capsule)
+{
+	delete static_cast<SharedBuffer*>(PyCapsule_GetPointer(capsule, 0));
+}
+
+//! Return a Python object holding a reference to buffer, to be the owner of views on it
+object makeSharedBufferOwner(const SharedBuffer& buffer)
+{
+	PyObject* capsule(PyCapsule_New(new SharedBuffer(buffer), 0, SharedBuffer_destroy));
+	if (!capsule)
+		throw_error_already_set();
+	return object(handle<>(capsule));
+}
+
+//! Copy the content of source, that must support the buffer protocol and hold as many bytes as destination, into destination
+void copyFromBuffer(object source, std::vector<double>& destination, const char* name, size_t recordSize, size_t records)
+{
+	Py_buffer buffer;
+	if (PyObject_GetBuffer(source.ptr(), &buffer, PyBUF_C_CONTIGUOUS) < 0)
+		throw_error_already_set();
+	const size_t size(destination.size() * sizeof(double));
+	if (size_t(buffer.len) != size)
+	{
+		PyBuffer_Release(&buffer);
+		PyErr_Format(PyExc_ValueError, "%s must hold %d values per robot, for %d robots", name, int(recordSize), int(records));
+		throw_error_already_set();
+	}
+	if (size)
+		std::copy((const char*)buffer.buf, (const char*)buffer.buf + size, (char*)&destination[0]);
+	PyBuffer_Release(&buffer);
+}
+
+//! Release the global interpreter lock of Python for the lifetime of this object, controlStep() is not overridden by Python meanwhile
+struct ScopedGILRelease
+{
+	//! Whether the current thread runs without the global interpreter lock
+	static thread_local bool active;
+	
+	PyThreadState* savedState;
+	bool wasActive;
+	
+	ScopedGILRelease():
+		savedState(PyEval_SaveThread()),
+		wasActive(active)
+	{
+		active = true;
+	}
+	
+	~ScopedGILRelease()
+	{
+		active = wasActive;
+		PyEval_RestoreThread(savedState);
+	}
+};
+
+thread_local bool ScopedGILRelease::active = false;
+
+//! Return a view on the pixels of a camera, one row of RGBA components per pixel
+object makeImageView(object owner, std::valarray<Color>& image)
+{
+	return makeArrayView(owner, image.size() ? image[0].components : 0, image.size(), 4, true);
+}
+
+//! Return a view on the distances of the pixels of a camera
+object makeDepthView(object owner, std::valarray<double>& zbuffer)
+{
+	return makeArrayView(owner, zbuffer.size() ? &zbuffer[0] : 0, zbuffer.size(), 0, true);
+}
+
 // wrappers for world
 
 static World::GroundTexture loadTexture(const std::string& fileName)
@@ -204,22 +444,105 @@ static World::GroundTexture loadTexture(const std::string& fileName)
 
 struct WorldWithoutObjectsOwnership: public World
 {
+	//! Values per object in objectStates
+	static const size_t OBJECT_STATE_SIZE = 6;
+	//! Pose and speed of objects, in the order of objects, updated after every step once objectStatesView was accessed; replaced when the number of objects changes
+	SharedBuffer objectStates;
+	//! Whether objectStates must be updated
+	bool objectStatesViewed;
+	
+	//! Values per robot in batchSensors: x, y, angle, left and right encoders, 8 infrared values, 8 infrared distances and 2 ground values
+	static const size_t BATCH_SENSORS_SIZE = 23;
+	//! Values per robot in batchCommands: left and right speeds, then RGBA colors of the 27 LEDs of Thymio II
+	static const size_t BATCH_COMMANDS_SIZE = 110;
+	//! Fields of a record of batchSensors, as in PEP 3118
+	static const char* batchSensorsFormat;
+	//! Fields of a record of batchCommands, as in PEP 3118
+	static const char* batchCommandsFormat;
+	//! Robots driven by stepBatch(), in the order of objects
+	std::vector<DifferentialWheeled*> batchRobots;
+	//! Sensors of batchRobots, a record per robot, updated by stepBatch(); replaced when the number of robots changes
+	SharedBuffer batchSensors;
+	//! Commands applied to batchRobots by stepBatch(), a record per robot; replaced when the number of robots changes
+	SharedBuffer batchCommands;
+	
 	WorldWithoutObjectsOwnership(double width, double height, const Color& wallsColor = Color::gray, const GroundTexture& groundTexture = GroundTexture()):
-		World(width, height, wallsColor, groundTexture)
+		World(width, height, wallsColor, groundTexture),
+		objectStatesViewed(false)
 	{
 		takeObjectOwnership = false;
 	}
 	
 	WorldWithoutObjectsOwnership(double r, const Color& wallsColor = Color::gray, const GroundTexture& groundTexture = GroundTexture()):
-		World(r, wallsColor, groundTexture)
+		World(r, wallsColor, groundTexture),
+		objectStatesViewed(false)
 	{
 		takeObjectOwnership = false;
 	}
 	
-	WorldWithoutObjectsOwnership()
+	WorldWithoutObjectsOwnership():
+		objectStatesViewed(false)
 	{
 		takeObjectOwnership = false;
 	}
+	
+	//! Copy the settings and the state of other but not its objects, which are added by the caller and owned by this world
+	explicit WorldWithoutObjectsOwnership(const World& other):
+		World(other),
+		objectStatesViewed(false)
+	{
+	}
+	
+	virtual void step(double dt, unsigned physicsOversampling = 1)
+	{
+		World::step(dt, physicsOversampling);
+		if (objectStatesViewed)
+			updateObjectStates();
+	}
+	
+	//! Copy x, y, angle, speed x, speed y and angular speed of all objects into objectStates, only replacing it if the number of objects changed
+	void updateObjectStates()
+	{
+		resizeSharedBuffer(objectStates, objects.size() * OBJECT_STATE_SIZE);
+		double* state(objectStates->empty() ? 0 : &(*objectStates)[0]);
+		for (ObjectsIterator it = objects.begin(); it != objects.end(); ++it)
+		{
+			const PhysicalObject* o(*it);
+			*state++ = o->pos.x;
+			*state++ = o->pos.y;
+			*state++ = o->angle;
+			*state++ = o->speed.x;
+			*state++ = o->speed.y;
+			*state++ = o->angSpeed;
+		}
+	}
+	
+	//! Return the state of the random generator of this world, setRandomSeed() with it resumes the sequence from this point
+	unsigned long getRandomState() const
+	{
+		return worldRandom.getState();
+	}
+	
+	//! Return the state of the random generator of this world, setRandomSeed() with it resumes the sequence from this point
+	unsigned long getRandomState() const
+	{
+		return worldRandom.getState();
+	}
+	
+	//! Return a read-only view on objectStates, one row per object, that keeps the current buffer of objectStates alive
+	static object getObjectStatesView(back_reference<WorldWithoutObjectsOwnership&> self)
+	{
+		WorldWithoutObjectsOwnership& world(self.get());
+		world.objectStatesViewed = true;
+		world.updateObjectStates();
+		std::vector<double>& states(*world.objectStates);
+		return makeArrayView(makeSharedBufferOwner(world.objectStates), states.empty() ? 0 : &states[0], world.objects.size(), OBJECT_STATE_SIZE, true, &world.objectStates->current);
+	}
+	
+	void updateBatchRobots();
+	static object getBatchSensorsView(back_reference<WorldWithoutObjectsOwnership&> self);
+	static object getBatchCommandsView(back_reference<WorldWithoutObjectsOwnership&> self);
+	static object stepBatch(back_reference<WorldWithoutObjectsOwnership&> self, unsigned steps, object commands, double dt, unsigned physicsOversampling);
 };
 
 struct WorldWithTexturedGround: public WorldWithoutObjectsOwnership
@@ -233,6 +556,22 @@ struct WorldWithTexturedGround: public WorldWithoutObjectsOwnership
 		WorldWithoutObjectsOwnership(r, wallsColor, loadTexture(ppmFileName))
 	{
 	}
+	
+	// constructors used when unpickling
+	
+	WorldWithTexturedGround(double width, double height, const Color& wallsColor, const GroundTexture& groundTexture):
+		WorldWithoutObjectsOwnership(width, height, wallsColor, groundTexture)
+	{
+	}
+	
+	WorldWithTexturedGround(double r, const Color& wallsColor, const GroundTexture& groundTexture):
+		WorldWithoutObjectsOwnership(r, wallsColor, groundTexture)
+	{
+	}
+	
+	WorldWithTexturedGround()
+	{
+	}
 };
 
 // wrappers for objects
@@ -241,36 +580,117 @@ struct CircularPhysicalObject: public PhysicalObject
 {
 	CircularPhysicalObject(double radius, double height, double mass, const Color& color = Color())
 	{
+		defaultDynamicsClass = &typeid(CircularPhysicalObject);
 		setCylindric(radius, height, mass);
 		setColor(color);
 	}
+	
+	virtual PhysicalObject* clone() const
+	{
+		return new CircularPhysicalObject(*this);
+	}
 };
 
 struct RectangularPhysicalObject: public PhysicalObject
 {
-	RectangularPhysicalObject(double l1, double l2, double height, double mass, const Color& color = Color())
+	//! Size along the x axis, for pickling
+	double l1;
+	//! Size along the y axis, for pickling
+	double l2;
+	
+	RectangularPhysicalObject(double l1, double l2, double height, double mass, const Color& color = Color()):
+		l1(l1),
+		l2(l2)
 	{
+		defaultDynamicsClass = &typeid(RectangularPhysicalObject);
 		setRectangular(l1, l2, height, mass);
 		setColor(color);
 	}
+	
+	virtual PhysicalObject* clone() const
+	{
+		return new RectangularPhysicalObject(*this);
+	}
 };
 
 // wrappers for robots
 
 struct EPuckWrap: EPuck, wrapper<EPuck>
 {
+	//! Values of infrared sensors, updated before every control step
+	double proxSensorValues[8];
+	//! Distances of infrared sensors, updated before every control step
+	double proxSensorDistances[8];
+	//! Whether controlStep() can be overridden in Python, false for copies made by fork()
+	bool pythonControlled;
+	
 	EPuckWrap():
-		EPuck(CAPABILITY_BASIC_SENSORS|CAPABILITY_CAMERA)
-	{}
+		EPuck(CAPABILITY_BASIC_SENSORS|CAPABILITY_CAMERA),
+		pythonControlled(true)
+	{
+		defaultDynamicsClass = &typeid(EPuckWrap);
+		std::fill(proxSensorValues, proxSensorValues + 8, 0.);
+		std::fill(proxSensorDistances, proxSensorDistances + 8, 0.);
+	}
+	
+	//! Copy other without its Python object
+	EPuckWrap(const EPuckWrap& other):
+		// Robot is a virtual base, so the most derived class must copy it
+		Robot(other),
+		EPuck(other),
+		wrapper<EPuck>(),
+		pythonControlled(false)
+	{
+		std::copy(other.proxSensorValues, other.proxSensorValues + 8, proxSensorValues);
+		std::copy(other.proxSensorDistances, other.proxSensorDistances + 8, proxSensorDistances);
+	}
+	
+	virtual PhysicalObject* clone() const
+	{
+		EPuckWrap* copy(new EPuckWrap(*this));
+		copy->copyInteractions(*this);
+		return copy;
+	}
 	
 	virtual void controlStep(double dt)
 	{
-		if (override controlStep = this->get_override("controlStep"))
-			controlStep(dt);
+		const IRSensor* sensors[8] = {
+			&infraredSensor0, &infraredSensor1, &infraredSensor2, &infraredSensor3,
+			&infraredSensor4, &infraredSensor5, &infraredSensor6, &infraredSensor7
+		};
+		for (size_t i = 0; i < 8; ++i)
+		{
+			proxSensorValues[i] = sensors[i]->getValue();
+			proxSensorDistances[i] = sensors[i]->getDist();
+		}
+		
+		if (pythonControlled && !ScopedGILRelease::active)
+			if (override controlStep = this->get_override("controlStep"))
+				controlStep(dt);
 		
 		EPuck::controlStep(dt);
 	}
 	
+	static object getProxSensorValuesView(back_reference<EPuckWrap&> self)
+	{
+		return makeArrayView(self.source(), self.get().proxSensorValues, 8, 0, true);
+	}
+	
+	static object getProxSensorDistancesView(back_reference<EPuckWrap&> self)
+	{
+		return makeArrayView(self.source(), self.get().proxSensorDistances, 8, 0, true);
+	}
+	
+	static object getCameraImageView(back_reference<EPuckWrap&> self)
+	{
+		return makeImageView(self.source(), self.get().camera.image);
+	}
+	
+	static object getCameraDepthView(back_reference<EPuckWrap&> self)
+	{
+		return makeDepthView(self.source(), self.get().camera.zbuffer);
+	}
+	
 	list getProxSensorValues(void)
 	{
 		list l;
@@ -311,14 +731,86 @@ struct EPuckWrap: EPuck, wrapper<EPuck>
 
 struct Thymio2Wrap: Thymio2, wrapper<Thymio2>
 {
+	static const size_t ledCount = LED_COUNT;
+	
+	//! Values of infrared sensors, updated before every control step
+	double proxSensorValues[7];
+	//! Distances of infrared sensors, updated before every control step
+	double proxSensorDistances[7];
+	//! Values of ground sensors, updated before every control step
+	double groundSensorValues[2];
+	//! Whether controlStep() can be overridden in Python, false for copies made by fork()
+	bool pythonControlled;
+	
+	Thymio2Wrap():
+		pythonControlled(true)
+	{
+		defaultDynamicsClass = &typeid(Thymio2Wrap);
+		std::fill(proxSensorValues, proxSensorValues + 7, 0.);
+		std::fill(proxSensorDistances, proxSensorDistances + 7, 0.);
+		std::fill(groundSensorValues, groundSensorValues + 2, 0.);
+	}
+	
+	//! Copy other without its Python object
+	Thymio2Wrap(const Thymio2Wrap& other):
+		// Robot is a virtual base, so the most derived class must copy it
+		Robot(other),
+		Thymio2(other),
+		wrapper<Thymio2>(),
+		pythonControlled(false)
+	{
+		std::copy(other.proxSensorValues, other.proxSensorValues + 7, proxSensorValues);
+		std::copy(other.proxSensorDistances, other.proxSensorDistances + 7, proxSensorDistances);
+		std::copy(other.groundSensorValues, other.groundSensorValues + 2, groundSensorValues);
+	}
+	
+	virtual PhysicalObject* clone() const
+	{
+		Thymio2Wrap* copy(new Thymio2Wrap(*this));
+		copy->copyInteractions(*this);
+		// the LED texture belongs to the viewer of this robot
+		copy->textureID = 0;
+		copy->ledTexture = 0;
+		copy->ledTextureNeedUpdate = true;
+		return copy;
+	}
+	
 	virtual void controlStep(double dt)
 	{
-		if (override controlStep = this->get_override("controlStep"))
-			controlStep(dt);
+		const IRSensor* sensors[7] = {
+			&infraredSensor0, &infraredSensor1, &infraredSensor2, &infraredSensor3,
+			&infraredSensor4, &infraredSensor5, &infraredSensor6
+		};
+		for (size_t i = 0; i < 7; ++i)
+		{
+			proxSensorValues[i] = sensors[i]->getValue();
+			proxSensorDistances[i] = sensors[i]->getDist();
+		}
+		groundSensorValues[0] = groundSensor0.getValue();
+		groundSensorValues[1] = groundSensor1.getValue();
+		
+		if (pythonControlled && !ScopedGILRelease::active)
+			if (override controlStep = this->get_override("controlStep"))
+				controlStep(dt);
 		
 		Thymio2::controlStep(dt);
 	}
 	
+	static object getProxSensorValuesView(back_reference<Thymio2Wrap&> self)
+	{
+		return makeArrayView(self.source(), self.get().proxSensorValues, 7, 0, true);
+	}
+	
+	static object getProxSensorDistancesView(back_reference<Thymio2Wrap&> self)
+	{
+		return makeArrayView(self.source(), self.get().proxSensorDistances, 7, 0, true);
+	}
+	
+	static object getGroundSensorValuesView(back_reference<Thymio2Wrap&> self)
+	{
+		return makeArrayView(self.source(), self.get().groundSensorValues, 2, 0, true);
+	}
+	
 	list getProxSensorValues(void)
 	{
 		list l;
@@ -360,6 +852,570 @@ struct Thymio2Wrap: Thymio2, wrapper<Thymio2>
 	void setLedColor(int index, const Color& color) {
 		Thymio2::setLedColor((LedIndex)index, color);
 	}
+
+	Color getLedColor(int index) const {
+		return Thymio2::getColorLed((LedIndex)index);
+	}
+};
+
+// batched stepping
+
+const char* WorldWithoutObjectsOwnership::batchSensorsFormat =
+	"T{d:x:d:y:d:angle:d:leftEncoder:d:rightEncoder:(8)d:proximitySensorValues:(8)d:proximitySensorDistances:(2)d:groundSensorValues:}";
+const char* WorldWithoutObjectsOwnership::batchCommandsFormat =
+	"T{d:leftSpeed:d:rightSpeed:(27,4)d:ledColors:}";
+
+//! Return the robots of world, in the order of objects
+std::vector<DifferentialWheeled*> getRobots(const World& world)
+{
+	std::vector<DifferentialWheeled*> robots;
+	for (World::Objects::const_iterator it = world.objects.begin(); it != world.objects.end(); ++it)
+	{
+		DifferentialWheeled* robot(dynamic_cast<DifferentialWheeled*>(*it));
+		if (robot)
+			robots.push_back(robot);
+	}
+	return robots;
+}
+
+//! Copy the speeds of robots and the LEDs of Thymio II robots into a command record per robot
+void readRobotCommands(const std::vector<DifferentialWheeled*>& robots, double* commands)
+{
+	for (size_t i = 0; i < robots.size(); ++i)
+	{
+		double* command(commands + i * WorldWithoutObjectsOwnership::BATCH_COMMANDS_SIZE);
+		std::fill(command, command + WorldWithoutObjectsOwnership::BATCH_COMMANDS_SIZE, 0.);
+		command[0] = robots[i]->leftSpeed;
+		command[1] = robots[i]->rightSpeed;
+		const Thymio2Wrap* thymio(dynamic_cast<Thymio2Wrap*>(robots[i]));
+		if (thymio)
+			for (size_t j = 0; j < Thymio2Wrap::ledCount; ++j)
+			{
+				const Color color(thymio->getLedColor(j));
+				std::copy(color.components, color.components + 4, command + 2 + j * 4);
+			}
+	}
+}
+
+//! Copy the state and sensors of robots into a sensor record per robot, sensors a robot does not have are NaN
+void readRobotSensors(const std::vector<DifferentialWheeled*>& robots, double* sensors)
+{
+	for (size_t i = 0; i < robots.size(); ++i)
+	{
+		const DifferentialWheeled* robot(robots[i]);
+		double* record(sensors + i * WorldWithoutObjectsOwnership::BATCH_SENSORS_SIZE);
+		record[0] = robot->pos.x;
+		record[1] = robot->pos.y;
+		record[2] = robot->angle;
+		record[3] = robot->leftEncoder;
+		record[4] = robot->rightEncoder;
+		std::fill(record + 5, record + WorldWithoutObjectsOwnership::BATCH_SENSORS_SIZE, std::numeric_limits<double>::quiet_NaN());
+		const EPuckWrap* epuck(dynamic_cast<const EPuckWrap*>(robot));
+		const Thymio2Wrap* thymio(dynamic_cast<const Thymio2Wrap*>(robot));
+		if (epuck)
+		{
+			std::copy(epuck->proxSensorValues, epuck->proxSensorValues + 8, record + 5);
+			std::copy(epuck->proxSensorDistances, epuck->proxSensorDistances + 8, record + 13);
+		}
+		else if (thymio)
+		{
+			std::copy(thymio->proxSensorValues, thymio->proxSensorValues + 7, record + 5);
+			std::copy(thymio->proxSensorDistances, thymio->proxSensorDistances + 7, record + 13);
+			std::copy(thymio->groundSensorValues, thymio->groundSensorValues + 2, record + 21);
+		}
+	}
+}
+
+//! Set the speeds of robots and the LEDs of Thymio II robots from a command record per robot
+void applyRobotCommands(const std::vector<DifferentialWheeled*>& robots, const double* commands)
+{
+	for (size_t i = 0; i < robots.size(); ++i)
+	{
+		const double* command(commands + i * WorldWithoutObjectsOwnership::BATCH_COMMANDS_SIZE);
+		robots[i]->leftSpeed = command[0];
+		robots[i]->rightSpeed = command[1];
+		Thymio2Wrap* thymio(dynamic_cast<Thymio2Wrap*>(robots[i]));
+		if (thymio)
+			for (size_t j = 0; j < Thymio2Wrap::ledCount; ++j)
+			{
+				const double* c(command + 2 + j * 4);
+				thymio->setLedColor(j, Color(c[0], c[1], c[2], c[3]));
+			}
+	}
+}
+
+//! Collect the robots of this world, and replace batchSensors and batchCommands if their number changed, filling them from the current state of robots
+void WorldWithoutObjectsOwnership::updateBatchRobots()
+{
+	batchRobots = getRobots(*this);
+	if (batchCommands && batchCommands->size() == batchRobots.size() * BATCH_COMMANDS_SIZE)
+		return;
+	
+	resizeSharedBuffer(batchSensors, batchRobots.size() * BATCH_SENSORS_SIZE);
+	resizeSharedBuffer(batchCommands, batchRobots.size() * BATCH_COMMANDS_SIZE);
+	if (batchRobots.empty())
+		return;
+	readRobotCommands(batchRobots, &(*batchCommands)[0]);
+	readRobotSensors(batchRobots, &(*batchSensors)[0]);
+}
+
+object WorldWithoutObjectsOwnership::getBatchSensorsView(back_reference<WorldWithoutObjectsOwnership&> self)
+{
+	WorldWithoutObjectsOwnership& world(self.get());
+	world.updateBatchRobots();
+	std::vector<double>& sensors(*world.batchSensors);
+	return makeRecordView(makeSharedBufferOwner(world.batchSensors), sensors.empty() ? 0 : &sensors[0], world.batchRobots.size(), 0, BATCH_SENSORS_SIZE, batchSensorsFormat, true, &world.batchSensors->current);
+}
+
+object WorldWithoutObjectsOwnership::getBatchCommandsView(back_reference<WorldWithoutObjectsOwnership&> self)
+{
+	WorldWithoutObjectsOwnership& world(self.get());
+	world.updateBatchRobots();
+	std::vector<double>& commands(*world.batchCommands);
+	return makeRecordView(makeSharedBufferOwner(world.batchCommands), commands.empty() ? 0 : &commands[0], world.batchRobots.size(), 0, BATCH_COMMANDS_SIZE, batchCommandsFormat, false, &world.batchCommands->current);
+}
+
+//! Apply commands, or batchCommands if None, and run steps without the global interpreter lock nor Python controllers, then return the view on batchSensors
+object WorldWithoutObjectsOwnership::stepBatch(back_reference<WorldWithoutObjectsOwnership&> self, unsigned steps, object commands, double dt, unsigned physicsOversampling)
+{
+	WorldWithoutObjectsOwnership& world(self.get());
+	world.updateBatchRobots();
+	if (!commands.is_none())
+		copyFromBuffer(commands, *world.batchCommands, "commands", BATCH_COMMANDS_SIZE, world.batchRobots.size());
+	if (world.batchRobots.empty())
+		return getBatchSensorsView(self);
+	applyRobotCommands(world.batchRobots, &(*world.batchCommands)[0]);
+	{
+		ScopedGILRelease release;
+		for (unsigned i = 0; i < steps; ++i)
+			world.step(dt, physicsOversampling);
+	}
+	readRobotSensors(world.batchRobots, &(*world.batchSensors)[0]);
+	return getBatchSensorsView(self);
+}
+
+// vectorized environments
+
+//! Copies of a world stepped in lockstep by a pool of threads, each reset to the initial state of the world when its episode ends, for reinforcement learning
+struct VecWorld
+{
+	//! Pool of threads stepping the copies, owns them
+	WorldBatch batch;
+	//! Number of robots in every copy
+	size_t robotCount;
+	//! Robots of every copy, in the order of objects
+	std::vector<std::vector<DifferentialWheeled*> > robots;
+	//! State of every copy when it was created, restored at every reset; states of copies differ by the uids of their objects
+	std::vector<std::vector<uint8_t> > initialStates;
+	//! Sensor records of the robots of the world when this object was created, returned after a reset with the new poses
+	std::vector<double> initialSensors;
+	//! Sensor records of all robots, copy after copy
+	std::vector<double> observations;
+	//! Command records of all robots, copy after copy, applied at every step
+	std::vector<double> actions;
+	//! Mean distance travelled by the robots of every copy during the last step
+	std::vector<double> rewards;
+	//! Whether the episode of every copy ended at the last step, in which case observations are the ones after the reset
+	std::vector<uint8_t> dones;
+	//! Whether Python ended the episode of every copy, which is then reset before the next step; cleared by it
+	std::vector<uint8_t> terminates;
+	//! Number of steps of the current episode of every copy
+	std::vector<unsigned> episodeSteps;
+	//! Generator of the randomization at reset, for every copy
+	std::vector<FastRandom> resetRandoms;
+	//! Position of robots before the last step, for rewards
+	std::vector<Vector> previousPositions;
+	//! Number of steps after which an episode ends, 0 for no limit
+	unsigned maxSteps;
+	//! Maximum distance robots and objects are moved on each axis at reset
+	double positionJitter;
+	//! Maximum angle robots and objects are rotated by at reset
+	double angleJitter;
+	
+	VecWorld(const World& world, size_t count, unsigned maxSteps = 0, double positionJitter = 0, double angleJitter = 0, unsigned long seed = 0, unsigned threadCount = 0);
+	void resetCopy(size_t index);
+	void afterStep(size_t index);
+	static object reset(back_reference<VecWorld&> self);
+	static tuple step(back_reference<VecWorld&> self, object actions, double dt, unsigned physicsOversampling);
+	static object getObservationsView(back_reference<VecWorld&> self);
+	static object getActionsView(back_reference<VecWorld&> self);
+	static object getRewardsView(back_reference<VecWorld&> self);
+	static object getDonesView(back_reference<VecWorld&> self);
+	static object getTerminatesView(back_reference<VecWorld&> self);
+	static object getEpisodeStepsView(back_reference<VecWorld&> self);
+	size_t size() const { return batch.size(); }
+};
+
+VecWorld::VecWorld(const World& world, size_t count, unsigned maxSteps, double positionJitter, double angleJitter, unsigned long seed, unsigned threadCount):
+	batch(threadCount),
+	robots(count),
+	initialStates(count),
+	rewards(count, 0.),
+	dones(count, 0),
+	terminates(count, 0),
+	episodeSteps(count, 0),
+	resetRandoms(count),
+	maxSteps(maxSteps),
+	positionJitter(positionJitter),
+	angleJitter(angleJitter)
+{
+	const std::vector<DifferentialWheeled*> worldRobots(getRobots(world));
+	robotCount = worldRobots.size();
+	initialSensors.resize(robotCount * WorldWithoutObjectsOwnership::BATCH_SENSORS_SIZE);
+	observations.resize(count * initialSensors.size());
+	actions.resize(count * robotCount * WorldWithoutObjectsOwnership::BATCH_COMMANDS_SIZE);
+	previousPositions.resize(count * robotCount);
+	if (robotCount)
+		readRobotSensors(worldRobots, &initialSensors[0]);
+	
+	{
+		ScopedGILRelease release;
+		batch.createWorlds(count, [&](size_t index) {
+			World* copy(world.fork());
+			initialStates[index] = copy->saveState();
+			return copy;
+		});
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		robots[i] = getRobots(*batch.getWorld(i));
+		if (robotCount)
+			readRobotCommands(robots[i], &actions[i * robotCount * WorldWithoutObjectsOwnership::BATCH_COMMANDS_SIZE]);
+		resetRandoms[i].setSeed(seed + i);
+		resetCopy(i);
+		batch.setCallback(i, [this, i](World*, unsigned) { afterStep(i); return true; });
+	}
+}
+
+//! Restore the copy of index to the initial state, move its objects randomly, reseed its generator and fill its observations
+void VecWorld::resetCopy(size_t index)
+{
+	World* world(batch.getWorld(index));
+	FastRandom& random(resetRandoms[index]);
+	world->restoreState(initialStates[index]);
+	world->setRandomSeed(random.get());
+	for (World::ObjectsIterator it = world->objects.begin(); it != world->objects.end(); ++it)
+	{
+		PhysicalObject* object(*it);
+		if (object->getMass() <= 0)
+			continue;
+		object->pos.x += positionJitter * (random.getRange(2.) - 1.);
+		object->pos.y += positionJitter * (random.getRange(2.) - 1.);
+		object->angle = normalizeAngle(object->angle + angleJitter * (random.getRange(2.) - 1.));
+	}
+	episodeSteps[index] = 0;
+	if (!robotCount)
+		return;
+	
+	// sensors are only updated by stepping, use the ones of the initial state with the new poses
+	const std::vector<DifferentialWheeled*>& copyRobots(robots[index]);
+	double* copyObservations(&observations[index * initialSensors.size()]);
+	readRobotSensors(copyRobots, copyObservations);
+	for (size_t i = 0; i < robotCount; ++i)
+	{
+		const size_t offset(i * WorldWithoutObjectsOwnership::BATCH_SENSORS_SIZE);
+		std::copy(&initialSensors[offset + 5], &initialSensors[offset + WorldWithoutObjectsOwnership::BATCH_SENSORS_SIZE], copyObservations + offset + 5);
+		previousPositions[index * robotCount + i] = copyRobots[i]->pos;
+	}
+}
+
+//! Compute observations, reward and end of episode of the copy of index after a step, in the thread that stepped it
+void VecWorld::afterStep(size_t index)
+{
+	++episodeSteps[index];
+	double distance(0);
+	for (size_t i = 0; i < robotCount; ++i)
+	{
+		Vector& previousPosition(previousPositions[index * robotCount + i]);
+		distance += (robots[index][i]->pos - previousPosition).norm();
+		previousPosition = robots[index][i]->pos;
+	}
+	rewards[index] = robotCount ? distance / robotCount : 0;
+	dones[index] = maxSteps && episodeSteps[index] >= maxSteps;
+	if (dones[index])
+		resetCopy(index);
+	else if (robotCount)
+		readRobotSensors(robots[index], &observations[index * initialSensors.size()]);
+}
+
+//! Reset all copies, return the view on observations
+object VecWorld::reset(back_reference<VecWorld&> self)
+{
+	VecWorld& vecWorld(self.get());
+	for (size_t i = 0; i < vecWorld.size(); ++i)
+	{
+		vecWorld.resetCopy(i);
+		vecWorld.rewards[i] = 0;
+		vecWorld.dones[i] = 0;
+		vecWorld.terminates[i] = 0;
+	}
+	return getObservationsView(self);
+}
+
+//! Reset the copies that Python terminated, apply actions, or the ones of actionsView if None, step all copies once without the global interpreter lock, and return the views on observations, rewards and dones
+tuple VecWorld::step(back_reference<VecWorld&> self, object actions, double dt, unsigned physicsOversampling)
+{
+	VecWorld& vecWorld(self.get());
+	for (size_t i = 0; i < vecWorld.size(); ++i)
+		if (vecWorld.terminates[i])
+		{
+			vecWorld.resetCopy(i);
+			vecWorld.terminates[i] = 0;
+		}
+	if (!actions.is_none())
+		copyFromBuffer(actions, vecWorld.actions, "actions", WorldWithoutObjectsOwnership::BATCH_COMMANDS_SIZE, vecWorld.size() * vecWorld.robotCount);
+	if (vecWorld.robotCount)
+		for (size_t i = 0; i < vecWorld.size(); ++i)
+			applyRobotCommands(vecWorld.robots[i], &vecWorld.actions[i * vecWorld.robotCount * WorldWithoutObjectsOwnership::BATCH_COMMANDS_SIZE]);
+	{
+		ScopedGILRelease release;
+		vecWorld.batch.step(dt, physicsOversampling);
+	}
+	return make_tuple(getObservationsView(self), getRewardsView(self), getDonesView(self));
+}
+
+object VecWorld::getObservationsView(back_reference<VecWorld&> self)
+{
+	VecWorld& vecWorld(self.get());
+	return makeRecordView(self.source(), vecWorld.observations.empty() ? 0 : &vecWorld.observations[0], vecWorld.size(), vecWorld.robotCount, WorldWithoutObjectsOwnership::BATCH_SENSORS_SIZE, WorldWithoutObjectsOwnership::batchSensorsFormat, true);
+}
+
+object VecWorld::getActionsView(back_reference<VecWorld&> self)
+{
+	VecWorld& vecWorld(self.get());
+	return makeRecordView(self.source(), vecWorld.actions.empty() ? 0 : &vecWorld.actions[0], vecWorld.size(), vecWorld.robotCount, WorldWithoutObjectsOwnership::BATCH_COMMANDS_SIZE, WorldWithoutObjectsOwnership::batchCommandsFormat, false);
+}
+
+object VecWorld::getRewardsView(back_reference<VecWorld&> self)
+{
+	VecWorld& vecWorld(self.get());
+	return makeArrayView(self.source(), vecWorld.rewards.empty() ? 0 : &vecWorld.rewards[0], vecWorld.size(), 0, true);
+}
+
+object VecWorld::getDonesView(back_reference<VecWorld&> self)
+{
+	VecWorld& vecWorld(self.get());
+	return makeView(self.source(), vecWorld.dones.empty() ? 0 : &vecWorld.dones[0], vecWorld.size(), 0, sizeof(uint8_t), "?", true);
+}
+
+object VecWorld::getTerminatesView(back_reference<VecWorld&> self)
+{
+	VecWorld& vecWorld(self.get());
+	return makeView(self.source(), vecWorld.terminates.empty() ? 0 : &vecWorld.terminates[0], vecWorld.size(), 0, sizeof(uint8_t), "?", false);
+}
+
+object VecWorld::getEpisodeStepsView(back_reference<VecWorld&> self)
+{
+	VecWorld& vecWorld(self.get());
+	return makeView(self.source(), vecWorld.episodeSteps.empty() ? 0 : &vecWorld.episodeSteps[0], vecWorld.size(), 0, sizeof(unsigned), "I", true);
+}
+
+// pickling
+
+//! Return a bytes object holding data
+object toBytes(const std::vector<uint8_t>& data)
+{
+	#if PY_MAJOR_VERSION >= 3
+	return object(handle<>(PyBytes_FromStringAndSize((const char*)(data.empty() ? 0 : &data[0]), data.size())));
+	#else
+	return object(handle<>(PyString_FromStringAndSize((const char*)(data.empty() ? 0 : &data[0]), data.size())));
+	#endif
+}
+
+//! Return the content of source, that must support the buffer protocol
+std::vector<uint8_t> fromBytes(object source)
+{
+	Py_buffer buffer;
+	if (PyObject_GetBuffer(source.ptr(), &buffer, PyBUF_C_CONTIGUOUS) < 0)
+		throw_error_already_set();
+	const uint8_t* bytes((const uint8_t*)buffer.buf);
+	std::vector<uint8_t> data(bytes, bytes + buffer.len);
+	PyBuffer_Release(&buffer);
+	return data;
+}
+
+//! Append the physical parameters of object that its constructor does not set, and its dynamic state
+void writePickledState(StateWriter& writer, const PhysicalObject& object)
+{
+	writer.write(object.collisionElasticity);
+	writer.write(object.dryFrictionCoefficient);
+	writer.write(object.viscousFrictionCoefficient);
+	writer.write(object.viscousMomentFrictionCoefficient);
+	object.saveState(writer);
+}
+
+//! Read back the values appended by writePickledState()
+void readPickledState(StateReader& reader, PhysicalObject& object)
+{
+	reader.read(object.collisionElasticity);
+	reader.read(object.dryFrictionCoefficient);
+	reader.read(object.viscousFrictionCoefficient);
+	reader.read(object.viscousMomentFrictionCoefficient);
+	object.restoreState(reader);
+}
+
+//! Also append the sensor values gathered before the last control step
+void writePickledState(StateWriter& writer, const EPuckWrap& epuck)
+{
+	writePickledState(writer, static_cast<const PhysicalObject&>(epuck));
+	writer.writeArray(epuck.proxSensorValues, 8);
+	writer.writeArray(epuck.proxSensorDistances, 8);
+}
+
+void readPickledState(StateReader& reader, EPuckWrap& epuck)
+{
+	readPickledState(reader, static_cast<PhysicalObject&>(epuck));
+	reader.readArray(epuck.proxSensorValues, 8);
+	reader.readArray(epuck.proxSensorDistances, 8);
+}
+
+//! Also append the sensor values gathered before the last control step
+void writePickledState(StateWriter& writer, const Thymio2Wrap& thymio)
+{
+	writePickledState(writer, static_cast<const PhysicalObject&>(thymio));
+	writer.writeArray(thymio.proxSensorValues, 7);
+	writer.writeArray(thymio.proxSensorDistances, 7);
+	writer.writeArray(thymio.groundSensorValues, 2);
+}
+
+void readPickledState(StateReader& reader, Thymio2Wrap& thymio)
+{
+	readPickledState(reader, static_cast<PhysicalObject&>(thymio));
+	reader.readArray(thymio.proxSensorValues, 7);
+	reader.readArray(thymio.proxSensorDistances, 7);
+	reader.readArray(thymio.groundSensorValues, 2);
+}
+
+//! Pickle objects and robots as their constructor arguments, a binary blob of their state, and their dictionary for Python subclasses
+template<typename ObjectType>
+struct ObjectPickleSuite: pickle_suite
+{
+	static tuple getstate(object self)
+	{
+		std::vector<uint8_t> data;
+		StateWriter writer(data);
+		writePickledState(writer, extract<const ObjectType&>(self)());
+		return make_tuple(toBytes(data), self.attr("__dict__"));
+	}
+	
+	static void setstate(object self, tuple state)
+	{
+		const std::vector<uint8_t> data(fromBytes(state[0]));
+		StateReader reader(data);
+		readPickledState(reader, extract<ObjectType&>(self)());
+		if (!reader.atEnd())
+			throw std::runtime_error("pickled state does not match the object it is restored into");
+		self.attr("__dict__").attr("update")(state[1]);
+	}
+	
+	static bool getstate_manages_dict() { return true; }
+};
+
+struct CircularObjectPickleSuite: ObjectPickleSuite<CircularPhysicalObject>
+{
+	static tuple getinitargs(const CircularPhysicalObject& object)
+	{
+		return make_tuple(object.getRadius(), object.getHeight(), object.getMass(), object.getColor());
+	}
+};
+
+struct RectangularObjectPickleSuite: ObjectPickleSuite<RectangularPhysicalObject>
+{
+	static tuple getinitargs(const RectangularPhysicalObject& object)
+	{
+		return make_tuple(object.l1, object.l2, object.getHeight(), object.getMass(), object.getColor());
+	}
+};
+
+//! Pickle worlds as a binary blob of their walls and ground texture passed to their constructor, and as state a binary blob of their settings, their objects and their dictionary
+template<typename WorldType>
+struct WorldPickleSuite: pickle_suite
+{
+	static tuple getinitargs(const WorldType& world)
+	{
+		std::vector<uint8_t> data;
+		StateWriter writer(data);
+		writer.write<int32_t>(world.wallsType);
+		writer.write(world.w);
+		writer.write(world.h);
+		writer.write(world.r);
+		writer.write(world.color);
+		writer.write<uint32_t>(world.groundTexture.width);
+		writer.write<uint32_t>(world.groundTexture.height);
+		writer.writeArray(world.groundTexture.data);
+		return make_tuple(toBytes(data));
+	}
+	
+	//! Build a world from the blob returned by getinitargs()
+	static WorldType* construct(object walls)
+	{
+		const std::vector<uint8_t> data(fromBytes(walls));
+		StateReader reader(data);
+		int32_t wallsType;
+		double w, h, r;
+		Color color;
+		World::GroundTexture groundTexture;
+		reader.read(wallsType);
+		reader.read(w);
+		reader.read(h);
+		reader.read(r);
+		reader.read(color);
+		reader.read(groundTexture.width);
+		reader.read(groundTexture.height);
+		// the array is prefixed with its size, peek it to allocate the texture
+		uint32_t size;
+		StateReader(reader).read(size);
+		groundTexture.data.resize(size);
+		reader.readArray(groundTexture.data);
+		if (!reader.atEnd())
+			throw std::runtime_error("pickled walls are too long");
+		switch (wallsType)
+		{
+			case World::WALLS_SQUARE: return new WorldType(w, h, color, groundTexture);
+			case World::WALLS_CIRCULAR: return new WorldType(r, color, groundTexture);
+			default: return new WorldType();
+		}
+	}
+	
+	static tuple getstate(object self)
+	{
+		const WorldType& world(extract<const WorldType&>(self)());
+		std::vector<uint8_t> data;
+		StateWriter writer(data);
+		writer.write(world.adaptiveOversampling);
+		writer.write(world.impulseSolver);
+		writer.write(world.continuousCollisionDetection);
+		writer.write(world.batchIntegration);
+		writer.write(world.getRandomState());
+		list objects;
+		for (World::Objects::const_iterator it = world.objects.begin(); it != world.objects.end(); ++it)
+			objects.append(ptr(*it));
+		return make_tuple(toBytes(data), objects, self.attr("__dict__"));
+	}
+	
+	static void setstate(object self, tuple state)
+	{
+		WorldType& world(extract<WorldType&>(self)());
+		const std::vector<uint8_t> data(fromBytes(state[0]));
+		StateReader reader(data);
+		unsigned long randomState;
+		reader.read(world.adaptiveOversampling);
+		reader.read(world.impulseSolver);
+		reader.read(world.continuousCollisionDetection);
+		reader.read(world.batchIntegration);
+		reader.read(randomState);
+		if (!reader.atEnd())
+			throw std::runtime_error("pickled state does not match the world it is restored into");
+		world.setRandomSeed(randomState);
+		// objects are added through Python, so that the world keeps them alive
+		object addObject(self.attr("addObject"));
+		const list objects(state[1]);
+		for (ssize_t i = 0; i < len(objects); ++i)
+			addObject(objects[i]);
+		self.attr("__dict__").attr("update")(state[2]);
+	}
+	
+	static bool getstate_manages_dict() { return true; }
 };
 
 struct PythonViewer: public ViewerWidget
@@ -417,12 +1473,78 @@ void run(World& world, unsigned steps)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(step_overloads, step, 1, 2)
 BOOST_PYTHON_FUNCTION_OVERLOADS(runInViewer_overloads, runInViewer, 1, 6)
 
+//! Return the number of events of a journal
+size_t getJournalEventCount(const InputJournal& journal)
+{
+	return journal.getEvents().size();
+}
+
+//! Replay a journal into a new world whose objects are copies without Python controllers
+WorldWithoutObjectsOwnership* replayJournal(InputJournal& journal, unsigned steps)
+{
+	if (!journal.getInitialWorld())
+		throw std::runtime_error("cannot replay an input journal that never recorded");
+	std::unique_ptr<WorldWithoutObjectsOwnership> world(new WorldWithoutObjectsOwnership(*journal.getInitialWorld()));
+	{
+		ScopedGILRelease release;
+		journal.replay(world.get(), steps);
+	}
+	return world.release();
+}
+
+//! Return a new world owning the objects of scene, whose robots are the classes exposed to Python
+WorldWithoutObjectsOwnership* createSceneWorld(const Scene& scene)
+{
+	const Scene::FileHeader& header(scene.getHeader());
+	std::unique_ptr<WorldWithoutObjectsOwnership> world;
+	if (header.wallsType == World::WALLS_SQUARE)
+		world.reset(new WorldWithoutObjectsOwnership(header.width, header.height, scene.getWallsColor(), scene.getGroundTexture()));
+	else if (header.wallsType == World::WALLS_CIRCULAR)
+		world.reset(new WorldWithoutObjectsOwnership(header.radius, scene.getWallsColor(), scene.getGroundTexture()));
+	else
+		world.reset(new WorldWithoutObjectsOwnership());
+	world->takeObjectOwnership = true;
+	Scene::ObjectFactories factories;
+	factories["epuck"] = [] () -> PhysicalObject* { return new EPuckWrap; };
+	factories["thymio2"] = [] () -> PhysicalObject* { return new Thymio2Wrap; };
+	scene.addObjects(world.get(), factories);
+	return world.release();
+}
+
+size_t getSceneObjectCount(const Scene& scene)
+{
+	return scene.getHeader().objectCount;
+}
+
+// wrappers for top view renderer
+
+//! Return a view of shape (height, width, 4) on the image of renderer
+object getTopViewImage(back_reference<TopViewRenderer&> self)
+{
+	const TopViewRenderer& renderer(self.get());
+	return makeView(self.source(), const_cast<uint8_t*>(renderer.getPixels()), renderer.getHeight(), renderer.getWidth(), 4, "4B", true);
+}
+
+//! Render world without the global interpreter lock and return the view on the image
+object renderTopView(back_reference<TopViewRenderer&> self, const World& world)
+{
+	{
+		ScopedGILRelease noGIL;
+		self.get().render(&world);
+	}
+	return getTopViewImage(self);
+}
+
 BOOST_PYTHON_MODULE(pyenki)
 {
 	// setup converters
 	to_python_converter<Vector, Vector_to_python_tuple>();
 	Vector_from_python();
 	
+	// zero-copy views
+	initArrayViewType();
+	scope().attr("ArrayView") = object(handle<>(borrowed((PyObject*)&ArrayViewType)));
+	
 	// TODO: complete doc
 	
 	// Color and texture
@@ -439,6 +1561,7 @@ BOOST_PYTHON_MODULE(pyenki)
 			args("r", "g", "b", "a")
 		)
 	)
+		.def_pickle(ColorPickleSuite())
 		.def(self += double())
 		.def(self + double())
 		.def(self -= double())
@@ -500,11 +1623,15 @@ BOOST_PYTHON_MODULE(pyenki)
 	
 	class_<CircularPhysicalObject, bases<PhysicalObject> >("CircularObject",
 		init<double, double, double, optional<const Color&> >(args("radius", "height", "mass", "color"))
-	);
+	)
+		.def_pickle(CircularObjectPickleSuite())
+	;
 	
 	class_<RectangularPhysicalObject, bases<PhysicalObject> >("RectangularObject",
 		init<double, double, double, double, optional<const Color&> >(args("l1", "l2", "height", "mass", "color"))
-	);
+	)
+		.def_pickle(RectangularObjectPickleSuite())
+	;
 	
 	// Robots
 	
@@ -522,25 +1649,34 @@ BOOST_PYTHON_MODULE(pyenki)
 	;
 	
 	class_<EPuckWrap, bases<DifferentialWheeled>, boost::noncopyable>("EPuck")
+		.def_pickle(ObjectPickleSuite<EPuckWrap>())
 		.def("controlStep", &EPuckWrap::controlStep)
 		.def("setLedRing", &EPuckWrap::setLedRing)
 		.def_readonly("proximitySensorValues", &EPuckWrap::getProxSensorValues)
 		.def_readonly("proximitySensorDistances", &EPuckWrap::getProxSensorDistances)
 		.def_readonly("cameraImage", &EPuckWrap::getCameraImage)
+		.add_property("proximitySensorValuesView", &EPuckWrap::getProxSensorValuesView, "View on the 8 values of infrared sensors, updated at every control step")
+		.add_property("proximitySensorDistancesView", &EPuckWrap::getProxSensorDistancesView, "View on the 8 distances of infrared sensors, updated at every control step")
+		.add_property("cameraImageView", &EPuckWrap::getCameraImageView, "View on the pixels of the camera, one row of RGBA components per pixel")
+		.add_property("cameraDepthView", &EPuckWrap::getCameraDepthView, "View on the squared distances of the pixels of the camera")
 	;
 	
 	class_<Thymio2Wrap, bases<DifferentialWheeled>, boost::noncopyable>("Thymio2")
+		.def_pickle(ObjectPickleSuite<Thymio2Wrap>())
 		.def("controlStep", &Thymio2Wrap::controlStep)
 		.def("setLedIntensity", &Thymio2Wrap::setLedIntensity)
 		.def("setLedColor", &Thymio2Wrap::setLedColor)
 		.def_readonly("proximitySensorValues", &Thymio2Wrap::getProxSensorValues)
 		.def_readonly("proximitySensorDistances", &Thymio2Wrap::getProxSensorDistances)
 		.def_readonly("groundSensorValues", &Thymio2Wrap::getGroundSensorValues)
+		.add_property("proximitySensorValuesView", &Thymio2Wrap::getProxSensorValuesView, "View on the 7 values of infrared sensors, updated at every control step")
+		.add_property("proximitySensorDistancesView", &Thymio2Wrap::getProxSensorDistancesView, "View on the 7 distances of infrared sensors, updated at every control step")
+		.add_property("groundSensorValuesView", &Thymio2Wrap::getGroundSensorValuesView, "View on the 2 values of ground sensors, updated at every control step")
 	;
 	
 	// World
 	
-	class_<World>("WorldBase", no_init)
+	class_<World, boost::noncopyable>("WorldBase", no_init)
 	;
 	
 	class_<WorldWithoutObjectsOwnership, bases<World> >("World",
@@ -549,19 +1685,127 @@ BOOST_PYTHON_MODULE(pyenki)
 		,
 		init<double, double, optional<const Color&> >(args("width", "height", "wallsColor"))
 	)
+		// overloads are tried from the last one, so that the other constructors take precedence
+		.def("__init__", make_constructor(&WorldPickleSuite<WorldWithoutObjectsOwnership>::construct, default_call_policies(), args("walls")),
+			"Create a world from the walls and ground texture returned by __getinitargs__(), used by pickle")
 		.def(init<double, optional<const Color&> >(args("r", "wallsColor")))
 		.def(init<>())
+		.def_pickle(WorldPickleSuite<WorldWithoutObjectsOwnership>())
 		.def("step", &World::step, step_overloads(args("dt", "physicsOversampling")))
 		.def("addObject", &World::addObject, with_custodian_and_ward<1,2>())
 		.def("removeObject", &World::removeObject)
 		.def("setRandomSeed", &World::setRandomSeed)
 		.def("run", run)
+		.add_property("objectStatesView", &WorldWithoutObjectsOwnership::getObjectStatesView,
+			"View on x, y, angle, speed x, speed y and angular speed of all objects, one row per object in their order of creation, updated after every step.\n"
+			"When objects are added or removed, the view becomes stale and converting it raises BufferError, access this property again to get a new one.")
+		.def("stepBatch", &WorldWithoutObjectsOwnership::stepBatch, (arg("self"), arg("steps"), arg("commands") = object(), arg("dt") = 1./30., arg("physicsOversampling") = 3),
+			"Apply commands to all robots, then run steps without calling Python controllers and with other Python threads running, and return batchSensorsView.\n"
+			"If commands is None, use the values of batchCommandsView; otherwise it must hold one record of batchCommandsView per robot, for instance an array of float64 of shape (robots, 110).")
+		.add_property("batchSensorsView", &WorldWithoutObjectsOwnership::getBatchSensorsView,
+			"View on the sensors of all robots, one record per robot in their order of creation, with fields x, y, angle, leftEncoder, rightEncoder, proximitySensorValues[8], proximitySensorDistances[8] and groundSensorValues[2].\n"
+			"Sensors a robot does not have are NaN. The view is updated by stepBatch() until robots are added or removed, it then becomes stale and converting it raises BufferError, access this property again to get a new one.")
+		.add_property("batchCommandsView", &WorldWithoutObjectsOwnership::getBatchCommandsView,
+			"Writable view on the commands applied to all robots by stepBatch(), one record per robot in their order of creation, with fields leftSpeed, rightSpeed and ledColors[27][4], the RGBA colors of LEDs of Thymio II.\n"
+			"When robots are added or removed, stepBatch() stops reading the view, which becomes stale and raises BufferError when converted, access this property again to get a new one.")
 		.def("runInViewer", runInViewer, runInViewer_overloads(args("self", "camPos", "camAltitude", "camYaw", "camPitch", "wallsHeight")))
 	;
 	
+	class_<VecWorld, boost::noncopyable>("VecWorld",
+		"Copies of a world stepped in lockstep by a pool of threads, for reinforcement learning.\n"
+		"The world is copied count times with its current state, Python controlStep() methods are not called in copies.\n"
+		"At every reset, a copy is restored to this state, its movable objects are moved by up to positionJitter on each axis and rotated by up to angleJitter, and its random generator is reseeded; copy i draws from seed + i.\n"
+		"Sensors are only updated by stepping, observations after a reset contain the sensors of the world when the copies were created, so step it once before.\n"
+		"The reward is fixed to the mean distance travelled by the robots of a copy during the step, compute task-specific rewards in Python from observationsView.\n"
+		"Episodes end after maxSteps steps, or when Python sets the flag of a copy in terminateView, which resets the copy at the next step."
+		,
+		init<const World&, size_t, optional<unsigned, double, double, unsigned long, unsigned> >(args("world", "count", "maxSteps", "positionJitter", "angleJitter", "seed", "threads"))
+	)
+		.def("__len__", &VecWorld::size)
+		.def("reset", &VecWorld::reset, "Reset all copies and return observationsView")
+		.def("step", &VecWorld::step, (arg("self"), arg("actions") = object(), arg("dt") = 1./30., arg("physicsOversampling") = 3),
+			"Apply actions, or the ones of actionsView if None, step all copies once and return (observationsView, rewardsView, donesView).\n"
+			"Copies whose flag is set in terminateView are reset before stepping and their flag is cleared, their done flag is not set.\n"
+			"Copies whose episode reached maxSteps are reset, and their observations are the ones after the reset.")
+		.def_readonly("robotCount", &VecWorld::robotCount)
+		.add_property("observationsView", &VecWorld::getObservationsView, "View on the sensors of robots, of shape (copies, robots), with the records of World.batchSensorsView")
+		.add_property("actionsView", &VecWorld::getActionsView, "Writable view on the commands of robots, of shape (copies, robots), with the records of World.batchCommandsView")
+		.add_property("rewardsView", &VecWorld::getRewardsView, "View on the mean distance travelled by the robots of every copy during the last step")
+		.add_property("donesView", &VecWorld::getDonesView, "View on whether the episode of every copy ended at the last step")
+		.add_property("terminateView", &VecWorld::getTerminatesView, "Writable view on flags ending the episode of every copy, for instance when Python detects that its task is done; the next step() resets these copies and clears their flag")
+		.add_property("episodeStepsView", &VecWorld::getEpisodeStepsView, "View on the number of steps of the current episode of every copy")
+	;
+	
+	class_<TrajectoryRecorder, boost::noncopyable> trajectoryRecorder("TrajectoryRecorder",
+		"Record the objects present in a world after each of its steps into a memory-mapped columnar file, read it with the enkitrajectory module.\n"
+		"channels combines CHANNEL_POSE, CHANNEL_SPEED, CHANNEL_WHEELS, CHANNEL_IR and CHANNEL_CAMERA with |, chunkRows is the number of rows per chunk of the file.\n"
+		"If deltaEncoding is True, doubles are stored as single precision differences to the previous row, halving the size of the file."
+		,
+		init<World*, const std::string&, optional<unsigned, unsigned, bool> >(args("world", "fileName", "channels", "chunkRows", "deltaEncoding"))[with_custodian_and_ward<1,2>()]
+	);
+	trajectoryRecorder
+		.def("record", &TrajectoryRecorder::record, args("time"), "Append a row with the current state of objects, at the given time")
+		.def("close", &TrajectoryRecorder::close, "Stop recording and close the file")
+		.add_property("rowCount", &TrajectoryRecorder::getRowCount)
+		.add_property("objectCount", &TrajectoryRecorder::getObjectCount)
+		.add_property("error", make_function(&TrajectoryRecorder::getError, return_value_policy<copy_const_reference>()), "Why recording stopped during a step, for instance because the disk is full, or an empty string")
+	;
+	trajectoryRecorder.attr("CHANNEL_POSE") = unsigned(TrajectoryRecorder::CHANNEL_POSE);
+	trajectoryRecorder.attr("CHANNEL_SPEED") = unsigned(TrajectoryRecorder::CHANNEL_SPEED);
+	trajectoryRecorder.attr("CHANNEL_WHEELS") = unsigned(TrajectoryRecorder::CHANNEL_WHEELS);
+	trajectoryRecorder.attr("CHANNEL_IR") = unsigned(TrajectoryRecorder::CHANNEL_IR);
+	trajectoryRecorder.attr("CHANNEL_CAMERA") = unsigned(TrajectoryRecorder::CHANNEL_CAMERA);
+	trajectoryRecorder.attr("CHANNELS_ALL") = unsigned(TrajectoryRecorder::CHANNELS_ALL);
+	
+	class_<InputJournal, boost::noncopyable>("InputJournal",
+		"Journal of the inputs applied to a world, by Python code between steps or by controllers, to replay its run exactly.\n"
+		"Replays do not call controllers, and are bit-exact as long as controllers set commands before the base control step, which is the case of Python ones."
+	)
+		.def("startRecording", &InputJournal::startRecording, with_custodian_and_ward<1,2>(), args("world"),
+			"Clear the journal, copy world and record its inputs at every step until stopRecording()")
+		.def("stopRecording", &InputJournal::stopRecording)
+		.add_property("isRecording", &InputJournal::isRecording)
+		.add_property("stepCount", &InputJournal::getStepCount)
+		.add_property("eventCount", getJournalEventCount)
+		.def("replay", replayJournal, return_value_policy<manage_new_object>(), (arg("self"), arg("steps") = std::numeric_limits<unsigned>::max()),
+			"Return a new World as it was when the recording started, stepped with the recorded inputs for steps steps, or all recorded steps, at full speed")
+	;
+	
+	class_<Scene, boost::noncopyable>("Scene",
+		"Description of a world and its objects, read from a text file or mapped from its binary form, see Scene.h for the syntax",
+		init<const std::string&>(args("fileName"))
+	)
+		.def("save", &Scene::save, args("fileName"),
+			"Write the binary form of this scene, which loads without parsing")
+		.add_property("objectCount", getSceneObjectCount)
+		.def("createWorld", createSceneWorld, return_value_policy<manage_new_object>(),
+			"Return a new World with the walls, ground and objects of this scene; its objects are only reachable through the views of the world")
+	;
+	
+	class_<TopViewRenderer, boost::noncopyable>("TopViewRenderer",
+		"Software renderer of worlds seen from above, without display nor GPU, for instance to write videos of runs.\n"
+		"It draws the ground, walls, objects and optionally the rays of IR sensors into an RGBA image whose first row is the highest y.",
+		init<unsigned, unsigned>(args("width", "height"))
+	)
+		.def("render", renderTopView, args("world"),
+			"Render world and return imageView")
+		.def("setView", &TopViewRenderer::setView, args("xMin", "yMin", "xMax", "yMax"),
+			"Show this rectangle of worlds, keeping the aspect ratio")
+		.def("fitWorld", &TopViewRenderer::fitWorld,
+			"Show whole worlds, the default")
+		.add_property("imageView", getTopViewImage, "View of shape (height, width, 4) on the bytes of the image, updated by render()")
+		.add_property("width", &TopViewRenderer::getWidth)
+		.add_property("height", &TopViewRenderer::getHeight)
+		.def_readwrite("drawSensorRays", &TopViewRenderer::drawSensorRays)
+		.def_readwrite("backgroundColor", &TopViewRenderer::backgroundColor)
+	;
+	
 	class_<WorldWithTexturedGround, bases<WorldWithoutObjectsOwnership> >("WorldWithTexturedGround",
 		init<double, double, const std::string&, optional<const Color&> >(args("width", "height", "ppmFileName", "wallsColor"))
 	)
+		.def("__init__", make_constructor(&WorldPickleSuite<WorldWithTexturedGround>::construct, default_call_policies(), args("walls")),
+			"Create a world from the walls and ground texture returned by __getinitargs__(), used by pickle")
 		.def(init<double, const std::string&, optional<const Color&> >(args("r", "ppmFileName", "wallsColor")))
+		.def_pickle(WorldPickleSuite<WorldWithTexturedGround>())
 	;
 }
@@ -0,0 +1,109 @@
+"""Reader of the trajectory files written by Enki::TrajectoryRecorder, with NumPy.
+
+A file holds a header, the description of its columns and the uids of the
+recorded objects, followed by fixed-size chunks of rows. Within a chunk, each
+column is an array of shape (chunkRows, objects, width). Files can be read
+while being written: rows are only visible once complete, call refresh() to
+see the rows written since the file was opened.
+
+	trajectory = enkitrajectory.Trajectory('run.trj')
+	poses = trajectory['pose'] # shape (rows, objects, 3): x, y, angle
+	images = trajectory['camera'] # shape (rows, objects, pixels, 4) of uint8
+"""
+
+import os
+import struct
+import numpy
+
+# must match TrajectoryRecorder::FileHeader and TrajectoryRecorder::ColumnHeader
+_FILE_HEADER = struct.Struct('=8sIIQIIIIQ')
+_COLUMN_HEADER = struct.Struct('=16sIIIIQQ')
+_ROW_COUNT_OFFSET = 40
+
+_TYPES = {ord('d'): numpy.float64, ord('f'): numpy.float32, ord('B'): numpy.uint8}
+
+
+class Column(object):
+	"""Description of a column: name, type ('d', 'f' for delta-encoded doubles, or 'B'), count of objects, width per object and offsets in a chunk"""
+
+	def __init__(self, data):
+		name, self.type, self.count, self.width, _, self.keyOffset, self.offset = _COLUMN_HEADER.unpack(data)
+		self.name = name.split(b'\0', 1)[0].decode('ascii')
+		self.type = chr(self.type)
+
+
+class Trajectory(object):
+	"""Trajectory file, whose columns are read as NumPy arrays with trajectory[name]"""
+
+	def __init__(self, fileName):
+		self.fileName = fileName
+		with open(fileName, 'rb') as f:
+			header = f.read(_FILE_HEADER.size)
+			magic, self.version, self.headerSize, self.chunkSize, self.chunkRows, objectCount, columnCount, _, _ = _FILE_HEADER.unpack(header)
+			if magic.split(b'\0', 1)[0] != b'ENKITRJ' or self.version != 1:
+				raise ValueError('%s is not a trajectory file of version 1' % fileName)
+			self.columns = [Column(f.read(_COLUMN_HEADER.size)) for _ in range(columnCount)]
+			self.uids = numpy.frombuffer(f.read(4 * objectCount), dtype=numpy.uint32)
+		self._map = None
+		self.rowCount = 0
+		self.refresh()
+
+	def refresh(self):
+		"""Update rowCount and the mapping of the file with the rows written so far, return rowCount"""
+		size = os.path.getsize(self.fileName)
+		if self._map is None or self._map.size != size:
+			self._map = numpy.memmap(self.fileName, dtype=numpy.uint8, mode='r', shape=(size,))
+		rowCount = int(self._map[_ROW_COUNT_OFFSET:_ROW_COUNT_OFFSET + 8].view(numpy.uint64)[0])
+		# the writer grows the file before publishing rows, but another mapping might be older
+		chunks = (size - self.headerSize) // self.chunkSize
+		self.rowCount = min(rowCount, chunks * self.chunkRows)
+		return self.rowCount
+
+	def names(self):
+		"""Return the names of the columns"""
+		return [column.name for column in self.columns]
+
+	def column(self, name):
+		"""Return the description of column name"""
+		for column in self.columns:
+			if column.name == name:
+				return column
+		raise KeyError(name)
+
+	def _chunk(self, column, index, rows):
+		"""Return the first rows of column in chunk of index, decoded to float64 if delta-encoded"""
+		begin = self.headerSize + index * self.chunkSize
+		rowSize = column.count * column.width
+		dtype = _TYPES[ord(column.type)]
+		values = numpy.ndarray((rows, rowSize), dtype=dtype, buffer=self._map, offset=begin + column.offset)
+		if column.type != 'f':
+			return values
+		key = numpy.ndarray((1, rowSize), dtype=numpy.float64, buffer=self._map, offset=begin + column.keyOffset)
+		# accumulate sequentially from the key, in the order the writer did
+		return numpy.cumsum(numpy.concatenate((key, values.astype(numpy.float64))), axis=0)[1:]
+
+	def __getitem__(self, name):
+		"""Return a copy of the rows of column name, of shape (rows,) for time, (rows, objects, pixels, 4) for camera and (rows, objects, width) otherwise"""
+		column = self.column(name)
+		chunks = []
+		for index in range((self.rowCount + self.chunkRows - 1) // self.chunkRows):
+			rows = min(self.chunkRows, self.rowCount - index * self.chunkRows)
+			chunks.append(self._chunk(column, index, rows))
+		dtype = numpy.float64 if column.type != 'B' else numpy.uint8
+		values = numpy.concatenate(chunks) if chunks else numpy.empty((0, column.count * column.width), dtype=dtype)
+		if name == 'time':
+			return values.reshape(-1)
+		if name == 'camera':
+			return values.reshape(-1, column.count, column.width // 4, 4)
+		return values.reshape(-1, column.count, column.width)
+
+	def __len__(self):
+		return self.rowCount
+
+
+def load(fileName):
+	"""Return a dictionary of all columns of a trajectory file, and of the uids of its objects"""
+	trajectory = Trajectory(fileName)
+	result = dict((name, trajectory[name]) for name in trajectory.names())
+	result['uids'] = trajectory.uids.copy()
+	return result
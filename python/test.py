@@ -21,4 +21,26 @@ w.addObject(e)
 
 for i in range(10):
 	w.step(0.05)
-	print ''
\ No newline at end of file
+	print ''
+
+# views on batches become stale when robots are added after taking them
+import numpy
+w = pyenki.World(100, 100)
+first = pyenki.EPuck()
+w.addObject(first)
+sensorsView = w.batchSensorsView
+commandsView = w.batchCommandsView
+assert numpy.asarray(sensorsView).shape == (1,) and numpy.asarray(commandsView).shape == (1,)
+for i in range(100):
+	e = pyenki.EPuck()
+	e.pos = (5 + (i % 10) * 9, 5 + (i // 10) * 9)
+	w.addObject(e)
+w.stepBatch(10)
+for view in (sensorsView, commandsView):
+	try:
+		numpy.asarray(view)
+		assert False, 'stale view was converted'
+	except BufferError:
+		pass
+assert numpy.asarray(w.batchSensorsView).shape == (101,)
+assert numpy.asarray(w.batchCommandsView).shape == (101,)
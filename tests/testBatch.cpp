@@ -0,0 +1,165 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#include "../enki/PhysicalEngine.h"
+#include "../enki/WorldBatch.h"
+#include "../enki/robots/e-puck/EPuck.h"
+#include <iostream>
+#include <stdexcept>
+
+using namespace Enki;
+using namespace std;
+
+#define CHECK(cond, message) \
+	if (!(cond)) { \
+		cerr << #cond << " failed: " << message << endl; \
+		exit(1); \
+	}
+
+//! Create a world of noisy e-pucks depending on seed
+World* createWorld(size_t seed)
+{
+	World* world = new World(40, 40);
+	world->setRandomSeed(seed);
+	for (unsigned i = 0; i < 6; ++i)
+	{
+		EPuck* epuck = new EPuck;
+		epuck->pos = Point(5 + Enki::random.getRange(30), 5 + Enki::random.getRange(30));
+		epuck->angle = Enki::random.getRange(6);
+		epuck->leftSpeed = 10;
+		epuck->rightSpeed = 8;
+		world->addObject(epuck);
+	}
+	return world;
+}
+
+//! Record the poses of all objects
+vector<double> recordWorld(World* world)
+{
+	vector<double> record;
+	for (World::ObjectsIterator it = world->objects.begin(); it != world->objects.end(); ++it)
+	{
+		record.push_back((*it)->pos.x);
+		record.push_back((*it)->pos.y);
+		record.push_back((*it)->angle);
+	}
+	return record;
+}
+
+void testRunMatchesSequential()
+{
+	const size_t worldCount = 12;
+	const unsigned steps = 50;
+	
+	// reference, stepped sequentially in this thread
+	vector<vector<double> > references;
+	for (size_t i = 0; i < worldCount; ++i)
+	{
+		World* world = createWorld(i);
+		for (unsigned step = 0; step < steps; ++step)
+			world->step(0.1, 2);
+		references.push_back(recordWorld(world));
+		delete world;
+	}
+	
+	for (unsigned pin = 0; pin < 2; ++pin)
+	{
+		for (unsigned lockstep = 0; lockstep < 2; ++lockstep)
+		{
+			WorldBatch batch(4, pin);
+			CHECK(batch.getThreadCount() == 4, "batch has " << batch.getThreadCount() << " threads");
+			CHECK(batch.createWorlds(worldCount, createWorld) == 0, "first world is not at index 0");
+			if (lockstep)
+			{
+				for (unsigned step = 0; step < steps; ++step)
+					CHECK(batch.step(0.1, 2) == worldCount, "worlds stopped in lockstep at step " << step);
+			}
+			else
+				batch.run(steps, 0.1, 2);
+			for (size_t i = 0; i < worldCount; ++i)
+			{
+				CHECK(batch.getStepCount(i) == steps, "world " << i << " did " << batch.getStepCount(i) << " steps");
+				CHECK(recordWorld(batch.getWorld(i)) == references[i], "world " << i << " diverged from sequential stepping, pin " << pin << ", lockstep " << lockstep);
+			}
+		}
+	}
+}
+
+void testCallbacks()
+{
+	WorldBatch batch(3);
+	vector<unsigned> calls(5, 0);
+	for (size_t i = 0; i < calls.size(); ++i)
+	{
+		// world i stops after i + 1 steps
+		unsigned* worldCalls = &calls[i];
+		const unsigned lastStep = i + 1;
+		batch.addWorld(createWorld(i), [worldCalls, lastStep](World* world, unsigned step) {
+			++(*worldCalls);
+			return step < lastStep;
+		});
+	}
+	
+	CHECK(batch.step(0.1) == calls.size() - 1, "world 0 did not stop after its first step");
+	batch.run(100, 0.1);
+	for (size_t i = 0; i < calls.size(); ++i)
+	{
+		CHECK(calls[i] == i + 1, "callback of world " << i << " was called " << calls[i] << " times");
+		CHECK(batch.getStepCount(i) == i + 1, "world " << i << " did " << batch.getStepCount(i) << " steps");
+		CHECK(!batch.isRunning(i), "world " << i << " is still running");
+	}
+	CHECK(batch.step(0.1) == 0, "stopped worlds were stepped");
+	
+	// exceptions thrown by callbacks are forwarded
+	const size_t index = batch.addWorld(createWorld(10), [](World* world, unsigned step) -> bool { throw runtime_error("stop"); });
+	bool thrown = false;
+	try
+	{
+		batch.run(10, 0.1);
+	}
+	catch (const runtime_error&)
+	{
+		thrown = true;
+	}
+	CHECK(thrown, "exception of callback was not forwarded");
+	CHECK(batch.getStepCount(index) == 1, "world continued after its callback threw");
+}
+
+int main()
+{
+	testRunMatchesSequential();
+	testCallbacks();
+	
+	return 0;
+}
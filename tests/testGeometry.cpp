@@ -33,6 +33,7 @@
 
 #include "../enki/Geometry.h"
 #include <iostream>
+#include <vector>
 
 using namespace Enki;
 using namespace std;
@@ -190,10 +191,47 @@ void testSegmentSegmentIntersection()
 	CHECK_INTERSECT_SEGMENT_SEGMENT(null1.doesIntersect(null0, &intersectionPoint), false, Point(0,0));
 }
 
+void testSinCos()
+{
+	// compare to the standard library on ranges of increasing size, up to the documented bound
+	const size_t count = 10000;
+	vector<double> angles(count), sines(count), cosines(count);
+	for (double range = M_PI; range <= 1e6; range *= 10)
+	{
+		for (size_t i = 0; i < count; ++i)
+			angles[i] = range * (2. * i / (count - 1) - 1.);
+		sinCos(&angles[0], &sines[0], &cosines[0], count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			if ((fabs(sines[i] - sin(angles[i])) > 5e-16) || (fabs(cosines[i] - cos(angles[i])) > 5e-16))
+			{
+				cerr << "sinCos(" << angles[i] << ") returned " << sines[i] << ", " << cosines[i] << " instead of " << sin(angles[i]) << ", " << cos(angles[i]) << endl;
+				exit(3);
+			}
+		}
+	}
+	
+	// exact values at quadrant boundaries
+	const double special[] = { 0., M_PI_2, -M_PI_2, M_PI };
+	const double expectedSines[] = { 0., 1., -1., 0. };
+	const double expectedCosines[] = { 1., 0., 0., -1. };
+	double specialSines[4], specialCosines[4];
+	sinCos(special, specialSines, specialCosines, 4);
+	for (size_t i = 0; i < 4; ++i)
+	{
+		if ((fabs(specialSines[i] - expectedSines[i]) > 5e-16) || (fabs(specialCosines[i] - expectedCosines[i]) > 5e-16))
+		{
+			cerr << "sinCos(" << special[i] << ") returned " << specialSines[i] << ", " << specialCosines[i] << endl;
+			exit(3);
+		}
+	}
+}
+
 int main()
 {
 	testPolygonCircleIntersection();
 	testSegmentSegmentIntersection();
+	testSinCos();
 	
 	return 0;
 }
@@ -0,0 +1,219 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#include "../enki/PhysicalEngine.h"
+#include "../enki/InputJournal.h"
+#include "../enki/robots/e-puck/EPuck.h"
+#include "../enki/robots/thymio2/Thymio2.h"
+#include "../enki/interactions/Bluetooth.h"
+#include <iostream>
+#include <typeinfo>
+#include <memory>
+
+using namespace Enki;
+using namespace std;
+
+#define CHECK(cond, message) \
+	if (!(cond)) { \
+		cerr << #cond << " failed: " << message << endl; \
+		exit(1); \
+	}
+
+//! An e-puck avoiding obstacles and sending its step count to a peer over Bluetooth
+class Wanderer: public EPuck
+{
+public:
+	Wanderer* peer;
+	unsigned count;
+	
+	Wanderer():
+		EPuck(CAPABILITY_BASIC_SENSORS | CAPABILITY_CAMERA | CAPABILITY_BLUETOOTH),
+		peer(0),
+		count(0)
+	{}
+	
+	virtual void controlStep(double dt)
+	{
+		const double front(infraredSensor0.getValue() + infraredSensor7.getValue());
+		leftSpeed = 10;
+		rightSpeed = front > 1000 ? -5 : 10;
+		setLedRing(front > 1000);
+		if (peer)
+		{
+			if (count == 0)
+				bluetooth->connectTo(peer->bluetooth->getAddress());
+			char message[4] = { char(count), 0, 0, 0 };
+			bluetooth->sendDataTo(peer->bluetooth->getAddress(), message, 4);
+		}
+		++count;
+		EPuck::controlStep(dt);
+	}
+};
+
+//! A Thymio II turning and blinking
+class Blinker: public Thymio2
+{
+public:
+	unsigned count;
+	
+	Blinker(): count(0) {}
+	
+	virtual void controlStep(double dt)
+	{
+		leftSpeed = 5 + (count % 7);
+		rightSpeed = 8;
+		setLedColor(TOP, (count / 5) % 2 ? Color::red : Color::blue);
+		++count;
+		Thymio2::controlStep(dt);
+	}
+};
+
+//! Return the dynamic state of all objects of world, without their uids
+vector<vector<uint8_t> > objectStates(const World* world)
+{
+	vector<vector<uint8_t> > states;
+	for (World::Objects::const_iterator it = world->objects.begin(); it != world->objects.end(); ++it)
+	{
+		states.push_back(vector<uint8_t>());
+		StateWriter writer(states.back());
+		(*it)->saveState(writer);
+	}
+	return states;
+}
+
+void testReplay()
+{
+	World world(80, 80);
+	world.initBluetoothBase();
+	world.setRandomSeed(3);
+	vector<Wanderer*> wanderers;
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		Wanderer* wanderer = new Wanderer;
+		wanderer->pos = Point(15 + 15 * i, 20 + 10 * (i % 2));
+		wanderer->angle = i;
+		world.addObject(wanderer);
+		wanderers.push_back(wanderer);
+	}
+	wanderers[0]->peer = wanderers[1];
+	Blinker* blinker = new Blinker;
+	blinker->pos = Point(40, 60);
+	world.addObject(blinker);
+	
+	InputJournal journal;
+	journal.startRecording(&world);
+	bool thrown = false;
+	try
+	{
+		journal.startRecording(&world);
+	}
+	catch (const runtime_error&)
+	{
+		thrown = true;
+	}
+	CHECK(thrown, "a world was recorded by two journals");
+	
+	const unsigned steps = 150;
+	vector<vector<uint8_t> > statesAt100;
+	for (unsigned step = 0; step < steps; ++step)
+	{
+		// external inputs, as a remote client would apply them
+		if (step % 20 == 10)
+		{
+			wanderers[3]->pos = Point(10 + step % 50, 60);
+			wanderers[3]->angle += 1;
+		}
+		if (step == 30)
+			blinker->setColor(Color::green);
+		if (step == 50)
+			world.setRandomSeed(7);
+		if (step == 60)
+		{
+			PhysicalObject* box = new PhysicalObject;
+			box->setRectangular(5, 5, 5, 100);
+			box->pos = Point(40, 40);
+			world.addObject(box);
+		}
+		if (step == 80)
+		{
+			world.removeObject(wanderers[2]);
+			delete wanderers[2];
+		}
+		world.step(0.1, step < 100 ? 3 : 2);
+		if (step == 99)
+			statesAt100 = objectStates(&world);
+	}
+	const vector<vector<uint8_t> > finalStates(objectStates(&world));
+	journal.stopRecording();
+	world.step(0.1);
+	CHECK(journal.getStepCount() == steps, "journal has " << journal.getStepCount() << " steps");
+	CHECK(world.inputJournal == 0, "world still has a journal");
+	CHECK(wanderers[1]->bluetooth->didIReceive(), "Bluetooth messages were not received");
+	
+	// the final state is reproduced without controllers
+	unique_ptr<World> replayed(journal.replay());
+	CHECK(replayed->objects.size() == world.objects.size(), "replayed world has " << replayed->objects.size() << " objects");
+	for (World::ObjectsIterator it = replayed->objects.begin(); it != replayed->objects.end(); ++it)
+		CHECK(typeid(**it) != typeid(Wanderer) && typeid(**it) != typeid(Blinker), "replayed world has controllers");
+	CHECK(objectStates(replayed.get()) == finalStates, "replay differs from recording");
+	
+	// replays can stop at any step
+	unique_ptr<World> partial(journal.replay(100));
+	CHECK(objectStates(partial.get()) == statesAt100, "replay of 100 steps differs from recording");
+	
+	// steps after stopRecording() are not recorded
+	CHECK(objectStates(&world) != finalStates, "last step made no difference");
+}
+
+void testStopOnDestruction()
+{
+	InputJournal journal;
+	{
+		World world(40, 40);
+		world.addObject(new EPuck);
+		journal.startRecording(&world);
+		world.step(0.1);
+	}
+	CHECK(!journal.isRecording(), "journal still records a destroyed world");
+	unique_ptr<World> replayed(journal.replay());
+	CHECK(replayed->objects.size() == 1, "replayed world has " << replayed->objects.size() << " objects");
+}
+
+int main()
+{
+	testReplay();
+	testStopOnDestruction();
+	
+	return 0;
+}
@@ -0,0 +1,520 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#include "../enki/PhysicalEngine.h"
+#include "../enki/robots/e-puck/EPuck.h"
+#include "../enki/robots/thymio2/Thymio2.h"
+#include <iostream>
+#include <thread>
+
+using namespace Enki;
+using namespace std;
+
+#define CHECK(cond, message) \
+	if (!(cond)) { \
+		cerr << #cond << " failed: " << message << endl; \
+		exit(1); \
+	}
+
+//! Create a frictionless ball of radius 1 at pos, moving with speed
+PhysicalObject* createBall(const Point& pos, const Vector& speed)
+{
+	PhysicalObject* ball = new PhysicalObject;
+	ball->setCylindric(1, 1, 1);
+	ball->dryFrictionCoefficient = 0;
+	ball->viscousFrictionCoefficient = 0;
+	ball->pos = pos;
+	ball->speed = speed;
+	return ball;
+}
+
+//! Create a static thin wall along y at x
+PhysicalObject* createThinWall(double x)
+{
+	PhysicalObject* wall = new PhysicalObject;
+	wall->setRectangular(0.5, 40, 5, -1);
+	wall->pos = Point(x, 0);
+	return wall;
+}
+
+void testAdaptiveOversamplingPreventsTunneling()
+{
+	World world;
+	world.adaptiveOversampling.enabled = true;
+	PhysicalObject* ball = createBall(Point(0, 0), Vector(300, 0));
+	world.addObject(ball);
+	world.addObject(createThinWall(50));
+	
+	for (unsigned i = 0; i < 10; ++i)
+		world.step(0.1);
+	
+	CHECK(ball->pos.x < 50, "ball went through the wall and is at " << ball->pos);
+	CHECK(ball->speed.x < 0, "ball did not bounce back, speed is " << ball->speed);
+}
+
+void testAdaptiveOversamplingIsolatedObjects()
+{
+	// isolated objects are integrated exactly as with a single physics step
+	World fixedWorld, adaptiveWorld;
+	adaptiveWorld.adaptiveOversampling.enabled = true;
+	PhysicalObject* fixedBall = createBall(Point(0, 0), Vector(10, 5));
+	PhysicalObject* adaptiveBall = createBall(Point(0, 0), Vector(10, 5));
+	fixedBall->dryFrictionCoefficient = adaptiveBall->dryFrictionCoefficient = 0.25;
+	fixedWorld.addObject(fixedBall);
+	adaptiveWorld.addObject(adaptiveBall);
+	fixedWorld.addObject(createBall(Point(100, 100), Vector(0, 0)));
+	adaptiveWorld.addObject(createBall(Point(100, 100), Vector(0, 0)));
+	
+	for (unsigned i = 0; i < 10; ++i)
+	{
+		fixedWorld.step(0.1, 1);
+		adaptiveWorld.step(0.1, 5);
+	}
+	
+	CHECK(fixedBall->pos == adaptiveBall->pos, "positions differ: " << fixedBall->pos << " and " << adaptiveBall->pos);
+	CHECK(fixedBall->speed == adaptiveBall->speed, "speeds differ: " << fixedBall->speed << " and " << adaptiveBall->speed);
+}
+
+void testAdaptiveOversamplingContacts()
+{
+	// two balls moving against each other in a square arena must not overlap much
+	World world(100, 100);
+	world.adaptiveOversampling.enabled = true;
+	PhysicalObject* ball1 = createBall(Point(30, 50), Vector(200, 0));
+	PhysicalObject* ball2 = createBall(Point(70, 50.3), Vector(-150, 0));
+	world.addObject(ball1);
+	world.addObject(ball2);
+	
+	for (unsigned i = 0; i < 100; ++i)
+	{
+		world.step(0.1);
+		const double dist = (ball1->pos - ball2->pos).norm();
+		CHECK(dist > 1.9, "balls overlap at step " << i << ", distance is " << dist);
+	}
+}
+
+void testImpulseSolverBounce()
+{
+	World world;
+	world.impulseSolver.enabled = true;
+	PhysicalObject* ball1 = createBall(Point(0, 0), Vector(50, 0));
+	PhysicalObject* ball2 = createBall(Point(10, 0), Vector(-50, 0));
+	world.addObject(ball1);
+	world.addObject(ball2);
+	
+	for (unsigned i = 0; i < 10; ++i)
+		world.step(0.1);
+	
+	CHECK(ball1->speed.x < -30 && ball2->speed.x > 30, "balls did not bounce, speeds are " << ball1->speed << " and " << ball2->speed);
+	CHECK((ball1->pos - ball2->pos).norm() > 2, "balls overlap at " << ball1->pos << " and " << ball2->pos);
+}
+
+void testImpulseSolverCrowd()
+{
+	// e-pucks all pushing towards the center of the arena
+	World world(200, 200);
+	world.impulseSolver.enabled = true;
+	vector<EPuck*> robots;
+	for (unsigned i = 0; i < 256; ++i)
+	{
+		EPuck* epuck = new EPuck(0);
+		epuck->pos = Point(47.5 + (i % 16) * 7, 47.5 + (i / 16) * 7);
+		epuck->leftSpeed = epuck->rightSpeed = 10;
+		world.addObject(epuck);
+		robots.push_back(epuck);
+	}
+	
+	vector<Point> lastPos(robots.size()), lastDisp(robots.size());
+	for (unsigned step = 0; step < 300; ++step)
+	{
+		for (size_t i = 0; i < robots.size(); ++i)
+			robots[i]->angle = (Point(100, 100) - robots[i]->pos).angle();
+		world.step(0.1, 1);
+		
+		// once the crowd is packed, it must neither jitter nor interpenetrate
+		for (size_t i = 0; i < robots.size(); ++i)
+		{
+			const Vector disp(robots[i]->pos - lastPos[i]);
+			if (step > 250)
+			{
+				CHECK((disp - lastDisp[i]).norm() < 0.1, "robot " << i << " jitters at step " << step << ", displacement changed from " << lastDisp[i] << " to " << disp);
+				for (size_t j = i + 1; j < robots.size(); ++j)
+				{
+					const double dist = (robots[i]->pos - robots[j]->pos).norm();
+					CHECK(dist > 2 * robots[i]->getRadius() - 0.1, "robots " << i << " and " << j << " overlap at step " << step << ", distance is " << dist);
+				}
+			}
+			lastDisp[i] = disp;
+			lastPos[i] = robots[i]->pos;
+		}
+	}
+}
+
+void testContinuousCollisionDetection()
+{
+	for (unsigned solver = 0; solver < 2; ++solver)
+	{
+		// fast ball against a thin static wall
+		World world;
+		world.continuousCollisionDetection.enabled = true;
+		world.impulseSolver.enabled = solver;
+		PhysicalObject* ball = createBall(Point(0, 0), Vector(300, 0));
+		world.addObject(ball);
+		world.addObject(createThinWall(50));
+		
+		for (unsigned i = 0; i < 10; ++i)
+			world.step(0.1, 1);
+		
+		CHECK(ball->pos.x < 50, "ball went through the wall and is at " << ball->pos << " with solver " << solver);
+		CHECK(ball->speed.x < 0, "ball did not bounce back, speed is " << ball->speed << " with solver " << solver);
+		
+		// fast ball against a slow one
+		World world2;
+		world2.continuousCollisionDetection.enabled = true;
+		world2.impulseSolver.enabled = solver;
+		PhysicalObject* fastBall = createBall(Point(0, 0), Vector(400, 0));
+		PhysicalObject* slowBall = createBall(Point(20, 0.5), Vector(-10, 0));
+		world2.addObject(fastBall);
+		world2.addObject(slowBall);
+		
+		world2.step(0.1, 1);
+		
+		CHECK(fastBall->pos.x < slowBall->pos.x, "fast ball went through the slow one, at " << fastBall->pos << " and " << slowBall->pos << " with solver " << solver);
+		CHECK(slowBall->speed.x > 0, "slow ball was not hit, speed is " << slowBall->speed << " with solver " << solver);
+		
+		// fast ball moving towards smaller x against a slow one, among balls away from its path
+		World world3;
+		world3.continuousCollisionDetection.enabled = true;
+		world3.impulseSolver.enabled = solver;
+		for (int i = 0; i < 40; ++i)
+			world3.addObject(createBall(Point(i * 5 - 100, 30), Vector()));
+		PhysicalObject* leftwardBall = createBall(Point(60, 0), Vector(-400, 0));
+		PhysicalObject* hitBall = createBall(Point(20, 0.5), Vector(10, 0));
+		world3.addObject(leftwardBall);
+		world3.addObject(hitBall);
+		
+		world3.step(0.1, 1);
+		
+		CHECK(leftwardBall->pos.x > hitBall->pos.x, "fast ball went through the slow one, at " << leftwardBall->pos << " and " << hitBall->pos << " with solver " << solver);
+		CHECK(hitBall->speed.x < 0, "slow ball was not hit, speed is " << hitBall->speed << " with solver " << solver);
+	}
+}
+
+void testBatchIntegration()
+{
+	// balls with friction and e-pucks colliding in an arena
+	vector<PhysicalObject*> objects;
+	for (unsigned i = 0; i < 16; ++i)
+	{
+		PhysicalObject* ball = new PhysicalObject;
+		ball->setCylindric(2, 1, 5);
+		ball->pos = Point(10 + (i % 4) * 12, 10 + (i / 4) * 12);
+		ball->speed = Vector(20 - i * 2.5, i * 1.5 - 10);
+		ball->angSpeed = i * 0.1 - 0.8;
+		objects.push_back(ball);
+	}
+	vector<EPuck*> robots;
+	for (unsigned i = 0; i < 16; ++i)
+	{
+		EPuck* epuck = new EPuck(0);
+		epuck->pos = Point(16 + (i % 4) * 12, 16 + (i / 4) * 12);
+		epuck->angle = i * 0.4;
+		objects.push_back(epuck);
+		robots.push_back(epuck);
+	}
+	vector<Point> initialPos(objects.size());
+	vector<Vector> initialSpeed(objects.size());
+	vector<double> initialAngle(objects.size()), initialAngSpeed(objects.size());
+	for (size_t i = 0; i < objects.size(); ++i)
+	{
+		initialPos[i] = objects[i]->pos;
+		initialSpeed[i] = objects[i]->speed;
+		initialAngle[i] = objects[i]->angle;
+		initialAngSpeed[i] = objects[i]->angSpeed;
+	}
+	
+	for (unsigned solver = 0; solver < 2; ++solver)
+	{
+		// run the same scene without and with batch integration, results must only differ by the rounding of sinCos() amplified by collisions
+		vector<Point> finalPos[2];
+		vector<double> finalAngle[2];
+		for (unsigned batch = 0; batch < 2; ++batch)
+		{
+			World world(60, 60);
+			world.takeObjectOwnership = false;
+			world.impulseSolver.enabled = solver;
+			world.batchIntegration = batch;
+			world.setRandomSeed(0);
+			for (size_t i = 0; i < objects.size(); ++i)
+			{
+				objects[i]->pos = initialPos[i];
+				objects[i]->speed = initialSpeed[i];
+				objects[i]->angle = initialAngle[i];
+				objects[i]->angSpeed = initialAngSpeed[i];
+				world.addObject(objects[i]);
+			}
+			for (size_t i = 0; i < robots.size(); ++i)
+			{
+				robots[i]->leftSpeed = 5 + i;
+				robots[i]->rightSpeed = 12 - (i % 3) * 4;
+			}
+			
+			for (unsigned step = 0; step < 100; ++step)
+				world.step(0.05, 3);
+			for (size_t i = 0; i < objects.size(); ++i)
+			{
+				finalPos[batch].push_back(objects[i]->pos);
+				finalAngle[batch].push_back(objects[i]->angle);
+			}
+			
+			// stop robots, so that the next run starts with the same commands
+			for (size_t i = 0; i < robots.size(); ++i)
+				robots[i]->leftSpeed = robots[i]->rightSpeed = 0;
+			world.step(0.05, 3);
+		}
+		
+		for (size_t i = 0; i < objects.size(); ++i)
+		{
+			CHECK(!(finalPos[1][i] == initialPos[i]), "object " << i << " did not move with solver " << solver);
+			CHECK((finalPos[0][i] - finalPos[1][i]).norm() < 1e-5 && fabs(finalAngle[0][i] - finalAngle[1][i]) < 1e-5, "object " << i << " is at " << finalPos[1][i] << " with batch integration instead of " << finalPos[0][i] << " with solver " << solver);
+		}
+	}
+	
+	for (size_t i = 0; i < objects.size(); ++i)
+		delete objects[i];
+}
+
+//! An e-puck whose wheels are blocked, by overriding applyForces()
+class BlockedEPuck: public EPuck
+{
+protected:
+	virtual void applyForces(double dt)
+	{
+		speed = Vector(0, 0);
+		angSpeed = 0;
+	}
+};
+
+void testBatchIntegrationCustomDynamics()
+{
+	// subclasses overriding applyForces() must not be integrated in batch
+	World world(60, 60);
+	world.batchIntegration = true;
+	BlockedEPuck* blocked = new BlockedEPuck;
+	blocked->pos = Point(20, 30);
+	blocked->leftSpeed = blocked->rightSpeed = 10;
+	world.addObject(blocked);
+	EPuck* epuck = new EPuck;
+	epuck->pos = Point(40, 30);
+	epuck->leftSpeed = epuck->rightSpeed = 10;
+	world.addObject(epuck);
+	
+	for (unsigned step = 0; step < 10; ++step)
+		world.step(0.05, 3);
+	CHECK(blocked->pos == Point(20, 30), "e-puck overriding applyForces() moved to " << blocked->pos << " with batch integration");
+	CHECK(!(epuck->pos == Point(40, 30)), "e-puck did not move with batch integration");
+}
+
+//! Record the poses of all objects and some sensor values of e-pucks
+vector<double> recordWorld(World& world)
+{
+	vector<double> record;
+	for (World::ObjectsIterator it = world.objects.begin(); it != world.objects.end(); ++it)
+	{
+		record.push_back((*it)->pos.x);
+		record.push_back((*it)->pos.y);
+		record.push_back((*it)->angle);
+		EPuck* epuck = dynamic_cast<EPuck*>(*it);
+		if (epuck)
+		{
+			record.push_back(epuck->infraredSensor0.getValue());
+			record.push_back(epuck->infraredSensor7.getValue());
+		}
+	}
+	return record;
+}
+
+//! Add noisy robots and balls that collide together to world
+void populateWorld(World& world)
+{
+	for (unsigned i = 0; i < 8; ++i)
+	{
+		EPuck* epuck = new EPuck;
+		epuck->pos = Point(10 + i * 6, 20 + (i % 2) * 3);
+		epuck->angle = i;
+		epuck->leftSpeed = 10;
+		epuck->rightSpeed = 5 + i;
+		world.addObject(epuck);
+	}
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		Thymio2* thymio = new Thymio2;
+		thymio->pos = Point(10 + i * 12, 45);
+		thymio->leftSpeed = 8;
+		thymio->rightSpeed = -2;
+		world.addObject(thymio);
+	}
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		PhysicalObject* ball = new PhysicalObject;
+		ball->setCylindric(2, 1, 5);
+		ball->pos = Point(15 + i * 10, 32);
+		ball->speed = Vector(10, 3 - 2. * i);
+		world.addObject(ball);
+	}
+}
+
+void testSaveRestoreState()
+{
+	// with cached contacts
+	World world(60, 60);
+	world.impulseSolver.enabled = true;
+	world.setRandomSeed(1);
+	populateWorld(world);
+	
+	for (unsigned step = 0; step < 50; ++step)
+		world.step(0.1, 2);
+	const vector<uint8_t> state(world.saveState());
+	
+	// run twice from the snapshot, results must be identical
+	vector<double> records[2];
+	for (unsigned run = 0; run < 2; ++run)
+	{
+		if (run > 0)
+			world.restoreState(state);
+		for (unsigned step = 0; step < 100; ++step)
+			world.step(0.1, 2);
+		records[run] = recordWorld(world);
+	}
+	CHECK(records[0] == records[1], "simulation diverged after restoring state");
+	
+	// invalid snapshots must leave the world unchanged
+	const vector<uint8_t> current(world.saveState());
+	vector<uint8_t> truncated(state.begin(), state.end() - 4);
+	vector<uint8_t> extended(state);
+	extended.push_back(0);
+	const vector<uint8_t>* invalidStates[] = { &truncated, &extended };
+	for (unsigned i = 0; i < 2; ++i)
+	{
+		bool invalidThrown = false;
+		try
+		{
+			world.restoreState(*invalidStates[i]);
+		}
+		catch (const std::runtime_error&)
+		{
+			invalidThrown = true;
+		}
+		CHECK(invalidThrown, "invalid state " << i << " was restored");
+		CHECK(world.saveState() == current, "restoring invalid state " << i << " changed the world");
+	}
+	
+	// snapshots cannot be restored into a world with different objects
+	world.addObject(createBall(Point(50, 50), Vector(0, 0)));
+	bool thrown = false;
+	try
+	{
+		world.restoreState(state);
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+	CHECK(thrown, "state was restored into a world with an additional object");
+}
+
+//! Step world for a number of steps
+void stepWorld(World* world, unsigned steps)
+{
+	for (unsigned step = 0; step < steps; ++step)
+		world->step(0.1, 2);
+}
+
+void testFork()
+{
+	World world(60, 60);
+	world.impulseSolver.enabled = true;
+	world.setRandomSeed(2);
+	populateWorld(world);
+	EPuck* talkingEPuck = new EPuck(EPuck::CAPABILITY_BASIC_SENSORS | EPuck::CAPABILITY_BLUETOOTH);
+	talkingEPuck->pos = Point(50, 10);
+	world.addObject(talkingEPuck);
+	stepWorld(&world, 20);
+	
+	World* forks[2] = { world.fork(), world.fork() };
+	
+	// shapes and textures are shared
+	CHECK(&forks[0]->groundTexture == &world.groundTexture, "ground texture is not shared");
+	for (World::ObjectsIterator it = world.objects.begin(), forkIt = forks[0]->objects.begin(); it != world.objects.end(); ++it, ++forkIt)
+	{
+		CHECK((*it)->uid == (*forkIt)->uid, "objects of the fork are in a different order");
+		if (!(*it)->isCylindric())
+			CHECK(&(*it)->getHull()[0].getShape() == &(*forkIt)->getHull()[0].getShape(), "hull of object " << (*it)->uid << " is not shared");
+	}
+	
+	// forks stepped concurrently give the same results as this world
+	std::thread threads[2];
+	for (unsigned i = 0; i < 2; ++i)
+		threads[i] = std::thread(stepWorld, forks[i], 100);
+	stepWorld(&world, 100);
+	for (unsigned i = 0; i < 2; ++i)
+		threads[i].join();
+	const vector<double> record(recordWorld(world));
+	for (unsigned i = 0; i < 2; ++i)
+		CHECK(recordWorld(*forks[i]) == record, "fork " << i << " diverged from its parent");
+	
+	// forks are independent
+	PhysicalObject* forkObject = *forks[0]->objects.begin();
+	forkObject->pos += Vector(1, 0);
+	CHECK(!(forkObject->pos == (*world.objects.begin())->pos), "moving an object of a fork moved the one of its parent");
+	delete forks[0];
+	delete forks[1];
+	stepWorld(&world, 1);
+}
+
+int main()
+{
+	testAdaptiveOversamplingPreventsTunneling();
+	testAdaptiveOversamplingIsolatedObjects();
+	testAdaptiveOversamplingContacts();
+	testImpulseSolverBounce();
+	testImpulseSolverCrowd();
+	testContinuousCollisionDetection();
+	testBatchIntegration();
+	testBatchIntegrationCustomDynamics();
+	testSaveRestoreState();
+	testFork();
+	
+	return 0;
+}
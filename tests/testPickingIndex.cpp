@@ -0,0 +1,181 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#include "../enki/PhysicalEngine.h"
+#include "../enki/PickingIndex.h"
+#include "../enki/Random.h"
+#include <iostream>
+#include <cmath>
+
+using namespace Enki;
+using namespace std;
+
+#define CHECK(cond, message) \
+	if (!(cond)) { \
+		cerr << #cond << " failed: " << message << endl; \
+		exit(1); \
+	}
+
+static PhysicalObject* addObject(World& world, double x, double y, double angle)
+{
+	PhysicalObject* object(new PhysicalObject);
+	object->pos = Point(x, y);
+	object->angle = angle;
+	world.addObject(object);
+	return object;
+}
+
+//! Rays looking straight down hit the ground where there is no object
+void testGround()
+{
+	World world(100, 100);
+	PickingIndex index;
+	index.build(&world);
+	
+	PickingIndex::Hit hit;
+	CHECK(index.pick(Ray(30, 40, 50, 0, 0, -1), hit), "hit ground");
+	CHECK(hit.object == 0, "ground is not an object");
+	CHECK(fabs(hit.point[0] - 30) < 1e-9 && fabs(hit.point[1] - 40) < 1e-9 && fabs(hit.point[2]) < 1e-9, "ground point");
+	CHECK(fabs(hit.t - 50) < 1e-9, "ray parameter");
+	CHECK(!index.pick(Ray(30, 40, 50, 0, 0, 1), hit), "ray looking up hits nothing");
+	CHECK(!index.pick(Ray(30, 40, 50, 0, 0, -1), hit, 10), "ground beyond maxT");
+}
+
+//! Cylinders and hulls are hit on their top and sides, rotated with their object
+void testShapes()
+{
+	World world(100, 100);
+	PhysicalObject* cylinder(addObject(world, 20, 20, 0));
+	cylinder->setCylindric(2, 5, 1);
+	PhysicalObject* box(addObject(world, 60, 60, M_PI / 2));
+	box->setRectangular(10, 2, 3, 1);
+	PickingIndex index;
+	index.build(&world);
+	CHECK(index.size() == 2, "two objects indexed");
+	
+	PickingIndex::Hit hit;
+	CHECK(index.pick(Ray(21, 20, 50, 0, 0, -1), hit) && hit.object == cylinder, "cylinder hit from above");
+	CHECK(fabs(hit.point[2] - 5) < 1e-9, "cylinder hit on its top");
+	CHECK(index.pick(Ray(23, 20, 50, 0, 0, -1), hit) && hit.object == 0, "beside cylinder");
+	CHECK(index.pick(Ray(23, 20, 50, 0, 0, -1), hit, 1e6, 1.5) && hit.object == cylinder, "cylinder with tolerance");
+	CHECK(index.pick(Ray(0, 20, 1, 1, 0, 0), hit) && hit.object == cylinder, "cylinder hit from the side");
+	CHECK(fabs(hit.point[0] - 18) < 1e-9, "cylinder hit on its side");
+	
+	// the box is 10 long along y once rotated
+	CHECK(index.pick(Ray(60, 64, 50, 0, 0, -1), hit) && hit.object == box, "rotated box hit");
+	CHECK(fabs(hit.point[2] - 3) < 1e-9, "box hit on its top");
+	CHECK(index.pick(Ray(64, 60, 50, 0, 0, -1), hit) && hit.object == 0, "beside rotated box");
+	CHECK(index.pick(Ray(60, 100, 1, 0, -1, 0), hit) && hit.object == box, "box hit from the side");
+	CHECK(fabs(hit.point[1] - 65) < 1e-9, "box hit on its side");
+	CHECK(index.pick(Ray(60, 100, 4, 0, -1, 0), hit) == false, "ray above box");
+	
+	// the closest object hides the other one
+	CHECK(index.pick(Ray(10, 10, 1, 1, 1, 0), hit) && hit.object == cylinder, "closest object hit first");
+	CHECK(index.pick(Ray(80, 80, 1, -1, -1, 0), hit) && hit.object == box, "closest object hit first, reversed");
+}
+
+//! Snapshots give the pose of objects
+void testSnapshot()
+{
+	World world(100, 100);
+	PhysicalObject* cylinder(addObject(world, 20, 20, 0));
+	cylinder->setCylindric(2, 5, 1);
+	WorldSnapshot snapshot;
+	snapshot.capture(&world);
+	cylinder->pos = Point(80, 80);
+	
+	PickingIndex index;
+	index.build(snapshot);
+	PickingIndex::Hit hit;
+	CHECK(index.pick(Ray(20, 20, 50, 0, 0, -1), hit) && hit.object == cylinder, "object at its captured pose");
+	CHECK(index.pick(Ray(80, 80, 50, 0, 0, -1), hit) && hit.object == 0, "not at its current pose");
+}
+
+//! The index finds the same objects as testing all of them
+void testAgainstBruteForce()
+{
+	World world(400, 400);
+	for (unsigned i = 0; i < 500; ++i)
+	{
+		PhysicalObject* object(addObject(world, Enki::random.getRange(400.), Enki::random.getRange(400.), Enki::random.getRange(2 * M_PI)));
+		if (i % 3)
+			object->setCylindric(0.5 + Enki::random.getRange(3.), 1 + Enki::random.getRange(5.), 1);
+		else
+			object->setRectangular(1 + Enki::random.getRange(6.), 1 + Enki::random.getRange(6.), 1 + Enki::random.getRange(5.), 1);
+	}
+	// a large object, not stored in cells
+	addObject(world, 200, 200, 0)->setCylindric(150, 0.5, -1);
+	WorldSnapshot snapshot;
+	snapshot.capture(&world);
+	PickingIndex index;
+	index.build(snapshot);
+	
+	for (unsigned i = 0; i < 200; ++i)
+	{
+		const double angle(Enki::random.getRange(2 * M_PI));
+		const Ray ray(Enki::random.getRange(400.), Enki::random.getRange(400.), 2 + Enki::random.getRange(50.), cos(angle), sin(angle), -Enki::random.getRange(1.));
+		PickingIndex::Hit hit;
+		const bool found(index.pick(ray, hit, 1e6, 0.2));
+		
+		// index each object alone
+		PhysicalObject* closest(0);
+		double closestT(ray.direction[2] < 0 ? -ray.origin[2] / ray.direction[2] : 1e6);
+		WorldSnapshot single;
+		single.objects.resize(1);
+		for (size_t j = 0; j < snapshot.objects.size(); ++j)
+		{
+			single.objects[0] = snapshot.objects[j];
+			PickingIndex singleIndex;
+			singleIndex.build(single);
+			PickingIndex::Hit singleHit;
+			if (singleIndex.pick(ray, singleHit, 1e6, 0.2) && singleHit.object && singleHit.t <= closestT)
+			{
+				closest = singleHit.object;
+				closestT = singleHit.t;
+			}
+		}
+		CHECK(found, "ray " << i << " hits something");
+		CHECK(hit.object == closest, "ray " << i << " hits the closest object");
+		CHECK(fabs(hit.t - closestT) < 1e-9, "ray " << i << " hit distance");
+	}
+}
+
+int main()
+{
+	testGround();
+	testShapes();
+	testSnapshot();
+	testAgainstBruteForce();
+	return 0;
+}
@@ -0,0 +1,192 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#include "../enki/PhysicalEngine.h"
+#include "../enki/Scene.h"
+#include "../enki/robots/e-puck/EPuck.h"
+#include "../enki/robots/thymio2/Thymio2.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <cstdio>
+#include <cmath>
+
+using namespace Enki;
+using namespace std;
+
+#define CHECK(cond, message) \
+	if (!(cond)) { \
+		cerr << #cond << " failed: " << message << endl; \
+		exit(1); \
+	}
+
+const char* sceneText =
+	"# a test arena\n"
+	"world square 120 80 0.5 0.6 0.7\n"
+	"ground testScene.ppm\n"
+	"shape pillar cylinder 3 5 -1\n"
+	"shape crate box 4 2 3 10\n"
+	"shape ramp hull 2 -1   0 0  8 0  8 4  # a triangle\n"
+	"\n"
+	"epuck 20 20 0.5\n"
+	"thymio2 40 20 -1 1 0 0\n"
+	"object pillar 60 40 0\n"
+	"object crate 70 40 1 0 0 1 0.5\n"
+	"object ramp 90 10 0\n"
+	"object crate 10 70 0\n";
+
+//! Return whether c has the components r, g, b, a
+bool isColor(const Color& c, double r, double g, double b, double a = 1)
+{
+	return c.components[0] == r && c.components[1] == g && c.components[2] == b && c.components[3] == a;
+}
+
+//! Check that the world built from scene matches sceneText
+void checkWorld(const Scene& scene)
+{
+	unique_ptr<World> world(scene.createWorld());
+	CHECK(world->wallsType == World::WALLS_SQUARE && world->w == 120 && world->h == 80, "walls");
+	CHECK(isColor(world->color, 0.5, 0.6, 0.7), "walls color");
+	CHECK(world->groundTexture.width == 2 && world->groundTexture.height == 1, "ground size");
+	CHECK(world->groundTexture.data[0] == 0xffff0000 && world->groundTexture.data[1] == 0xff00ff00, "ground pixels");
+	CHECK(world->objects.size() == 6, "object count " << world->objects.size());
+	
+	vector<PhysicalObject*> objects(world->objects.begin(), world->objects.end());
+	CHECK(dynamic_cast<EPuck*>(objects[0]), "first object is an e-puck");
+	CHECK(objects[0]->pos.x == 20 && objects[0]->pos.y == 20 && objects[0]->angle == 0.5, "e-puck pose");
+	CHECK(dynamic_cast<Thymio2*>(objects[1]), "second object is a Thymio II");
+	CHECK(isColor(objects[1]->getColor(), 1, 0, 0), "Thymio II color");
+	CHECK(objects[2]->getMass() < 0 && objects[2]->getRadius() == 3 && objects[2]->getHeight() == 5, "pillar shape");
+	CHECK(objects[3]->getMass() == 10 && isColor(objects[3]->getColor(), 0, 0, 1, 0.5), "crate");
+	CHECK(objects[4]->getHull().size() == 1 && objects[4]->getHull()[0].getShape().size() == 3, "ramp hull");
+	CHECK(&objects[3]->getHull()[0].getShape() == &objects[5]->getHull()[0].getShape(), "objects of a shape share their hull");
+	
+	world->step(0.1, 3);
+	CHECK(objects[2]->pos.x == 60 && objects[2]->pos.y == 40, "static objects do not move");
+}
+
+//! Parse errors report their line
+void checkError(const string& text, const string& expected)
+{
+	istringstream stream(text);
+	try
+	{
+		Scene scene(stream);
+	}
+	catch (const runtime_error& e)
+	{
+		CHECK(string(e.what()).find(expected) != string::npos, "unexpected error " << e.what());
+		return;
+	}
+	CHECK(false, "no error for " << text);
+}
+
+int main()
+{
+	{
+		ofstream ppm("testScene.ppm");
+		ppm << "P3\n# red and green\n2 1\n255\n255 0 0  0 255 0\n";
+	}
+	{
+		ofstream file("testScene.txt");
+		file << sceneText;
+	}
+	
+	// text form
+	Scene textScene("testScene.txt");
+	CHECK(textScene.getHeader().objectCount == 6 && textScene.getHeader().typeCount == 2 && textScene.getHeader().shapeCount == 3, "counts");
+	checkWorld(textScene);
+	
+	// binary form, mapped
+	textScene.save("testScene.bin");
+	{
+		Scene binaryScene("testScene.bin");
+		checkWorld(binaryScene);
+	}
+	
+	// custom factories
+	{
+		unique_ptr<World> world(new World);
+		Scene::ObjectFactories factories;
+		factories["epuck"] = [] () -> PhysicalObject* { return new EPuck(EPuck::CAPABILITY_BASIC_SENSORS | EPuck::CAPABILITY_CAMERA); };
+		textScene.addObjects(world.get(), factories);
+		CHECK(dynamic_cast<EPuck*>(*world->objects.begin())->getLocalInteractions().size() > EPuck().getLocalInteractions().size(), "custom factory used");
+	}
+	
+	// unknown types leave the world unchanged
+	{
+		istringstream stream("epuck 0 0 0\nroomba 1 1 0\n");
+		Scene scene(stream);
+		World world;
+		bool thrown(false);
+		try
+		{
+			scene.addObjects(&world);
+		}
+		catch (const runtime_error&)
+		{
+			thrown = true;
+		}
+		CHECK(thrown && world.objects.empty(), "unknown type");
+	}
+	
+	checkError("world hexagonal 3\n", "line 1: unknown walls type");
+	checkError("\nobject pillar 0 0 0\n", "line 2: unknown shape");
+	checkError("shape a hull 1 1 0 0 1 0\n", "at least 3 vertices");
+	checkError("shape a hull 1 1 0 0 0 1 1 0\n", "convex and counter-clockwise");
+	checkError("epuck 0 0\n", "missing angle");
+	checkError("epuck 0 0 1 0.5\n", "missing green");
+	checkError("epuck 0 0 x\n", "invalid angle");
+	checkError("ground missing.ppm\n", "cannot open ground texture");
+	
+	// many objects
+	{
+		ostringstream text;
+		text << "world square 1000 1000\nshape pebble cylinder 1 1 1\n";
+		for (unsigned i = 0; i < 10000; ++i)
+			text << (i % 10 ? "object pebble " : "epuck ") << (i % 100) * 10 + 5 << ' ' << (i / 100) * 10 + 5 << " 0\n";
+		istringstream stream(text.str());
+		Scene scene(stream);
+		unique_ptr<World> world(scene.createWorld());
+		CHECK(world->objects.size() == 10000, "10000 objects");
+		CHECK((*world->objects.rbegin())->pos.x == 995 && (*world->objects.rbegin())->pos.y == 995, "last object");
+	}
+	
+	remove("testScene.ppm");
+	remove("testScene.txt");
+	remove("testScene.bin");
+	
+	return 0;
+}
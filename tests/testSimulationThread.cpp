@@ -0,0 +1,173 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#include "../enki/PhysicalEngine.h"
+#include "../enki/SimulationThread.h"
+#include "../enki/robots/e-puck/EPuck.h"
+#include "../enki/robots/thymio2/Thymio2.h"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <cmath>
+
+using namespace Enki;
+using namespace std;
+
+#define CHECK(cond, message) \
+	if (!(cond)) { \
+		cerr << #cond << " failed: " << message << endl; \
+		exit(1); \
+	}
+
+//! Snapshots taken by the reader are not modified by later publications
+void testSnapshotBuffer()
+{
+	World world(100, 100);
+	SnapshotBuffer buffer;
+	CHECK(!buffer.take(), "nothing published yet");
+	
+	buffer.getBack().capture(&world, 1);
+	buffer.publish();
+	CHECK(!buffer.isTaken(), "published snapshot not taken");
+	CHECK(buffer.take() && buffer.getFront().step == 1, "take first snapshot");
+	CHECK(buffer.isTaken(), "snapshot taken");
+	
+	for (uint64_t step = 2; step < 10; ++step)
+	{
+		buffer.getBack().capture(&world, step);
+		buffer.publish();
+		CHECK(buffer.getFront().step == 1, "front snapshot unchanged while publishing");
+	}
+	CHECK(buffer.take() && buffer.getFront().step == 9, "take latest snapshot");
+	CHECK(!buffer.take() && buffer.getFront().step == 9, "no newer snapshot");
+}
+
+//! Snapshots hold the pose, odometry and LEDs of objects
+void testCapture()
+{
+	World world(100, 100);
+	EPuck* epuck(new EPuck);
+	epuck->pos = Point(10, 20);
+	epuck->angle = 0.5;
+	world.addObject(epuck);
+	Thymio2* thymio(new Thymio2);
+	thymio->setLedColor(Thymio2::TOP, Color::red);
+	world.addObject(thymio);
+	PhysicalObject* box(new PhysicalObject);
+	box->setRectangular(2, 2, 2, 1);
+	box->setColor(Color::blue);
+	world.addObject(box);
+	
+	epuck->leftSpeed = 5;
+	world.step(0.1);
+	
+	WorldSnapshot snapshot;
+	snapshot.capture(&world, 1, 0.1);
+	CHECK(snapshot.objects.size() == 3, "object count");
+	const WorldSnapshot::Object* state(snapshot.find(epuck));
+	CHECK(state && state->pos.x == epuck->pos.x && state->pos.y == epuck->pos.y && state->angle == epuck->angle, "e-puck pose");
+	CHECK(state->leftOdometry == epuck->leftOdometry && state->leftOdometry > 0, "e-puck odometry");
+	CHECK(state->ledCount == 0, "e-puck has no LEDs in snapshots");
+	state = snapshot.find(thymio);
+	CHECK(state && state->ledCount == Thymio2::LED_COUNT, "Thymio II LEDs");
+	CHECK(snapshot.leds[state->firstLed + Thymio2::TOP].r() == 1, "Thymio II top LED");
+	state = snapshot.find(box);
+	CHECK(state && state->color.b() == 1 && state->leftOdometry == 0, "box");
+	
+	world.removeObject(box);
+	snapshot.capture(&world);
+	CHECK(!snapshot.find(box), "removed object");
+	delete box;
+}
+
+//! The thread steps the world, applies posted functions and publishes snapshots
+void testThread()
+{
+	World world(100, 100);
+	EPuck* epuck(new EPuck);
+	epuck->pos = Point(50, 50);
+	world.addObject(epuck);
+	
+	SimulationThread simulation(&world, 0.01, 1);
+	simulation.post([] (World* world) { (*world->objects.begin())->angle = 1; });
+	CHECK(epuck->angle == 1, "functions are called immediately when not running");
+	
+	// as fast as possible, the reader getting fresh snapshots
+	simulation.setSpeed(0);
+	simulation.start();
+	CHECK(simulation.updateSnapshot() && simulation.getSnapshot().step == 0, "first snapshot");
+	uint64_t lastStep(0);
+	for (unsigned i = 0; i < 20; ++i)
+	{
+		this_thread::sleep_for(chrono::milliseconds(5));
+		if (simulation.updateSnapshot())
+		{
+			CHECK(simulation.getSnapshot().step >= lastStep, "snapshots are in order");
+			lastStep = simulation.getSnapshot().step;
+		}
+	}
+	CHECK(lastStep > 0, "snapshots follow the simulation");
+	
+	// posted functions are applied between steps
+	simulation.post([] (World* world) { PhysicalObject* object(*world->objects.begin()); object->pos = Point(20, 20); object->speed = Vector(); });
+	simulation.stop();
+	CHECK(!simulation.isRunning(), "stopped");
+	CHECK(fabs(epuck->pos.x - 20) < 1e-9 && fabs(epuck->pos.y - 20) < 1e-9, "posted function applied");
+	const uint64_t fastSteps(simulation.getStepCount());
+	CHECK(fastSteps > 20, "fast steps " << fastSteps);
+	
+	// real time, 10 times faster: a step of 10 ms every ms
+	simulation.setSpeed(10);
+	simulation.start();
+	this_thread::sleep_for(chrono::milliseconds(200));
+	simulation.stop();
+	const uint64_t realTimeSteps(simulation.getStepCount() - fastSteps);
+	CHECK(realTimeSteps > 50 && realTimeSteps < 250, "real-time steps " << realTimeSteps);
+	
+	// paused
+	simulation.setPaused(true);
+	simulation.start();
+	this_thread::sleep_for(chrono::milliseconds(50));
+	simulation.stop();
+	CHECK(simulation.getStepCount() - fastSteps == realTimeSteps, "no steps when paused");
+}
+
+int main()
+{
+	testSnapshotBuffer();
+	testCapture();
+	testThread();
+	
+	return 0;
+}
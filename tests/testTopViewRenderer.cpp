@@ -0,0 +1,183 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#include "../enki/PhysicalEngine.h"
+#include "../enki/TopViewRenderer.h"
+#include "../enki/robots/e-puck/EPuck.h"
+#include <iostream>
+#include <cmath>
+
+using namespace Enki;
+using namespace std;
+
+#define CHECK(cond, message) \
+	if (!(cond)) { \
+		cerr << #cond << " failed: " << message << endl; \
+		exit(1); \
+	}
+
+//! Return whether the pixel of renderer at the point p of the world has the color r, g, b
+static bool hasColor(const TopViewRenderer& renderer, const Point& p, int r, int g, int b)
+{
+	const Point pixel(renderer.toImage(p));
+	const uint8_t* rgba(renderer.getPixels() + (int(pixel.y) * renderer.getWidth() + int(pixel.x)) * 4);
+	return abs(rgba[0] - r) <= 1 && abs(rgba[1] - g) <= 1 && abs(rgba[2] - b) <= 1 && rgba[3] == 255;
+}
+
+//! Return the number of pixels of renderer with the color r, g, b
+static unsigned countColor(const TopViewRenderer& renderer, int r, int g, int b)
+{
+	unsigned count(0);
+	const uint8_t* rgba(renderer.getPixels());
+	for (unsigned i = 0; i < renderer.getWidth() * renderer.getHeight(); ++i, rgba += 4)
+		if (rgba[0] == r && rgba[1] == g && rgba[2] == b)
+			++count;
+	return count;
+}
+
+//! The ground, walls and outside of square and circular worlds
+void testBackground()
+{
+	World square(100, 50, Color::gray);
+	TopViewRenderer renderer(200, 200);
+	renderer.render(&square);
+	CHECK(hasColor(renderer, Point(50, 25), 128, 128, 128), "ground");
+	CHECK(hasColor(renderer, Point(-1, 25), 77, 77, 77), "walls");
+	CHECK(hasColor(renderer, Point(50, 40 + 25), 255, 255, 255), "outside");
+	CHECK(fabs(renderer.toImage(Point(50, 25)).x - 100) < 1e-9 && fabs(renderer.toImage(Point(50, 25)).y - 100) < 1e-9, "world centered");
+	
+	World circle(20, Color::red);
+	renderer.render(&circle);
+	CHECK(hasColor(renderer, Point(0, 0), 255, 0, 0), "round ground");
+	CHECK(hasColor(renderer, Point(19, 19), 255, 255, 255), "outside of round walls");
+	
+	const uint32_t texture[4] = { 0xffff0000, 0xff00ff00, 0xff0000ff, 0xffffffff };
+	World textured(100, 100, Color::gray, World::GroundTexture(2, 2, texture));
+	renderer.render(&textured);
+	CHECK(hasColor(renderer, Point(25, 25), 255, 0, 0), "ground texture, first texel");
+	CHECK(hasColor(renderer, Point(75, 25), 0, 255, 0), "ground texture, second texel");
+	CHECK(hasColor(renderer, Point(25, 75), 0, 0, 255), "ground texture, second row");
+}
+
+//! Objects are drawn in their color, the highest on top, with textured sides outlined
+void testObjects()
+{
+	World world(100, 100, Color::gray);
+	PhysicalObject* low(new PhysicalObject);
+	low->pos = Point(50, 50);
+	low->setRectangular(40, 10, 1, -1);
+	low->setColor(Color::blue);
+	world.addObject(low);
+	PhysicalObject* high(new PhysicalObject);
+	high->pos = Point(50, 50);
+	high->setCylindric(4, 5, -1);
+	high->setColor(Color::red);
+	world.addObject(high);
+	
+	Polygon square;
+	square.push_back(Point(-5, -5));
+	square.push_back(Point(5, -5));
+	square.push_back(Point(5, 5));
+	square.push_back(Point(-5, 5));
+	Textures textures(4, Texture(1, Color::green));
+	PhysicalObject* textured(new PhysicalObject);
+	textured->pos = Point(20, 20);
+	textured->angle = M_PI / 4;
+	textured->setCustomHull(PhysicalObject::Hull(PhysicalObject::Part(square, 2, textures)), -1);
+	textured->setColor(Color::white);
+	world.addObject(textured);
+	
+	TopViewRenderer renderer(300, 300);
+	renderer.render(&world);
+	CHECK(hasColor(renderer, Point(50, 50), 255, 0, 0), "highest object on top");
+	CHECK(hasColor(renderer, Point(65, 50), 0, 0, 255), "lowest object around");
+	CHECK(hasColor(renderer, Point(50, 58), 128, 128, 128), "ground beside objects");
+	CHECK(hasColor(renderer, Point(20, 20), 255, 255, 255), "textured object top");
+	CHECK(countColor(renderer, 0, 255, 0) > 40, "textured sides");
+	CHECK(hasColor(renderer, Point(24.5, 24.5), 128, 128, 128), "object rotated");
+	
+	// a fixed view
+	renderer.setView(46, 46, 54, 54);
+	renderer.render(&world);
+	CHECK(countColor(renderer, 128, 128, 128) == 0, "zoomed on objects");
+	renderer.fitWorld();
+	renderer.render(&world);
+	CHECK(hasColor(renderer, Point(90, 90), 128, 128, 128), "whole world again");
+}
+
+//! Rays of IR sensors are drawn from the sensors
+void testSensorRays()
+{
+	World world(100, 100, Color::gray);
+	EPuck* epuck(new EPuck);
+	epuck->pos = Point(50, 50);
+	world.addObject(epuck);
+	world.step(0.1);
+	
+	TopViewRenderer renderer(400, 400);
+	renderer.render(&world);
+	CHECK(countColor(renderer, 0, 255, 0) == 0, "no rays by default");
+	renderer.drawSensorRays = true;
+	renderer.render(&world);
+	CHECK(countColor(renderer, 0, 255, 0) > 50, "free rays drawn in green");
+}
+
+//! Many robots
+void testManyRobots()
+{
+	World world(400, 400, Color::gray);
+	for (unsigned i = 0; i < 1000; ++i)
+	{
+		EPuck* epuck(new EPuck);
+		epuck->pos = Point(10 + (i % 32) * 12, 10 + (i / 32) * 12);
+		world.addObject(epuck);
+	}
+	TopViewRenderer renderer(512, 512);
+	renderer.drawSensorRays = true;
+	for (unsigned i = 0; i < 10; ++i)
+	{
+		world.step(0.1);
+		renderer.render(&world);
+	}
+	CHECK(countColor(renderer, 128, 128, 128) < 512 * 512, "robots drawn");
+}
+
+int main()
+{
+	testBackground();
+	testObjects();
+	testSensorRays();
+	testManyRobots();
+	return 0;
+}
@@ -0,0 +1,305 @@
+/*
+    Enki - a fast 2D robot simulator
+    Copyright (C) 1999-2016 Stephane Magnenat <stephane at magnenat dot net>
+    Copyright (C) 2004-2005 Markus Waibel <markus dot waibel at epfl dot ch>
+    Copyright (c) 2004-2005 Antoine Beyeler <abeyeler at ab-ware dot com>
+    Copyright (C) 2005-2006 Laboratory of Intelligent Systems, EPFL, Lausanne
+    Copyright (C) 2006-2008 Laboratory of Robotics Systems, EPFL, Lausanne
+    See AUTHORS for details
+
+    This program is free software; the authors of any publication 
+    arising from research using this software are asked to add the 
+    following reference:
+    Enki - a fast 2D robot simulator
+    http://home.gna.org/enki
+    Stephane Magnenat <stephane at magnenat dot net>,
+    Markus Waibel <markus dot waibel at epfl dot ch>
+    Laboratory of Intelligent Systems, EPFL, Lausanne.
+
+    You can redistribute this program and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#include "../enki/PhysicalEngine.h"
+#include "../enki/TrajectoryRecorder.h"
+#include "../enki/robots/e-puck/EPuck.h"
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <csignal>
+#endif
+
+using namespace Enki;
+using namespace std;
+
+#define CHECK(cond, message) \
+	if (!(cond)) { \
+		cerr << #cond << " failed: " << message << endl; \
+		exit(1); \
+	}
+
+//! Content of a trajectory file, decoded as a reader would
+struct Trajectory
+{
+	TrajectoryRecorder::FileHeader header;
+	vector<TrajectoryRecorder::ColumnHeader> columns;
+	vector<uint32_t> uids;
+	vector<uint8_t> data;
+	
+	//! Read the whole file
+	Trajectory(const string& fileName)
+	{
+		ifstream file(fileName.c_str(), ios::binary);
+		data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+		CHECK(data.size() >= sizeof(header), "file is too short");
+		memcpy(&header, &data[0], sizeof(header));
+		CHECK(strcmp(header.magic, "ENKITRJ") == 0, "wrong magic");
+		columns.resize(header.columnCount);
+		memcpy(&columns[0], &data[sizeof(header)], columns.size() * sizeof(columns[0]));
+		uids.resize(header.objectCount);
+		memcpy(&uids[0], &data[sizeof(header) + columns.size() * sizeof(columns[0])], uids.size() * sizeof(uint32_t));
+	}
+	
+	//! Return the column of name
+	const TrajectoryRecorder::ColumnHeader& column(const string& name) const
+	{
+		for (size_t i = 0; i < columns.size(); ++i)
+			if (name == columns[i].name)
+				return columns[i];
+		CHECK(false, "no column " << name);
+		return columns[0];
+	}
+	
+	//! Return the decoded doubles of column name, row after row
+	vector<double> doubles(const string& name) const
+	{
+		const TrajectoryRecorder::ColumnHeader& c(column(name));
+		const size_t rowSize(size_t(c.count) * c.width);
+		vector<double> values;
+		for (uint64_t row = 0; row < header.rowCount; ++row)
+		{
+			const uint8_t* chunk(&data[header.headerSize + (row / header.chunkRows) * header.chunkSize]);
+			const unsigned rowInChunk(row % header.chunkRows);
+			for (size_t j = 0; j < rowSize; ++j)
+			{
+				if (c.type == TrajectoryRecorder::TYPE_FLOAT64)
+				{
+					double value;
+					memcpy(&value, chunk + c.offset + (rowInChunk * rowSize + j) * sizeof(double), sizeof(double));
+					values.push_back(value);
+				}
+				else
+				{
+					// accumulate deltas from the key row
+					double value;
+					memcpy(&value, chunk + c.keyOffset + j * sizeof(double), sizeof(double));
+					for (unsigned r = 0; r <= rowInChunk; ++r)
+					{
+						float delta;
+						memcpy(&delta, chunk + c.offset + (r * rowSize + j) * sizeof(float), sizeof(float));
+						value += double(delta);
+					}
+					values.push_back(value);
+				}
+			}
+		}
+		return values;
+	}
+};
+
+//! Record the values the recorder should write after each step
+struct Expectation: public StepObserver
+{
+	vector<double> time, pose, wheels, ir;
+	vector<uint8_t> camera;
+	double t;
+	
+	Expectation() : t(0) {}
+	
+	virtual void worldStepped(World* world, double dt)
+	{
+		t += dt;
+		time.push_back(t);
+		for (World::ObjectsIterator it = world->objects.begin(); it != world->objects.end(); ++it)
+		{
+			pose.push_back((*it)->pos.x);
+			pose.push_back((*it)->pos.y);
+			pose.push_back((*it)->angle);
+			EPuck* epuck(dynamic_cast<EPuck*>(*it));
+			wheels.push_back(epuck ? epuck->leftSpeed : NAN);
+			wheels.push_back(epuck ? epuck->rightSpeed : NAN);
+			const IRSensor* sensors[] = { &epuck->infraredSensor0, &epuck->infraredSensor1, &epuck->infraredSensor2, &epuck->infraredSensor3, &epuck->infraredSensor4, &epuck->infraredSensor5, &epuck->infraredSensor6, &epuck->infraredSensor7 };
+			for (size_t i = 0; i < 8; ++i)
+				ir.push_back(epuck ? sensors[i]->getValue() : NAN);
+			for (size_t i = 0; i < 60 * 4; ++i)
+				camera.push_back(epuck ? uint8_t(epuck->camera.image[i / 4].components[i % 4] * 255. + 0.5) : 0);
+		}
+	}
+};
+
+//! Return whether a and b are equal up to a tolerance relative to the largest value of b, NaN being equal to NaN
+bool sameValues(const vector<double>& a, const vector<double>& b, double tolerance)
+{
+	if (a.size() != b.size())
+		return false;
+	double scale(1);
+	for (size_t i = 0; i < b.size(); ++i)
+		if (!std::isnan(b[i]))
+			scale = max(scale, fabs(b[i]));
+	for (size_t i = 0; i < a.size(); ++i)
+		if ((std::isnan(a[i]) != std::isnan(b[i])) || (!std::isnan(a[i]) && fabs(a[i] - b[i]) > tolerance * scale))
+			return false;
+	return true;
+}
+
+//! Create a world with e-pucks running in circles and a box
+World* createWorld()
+{
+	World* world = new World(60, 60);
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		EPuck* epuck = new EPuck(EPuck::CAPABILITY_BASIC_SENSORS | EPuck::CAPABILITY_CAMERA);
+		epuck->pos = Point(10 + 12 * i, 30);
+		epuck->angle = i;
+		epuck->leftSpeed = 10 + i;
+		epuck->rightSpeed = 6;
+		world->addObject(epuck);
+	}
+	PhysicalObject* box = new PhysicalObject;
+	box->setRectangular(4, 4, 4, 10);
+	box->pos = Point(30, 40);
+	world->addObject(box);
+	return world;
+}
+
+void testRecording(bool deltaEncoding)
+{
+	const string fileName(deltaEncoding ? "testTrajectoryDelta.trj" : "testTrajectory.trj");
+	const unsigned steps = 23, chunkRows = 5;
+	World* world = createWorld();
+	TrajectoryRecorder* recorder = new TrajectoryRecorder(world, fileName, TrajectoryRecorder::CHANNELS_ALL, chunkRows, deltaEncoding);
+	Expectation expectation;
+	world->addStepObserver(&expectation);
+	for (unsigned step = 0; step < steps; ++step)
+		world->step(0.1, 3);
+	CHECK(recorder->getRowCount() == steps, "recorder wrote " << recorder->getRowCount() << " rows");
+	
+	// the file is readable while being written
+	{
+		Trajectory trajectory(fileName);
+		CHECK(trajectory.header.rowCount == steps, "header has " << trajectory.header.rowCount << " rows");
+		CHECK(trajectory.header.objectCount == 5, "header has " << trajectory.header.objectCount << " objects");
+		CHECK(trajectory.columns.size() == 6, "file has " << trajectory.columns.size() << " columns");
+		CHECK(trajectory.data.size() == trajectory.header.headerSize + 5 * trajectory.header.chunkSize, "file does not hold 5 whole chunks");
+	}
+	
+	// steps after close() are not recorded
+	delete recorder;
+	world->removeStepObserver(&expectation);
+	world->step(0.1, 3);
+	Trajectory trajectory(fileName);
+	CHECK(trajectory.header.rowCount == steps, "step after close was recorded");
+	
+	size_t i = 0;
+	for (World::ObjectsIterator it = world->objects.begin(); it != world->objects.end(); ++it, ++i)
+		CHECK(trajectory.uids[i] == (*it)->uid, "uid of object " << i << " is " << trajectory.uids[i]);
+	
+	const double tolerance(deltaEncoding ? 1e-6 : 0);
+	CHECK(sameValues(trajectory.doubles("time"), expectation.time, 1e-12), "time differs");
+	CHECK(sameValues(trajectory.doubles("pose"), expectation.pose, tolerance), "poses differ");
+	CHECK(sameValues(trajectory.doubles("wheels"), expectation.wheels, tolerance), "wheel commands differ");
+	CHECK(sameValues(trajectory.doubles("ir"), expectation.ir, tolerance), "IR values differ");
+	CHECK(trajectory.column("ir").width == 8, "IR column has " << trajectory.column("ir").width << " values per object");
+	
+	const TrajectoryRecorder::ColumnHeader& camera(trajectory.column("camera"));
+	CHECK(camera.type == TrajectoryRecorder::TYPE_UINT8 && camera.width == 60 * 4, "camera column has a wrong type");
+	for (uint64_t row = 0; row < steps; ++row)
+	{
+		const uint8_t* pixels(&trajectory.data[trajectory.header.headerSize + (row / chunkRows) * trajectory.header.chunkSize + camera.offset + (row % chunkRows) * 5 * camera.width]);
+		CHECK(equal(pixels, pixels + 5 * camera.width, expectation.camera.begin() + row * 5 * camera.width), "camera images differ at row " << row);
+	}
+	
+	delete world;
+	remove(fileName.c_str());
+}
+
+void testRemovedObjects()
+{
+	const string fileName("testTrajectoryRemoved.trj");
+	World* world = createWorld();
+	PhysicalObject* removed = *world->objects.begin();
+	{
+		TrajectoryRecorder recorder(world, fileName, TrajectoryRecorder::CHANNEL_POSE);
+		world->step(0.1);
+		world->removeObject(removed);
+		world->step(0.1);
+	}
+	CHECK(world->stepObservers.empty(), "recorder did not unregister itself");
+	delete removed;
+	
+	Trajectory trajectory(fileName);
+	CHECK(trajectory.columns.size() == 2, "file has " << trajectory.columns.size() << " columns");
+	const vector<double> poses(trajectory.doubles("pose"));
+	CHECK(poses.size() == 2 * 5 * 3, "file has " << poses.size() << " pose values");
+	CHECK(!std::isnan(poses[0]) && std::isnan(poses[15]), "removed object is not NaN");
+	CHECK(!std::isnan(poses[18]), "object after removed one is NaN");
+	
+	delete world;
+	remove(fileName.c_str());
+}
+
+void testFileSizeLimit()
+{
+	#ifndef _WIN32
+	// the file cannot grow beyond 64 KiB, and growing it fails instead of raising SIGXFSZ
+	const string fileName("testTrajectoryLimit.trj");
+	World* world = createWorld();
+	rlimit previousLimit;
+	getrlimit(RLIMIT_FSIZE, &previousLimit);
+	rlimit limit(previousLimit);
+	limit.rlim_cur = 64 * 1024;
+	signal(SIGXFSZ, SIG_IGN);
+	setrlimit(RLIMIT_FSIZE, &limit);
+	{
+		TrajectoryRecorder recorder(world, fileName, TrajectoryRecorder::CHANNEL_POSE, 1);
+		for (unsigned step = 0; step < 100; ++step)
+			world->step(0.1);
+		CHECK(!recorder.getError().empty(), "recorder did not report that the file could not grow");
+		CHECK(recorder.getRowCount() > 0 && recorder.getRowCount() < 100, "recorder wrote " << recorder.getRowCount() << " rows");
+		CHECK(world->stepObservers.empty(), "recorder did not stop observing the world");
+	}
+	setrlimit(RLIMIT_FSIZE, &previousLimit);
+	signal(SIGXFSZ, SIG_DFL);
+	
+	delete world;
+	remove(fileName.c_str());
+	#endif // _WIN32
+}
+
+int main()
+{
+	testRecording(false);
+	testRecording(true);
+	testRemovedObjects();
+	testFileSizeLimit();
+	
+	return 0;
+}